@@ -4,9 +4,20 @@
 #include "event.h"
 #include "display.h"
 #include "axlib.h"
+#include <stdio.h>
 
 #define internal static
-#define AX_APPLICATION_RETRIES 10
+#define AX_APPLICATION_PROBE_DELAY 5
+#define AX_APPLICATION_PROBE_MAX_DELAY 1000
+#define AX_APPLICATION_PROBE_DEADLINE 10000
+#define AX_APPLICATION_READINESS_SAVE_DELAY 30000
+
+internal std::map<std::string, ax_application_launch> ApplicationLaunches;
+internal pthread_mutex_t ApplicationLaunchLock = PTHREAD_MUTEX_INITIALIZER;
+internal std::string ApplicationReadinessPath;
+internal bool ApplicationReadinessDirty;
+internal bool ApplicationReadinessScheduled;
+internal uint32_t ApplicationProbeDeadline = AX_APPLICATION_PROBE_DEADLINE;
 
 enum ax_application_notifications
 {
@@ -48,6 +59,34 @@ AXNotificationFromEnum(int Type)
     }
 }
 
+/* NOTE(koekeishiya): Every notification that AXApplicationCallback handles, recorded by index. */
+internal CFStringRef
+AXLibApplicationNotificationName(int Index)
+{
+    switch(Index)
+    {
+        case 0: { return kAXWindowCreatedNotification; } break;
+        case 1: { return kAXUIElementDestroyedNotification; } break;
+        case 2: { return kAXFocusedWindowChangedNotification; } break;
+        case 3: { return kAXWindowMiniaturizedNotification; } break;
+        case 4: { return kAXWindowDeminiaturizedNotification; } break;
+        case 5: { return kAXWindowMovedNotification; } break;
+        case 6: { return kAXWindowResizedNotification; } break;
+        case 7: { return kAXTitleChangedNotification; } break;
+        default: { return NULL; } break;
+    }
+}
+
+/* NOTE(koekeishiya): The reference of these notifications is the ax_window they were added for,
+ *                    the reference of every other notification is the ax_application. */
+internal inline bool
+AXLibIsWindowNotification(CFStringRef Notification)
+{
+    return CFEqual(Notification, kAXUIElementDestroyedNotification) ||
+           CFEqual(Notification, kAXWindowMiniaturizedNotification) ||
+           CFEqual(Notification, kAXWindowDeminiaturizedNotification);
+}
+
 internal inline ax_window *
 AXLibGetWindowByRef(ax_application *Application, AXUIElementRef WindowRef)
 {
@@ -62,7 +101,8 @@ AXLibDestroyInvalidWindow(ax_window *Window)
     AXLibDestroyWindow(Window);
 }
 
-internal OBSERVER_CALLBACK(AXApplicationCallback)
+internal void
+AXLibHandleApplicationNotification(AXUIElementRef Element, CFStringRef Notification, void *Reference)
 {
     ax_application *Application = (ax_application *) Reference;
 
@@ -74,13 +114,11 @@ internal OBSERVER_CALLBACK(AXApplicationCallback)
             AXLibAddApplicationWindow(Application, Window);
 
             /* NOTE(koekeishiya): Triggers an AXEvent_WindowCreated and passes a pointer to the new ax_window */
-            uint32_t *WindowID = (uint32_t *) malloc(sizeof(uint32_t));
-            *WindowID = Window->ID;
-            AXLibConstructEvent(AXEvent_WindowCreated, WindowID, false);
+            AXLibConstructEvent(AXEvent_WindowCreated, AXLibWindowPayload(Window->ID), false);
 
             /* NOTE(koekeishiya): When a new window is created, we incorrectly receive the kAXFocusedWindowChangedNotification
                                   first, for some reason. We discard that notification and restore it when we have the window to work with. */
-            AXApplicationCallback(Observer, Window->Ref, kAXFocusedWindowChangedNotification, Application);
+            AXLibHandleApplicationNotification(Window->Ref, kAXFocusedWindowChangedNotification, Application);
         }
         else
         {
@@ -98,9 +136,7 @@ internal OBSERVER_CALLBACK(AXApplicationCallback)
 
             /* NOTE(koekeishiya): The callback is responsible for calling AXLibDestroyWindow(Window);
                                   and AXLibRemoveApplicationWindow(Window->Application, Window->ID); */
-            uint32_t *WindowID = (uint32_t *) malloc(sizeof(uint32_t));
-            *WindowID = Window->ID;
-            AXLibConstructEvent(AXEvent_WindowDestroyed, WindowID, false);
+            AXLibConstructEvent(AXEvent_WindowDestroyed, AXLibWindowPayload(Window->ID), false);
         }
     }
     else if(CFEqual(Notification, kAXFocusedWindowChangedNotification))
@@ -145,9 +181,7 @@ internal OBSERVER_CALLBACK(AXApplicationCallback)
                    window is visible. Only notify our callback when we know that we can interact with the window in question. */
                 if(!AXLibHasFlags(Window, AXWindow_Minimized))
                 {
-                    uint32_t *WindowID = (uint32_t *) malloc(sizeof(uint32_t));
-                    *WindowID = Window->ID;
-                    AXLibConstructEvent(AXEvent_WindowFocused, WindowID, false);
+                    AXLibConstructEvent(AXEvent_WindowFocused, AXLibWindowPayload(Window->ID), false);
                 }
 
                 /* NOTE(koekeishiya): If the application corresponding to this window is flagged for activation and
@@ -157,9 +191,7 @@ internal OBSERVER_CALLBACK(AXApplicationCallback)
                     AXLibClearFlags(Window->Application, AXApplication_Activate);
                     if(!AXLibHasFlags(Window, AXWindow_Minimized))
                     {
-                        pid_t *ApplicationPID = (pid_t *) malloc(sizeof(pid_t));
-                        *ApplicationPID = Window->Application->PID;
-                        AXLibConstructEvent(AXEvent_ApplicationActivated, ApplicationPID, false);
+                        AXLibConstructEvent(AXEvent_ApplicationActivated, AXLibPIDPayload(Window->Application->PID), false);
                     }
                 }
             }
@@ -172,9 +204,7 @@ internal OBSERVER_CALLBACK(AXApplicationCallback)
         if(Window)
         {
             AXLibAddFlags(Window, AXWindow_Minimized);
-            uint32_t *WindowID = (uint32_t *) malloc(sizeof(uint32_t));
-            *WindowID = Window->ID;
-            AXLibConstructEvent(AXEvent_WindowMinimized, WindowID, false);
+            AXLibConstructEvent(AXEvent_WindowMinimized, AXLibWindowPayload(Window->ID), false);
         }
     }
     else if(CFEqual(Notification, kAXWindowDeminiaturizedNotification))
@@ -210,17 +240,11 @@ internal OBSERVER_CALLBACK(AXApplicationCallback)
             ax_display *Display = AXLibWindowDisplay(Window);
             if(AXLibSpaceHasWindow(Window, Display->Space->ID))
             {
-                uint32_t *WindowID = (uint32_t *) malloc(sizeof(uint32_t));
-                *WindowID = Window->ID;
-                AXLibConstructEvent(AXEvent_WindowDeminimized, WindowID, false);
+                AXLibConstructEvent(AXEvent_WindowDeminimized, AXLibWindowPayload(Window->ID), false);
 
-                pid_t *ApplicationPID = (pid_t *) malloc(sizeof(pid_t));
-                *ApplicationPID = Window->Application->PID;
-                AXLibConstructEvent(AXEvent_ApplicationActivated, ApplicationPID, false);
+                AXLibConstructEvent(AXEvent_ApplicationActivated, AXLibPIDPayload(Window->Application->PID), false);
 
-                WindowID = (uint32_t *) malloc(sizeof(uint32_t));
-                *WindowID = Window->ID;
-                AXLibConstructEvent(AXEvent_WindowFocused, WindowID, false);
+                AXLibConstructEvent(AXEvent_WindowFocused, AXLibWindowPayload(Window->ID), false);
             }
         }
     }
@@ -233,11 +257,9 @@ internal OBSERVER_CALLBACK(AXApplicationCallback)
             Window->Position = AXLibGetWindowPosition(Window->Ref);
 
             bool Intrinsic = AXLibHasFlags(Window, AXWindow_MoveIntrinsic);
-            uint32_t *WindowID = (uint32_t *) malloc(sizeof(uint32_t));
-            *WindowID = Window->ID;
 
             AXLibClearFlags(Window, AXWindow_MoveIntrinsic);
-            AXLibConstructEvent(AXEvent_WindowMoved, WindowID, Intrinsic);
+            AXLibConstructEvent(AXEvent_WindowMoved, AXLibWindowPayload(Window->ID), Intrinsic);
         }
     }
     else if(CFEqual(Notification, kAXWindowResizedNotification))
@@ -250,19 +272,96 @@ internal OBSERVER_CALLBACK(AXApplicationCallback)
             Window->Size = AXLibGetWindowSize(Window->Ref);
 
             bool Intrinsic = AXLibHasFlags(Window, AXWindow_SizeIntrinsic);
-            uint32_t *WindowID = (uint32_t *) malloc(sizeof(uint32_t));
-            *WindowID = Window->ID;
 
             AXLibClearFlags(Window, AXWindow_SizeIntrinsic);
-            AXLibConstructEvent(AXEvent_WindowResized, WindowID, Intrinsic);
+            AXLibConstructEvent(AXEvent_WindowResized, AXLibWindowPayload(Window->ID), Intrinsic);
         }
     }
     else if(CFEqual(Notification, kAXTitleChangedNotification))
     {
-        uint32_t *WindowID = (uint32_t *) malloc(sizeof(uint32_t));
-        *WindowID = AXLibGetWindowID(Element);
-        AXLibConstructEvent(AXEvent_WindowTitleChanged, WindowID, false);
+        AXLibConstructEvent(AXEvent_WindowTitleChanged, AXLibWindowPayload(AXLibGetWindowID(Element)), false);
+    }
+}
+
+internal AXUIElementRef NotificationElement;
+internal void *NotificationReference;
+
+/* NOTE(koekeishiya): Args holds the process id of the application, the index of the notification,
+ *                    and for a window notification the id of the window and its index in the
+ *                    NullWindows of the application, or -1. A replayed notification is given the
+ *                    recorded ax_window or ax_application, and an element from AXLibReplayElement. */
+EVENT_CALLBACK(AXLibApplicationNotification)
+{
+    CFStringRef Notification = AXLibApplicationNotificationName(Event->Payload.Args[1]);
+    if(!AXLibIsReplayingEvents())
+    {
+        AXLibHandleApplicationNotification(NotificationElement, Notification, NotificationReference);
+        return;
+    }
+
+    BeginAXLibApplications();
+    ax_application *Application = AXLibGetApplicationByPID(Event->Payload.Args[0]);
+    EndAXLibApplications();
+
+    if(!Application || !Notification)
+        return;
+
+    void *Reference = Application;
+    if(AXLibIsWindowNotification(Notification))
+    {
+        int NullWindow = Event->Payload.Args[3];
+        if(NullWindow == -1)
+            Reference = AXLibFindApplicationWindow(Application, (uint32_t) Event->Payload.Args[2]);
+        else if(NullWindow < Application->NullWindows.size())
+            Reference = Application->NullWindows[NullWindow];
+        else
+            Reference = NULL;
+    }
+
+    AXUIElementRef Element = AXLibReplayElement();
+    AXLibHandleApplicationNotification(Element, Notification, Reference);
+    CFRelease(Element);
+}
+
+internal OBSERVER_CALLBACK(AXApplicationCallback)
+{
+    int Index = 0;
+    while(AXLibApplicationNotificationName(Index) &&
+          !CFEqual(Notification, AXLibApplicationNotificationName(Index)))
+        ++Index;
+
+    if(!AXLibApplicationNotificationName(Index))
+        return;
+
+    ax_event Event = {};
+    Event.Name = "AXLibApplicationNotification";
+    Event.Handle = &AXLibApplicationNotification;
+    Event.Payload.Type = AXPayload_Args;
+    Event.Payload.Args[1] = Index;
+    Event.Payload.Args[3] = -1;
+
+    if(AXLibIsWindowNotification(Notification))
+    {
+        ax_window *Window = (ax_window *) Reference;
+        if(Window)
+        {
+            Event.Payload.Args[0] = Window->Application->PID;
+            Event.Payload.Args[2] = (int) Window->ID;
+            for(int NullWindow = 0; NullWindow < Window->Application->NullWindows.size(); ++NullWindow)
+            {
+                if(Window->Application->NullWindows[NullWindow] == Window)
+                    Event.Payload.Args[3] = NullWindow;
+            }
+        }
+    }
+    else
+    {
+        Event.Payload.Args[0] = ((ax_application *) Reference)->PID;
     }
+
+    NotificationElement = Element;
+    NotificationReference = Reference;
+    AXLibRunEventSource(&Event);
 }
 
 internal inline bool
@@ -327,14 +426,188 @@ ax_application *AXLibConstructApplication(pid_t PID, std::string Name)
 {
     ax_application *Application = new ax_application();
 
-    Application->Ref = AXUIElementCreateApplication(PID);
-    GetProcessForPID(PID, &Application->PSN);
+    Application->Ref = AXLibIsReplayingEvents() ? AXLibReplayElement() : AXUIElementCreateApplication(PID);
+    if(!AXLibReplayResponse(AXQuery_ProcessSerialNumber, &Application->PSN, sizeof(Application->PSN)))
+    {
+        GetProcessForPID(PID, &Application->PSN);
+        AXLibRecordResponse(AXQuery_ProcessSerialNumber, &Application->PSN, sizeof(Application->PSN));
+    }
     Application->Name = Name;
     Application->PID = PID;
 
     return Application;
 }
 
+/* NOTE(koekeishiya): Recorded, so that a replayed launch takes the same decisions. */
+internal inline uint64_t
+AXLibGetApplicationLaunchElapsed(ax_application *Application)
+{
+    uint64_t Elapsed;
+    if(AXLibReplayResponse(AXQuery_ApplicationLaunchElapsed, &Elapsed, sizeof(Elapsed)))
+        return Elapsed;
+
+    Elapsed = (AXLibGetTimestamp() - Application->LaunchTime) / 1000000;
+    AXLibRecordResponse(AXQuery_ApplicationLaunchElapsed, &Elapsed, sizeof(Elapsed));
+    return Elapsed;
+}
+
+/* NOTE(koekeishiya): The table is copied under the lock and written without it, so that a
+ * launch that is learned meanwhile does not wait for the disk. */
+void AXLibSaveApplicationReadiness()
+{
+    pthread_mutex_lock(&ApplicationLaunchLock);
+    ApplicationReadinessScheduled = false;
+    if(!ApplicationReadinessDirty || ApplicationReadinessPath.empty() || AXLibIsReplayingEvents())
+    {
+        pthread_mutex_unlock(&ApplicationLaunchLock);
+        return;
+    }
+
+    std::string Path = ApplicationReadinessPath;
+    std::string Output;
+    std::map<std::string, ax_application_launch>::iterator It;
+    for(It = ApplicationLaunches.begin(); It != ApplicationLaunches.end(); ++It)
+        Output += std::to_string(It->second.ReadyDelay) + " " + It->first + "\n";
+
+    ApplicationReadinessDirty = false;
+    pthread_mutex_unlock(&ApplicationLaunchLock);
+
+    FILE *Handle = fopen(Path.c_str(), "w");
+    if(Handle)
+    {
+        fwrite(Output.c_str(), 1, Output.size(), Handle);
+        fclose(Handle);
+    }
+}
+
+EVENT_CALLBACK(AXLibSaveApplicationReadinessTimer)
+{
+    AXLibSaveApplicationReadiness();
+}
+
+/* NOTE(koekeishiya): Moving average, so that one slow launch (e.g. a cold disk cache) does not
+ * make every following launch wait. */
+internal void
+AXLibLearnApplicationReadiness(ax_application *Application, uint64_t Elapsed)
+{
+    pthread_mutex_lock(&ApplicationLaunchLock);
+    ax_application_launch *Launch = &ApplicationLaunches[Application->Name];
+    Launch->ReadyDelay = Launch->ReadyDelay ? (uint32_t) ((Launch->ReadyDelay * 3 + Elapsed) / 4)
+                                            : (uint32_t) Elapsed;
+    ++Launch->Launches;
+
+#ifdef DEBUG_BUILD
+    printf("AX: %s - Ready after %llums, learned %ums\n", Application->Name.c_str(),
+           (unsigned long long) Elapsed, Launch->ReadyDelay);
+#endif
+
+    /* NOTE(koekeishiya): Launches tend to come in bursts (login, restoring a session), so the
+     * learned delays are written back once, AX_APPLICATION_READINESS_SAVE_DELAY after the first
+     * change, instead of once per launch. */
+    ApplicationReadinessDirty = true;
+    bool Schedule = !ApplicationReadinessScheduled;
+    ApplicationReadinessScheduled = true;
+    pthread_mutex_unlock(&ApplicationLaunchLock);
+
+    if(Schedule)
+    {
+        ax_event Event = {};
+        Event.Name = "AXLibSaveApplicationReadiness";
+        Event.Lane = AXEventLane_Background;
+        Event.Payload = AXLibEmptyPayload();
+        Event.Handle = &AXLibSaveApplicationReadinessTimer;
+        AXLibScheduleEvent(Event, AX_APPLICATION_READINESS_SAVE_DELAY, 0);
+    }
+}
+
+/* NOTE(koekeishiya): The file holds one line per application: the learned delay followed
+ * by the name of the application. Learned delays are written back to it shortly after they
+ * change, and when AXLibSaveApplicationReadiness is called on exit. */
+bool AXLibLoadApplicationReadiness(std::string Path)
+{
+    pthread_mutex_lock(&ApplicationLaunchLock);
+    ApplicationReadinessPath = Path;
+
+    FILE *Handle = fopen(Path.c_str(), "r");
+    if(Handle)
+    {
+        char Line[512];
+        while(fgets(Line, sizeof(Line), Handle))
+        {
+            unsigned int ReadyDelay;
+            int Offset;
+            if(sscanf(Line, "%u %n", &ReadyDelay, &Offset) == 1)
+            {
+                std::string Name(Line + Offset);
+                if(!Name.empty() && Name[Name.size() - 1] == '\n')
+                    Name.erase(Name.size() - 1);
+
+                if(!Name.empty())
+                    ApplicationLaunches[Name].ReadyDelay = ReadyDelay;
+            }
+        }
+
+        fclose(Handle);
+    }
+
+    pthread_mutex_unlock(&ApplicationLaunchLock);
+    return Handle != NULL;
+}
+
+void AXLibSetApplicationProbeDeadline(uint32_t Milliseconds)
+{
+    ApplicationProbeDeadline = Milliseconds;
+}
+
+/* NOTE(koekeishiya): Called for an application that has just launched. The first probe is
+ * made a little before the application became ready the last time it launched, or after
+ * AX_APPLICATION_PROBE_DELAY if it has not been seen before. Every failed probe doubles
+ * the time until the next, up to AX_APPLICATION_PROBE_MAX_DELAY, until the deadline. */
+void AXLibProbeApplication(ax_application *Application)
+{
+    pthread_mutex_lock(&ApplicationLaunchLock);
+    std::map<std::string, ax_application_launch>::iterator It = ApplicationLaunches.find(Application->Name);
+    uint32_t Delay = It != ApplicationLaunches.end() ? It->second.ReadyDelay * 3 / 4 : 0;
+    pthread_mutex_unlock(&ApplicationLaunchLock);
+
+    if(Delay < AX_APPLICATION_PROBE_DELAY)
+        Delay = AX_APPLICATION_PROBE_DELAY;
+
+    Application->LaunchTime = AXLibGetTimestamp();
+    Application->ProbeDelay = AX_APPLICATION_PROBE_DELAY;
+    AXLibAddFlags(Application, AXApplication_Launching);
+    AXLibScheduleApplicationInitialization(Application->PID, Delay);
+}
+
+/* NOTE(koekeishiya): Called by user-code when it tiles a window, only the first window of an
+ * application that was launched while we were running is recorded. */
+void AXLibRecordApplicationTiled(ax_application *Application)
+{
+    if(!AXLibHasFlags(Application, AXApplication_Launching) ||
+       AXLibHasFlags(Application, AXApplication_Tiled))
+        return;
+
+    AXLibAddFlags(Application, AXApplication_Tiled);
+    uint64_t Elapsed = AXLibGetApplicationLaunchElapsed(Application);
+
+    pthread_mutex_lock(&ApplicationLaunchLock);
+    ax_application_launch *Launch = &ApplicationLaunches[Application->Name];
+    ++Launch->Tiles;
+    Launch->LastTile = Elapsed;
+    Launch->TotalTile += Elapsed;
+    if(Elapsed > Launch->MaxTile)
+        Launch->MaxTile = Elapsed;
+    pthread_mutex_unlock(&ApplicationLaunchLock);
+}
+
+std::map<std::string, ax_application_launch> AXLibGetApplicationLaunchStatistics()
+{
+    pthread_mutex_lock(&ApplicationLaunchLock);
+    std::map<std::string, ax_application_launch> Result = ApplicationLaunches;
+    pthread_mutex_unlock(&ApplicationLaunchLock);
+    return Result;
+}
+
 bool AXLibInitializeApplication(pid_t PID)
 {
     BeginAXLibApplications();
@@ -348,29 +621,42 @@ bool AXLibInitializeApplication(pid_t PID)
         {
             AXLibAddApplicationWindows(Application);
             Application->Focus = AXLibGetFocusedWindow(Application);
+
+            if(AXLibHasFlags(Application, AXApplication_Launching))
+                AXLibLearnApplicationReadiness(Application, AXLibGetApplicationLaunchElapsed(Application));
         }
         else
         {
             AXLibRemoveApplicationObserver(Application);
-            if(++Application->Retries < AX_APPLICATION_RETRIES)
+            if(Application->LaunchTime == 0)
+            {
+                Application->LaunchTime = AXLibGetTimestamp();
+                Application->ProbeDelay = AX_APPLICATION_PROBE_DELAY;
+            }
+
+            uint64_t Elapsed = AXLibGetApplicationLaunchElapsed(Application);
+            if(Elapsed < ApplicationProbeDeadline)
             {
+                uint32_t Delay = Application->ProbeDelay;
+                if(Delay > ApplicationProbeDeadline - Elapsed)
+                    Delay = (uint32_t) (ApplicationProbeDeadline - Elapsed);
+
+                Application->ProbeDelay *= 2;
+                if(Application->ProbeDelay > AX_APPLICATION_PROBE_MAX_DELAY)
+                    Application->ProbeDelay = AX_APPLICATION_PROBE_MAX_DELAY;
+
 #ifdef DEBUG_BUILD
-                printf("AX: %s - Not responding, retry %d\n", Application->Name.c_str(), Application->Retries);
+                printf("AX: %s - Not responding after %llums, retry in %ums\n", Application->Name.c_str(),
+                       (unsigned long long) Elapsed, Delay);
 #endif
-                dispatch_after(dispatch_time(DISPATCH_TIME_NOW, 1 * NSEC_PER_SEC), dispatch_get_main_queue(),
-                ^{
-                    if(AXLibInitializeApplication(PID))
-                        AXLibInitializedApplication(Application);
-                });
+                AXLibScheduleApplicationInitialization(PID, Delay);
             }
             else
             {
 #ifdef DEBUG_BUILD
                 printf("AX: %s did not respond, remove application reference\n", Application->Name.c_str());
 #endif
-                pid_t *ApplicationPID = (pid_t *) malloc(sizeof(pid_t));
-                *ApplicationPID = Application->PID;
-                AXLibConstructEvent(AXEvent_ApplicationTerminated, ApplicationPID, false);
+                AXLibConstructEvent(AXEvent_ApplicationTerminated, AXLibPIDPayload(Application->PID), false);
             }
         }
 
@@ -380,11 +666,34 @@ bool AXLibInitializeApplication(pid_t PID)
     return false;
 }
 
+EVENT_CALLBACK(AXLibInitializeApplicationTimer)
+{
+    if(AXLibInitializeApplication(Event->Payload.PID))
+    {
+        BeginAXLibApplications();
+        ax_application *Application = AXLibGetApplicationByPID(Event->Payload.PID);
+        EndAXLibApplications();
+
+        if(Application)
+            AXLibInitializedApplication(Application);
+    }
+}
+
+/* NOTE(koekeishiya): Applications do not respond to the accessibility API right after they
+ * launch, so initialization is retried on the event loop after a delay, in milliseconds. */
+void AXLibScheduleApplicationInitialization(pid_t PID, uint32_t Delay)
+{
+    ax_event Event = {};
+    Event.Name = "AXLibInitializeApplication";
+    Event.Lane = AXEventLane_Background;
+    Event.Payload = AXLibPIDPayload(PID);
+    Event.Handle = &AXLibInitializeApplicationTimer;
+    AXLibScheduleEvent(Event, Delay, 0);
+}
+
 void AXLibInitializedApplication(ax_application *Application)
 {
-    pid_t *ApplicationPID = (pid_t *) malloc(sizeof(pid_t));
-    *ApplicationPID = Application->PID;
-    AXLibConstructEvent(AXEvent_ApplicationLaunched, ApplicationPID, false);
+    AXLibConstructEvent(AXEvent_ApplicationLaunched, AXLibPIDPayload(Application->PID), false);
 
     if((!Application->Focus) ||
        (AXLibHasFlags(Application->Focus, AXWindow_Minimized)))
@@ -393,36 +702,46 @@ void AXLibInitializedApplication(ax_application *Application)
     }
     else
     {
-        pid_t *ApplicationPID = (pid_t *) malloc(sizeof(pid_t));
-        *ApplicationPID = Application->PID;
-        AXLibConstructEvent(AXEvent_ApplicationActivated, ApplicationPID, false);
+        AXLibConstructEvent(AXEvent_ApplicationActivated, AXLibPIDPayload(Application->PID), false);
     }
 }
 
+/* NOTE(koekeishiya): Only the number of windows is recorded, a replayed window is an element
+ *                    from AXLibReplayElement. */
 void AXLibAddApplicationWindows(ax_application *Application)
 {
-    CFArrayRef Windows = (CFArrayRef) AXLibGetWindowProperty(Application->Ref, kAXWindowsAttribute);
-    if(Windows)
+    CFArrayRef Windows = NULL;
+    uint32_t Count = 0;
+    if(!AXLibReplayResponse(AXQuery_ApplicationWindows, &Count, sizeof(Count)))
+    {
+        Windows = (CFArrayRef) AXLibGetWindowProperty(Application->Ref, kAXWindowsAttribute);
+        Count = Windows ? (uint32_t) CFArrayGetCount(Windows) : 0;
+        AXLibRecordResponse(AXQuery_ApplicationWindows, &Count, sizeof(Count));
+    }
+
+    for(uint32_t Index = 0; Index < Count; ++Index)
     {
-        CFIndex Count = CFArrayGetCount(Windows);
-        for(CFIndex Index = 0; Index < Count; ++Index)
+        AXUIElementRef Ref = Windows ? (AXUIElementRef) CFArrayGetValueAtIndex(Windows, Index)
+                                     : AXLibReplayElement();
+        if(!AXLibGetWindowByRef(Application, Ref))
         {
-            AXUIElementRef Ref = (AXUIElementRef) CFArrayGetValueAtIndex(Windows, Index);
-            if(!AXLibGetWindowByRef(Application, Ref))
+            ax_window *Window = AXLibConstructWindow(Application, Ref);
+            if(AXLibAddObserverNotification(&Application->Observer, Window->Ref, kAXUIElementDestroyedNotification, Window) == kAXErrorSuccess)
             {
-                ax_window *Window = AXLibConstructWindow(Application, Ref);
-                if(AXLibAddObserverNotification(&Application->Observer, Window->Ref, kAXUIElementDestroyedNotification, Window) == kAXErrorSuccess)
-                {
-                    AXLibAddApplicationWindow(Application, Window);
-                }
-                else
-                {
-                    AXLibDestroyWindow(Window);
-                }
+                AXLibAddApplicationWindow(Application, Window);
+            }
+            else
+            {
+                AXLibDestroyWindow(Window);
             }
         }
-        CFRelease(Windows);
+
+        if(!Windows)
+            CFRelease(Ref);
     }
+
+    if(Windows)
+        CFRelease(Windows);
 }
 
 void AXLibRemoveApplicationWindows(ax_application *Application)
@@ -479,17 +798,30 @@ void AXLibRemoveApplicationWindow(ax_application *Application, uint32_t WID)
 
 void AXLibActivateApplication(ax_application *Application)
 {
-    SharedWorkspaceActivateApplication(Application->PID);
+    if(!AXLibIsReplayingEvents())
+        SharedWorkspaceActivateApplication(Application->PID);
 }
 
 bool AXLibIsApplicationActive(ax_application *Application)
 {
-    return SharedWorkspaceIsApplicationActive(Application->PID);
+    bool Result;
+    if(AXLibReplayResponse(AXQuery_ApplicationActive, &Result, sizeof(Result)))
+        return Result;
+
+    Result = SharedWorkspaceIsApplicationActive(Application->PID);
+    AXLibRecordResponse(AXQuery_ApplicationActive, &Result, sizeof(Result));
+    return Result;
 }
 
 bool AXLibIsApplicationHidden(ax_application *Application)
 {
-    return SharedWorkspaceIsApplicationHidden(Application->PID);
+    bool Result;
+    if(AXLibReplayResponse(AXQuery_ApplicationHidden, &Result, sizeof(Result)))
+        return Result;
+
+    Result = SharedWorkspaceIsApplicationHidden(Application->PID);
+    AXLibRecordResponse(AXQuery_ApplicationHidden, &Result, sizeof(Result));
+    return Result;
 }
 
 void AXLibDestroyApplication(ax_application *Application)
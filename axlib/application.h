@@ -10,6 +10,7 @@
 
 #include "window.h"
 #include "observer.h"
+#include "event.h"
 
 typedef std::map<uint32_t, ax_window *> ax_window_map;
 typedef std::map<uint32_t, ax_window *>::iterator ax_window_map_iter;
@@ -20,6 +21,21 @@ enum ax_application_flags
     AXApplication_PrepIgnoreFocus = (1 << 1),
     AXApplication_IgnoreFocus = (1 << 2),
     AXApplication_RestoreFocus = (1 << 3),
+    AXApplication_Launching = (1 << 4),
+    AXApplication_Tiled = (1 << 5),
+};
+
+/* NOTE(koekeishiya): Launch statistics per application name. ReadyDelay is the learned time from
+ *                    launch until the application responds to the accessibility API, and is kept
+ *                    across launches. All times are in milliseconds. */
+struct ax_application_launch
+{
+    uint32_t ReadyDelay;
+    uint32_t Launches;
+    uint32_t Tiles;
+    uint64_t LastTile;
+    uint64_t MaxTile;
+    uint64_t TotalTile;
 };
 
 struct ax_application
@@ -32,7 +48,8 @@ struct ax_application
     ax_observer Observer;
     uint32_t Flags;
     uint32_t Notifications;
-    unsigned int Retries;
+    uint64_t LaunchTime;
+    uint32_t ProbeDelay;
 
     ax_window *Focus;
     ax_window_map Windows;
@@ -62,7 +79,17 @@ ax_application *AXLibConstructApplication(pid_t PID, std::string Name);
 void AXLibDestroyApplication(ax_application *Application);
 
 bool AXLibInitializeApplication(pid_t PID);
+EVENT_CALLBACK(AXLibApplicationNotification);
+EVENT_CALLBACK(AXLibInitializeApplicationTimer);
+EVENT_CALLBACK(AXLibSaveApplicationReadinessTimer);
 void AXLibInitializedApplication(ax_application *Application);
+void AXLibScheduleApplicationInitialization(pid_t PID, uint32_t Delay);
+void AXLibProbeApplication(ax_application *Application);
+void AXLibSetApplicationProbeDeadline(uint32_t Milliseconds);
+bool AXLibLoadApplicationReadiness(std::string Path);
+void AXLibSaveApplicationReadiness();
+void AXLibRecordApplicationTiled(ax_application *Application);
+std::map<std::string, ax_application_launch> AXLibGetApplicationLaunchStatistics();
 
 void AXLibAddApplicationWindows(ax_application *Application);
 void AXLibRemoveApplicationWindows(ax_application *Application);
@@ -1,5 +1,7 @@
 #include "axlib.h"
 #include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
 #include <vector>
 
 #define internal static
@@ -18,6 +20,13 @@ internal ax_application_map *AXApplications;
 internal pthread_mutex_t AXApplicationsMutex;
 
 internal std::map<CGDirectDisplayID, ax_display> *AXDisplays;
+internal bool AXStateInitialized;
+
+internal void
+AXLibCreateSystemWideElement(void *Context)
+{
+    *(AXUIElementRef *) Context = AXUIElementCreateSystemWide();
+}
 
 internal inline AXUIElementRef
 AXLibSystemWideElement()
@@ -25,10 +34,7 @@ AXLibSystemWideElement()
     local_persist AXUIElementRef AXLibSystemWideElement;
     local_persist dispatch_once_t OnceToken;
 
-    dispatch_once(&OnceToken, ^{
-        AXLibSystemWideElement = AXUIElementCreateSystemWide();
-    });
-
+    dispatch_once_f(&OnceToken, &AXLibSystemWideElement, &AXLibCreateSystemWideElement);
     return AXLibSystemWideElement;
 }
 
@@ -42,6 +48,50 @@ GetCursorPos()
     return Cursor;
 }
 
+CGPoint AXLibGetCursorPos()
+{
+    CGPoint Cursor;
+    if(AXLibReplayResponse(AXQuery_Cursor, &Cursor, sizeof(Cursor)))
+        return Cursor;
+
+    Cursor = GetCursorPos();
+    AXLibRecordResponse(AXQuery_Cursor, &Cursor, sizeof(Cursor));
+    return Cursor;
+}
+
+void AXLibSetCursorPos(CGPoint Cursor)
+{
+    if(!AXLibIsReplayingEvents())
+        CGWarpMouseCursorPosition(Cursor);
+}
+
+/* NOTE(koekeishiya): Only whether the element exists is recorded. A replayed handler gets an
+ *                    element from AXLibReplayElement, whose attributes are recorded separately. */
+internal AXUIElementRef
+AXLibGetElementProperty(AXUIElementRef Element, CFStringRef Property, ax_event_query Query)
+{
+    bool Found;
+    if(AXLibReplayResponse(Query, &Found, sizeof(Found)))
+        return Found ? AXLibReplayElement() : NULL;
+
+    AXUIElementRef Ref = (AXUIElementRef) AXLibGetWindowProperty(Element, Property);
+    Found = Ref != NULL;
+    AXLibRecordResponse(Query, &Found, sizeof(Found));
+    return Ref;
+}
+
+internal pid_t
+AXLibGetElementPID(AXUIElementRef Ref)
+{
+    pid_t PID = 0;
+    if(AXLibReplayResponse(AXQuery_ProcessID, &PID, sizeof(PID)))
+        return PID;
+
+    AXUIElementGetPid(Ref, &PID);
+    AXLibRecordResponse(AXQuery_ProcessID, &PID, sizeof(PID));
+    return PID;
+}
+
 internal bool
 IsPointInsideRect(CGPoint *Point, CGRect *Rect)
 {
@@ -72,12 +122,12 @@ ax_application *AXLibGetApplicationByPID(pid_t PID)
 /* NOTE(koekeishiya): Returns a pointer to the ax_application struct that is the current active application. */
 ax_application *AXLibGetFocusedApplication()
 {
-    AXUIElementRef Ref = (AXUIElementRef) AXLibGetWindowProperty(AXLibSystemWideElement(), kAXFocusedApplicationAttribute);
+    AXUIElementRef Ref = AXLibGetElementProperty(AXLibSystemWideElement(), kAXFocusedApplicationAttribute,
+                                                 AXQuery_FocusedApplication);
 
     if(Ref)
     {
-        pid_t PID;
-        AXUIElementGetPid(Ref, &PID);
+        pid_t PID = AXLibGetElementPID(Ref);
         CFRelease(Ref);
 
         return AXLibGetApplicationByPID(PID);
@@ -89,7 +139,7 @@ ax_application *AXLibGetFocusedApplication()
 /* NOTE(koekeishiya): Returns a pointer to the ax_window struct that is the current focused window of an application. */
 ax_window *AXLibGetFocusedWindow(ax_application *Application)
 {
-    AXUIElementRef Ref = (AXUIElementRef) AXLibGetWindowProperty(Application->Ref, kAXFocusedWindowAttribute);
+    AXUIElementRef Ref = AXLibGetElementProperty(Application->Ref, kAXFocusedWindowAttribute, AXQuery_FocusedWindow);
     if(Ref)
     {
         uint32_t WID = AXLibGetWindowID(Ref);
@@ -110,7 +160,8 @@ void AXLibSetFocusedWindow(ax_window *Window)
     {
         AXLibSetWindowProperty(Window->Ref, kAXMainAttribute, kCFBooleanTrue);
         AXLibSetWindowProperty(Window->Ref, kAXFocusedAttribute, kCFBooleanTrue);
-        AXUIElementPerformAction(Window->Ref, kAXRaiseAction);
+        if(!AXLibIsReplayingEvents())
+            AXUIElementPerformAction(Window->Ref, kAXRaiseAction);
 
         /* NOTE(koekeishiya): If the window to gain focus is on a different display,
          * we want to ignore the window focused event emitted by OSX after the
@@ -118,7 +169,8 @@ void AXLibSetFocusedWindow(ax_window *Window)
         if(AXLibWindowDisplay(Window) != AXLibMainDisplay())
             AXLibAddFlags(Window->Application, AXApplication_PrepIgnoreFocus);
 
-        SetFrontProcessWithOptions(&Window->Application->PSN, kSetFrontProcessFrontWindowOnly);
+        if(!AXLibIsReplayingEvents())
+            SetFrontProcessWithOptions(&Window->Application->PSN, kSetFrontProcessFrontWindowOnly);
     }
     else
     {
@@ -151,6 +203,42 @@ std::vector<ax_window *> AXLibGetAllKnownWindows()
     return Windows;
 }
 
+/* NOTE(koekeishiya): Recorded as the error followed by the window ids. */
+internal CGError
+AXLibGetOnScreenWindowList(std::vector<int> *WindowList)
+{
+    std::string Recorded;
+    if(AXLibReplayResponse(AXQuery_OnScreenWindows, &Recorded) && Recorded.size() >= sizeof(CGError))
+    {
+        CGError Error;
+        memcpy(&Error, Recorded.data(), sizeof(Error));
+        WindowList->resize((Recorded.size() - sizeof(Error)) / sizeof(int));
+        if(!WindowList->empty())
+            memcpy(&(*WindowList)[0], Recorded.data() + sizeof(Error), WindowList->size() * sizeof(int));
+
+        return Error;
+    }
+
+    /* NOTE(koekeishiya): Is it necessary to actually decide how many windows are on the screen.
+                          Can we just pass an estimated high enough number such as 200 (?) */
+    int WindowCount = 0;
+    CGError Error = CGSGetOnScreenWindowCount(CGSDefaultConnection, 0, &WindowCount);
+    if(Error == kCGErrorSuccess)
+    {
+        /* NOTE(koekeishiya): This function seems to be pretty expensive.. Is CGWindowListCopyWindowInfo faster (?) */
+        WindowList->resize(WindowCount + 1);
+        Error = CGSGetOnScreenWindowList(CGSDefaultConnection, 0, WindowCount, &(*WindowList)[0], &WindowCount);
+        WindowList->resize(Error == kCGErrorSuccess ? WindowCount : 0);
+    }
+
+    Recorded.assign((const char *) &Error, sizeof(Error));
+    if(!WindowList->empty())
+        Recorded.append((const char *) &(*WindowList)[0], WindowList->size() * sizeof(int));
+
+    AXLibRecordResponse(AXQuery_OnScreenWindows, Recorded.data(), (uint32_t) Recorded.size());
+    return Error;
+}
+
 internal inline bool
 AXLibArrayContains(int *WindowList, int WindowCount, uint32_t WindowID)
 {
@@ -169,52 +257,46 @@ std::vector<ax_window *> AXLibGetAllVisibleWindows()
 {
     std::vector<ax_window *> Windows;
 
-    /* NOTE(koekeishiya): Is it necessary to actually decide how many windows are on the screen.
-                          Can we just pass an estimated high enough number such as 200 (?) */
-    int WindowCount = 0;
-    CGError Error = CGSGetOnScreenWindowCount(CGSDefaultConnection, 0, &WindowCount);
-    if(Error == kCGErrorSuccess)
+    std::vector<int> OnScreen;
+    if(AXLibGetOnScreenWindowList(&OnScreen) == kCGErrorSuccess)
     {
-        /* NOTE(koekeishiya): This function seems to be pretty expensive.. Is CGWindowListCopyWindowInfo faster (?) */
-        int WindowList[WindowCount];
-        Error = CGSGetOnScreenWindowList(CGSDefaultConnection, 0, WindowCount, WindowList, &WindowCount);
-        if(Error == kCGErrorSuccess)
+        int WindowCount = (int) OnScreen.size();
+        int *WindowList = OnScreen.empty() ? NULL : &OnScreen[0];
+
+        BeginAXLibApplications();
+        for(ax_application_map_iter It = AXApplications->begin();
+            It != AXApplications->end();
+            ++It)
         {
-            BeginAXLibApplications();
-            for(ax_application_map_iter It = AXApplications->begin();
-                It != AXApplications->end();
-                ++It)
+            ax_application *Application = It->second;
+            if(!AXLibIsApplicationHidden(Application))
             {
-                ax_application *Application = It->second;
-                if(!AXLibIsApplicationHidden(Application))
+                for(ax_window_map_iter WIt = Application->Windows.begin();
+                    WIt != Application->Windows.end();
+                    ++WIt)
                 {
-                    for(ax_window_map_iter WIt = Application->Windows.begin();
-                        WIt != Application->Windows.end();
-                        ++WIt)
+                    ax_window *Window = WIt->second;
+                    /* NOTE(koekeishiya): If a window is minimized, the ArrayContains check should fail
+                                          if(!AXLibIsWindowMinimized(Window->Ref)) */
+
+                    if((AXLibArrayContains(WindowList, WindowCount, Window->ID)) &&
+                       (AXLibIsWindowStandard(Window) || AXLibIsWindowCustom(Window)) &&
+                       (!AXLibHasFlags(Window, AXWindow_Floating)))
                     {
-                        ax_window *Window = WIt->second;
-                        /* NOTE(koekeishiya): If a window is minimized, the ArrayContains check should fail
-                                              if(!AXLibIsWindowMinimized(Window->Ref)) */
-
-                        if((AXLibArrayContains(WindowList, WindowCount, Window->ID)) &&
-                           (AXLibIsWindowStandard(Window) || AXLibIsWindowCustom(Window)) &&
-                           (!AXLibHasFlags(Window, AXWindow_Floating)))
-                        {
-                            Windows.push_back(Window);
-                        }
+                        Windows.push_back(Window);
                     }
                 }
             }
-            EndAXLibApplications();
         }
+        EndAXLibApplications();
     }
 
     return Windows;
 }
 
-/* NOTE(koekeishiya): Returns the window id of the window below the cursor. */
 #define CONTEXT_MENU_LAYER 101
-uint32_t AXLibGetWindowBelowCursor()
+internal uint32_t
+AXLibQueryWindowBelowCursor()
 {
     uint32_t Result = 0;
     CGWindowListOption WindowListOption = kCGWindowListOptionOnScreenOnly |
@@ -276,10 +358,56 @@ uint32_t AXLibGetWindowBelowCursor()
     return Result;
 }
 
+/* NOTE(koekeishiya): Returns the window id of the window below the cursor. */
+uint32_t AXLibGetWindowBelowCursor()
+{
+    uint32_t Result;
+    if(AXLibReplayResponse(AXQuery_WindowBelowCursor, &Result, sizeof(Result)))
+        return Result;
+
+    Result = AXLibQueryWindowBelowCursor();
+    AXLibRecordResponse(AXQuery_WindowBelowCursor, &Result, sizeof(Result));
+    return Result;
+}
+
+/* NOTE(koekeishiya): Recorded as one line of '<pid> <name>' per application. */
+internal shared_ws_map
+AXLibGetRunningApplications()
+{
+    shared_ws_map List;
+    std::string Recorded;
+    if(AXLibReplayResponse(AXQuery_RunningApplications, &Recorded))
+    {
+        std::size_t At = 0;
+        while(At < Recorded.size())
+        {
+            std::size_t End = Recorded.find('\n', At);
+            if(End == std::string::npos)
+                End = Recorded.size();
+
+            std::string Line = Recorded.substr(At, End - At);
+            std::size_t Split = Line.find(' ');
+            if(Split != std::string::npos)
+                List[(pid_t) atoi(Line.c_str())] = Line.substr(Split + 1);
+
+            At = End + 1;
+        }
+
+        return List;
+    }
+
+    List = SharedWorkspaceRunningApplications();
+    for(shared_ws_map_iter It = List.begin(); It != List.end(); ++It)
+        Recorded += std::to_string(It->first) + " " + It->second + "\n";
+
+    AXLibRecordResponse(AXQuery_RunningApplications, Recorded.data(), (uint32_t) Recorded.size());
+    return List;
+}
+
 /* NOTE(koekeishiya): Update state of known applications and their windows, stored inside the ax_state passed to AXLibInit(..). */
 void AXLibRunningApplications()
 {
-    shared_ws_map List = SharedWorkspaceRunningApplications();
+    shared_ws_map List = AXLibGetRunningApplications();
     for(shared_ws_map_iter It = List.begin();
         It != List.end();
         ++It)
@@ -306,6 +434,58 @@ void AXLibRunningApplications()
     }
 }
 
+/* NOTE(koekeishiya): The state changes of the workspace notifications. These are run as sources by
+                      the notification handlers in sharedworkspace.mm. */
+EVENT_CALLBACK(SharedWorkspaceActiveSpaceChanged)
+{
+    /* NOTE(koekeishiya): OSX APIs are horrible, so we need to detect which display
+                          this event was triggered for. */
+    ax_display *MainDisplay = AXLibMainDisplay();
+    ax_display *Display = MainDisplay;
+    do
+    {
+        ax_space *PrevSpace = Display->Space;
+        Display->Space = AXLibGetActiveSpace(Display);
+        Display->PrevSpace = PrevSpace;
+        if(Display->Space != Display->PrevSpace)
+            break;
+
+        Display = AXLibNextDisplay(Display);
+    } while(Display != MainDisplay);
+
+    AXLibConstructEvent(AXEvent_SpaceChanged, AXLibDisplayPayload(Display), false);
+}
+
+EVENT_CALLBACK(SharedWorkspaceApplicationActivated)
+{
+    pid_t PID = Event->Payload.PID;
+    ax_application_map *Applications = BeginAXLibApplications();
+    if(Applications->find(PID) != Applications->end())
+    {
+        ax_application *Application = (*Applications)[PID];
+
+        if(AXLibHasFlags(Application, AXApplication_PrepIgnoreFocus))
+        {
+            AXLibClearFlags(Application, AXApplication_PrepIgnoreFocus);
+            AXLibAddFlags(Application, AXApplication_IgnoreFocus);
+        }
+
+        /* NOTE(koekeishiya): When an application that is already running, but has no open windows, is activated,
+                              or a window is deminimized, we receive 'didApplicationActivate' notification first.
+                              We have to preserve our insertion point and flag this application for activation at a later point in time. */
+        if((!Application->Focus) ||
+           (AXLibHasFlags(Application->Focus, AXWindow_Minimized)))
+        {
+            AXLibAddFlags(Application, AXApplication_Activate);
+        }
+        else
+        {
+            AXLibConstructEvent(AXEvent_ApplicationActivated, AXLibPIDPayload(Application->PID), false);
+        }
+    }
+    EndAXLibApplications();
+}
+
 ax_application_map *BeginAXLibApplications()
 {
     pthread_mutex_lock(&AXApplicationsMutex);
@@ -322,24 +502,44 @@ void EndAXLibApplications()
                       populate the display and running applications map in the ax_state struct.  */
 bool AXLibInit()
 {
-    AXUIElementSetMessagingTimeout(AXLibSystemWideElement(), 1.0);
+    AXLibInitializeTimestamp();
+
+    ax_event Event = {};
+    Event.Name = "AXLibInitializeState";
+    Event.Handle = &AXLibInitializeState;
+    AXLibRunEventSource(&Event);
+    return AXStateInitialized;
+}
+
+/* NOTE(koekeishiya): The body of AXLibInit, recorded as a source of its own. When it is replayed
+ *                    it does not subscribe to the notifications of the live session. */
+EVENT_CALLBACK(AXLibInitializeState)
+{
+    bool Replaying = AXLibIsReplayingEvents();
+    if(!Replaying)
+        AXUIElementSetMessagingTimeout(AXLibSystemWideElement(), 1.0);
 
     Carbon = &AXState.Carbon;
     AXDisplays = &AXState.Displays;
     AXApplications = &AXState.Applications;
+    AXStateInitialized = false;
 
     if(pthread_mutex_init(&AXApplicationsMutex, NULL) != 0)
     {
-        return false;
+        return;
     }
 
-    if(!AXLibInitializeCarbonEventHandler(Carbon))
+    if(!Replaying)
     {
-        return false;
+        if(!AXLibInitializeCarbonEventHandler(Carbon))
+        {
+            return;
+        }
+
+        SharedWorkspaceInitialize();
     }
 
-    SharedWorkspaceInitialize();
     AXLibInitializeDisplays(AXDisplays);
     AXLibRunningApplications();
-    return true;
+    AXStateInitialized = true;
 }
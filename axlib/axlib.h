@@ -8,6 +8,8 @@
 #include "display.h"
 #include "sharedworkspace.h"
 #include "event.h"
+#include "eventlog.h"
+#include "timer.h"
 #include "carbon.h"
 
 /*
@@ -52,8 +54,11 @@ void AXLibSetFocusedWindow(ax_window *Window);
 std::vector<ax_window *> AXLibGetAllKnownWindows();
 std::vector<ax_window *> AXLibGetAllVisibleWindows();
 uint32_t AXLibGetWindowBelowCursor();
+CGPoint AXLibGetCursorPos();
+void AXLibSetCursorPos(CGPoint Cursor);
 void AXLibRunningApplications();
 bool AXLibInit();
+EVENT_CALLBACK(AXLibInitializeState);
 
 
 ax_application_map *BeginAXLibApplications();
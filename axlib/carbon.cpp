@@ -30,9 +30,19 @@ CopyPascalStringToC(ConstStr255Param Source, char *Destination)
     Destination[Source[0]] = '\0';
 }
 
-internal void
-CarbonApplicationLaunched(ProcessSerialNumber PSN)
+struct carbon_process_information
 {
+    uint32_t Mode;
+    char Name[256];
+};
+
+internal carbon_process_information
+CarbonGetProcessInformation(ProcessSerialNumber *PSN)
+{
+    carbon_process_information Result = {};
+    if(AXLibReplayResponse(AXQuery_ProcessInformation, &Result, sizeof(Result)))
+        return Result;
+
     Str255 ProcessName = {};
     ProcessInfoRec ProcessInfo = {};
     ProcessInfo.processInfoLength = sizeof(ProcessInfoRec);
@@ -40,20 +50,40 @@ CarbonApplicationLaunched(ProcessSerialNumber PSN)
 
     /* NOTE(koekeishiya): Deprecated, consider switching to
      * CFDictionaryRef ProcessInformationCopyDictionary(const ProcessSerialNumber *PSN, UInt32 infoToReturn) */
-    GetProcessInformation(&PSN, &ProcessInfo);
+    GetProcessInformation(PSN, &ProcessInfo);
 
-    char ProcessNameCString[256] = {0};
     if(ProcessInfo.processName)
-        CopyPascalStringToC(ProcessInfo.processName, ProcessNameCString);
-    std::string Name = ProcessNameCString;
+        CopyPascalStringToC(ProcessInfo.processName, Result.Name);
+
+    Result.Mode = ProcessInfo.processMode;
+    AXLibRecordResponse(AXQuery_ProcessInformation, &Result, sizeof(Result));
+    return Result;
+}
+
+internal pid_t
+CarbonGetProcessPID(ProcessSerialNumber *PSN)
+{
+    pid_t PID = 0;
+    if(AXLibReplayResponse(AXQuery_ProcessID, &PID, sizeof(PID)))
+        return PID;
+
+    GetProcessPID(PSN, &PID);
+    AXLibRecordResponse(AXQuery_ProcessID, &PID, sizeof(PID));
+    return PID;
+}
+
+internal void
+CarbonApplicationLaunched(ProcessSerialNumber PSN)
+{
+    carbon_process_information ProcessInfo = CarbonGetProcessInformation(&PSN);
+    std::string Name = ProcessInfo.Name;
 
     /* NOTE(koekeishiya): Check if we should care about this process. */
     if((!IsProcessWhitelisted(Name)) &&
-       ((ProcessInfo.processMode & modeOnlyBackground) != 0))
+       ((ProcessInfo.Mode & modeOnlyBackground) != 0))
         return;
 
-    pid_t PID = 0;
-    GetProcessPID(&PSN, &PID);
+    pid_t PID = CarbonGetProcessPID(&PSN);
 
     /*
     printf("Carbon: Application launched %s\n", Name.c_str());
@@ -82,11 +112,7 @@ CarbonApplicationLaunched(ProcessSerialNumber PSN)
     (*Applications)[PID] = Application;
     EndAXLibApplications();
 
-    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, 0.5 * NSEC_PER_SEC), dispatch_get_main_queue(),
-    ^{
-        if(AXLibInitializeApplication(Application->PID))
-            AXLibInitializedApplication(Application);
-    });
+    AXLibProbeApplication(Application);
 }
 
 internal void
@@ -102,27 +128,22 @@ CarbonApplicationTerminated(ProcessSerialNumber PSN)
         if(Application->PSN.lowLongOfPSN == PSN.lowLongOfPSN &&
            Application->PSN.highLongOfPSN == PSN.highLongOfPSN)
         {
-            pid_t *ApplicationPID = (pid_t *) malloc(sizeof(pid_t));
-            *ApplicationPID = Application->PID;
-            AXLibConstructEvent(AXEvent_ApplicationTerminated, ApplicationPID, false);
+            AXLibConstructEvent(AXEvent_ApplicationTerminated, AXLibPIDPayload(Application->PID), false);
             break;
         }
     }
     EndAXLibApplications();
 }
 
-internal OSStatus
-CarbonApplicationEventHandler(EventHandlerCallRef HandlerCallRef, EventRef Event, void *Refcon)
+/* NOTE(koekeishiya): Args holds the high and low long of the process serial number and the kind
+ *                    of the carbon event. */
+EVENT_CALLBACK(AXLibCarbonApplicationEvent)
 {
     ProcessSerialNumber PSN;
-    if(GetEventParameter(Event, kEventParamProcessID, typeProcessSerialNumber, NULL, sizeof(PSN), NULL, &PSN) != noErr)
-    {
-        printf("CarbonEventHandler: Could not get event parameter in application event\n");
-        return -1;
-    }
+    PSN.highLongOfPSN = (UInt32) Event->Payload.Args[0];
+    PSN.lowLongOfPSN = (UInt32) Event->Payload.Args[1];
 
-    UInt32 Type = GetEventKind(Event);
-    switch(Type)
+    switch(Event->Payload.Args[2])
     {
         case kEventAppLaunched:
         {
@@ -133,6 +154,26 @@ CarbonApplicationEventHandler(EventHandlerCallRef HandlerCallRef, EventRef Event
             CarbonApplicationTerminated(PSN);
         } break;
     }
+}
+
+internal OSStatus
+CarbonApplicationEventHandler(EventHandlerCallRef HandlerCallRef, EventRef Event, void *Refcon)
+{
+    ProcessSerialNumber PSN;
+    if(GetEventParameter(Event, kEventParamProcessID, typeProcessSerialNumber, NULL, sizeof(PSN), NULL, &PSN) != noErr)
+    {
+        printf("CarbonEventHandler: Could not get event parameter in application event\n");
+        return -1;
+    }
+
+    ax_event ApplicationEvent = {};
+    ApplicationEvent.Name = "AXLibCarbonApplicationEvent";
+    ApplicationEvent.Handle = &AXLibCarbonApplicationEvent;
+    ApplicationEvent.Payload.Type = AXPayload_Args;
+    ApplicationEvent.Payload.Args[0] = (int) PSN.highLongOfPSN;
+    ApplicationEvent.Payload.Args[1] = (int) PSN.lowLongOfPSN;
+    ApplicationEvent.Payload.Args[2] = (int) GetEventKind(Event);
+    AXLibRunEventSource(&ApplicationEvent);
 
     return noErr;
 }
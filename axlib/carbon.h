@@ -4,6 +4,8 @@
 #include <Carbon/Carbon.h>
 #include <string>
 
+#include "event.h"
+
 struct carbon_event_handler
 {
     EventTargetRef EventTarget;
@@ -14,5 +16,6 @@ struct carbon_event_handler
 
 bool AXLibInitializeCarbonEventHandler(carbon_event_handler *Carbon);
 void CarbonWhitelistProcess(std::string Name);
+EVENT_CALLBACK(AXLibCarbonApplicationEvent);
 
 #endif
@@ -85,6 +85,7 @@ ax_display *AXLibArrangementDisplay(unsigned int ArrangementID);
 ax_space *AXLibGetActiveSpace(ax_display *Display);
 void AXLibSpaceTransition(ax_display *Display, CGSSpaceID SpaceID);
 
+bool AXLibRefreshSpaceTransition();
 bool AXLibIsSpaceTransitionInProgress();
 bool AXLibDisplayHasSeparateSpaces();
 
@@ -2,6 +2,7 @@
 #include "event.h"
 #include "window.h"
 #include "element.h"
+#include "axlib.h"
 #include <Cocoa/Cocoa.h>
 #include <stdio.h>
 
@@ -26,6 +27,7 @@ extern "C" void CGSAddWindowsToSpaces(CGSConnectionID CID, CFArrayRef Windows, C
 internal std::map<CGDirectDisplayID, ax_display> *Displays;
 internal unsigned int MaxDisplayCount = 5;
 internal unsigned int ActiveDisplayCount = 0;
+internal bool SpaceTransition = false;
 
 /* NOTE(koekeishiya): If the display UUID is stored, return the corresponding
                       CGDirectDisplayID. Otherwise we return 0 */
@@ -152,11 +154,9 @@ AXLibConstructSpace(CFStringRef Identifier, CGSSpaceID SpaceID, CGSSpaceType Spa
     return Space;
 }
 
-/* NOTE(koekeishiya): Find the active ax_space for a given ax_display. */
-ax_space *AXLibGetActiveSpace(ax_display *Display)
+internal ax_space *
+AXLibConstructActiveSpace(ax_display *Display, CGSSpaceID SpaceID)
 {
-    CGSSpaceID SpaceID = AXLibGetActiveSpaceID(Display);
-
     /* NOTE(koekeishiya): This is the first time we see this space. It was most likely created after
                           AXLib was initialized. Create ax_space struct and add to the displays space list. */
     if(!AXLibDisplayHasSpace(Display, SpaceID))
@@ -170,6 +170,39 @@ ax_space *AXLibGetActiveSpace(ax_display *Display)
     return &Display->Spaces[SpaceID];
 }
 
+/* NOTE(koekeishiya): Find the active ax_space for a given ax_display. A space that is new to us is
+                      recorded as its type followed by its identifier. */
+ax_space *AXLibGetActiveSpace(ax_display *Display)
+{
+    CGSSpaceID SpaceID;
+    if(!AXLibReplayResponse(AXQuery_ActiveSpace, &SpaceID, sizeof(SpaceID)))
+    {
+        SpaceID = AXLibGetActiveSpaceID(Display);
+        AXLibRecordResponse(AXQuery_ActiveSpace, &SpaceID, sizeof(SpaceID));
+    }
+
+    if(!AXLibDisplayHasSpace(Display, SpaceID))
+    {
+        std::string Recorded;
+        if(AXLibReplayResponse(AXQuery_SpaceInformation, &Recorded) && Recorded.size() >= sizeof(CGSSpaceType))
+        {
+            ax_space *Space = &Display->Spaces[SpaceID];
+            Space->ID = SpaceID;
+            memcpy(&Space->Type, Recorded.data(), sizeof(CGSSpaceType));
+            Space->Identifier = Recorded.substr(sizeof(CGSSpaceType));
+        }
+        else
+        {
+            ax_space *Space = AXLibConstructActiveSpace(Display, SpaceID);
+            Recorded.assign((const char *) &Space->Type, sizeof(CGSSpaceType));
+            Recorded += Space->Identifier;
+            AXLibRecordResponse(AXQuery_SpaceInformation, Recorded.data(), (uint32_t) Recorded.size());
+        }
+    }
+
+    return &Display->Spaces[SpaceID];
+}
+
 /* NOTE(koekeishiya): Constructs ax_space structs for every space of a given ax_display. */
 internal void
 AXLibConstructSpacesForDisplay(ax_display *Display)
@@ -214,7 +247,7 @@ AXLibChangeDisplayID(CGDirectDisplayID OldDisplayID, CGDirectDisplayID NewDispla
     Display->ID = NewDisplayID;
     Display->Spaces.clear();
     AXLibConstructSpacesForDisplay(Display);
-    Display->Space = AXLibGetActiveSpace(Display);
+    Display->Space = AXLibConstructActiveSpace(Display, AXLibGetActiveSpaceID(Display));
     Display->PrevSpace = Display->Space;
 }
 
@@ -229,7 +262,7 @@ AXLibConstructDisplay(CGDirectDisplayID DisplayID, unsigned int ArrangementID)
     Display.Identifier = AXLibGetDisplayIdentifier(DisplayID);
     Display.Frame = CGDisplayBounds(DisplayID);
     AXLibConstructSpacesForDisplay(&Display);
-    Display.Space = AXLibGetActiveSpace(&Display);
+    Display.Space = AXLibConstructActiveSpace(&Display, AXLibGetActiveSpaceID(&Display));
     Display.PrevSpace = Display.Space;
 
     return Display;
@@ -296,7 +329,7 @@ AXLibAddDisplay(CGDirectDisplayID DisplayID)
     AXLibRefreshDisplays();
 
     /* TODO(koekeishiya): Should probably pass an identifier for the added display. */
-    AXLibConstructEvent(AXEvent_DisplayAdded, NULL, false);
+    AXLibConstructEvent(AXEvent_DisplayAdded, AXLibEmptyPayload(), false);
 }
 
 internal inline void
@@ -327,7 +360,7 @@ AXLibRemoveDisplay(CGDirectDisplayID DisplayID)
     AXLibRefreshDisplays();
 
     /* TODO(koekeishiya): Should probably pass an identifier for the removed display. */
-    AXLibConstructEvent(AXEvent_DisplayRemoved, NULL, false);
+    AXLibConstructEvent(AXEvent_DisplayRemoved, AXLibEmptyPayload(), false);
 }
 
 internal inline void
@@ -342,7 +375,7 @@ AXLibResizeDisplay(CGDirectDisplayID DisplayID)
 
         ax_display *Display = AXLibDisplay(DisplayIdentifier);
         if(Display)
-            AXLibConstructEvent(AXEvent_DisplayResized, Display, false);
+            AXLibConstructEvent(AXEvent_DisplayResized, AXLibDisplayPayload(Display), false);
 
         if(DisplayIdentifier)
             CFRelease(DisplayIdentifier);
@@ -362,7 +395,7 @@ AXLibMoveDisplay(CGDirectDisplayID DisplayID)
 
         ax_display *Display = AXLibDisplay(DisplayIdentifier);
         if(Display)
-            AXLibConstructEvent(AXEvent_DisplayMoved, Display, false);
+            AXLibConstructEvent(AXEvent_DisplayMoved, AXLibDisplayPayload(Display), false);
 
         if(DisplayIdentifier)
             CFRelease(DisplayIdentifier);
@@ -438,12 +471,20 @@ AXDisplayReconfigurationCallBack(CGDirectDisplayID DisplayID, CGDisplayChangeSum
 #endif
 
     AXLibResumeEventLoop();
+    AXLibUpdateSpaceTransition();
 }
 
-/* NOTE(koekeishiya): Populate map with information about all connected displays. */
+/* NOTE(koekeishiya): Populate map with information about all connected displays. Displays that are
+                      reconfigured after this are not recorded, a replay does not register for them. */
 internal void
 AXLibActiveDisplays()
 {
+    if(AXLibReplayDisplays(Displays))
+    {
+        ActiveDisplayCount = (unsigned int) Displays->size();
+        return;
+    }
+
     CGDirectDisplayID *CGDirectDisplayList = (CGDirectDisplayID *) malloc(sizeof(CGDirectDisplayID) * MaxDisplayCount);
     CGGetActiveDisplayList(MaxDisplayCount, CGDirectDisplayList, &ActiveDisplayCount);
 
@@ -454,15 +495,21 @@ AXLibActiveDisplays()
     }
 
     free(CGDirectDisplayList);
+    AXLibRecordDisplays(Displays);
     CGDisplayRegisterReconfigurationCallback(AXDisplayReconfigurationCallBack, NULL);
 }
 
 /* NOTE(koekeishiya): The main display is the display which currently holds the window that accepts key-input. */
 ax_display *AXLibMainDisplay()
 {
+    CGDirectDisplayID MainDisplay;
+    if(AXLibReplayResponse(AXQuery_MainDisplay, &MainDisplay, sizeof(MainDisplay)))
+        return &(*Displays)[MainDisplay];
+
     NSDictionary *ScreenDictionary = [[NSScreen mainScreen] deviceDescription];
     NSNumber *ScreenID = [ScreenDictionary objectForKey:@"NSScreenNumber"];
-    CGDirectDisplayID MainDisplay = [ScreenID unsignedIntValue];
+    MainDisplay = [ScreenID unsignedIntValue];
+    AXLibRecordResponse(AXQuery_MainDisplay, &MainDisplay, sizeof(MainDisplay));
     if(Displays->find(MainDisplay) == Displays->end())
         AXLibAddDisplay(MainDisplay);
 
@@ -472,9 +519,7 @@ ax_display *AXLibMainDisplay()
 /* NOTE(koekeishiya): The display that holds the cursor. */
 ax_display *AXLibCursorDisplay()
 {
-    CGEventRef Event = CGEventCreate(NULL);
-    CGPoint Cursor = CGEventGetLocation(Event);
-    CFRelease(Event);
+    CGPoint Cursor = AXLibGetCursorPos();
 
     ax_display *Result = NULL;
     std::map<CGDirectDisplayID, ax_display>::iterator It;
@@ -557,7 +602,8 @@ ax_display *AXLibArrangementDisplay(unsigned int ArrangementID)
     return NULL;
 }
 
-unsigned int AXLibDesktopIDFromCGSSpaceID(ax_display *Display, CGSSpaceID SpaceID)
+internal unsigned int
+AXLibQueryDesktopIDFromCGSSpaceID(ax_display *Display, CGSSpaceID SpaceID)
 {
     unsigned int Result = 0;
     NSString *CurrentIdentifier = (__bridge NSString *)Display->Identifier;
@@ -588,7 +634,19 @@ unsigned int AXLibDesktopIDFromCGSSpaceID(ax_display *Display, CGSSpaceID SpaceI
     return Result;
 }
 
-CGSSpaceID AXLibCGSSpaceIDFromDesktopID(ax_display *Display, unsigned int DesktopID)
+unsigned int AXLibDesktopIDFromCGSSpaceID(ax_display *Display, CGSSpaceID SpaceID)
+{
+    unsigned int Result;
+    if(AXLibReplayResponse(AXQuery_DesktopID, &Result, sizeof(Result)))
+        return Result;
+
+    Result = AXLibQueryDesktopIDFromCGSSpaceID(Display, SpaceID);
+    AXLibRecordResponse(AXQuery_DesktopID, &Result, sizeof(Result));
+    return Result;
+}
+
+internal CGSSpaceID
+AXLibQueryCGSSpaceIDFromDesktopID(ax_display *Display, unsigned int DesktopID)
 {
     CGSSpaceID Result = 0;
     NSString *CurrentIdentifier = (__bridge NSString *)Display->Identifier;
@@ -618,7 +676,19 @@ CGSSpaceID AXLibCGSSpaceIDFromDesktopID(ax_display *Display, unsigned int Deskto
     return Result;
 }
 
-unsigned int AXLibDisplaySpacesCount(ax_display *Display)
+CGSSpaceID AXLibCGSSpaceIDFromDesktopID(ax_display *Display, unsigned int DesktopID)
+{
+    CGSSpaceID Result;
+    if(AXLibReplayResponse(AXQuery_SpaceID, &Result, sizeof(Result)))
+        return Result;
+
+    Result = AXLibQueryCGSSpaceIDFromDesktopID(Display, DesktopID);
+    AXLibRecordResponse(AXQuery_SpaceID, &Result, sizeof(Result));
+    return Result;
+}
+
+internal unsigned int
+AXLibQueryDisplaySpacesCount(ax_display *Display)
 {
     unsigned int Result = 0;
     NSString *CurrentIdentifier = (__bridge NSString *)Display->Identifier;
@@ -638,6 +708,17 @@ unsigned int AXLibDisplaySpacesCount(ax_display *Display)
     return Result;
 }
 
+unsigned int AXLibDisplaySpacesCount(ax_display *Display)
+{
+    unsigned int Result;
+    if(AXLibReplayResponse(AXQuery_SpacesCount, &Result, sizeof(Result)))
+        return Result;
+
+    Result = AXLibQueryDisplaySpacesCount(Display);
+    AXLibRecordResponse(AXQuery_SpacesCount, &Result, sizeof(Result));
+    return Result;
+}
+
 /* NOTE(koekeishiya): Given an abitrary CGSSpaceID, return the ax_display it belongs to. */
 ax_display * AXLibSpaceDisplay(CGSSpaceID SpaceID)
 {
@@ -657,7 +738,11 @@ ax_display * AXLibSpaceDisplay(CGSSpaceID SpaceID)
     return Result;
 }
 
-bool AXLibIsSpaceTransitionInProgress()
+/* NOTE(koekeishiya): Asks the window server whether any display is animating a space transition,
+                      and caches the answer. This is a round-trip to the window server for every
+                      display, so it is only done from the space and display notifications,
+                      through AXLibUpdateSpaceTransition. */
+bool AXLibRefreshSpaceTransition()
 {
     bool Result = false;
 
@@ -668,12 +753,21 @@ bool AXLibIsSpaceTransitionInProgress()
         Result = Result || CGSManagedDisplayIsAnimating(CGSDefaultConnection, Display->Identifier);
     }
 
+    __atomic_store_n(&SpaceTransition, Result, __ATOMIC_SEQ_CST);
     return Result;
 }
 
+bool AXLibIsSpaceTransitionInProgress()
+{
+    return __atomic_load_n(&SpaceTransition, __ATOMIC_SEQ_CST);
+}
+
 /* NOTE(koekeishiya): Performs a space transition without the animation. */
 void AXLibSpaceTransition(ax_display *Display, CGSSpaceID SpaceID)
 {
+    if(AXLibIsReplayingEvents())
+        return;
+
     NSArray *NSArraySourceSpace = @[ @(Display->Space->ID) ];
     NSArray *NSArrayDestinationSpace = @[ @(SpaceID) ];
     CGSManagedDisplaySetIsAnimating(CGSDefaultConnection, Display->Identifier, true);
@@ -689,6 +783,9 @@ void AXLibSpaceTransition(ax_display *Display, CGSSpaceID SpaceID)
 
 void AXLibSpaceAddWindow(CGSSpaceID SpaceID, uint32_t WindowID)
 {
+    if(AXLibIsReplayingEvents())
+        return;
+
     NSArray *NSArrayWindow = @[ @(WindowID) ];
     NSArray *NSArrayDestinationSpace = @[ @(SpaceID) ];
     CGSAddWindowsToSpaces(CGSDefaultConnection, (__bridge CFArrayRef)NSArrayWindow, (__bridge CFArrayRef)NSArrayDestinationSpace);
@@ -698,6 +795,9 @@ void AXLibSpaceAddWindow(CGSSpaceID SpaceID, uint32_t WindowID)
 
 void AXLibSpaceRemoveWindow(CGSSpaceID SpaceID, uint32_t WindowID)
 {
+    if(AXLibIsReplayingEvents())
+        return;
+
     NSArray *NSArrayWindow = @[ @(WindowID) ];
     NSArray *NSArraySourceSpace = @[ @(SpaceID) ];
     CGSRemoveWindowsFromSpaces(CGSDefaultConnection, (__bridge CFArrayRef)NSArrayWindow, (__bridge CFArrayRef)NSArraySourceSpace);
@@ -705,7 +805,8 @@ void AXLibSpaceRemoveWindow(CGSSpaceID SpaceID, uint32_t WindowID)
     [NSArraySourceSpace release];
 }
 
-bool AXLibSpaceHasWindow(ax_window *Window, CGSSpaceID SpaceID)
+internal bool
+AXLibQuerySpaceHasWindow(ax_window *Window, CGSSpaceID SpaceID)
 {
     bool Result = false;
     NSArray *NSArrayWindow = @[ @(Window->ID) ];
@@ -726,7 +827,19 @@ bool AXLibSpaceHasWindow(ax_window *Window, CGSSpaceID SpaceID)
     return Result;
 }
 
-bool AXLibStickyWindow(ax_window *Window)
+bool AXLibSpaceHasWindow(ax_window *Window, CGSSpaceID SpaceID)
+{
+    bool Result;
+    if(AXLibReplayResponse(AXQuery_SpaceHasWindow, &Result, sizeof(Result)))
+        return Result;
+
+    Result = AXLibQuerySpaceHasWindow(Window, SpaceID);
+    AXLibRecordResponse(AXQuery_SpaceHasWindow, &Result, sizeof(Result));
+    return Result;
+}
+
+internal bool
+AXLibQueryStickyWindow(ax_window *Window)
 {
     bool Result = false;
     NSArray *NSArrayWindow = @[ @(Window->ID) ];
@@ -739,6 +852,17 @@ bool AXLibStickyWindow(ax_window *Window)
     return Result;
 }
 
+bool AXLibStickyWindow(ax_window *Window)
+{
+    bool Result;
+    if(AXLibReplayResponse(AXQuery_StickyWindow, &Result, sizeof(Result)))
+        return Result;
+
+    Result = AXLibQueryStickyWindow(Window);
+    AXLibRecordResponse(AXQuery_StickyWindow, &Result, sizeof(Result));
+    return Result;
+}
+
 bool AXLibDisplayHasSeparateSpaces()
 {
     return [NSScreen screensHaveSeparateSpaces];
@@ -1,4 +1,5 @@
 #include "element.h"
+#include "eventlog.h"
 
 char *CopyCFStringToC(CFStringRef String, bool UTF8)
 {
@@ -22,8 +23,21 @@ char *CopyCFStringToC(CFStringRef String, bool UTF8)
     return Result;
 }
 
+/* NOTE(koekeishiya): Number of AX attribute reads and writes issued through AXLib, for the
+                      statistics of the event log. */
+static uint64_t ElementReads = 0;
+static uint64_t ElementWrites = 0;
+
+void AXLibGetElementCallCount(uint64_t *Reads, uint64_t *Writes)
+{
+    *Reads = __atomic_load_n(&ElementReads, __ATOMIC_RELAXED);
+    *Writes = __atomic_load_n(&ElementWrites, __ATOMIC_RELAXED);
+}
+
 CFTypeRef AXLibGetWindowProperty(AXUIElementRef WindowRef, CFStringRef Property)
 {
+    __atomic_add_fetch(&ElementReads, 1, __ATOMIC_RELAXED);
+
     CFTypeRef TypeRef;
     AXError Error = AXUIElementCopyAttributeValue(WindowRef, Property, &TypeRef);
     bool Result = (Error == kAXErrorSuccess);
@@ -34,59 +48,72 @@ CFTypeRef AXLibGetWindowProperty(AXUIElementRef WindowRef, CFStringRef Property)
     return Result ? TypeRef : NULL;
 }
 
+/* NOTE(koekeishiya): The result of a write is recorded, the write itself is not made again
+ *                    when the handler is replayed. */
 AXError AXLibSetWindowProperty(AXUIElementRef WindowRef, CFStringRef Property, CFTypeRef Value)
 {
-    return AXUIElementSetAttributeValue(WindowRef, Property, Value);
+    __atomic_add_fetch(&ElementWrites, 1, __ATOMIC_RELAXED);
+
+    AXError Result;
+    if(AXLibReplayResponse(AXQuery_WindowWrite, &Result, sizeof(Result)))
+        return Result;
+
+    Result = AXUIElementSetAttributeValue(WindowRef, Property, Value);
+    AXLibRecordResponse(AXQuery_WindowWrite, &Result, sizeof(Result));
+    return Result;
 }
 
-bool AXLibIsWindowMinimized(AXUIElementRef WindowRef)
+static bool
+AXLibGetWindowBool(AXUIElementRef WindowRef, CFStringRef Property, ax_event_query Query, bool Default)
 {
-    bool Result = true;
+    bool Result = Default;
+    if(AXLibReplayResponse(Query, &Result, sizeof(Result)))
+        return Result;
 
-    CFBooleanRef Value = (CFBooleanRef) AXLibGetWindowProperty(WindowRef, kAXMinimizedAttribute);
+    CFBooleanRef Value = (CFBooleanRef) AXLibGetWindowProperty(WindowRef, Property);
     if(Value)
     {
         Result = CFBooleanGetValue(Value);
         CFRelease(Value);
     }
 
+    AXLibRecordResponse(Query, &Result, sizeof(Result));
     return Result;
 }
 
-bool AXLibIsWindowMovable(AXUIElementRef WindowRef)
+static bool
+AXLibIsWindowPropertySettable(AXUIElementRef WindowRef, CFStringRef Property, ax_event_query Query)
 {
     bool Result;
+    if(AXLibReplayResponse(Query, &Result, sizeof(Result)))
+        return Result;
 
-    AXError Error = AXUIElementIsAttributeSettable(WindowRef, kAXPositionAttribute, (Boolean *)&Result);
-    if(Error != kAXErrorSuccess)
-        Result = false;
+    Boolean Settable;
+    AXError Error = AXUIElementIsAttributeSettable(WindowRef, Property, &Settable);
+    Result = Error == kAXErrorSuccess && Settable;
 
+    AXLibRecordResponse(Query, &Result, sizeof(Result));
     return Result;
 }
 
-bool AXLibIsWindowFullscreen(AXUIElementRef WindowRef)
+bool AXLibIsWindowMinimized(AXUIElementRef WindowRef)
 {
-    bool Result = false;
+    return AXLibGetWindowBool(WindowRef, kAXMinimizedAttribute, AXQuery_WindowMinimized, true);
+}
 
-    CFBooleanRef Value = (CFBooleanRef) AXLibGetWindowProperty(WindowRef, kAXFullscreenAttribute);
-    if(Value)
-    {
-        Result = CFBooleanGetValue(Value);
-        CFRelease(Value);
-    }
+bool AXLibIsWindowMovable(AXUIElementRef WindowRef)
+{
+    return AXLibIsWindowPropertySettable(WindowRef, kAXPositionAttribute, AXQuery_WindowMovable);
+}
 
-    return Result;
+bool AXLibIsWindowFullscreen(AXUIElementRef WindowRef)
+{
+    return AXLibGetWindowBool(WindowRef, kAXFullscreenAttribute, AXQuery_WindowFullscreen, false);
 }
 
 bool AXLibIsWindowResizable(AXUIElementRef WindowRef)
 {
-    bool Result;
-
-    AXError Error = AXUIElementIsAttributeSettable(WindowRef, kAXSizeAttribute, (Boolean *)&Result);
-    if(Error != kAXErrorSuccess)
-        Result = false;
-
-    return Result;
+    return AXLibIsWindowPropertySettable(WindowRef, kAXSizeAttribute, AXQuery_WindowResizable);
 }
 
 bool AXLibSetWindowPosition(AXUIElementRef WindowRef, int X, int Y)
@@ -129,12 +156,20 @@ bool AXLibSetWindowSize(AXUIElementRef WindowRef, int Width, int Height)
 uint32_t AXLibGetWindowID(AXUIElementRef WindowRef)
 {
     uint32_t WindowID = kCGNullWindowID;
+    if(AXLibReplayResponse(AXQuery_WindowID, &WindowID, sizeof(WindowID)))
+        return WindowID;
+
     _AXUIElementGetWindow(WindowRef, &WindowID);
+    AXLibRecordResponse(AXQuery_WindowID, &WindowID, sizeof(WindowID));
     return WindowID;
 }
 
 char *AXLibGetWindowTitle(AXUIElementRef WindowRef)
 {
+    std::string Recorded;
+    if(AXLibReplayResponse(AXQuery_WindowTitle, &Recorded))
+        return Recorded.empty() ? NULL : strdup(Recorded.c_str());
+
     CFStringRef WindowTitleRef = (CFStringRef) AXLibGetWindowProperty(WindowRef, kAXTitleAttribute);
     char *WindowTitle = NULL;
 
@@ -147,12 +182,16 @@ char *AXLibGetWindowTitle(AXUIElementRef WindowRef)
         CFRelease(WindowTitleRef);
     }
 
+    AXLibRecordResponse(AXQuery_WindowTitle, WindowTitle, WindowTitle ? (uint32_t) strlen(WindowTitle) + 1 : 0);
     return WindowTitle;
 }
 
 CGPoint AXLibGetWindowPosition(AXUIElementRef WindowRef)
 {
     CGPoint WindowPos = {};
+    if(AXLibReplayResponse(AXQuery_WindowPosition, &WindowPos, sizeof(WindowPos)))
+        return WindowPos;
+
     AXValueRef WindowPosRef = (AXValueRef) AXLibGetWindowProperty(WindowRef, kAXPositionAttribute);
 
     if(WindowPosRef)
@@ -161,12 +200,16 @@ CGPoint AXLibGetWindowPosition(AXUIElementRef WindowRef)
         CFRelease(WindowPosRef);
     }
 
+    AXLibRecordResponse(AXQuery_WindowPosition, &WindowPos, sizeof(WindowPos));
     return WindowPos;
 }
 
 CGSize AXLibGetWindowSize(AXUIElementRef WindowRef)
 {
     CGSize WindowSize = {};
+    if(AXLibReplayResponse(AXQuery_WindowSize, &WindowSize, sizeof(WindowSize)))
+        return WindowSize;
+
     AXValueRef WindowSizeRef = (AXValueRef) AXLibGetWindowProperty(WindowRef, kAXSizeAttribute);
 
     if(WindowSizeRef)
@@ -175,17 +218,32 @@ CGSize AXLibGetWindowSize(AXUIElementRef WindowRef)
         CFRelease(WindowSizeRef);
     }
 
+    AXLibRecordResponse(AXQuery_WindowSize, &WindowSize, sizeof(WindowSize));
     return WindowSize;
 }
 
+/* NOTE(koekeishiya): A replayed string attribute is a new CFString, which the caller releases
+ *                    just like the one it would have gotten from the window system. */
+static CFTypeRef
+AXLibGetWindowString(AXUIElementRef WindowRef, CFStringRef Property, ax_event_query Query)
+{
+    std::string Recorded;
+    if(AXLibReplayResponse(Query, &Recorded))
+        return Recorded.empty() ? NULL : CFStringCreateWithCString(NULL, Recorded.c_str(), kCFStringEncodingUTF8);
+
+    CFTypeRef Result = AXLibGetWindowProperty(WindowRef, Property);
+    AXLibRecordResponse(Query, (CFStringRef) Result);
+    return Result;
+}
+
 bool AXLibGetWindowRole(AXUIElementRef WindowRef, CFTypeRef *Role)
 {
-    *Role = AXLibGetWindowProperty(WindowRef, kAXRoleAttribute);
+    *Role = AXLibGetWindowString(WindowRef, kAXRoleAttribute, AXQuery_WindowRole);
     return *Role != NULL;
 }
 
 bool AXLibGetWindowSubrole(AXUIElementRef WindowRef, CFTypeRef *Subrole)
 {
-    *Subrole = AXLibGetWindowProperty(WindowRef, kAXSubroleAttribute);
+    *Subrole = AXLibGetWindowString(WindowRef, kAXSubroleAttribute, AXQuery_WindowSubrole);
     return *Subrole != NULL;
 }
@@ -16,6 +16,7 @@ bool AXLibIsWindowFullscreen(AXUIElementRef WindowRef);
 bool AXLibSetWindowPosition(AXUIElementRef WindowRef, int X, int Y);
 bool AXLibSetWindowSize(AXUIElementRef WindowRef, int Width, int Height);
 
+void AXLibGetElementCallCount(uint64_t *Reads, uint64_t *Writes);
 CFTypeRef AXLibGetWindowProperty(AXUIElementRef WindowRef, CFStringRef Property);
 AXError AXLibSetWindowProperty(AXUIElementRef WindowRef, CFStringRef Property, CFTypeRef Value);
 
@@ -1,56 +1,957 @@
 #include "event.h"
+#include "eventlog.h"
+#include "timer.h"
+#include "element.h"
 #include "display.h"
 
-#ifdef DEBUG_BUILD
+#include <stdlib.h>
 #include <stdio.h>
-#endif
+#include <errno.h>
+#include <sys/time.h>
+#include <mach/mach_time.h>
+#include <dispatch/dispatch.h>
 
 #define internal static
 internal ax_event_loop EventLoop = {};
+internal mach_timebase_info_data_t Timebase;
 
-/* NOTE(koekeishiya): Must be thread-safe! Called through AXLibConstructEvent macro */
-void AXLibAddEvent(ax_event Event)
+/* NOTE(koekeishiya): Mouse events carry no payload; their handlers read the current state
+ *                    of the cursor. Window moved and resized events carry the id of the window
+ *                    and their handlers read the current frame of the window. Only the latest
+ *                    event of each type and target matters. */
+internal bool
+AXLibGetEventCoalesceKey(ax_event *Event, uint64_t *Key)
 {
-    if(EventLoop.Running && Event.Handle)
+    switch(Event->Type)
     {
-        pthread_mutex_lock(&EventLoop.WorkerLock);
-        EventLoop.Queue.push(Event);
+        case AXEvent_MouseMoved:
+        case AXEvent_LeftMouseDragged:
+        case AXEvent_RightMouseDragged:
+        {
+            *Key = (uint64_t) Event->Type << 32;
+            return true;
+        } break;
+        case AXEvent_WindowMoved:
+        case AXEvent_WindowResized:
+        {
+            *Key = ((uint64_t) Event->Type << 32) | Event->Payload.WindowID;
+            return true;
+        } break;
+        default:
+        {
+            return false;
+        } break;
+    }
+}
+
+internal inline bool
+AXLibIsEventDroppable(ax_event *Event)
+{
+    return Event->Type == AXEvent_MouseMoved ||
+           Event->Type == AXEvent_LeftMouseDragged ||
+           Event->Type == AXEvent_RightMouseDragged;
+}
+
+/* NOTE(koekeishiya): Every coalescing slot is a single word holding the key of the event it
+ *                    tracks and two flags: whether an event with that key is queued, and
+ *                    whether any event merged into it was not intrinsic. A producer either
+ *                    merges into the queued event of its key or claims an idle slot; the
+ *                    worker clears the flags when it dequeues the event. A slot that is busy
+ *                    with a different key is left alone and the event is queued untracked. */
+#define AX_EVENT_COALESCE_PENDING 0x1
+#define AX_EVENT_COALESCE_EXTRINSIC 0x2
+
+internal inline uint64_t *
+AXLibGetEventCoalesceSlot(uint64_t Key)
+{
+    uint64_t Hash = Key * 0x9E3779B97F4A7C15ULL;
+    return &EventLoop.Coalesce[(Hash >> 32) & (AX_EVENT_COALESCE_SLOTS - 1)];
+}
+
+/* NOTE(koekeishiya): Returns true if the event was merged into a queued event of the same key. */
+internal bool
+AXLibCoalesceEvent(ax_event *Event)
+{
+    uint64_t Key;
+    if(!AXLibGetEventCoalesceKey(Event, &Key))
+        return false;
+
+    uint64_t *Slot = AXLibGetEventCoalesceSlot(Key);
+    uint64_t Flags = AX_EVENT_COALESCE_PENDING | (Event->Intrinsic ? 0 : AX_EVENT_COALESCE_EXTRINSIC);
+    uint64_t Word = __atomic_load_n(Slot, __ATOMIC_ACQUIRE);
+    for(;;)
+    {
+        if(Word & AX_EVENT_COALESCE_PENDING)
+        {
+            if((Word >> 2) != Key)
+                return false;
 
+            if(__atomic_compare_exchange_n(Slot, &Word, Word | Flags, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            {
+                __atomic_add_fetch(&EventLoop.Coalesced[Event->Type], 1, __ATOMIC_RELAXED);
+                AXLibReleaseEventPayload(&Event->Payload);
+                return true;
+            }
+        }
+        else if(__atomic_compare_exchange_n(Slot, &Word, (Key << 2) | Flags, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            Event->Pending = Slot;
+            return false;
+        }
+    }
+}
+
+/* NOTE(koekeishiya): Called by the worker when the event leaves the queue. Events merged into
+ *                    it after this point are queued as a new event. */
+internal void
+AXLibReleaseCoalescedEvent(ax_event *Event)
+{
+    if(Event->Pending)
+    {
+        uint64_t Word = __atomic_load_n(Event->Pending, __ATOMIC_ACQUIRE);
+        while(!__atomic_compare_exchange_n(Event->Pending, &Word, Word & ~(uint64_t) 0x3, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+        Event->Intrinsic = !(Word & AX_EVENT_COALESCE_EXTRINSIC);
+        Event->Pending = NULL;
+    }
+}
+
+/* NOTE(koekeishiya): Lock-free, may be called from any number of threads at once.
+ *                    Returns false if the ring is full. */
+internal bool
+AXLibPushEventRing(ax_event_ring *Ring, ax_event *Event)
+{
+    uint64_t Position = __atomic_load_n(&Ring->Head, __ATOMIC_RELAXED);
+    for(;;)
+    {
+        ax_event_slot *Slot = &Ring->Slots[Position & Ring->Mask];
+        uint64_t Sequence = __atomic_load_n(&Slot->Sequence, __ATOMIC_ACQUIRE);
+        int64_t Distance = (int64_t) Sequence - (int64_t) Position;
+
+        if(Distance == 0)
+        {
+            if(__atomic_compare_exchange_n(&Ring->Head, &Position, Position + 1, true,
+                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                Slot->Event = *Event;
+                __atomic_store_n(&Slot->Sequence, Position + 1, __ATOMIC_SEQ_CST);
+                return true;
+            }
+        }
+        else if(Distance < 0)
+        {
+            return false;
+        }
+        else
+        {
+            Position = __atomic_load_n(&Ring->Head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/* NOTE(koekeishiya): Only called from the worker thread. */
+internal bool
+AXLibPopEventRing(ax_event_ring *Ring, ax_event *Event)
+{
+    ax_event_slot *Slot = &Ring->Slots[Ring->Tail & Ring->Mask];
+    if(__atomic_load_n(&Slot->Sequence, __ATOMIC_SEQ_CST) != Ring->Tail + 1)
+        return false;
+
+    *Event = Slot->Event;
+    __atomic_store_n(&Slot->Sequence, Ring->Tail + Ring->Mask + 1, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&Ring->Tail, Ring->Tail + 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+internal inline bool
+AXLibIsEventRingEmpty(ax_event_ring *Ring)
+{
+    ax_event_slot *Slot = &Ring->Slots[Ring->Tail & Ring->Mask];
+    return __atomic_load_n(&Slot->Sequence, __ATOMIC_SEQ_CST) != Ring->Tail + 1;
+}
+
+/* NOTE(koekeishiya): Events only go to the overflow queue of a lane while its ring is full, or
+ *                    while the overflow queue still holds older events, so that events from the
+ *                    same producer are never reordered. */
+internal bool
+AXLibHasOverflowEvents(ax_event_lane *Lane)
+{
+    return __atomic_load_n(&Lane->OverflowCount, __ATOMIC_SEQ_CST) != 0;
+}
+
+internal void
+AXLibSpillEvent(ax_event_lane *Lane, ax_event *Event)
+{
+    pthread_mutex_lock(&EventLoop.OverflowLock);
+    Lane->OverflowQueue.push(*Event);
+    __atomic_add_fetch(&Lane->OverflowCount, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&EventLoop.Spilled, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&EventLoop.OverflowLock);
+}
+
+internal bool
+AXLibPopOverflowEvent(ax_event_lane *Lane, ax_event *Event)
+{
+    bool Result = false;
+    pthread_mutex_lock(&EventLoop.OverflowLock);
+    if(!Lane->OverflowQueue.empty())
+    {
+        *Event = Lane->OverflowQueue.front();
+        Lane->OverflowQueue.pop();
+        __atomic_sub_fetch(&Lane->OverflowCount, 1, __ATOMIC_SEQ_CST);
+        Result = true;
+    }
+    pthread_mutex_unlock(&EventLoop.OverflowLock);
+    return Result;
+}
+
+internal void
+AXLibBlockUntilEventIsQueued(ax_event_lane *Lane, ax_event *Event)
+{
+    pthread_mutex_lock(&EventLoop.OverflowLock);
+    __atomic_add_fetch(&EventLoop.Blocked, 1, __ATOMIC_SEQ_CST);
+    while(EventLoop.Running && !AXLibPushEventRing(&Lane->Ring, Event))
+        pthread_cond_wait(&EventLoop.Room, &EventLoop.OverflowLock);
+    __atomic_sub_fetch(&EventLoop.Blocked, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&EventLoop.OverflowLock);
+}
+
+internal inline bool
+AXLibIsInputEvent(ax_event *Event)
+{
+    return Event->Type >= AXEvent_MouseMoved && Event->Type <= AXEvent_RightMouseUp;
+}
+
+/* NOTE(koekeishiya): Wakes the worker if it is parked, so that it picks up new events or
+ *                    recomputes how long it may sleep. The worker sets Parked before it
+ *                    checks the queue one last time, and producers check Parked after
+ *                    publishing an event. Both sides use sequentially consistent operations,
+ *                    so either the worker sees the event or the producer sees the worker
+ *                    parked and wakes it. Producers never touch a mutex while the worker is busy. */
+void AXLibWakeEventLoop()
+{
+    if(__atomic_load_n(&EventLoop.Parked, __ATOMIC_SEQ_CST))
+    {
+        pthread_mutex_lock(&EventLoop.WorkerLock);
         pthread_cond_signal(&EventLoop.State);
         pthread_mutex_unlock(&EventLoop.WorkerLock);
     }
 }
 
-/* NOTE(koekeishiya): Uses dynamic dispatch to process events of any type. */
+internal void
+AXLibUpdateMaxQueueDepth(ax_event_lane *Lane)
+{
+    uint64_t Head = __atomic_load_n(&Lane->Ring.Head, __ATOMIC_RELAXED);
+    uint64_t Tail = __atomic_load_n(&Lane->Ring.Tail, __ATOMIC_RELAXED);
+    uint64_t Depth = (Head > Tail ? Head - Tail : 0) +
+                     __atomic_load_n(&Lane->OverflowCount, __ATOMIC_RELAXED);
+
+    uint64_t MaxDepth = __atomic_load_n(&Lane->MaxDepth, __ATOMIC_RELAXED);
+    while(Depth > MaxDepth &&
+          !__atomic_compare_exchange_n(&Lane->MaxDepth, &MaxDepth, Depth, true,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/* NOTE(koekeishiya): Called by AXLibInit and AXLibStartEventLoop, before any other thread can
+ *                    ask for a timestamp, so that AXLibGetTimestamp never races to fill it in. */
+void AXLibInitializeTimestamp()
+{
+    if(Timebase.denom == 0)
+        mach_timebase_info(&Timebase);
+}
+
+uint64_t AXLibGetTimestamp()
+{
+    return mach_absolute_time() * Timebase.numer / Timebase.denom;
+}
+
+/* NOTE(koekeishiya): For handlers that decide something based on how much time has passed. The
+ *                    value is recorded, so that a replayed handler decides the same way. */
+uint64_t AXLibGetHandlerTimestamp()
+{
+    uint64_t Result;
+    if(AXLibReplayResponse(AXQuery_Timestamp, &Result, sizeof(Result)))
+        return Result;
+
+    Result = AXLibGetTimestamp();
+    AXLibRecordResponse(AXQuery_Timestamp, &Result, sizeof(Result));
+    return Result;
+}
+
+/* NOTE(koekeishiya): For handlers that decide something based on state that AXLib does not know
+ *                    about. Returns Value, which is recorded, or the recorded value when replaying. */
+int64_t AXLibGetHandlerValue(int64_t Value)
+{
+    int64_t Result;
+    if(AXLibReplayResponse(AXQuery_HandlerValue, &Result, sizeof(Result)))
+        return Result;
+
+    AXLibRecordResponse(AXQuery_HandlerValue, &Value, sizeof(Value));
+    return Value;
+}
+
+/* NOTE(koekeishiya): A mouse event that did not fit in the ring. The events that can be deferred
+ *                    carry no payload, so the handle and a bit for the type is all there is to keep.
+ *                    The handle is published before the bit, the worker reads them in reverse. */
+internal void
+AXLibDeferInputEvent(ax_event *Event)
+{
+    __atomic_store_n(&EventLoop.DeferredHandle[Event->Type], Event->Handle, __ATOMIC_RELEASE);
+    __atomic_or_fetch(&EventLoop.DeferredInput, 1u << (Event->Type - AXEvent_MouseMoved), __ATOMIC_SEQ_CST);
+}
+
+/* NOTE(koekeishiya): Must be thread-safe! Called through AXLibConstructEvent macro.
+ *                    Called from the event tap, so it must not block unless the
+ *                    overflow policy explicitly asks for it. */
+void AXLibAddEvent(ax_event Event)
+{
+    if(EventLoop.Running && Event.Handle)
+    {
+        if(Event.Type != AXEvent_None)
+            Event.Lane = AXLibIsInputEvent(&Event) ? AXEventLane_Interactive : AXEventLane_Background;
+
+        Event.Pending = NULL;
+        Event.Timestamp = AXLibGetTimestamp();
+        if(AXLibCoalesceEvent(&Event))
+            return;
+
+        ax_event_lane *Lane = &EventLoop.Lanes[Event.Lane];
+        if(AXLibHasOverflowEvents(Lane) || !AXLibPushEventRing(&Lane->Ring, &Event))
+        {
+            if(EventLoop.Overflow == AXEventOverflow_Block)
+            {
+                AXLibBlockUntilEventIsQueued(Lane, &Event);
+            }
+            else if(EventLoop.Overflow == AXEventOverflow_DeferInput &&
+                    AXLibIsEventDroppable(&Event))
+            {
+                AXLibReleaseCoalescedEvent(&Event);
+                AXLibReleaseEventPayload(&Event.Payload);
+                AXLibDeferInputEvent(&Event);
+                __atomic_add_fetch(&EventLoop.Dropped, 1, __ATOMIC_RELAXED);
+                AXLibWakeEventLoop();
+                return;
+            }
+            else
+            {
+                AXLibSpillEvent(Lane, &Event);
+            }
+        }
+
+        AXLibUpdateMaxQueueDepth(Lane);
+        AXLibWakeEventLoop();
+    }
+    else
+    {
+        AXLibReleaseEventPayload(&Event.Payload);
+    }
+}
+
+internal bool
+AXLibPopLaneEvent(ax_event_lane *Lane, ax_event *Event)
+{
+    if(AXLibPopEventRing(&Lane->Ring, Event))
+    {
+        if(__atomic_load_n(&EventLoop.Blocked, __ATOMIC_SEQ_CST))
+        {
+            pthread_mutex_lock(&EventLoop.OverflowLock);
+            pthread_cond_broadcast(&EventLoop.Room);
+            pthread_mutex_unlock(&EventLoop.OverflowLock);
+        }
+    }
+    else if(!AXLibHasOverflowEvents(Lane) || !AXLibPopOverflowEvent(Lane, Event))
+    {
+        return false;
+    }
+
+    __atomic_add_fetch(&Lane->Processed, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+/* NOTE(koekeishiya): Interactive events go first, so a hotkey or a kwmc command only ever
+ *                    waits for the handler that is running and at most one background event.
+ *                    A background event waits for no more than AX_EVENT_INTERACTIVE_BURST
+ *                    interactive events, so a flood of input can not starve it. */
+internal bool
+AXLibPopEvent(ax_event *Event)
+{
+    ax_event_lane *Interactive = &EventLoop.Lanes[AXEventLane_Interactive];
+    ax_event_lane *Background = &EventLoop.Lanes[AXEventLane_Background];
+
+    if(EventLoop.InteractiveBurst >= AX_EVENT_INTERACTIVE_BURST &&
+       AXLibPopLaneEvent(Background, Event))
+    {
+        EventLoop.InteractiveBurst = 0;
+        return true;
+    }
+
+    if(AXLibPopLaneEvent(Interactive, Event))
+    {
+        ++EventLoop.InteractiveBurst;
+        return true;
+    }
+
+    EventLoop.InteractiveBurst = 0;
+    return AXLibPopLaneEvent(Background, Event);
+}
+
+internal inline bool
+AXLibIsEventQueueEmpty()
+{
+    for(int Index = 0; Index < AXEventLane_Count; ++Index)
+    {
+        ax_event_lane *Lane = &EventLoop.Lanes[Index];
+        if(!AXLibIsEventRingEmpty(&Lane->Ring) || AXLibHasOverflowEvents(Lane))
+            return false;
+    }
+
+    return true;
+}
+
+/* NOTE(koekeishiya): Values below 4 get a bucket of their own. Above that, the exponent selects
+ *                    a group of four buckets and the two bits below the leading one select the
+ *                    bucket within the group. */
+internal inline int
+AXLibGetHistogramBucket(uint64_t Value)
+{
+    if(Value < 4)
+        return (int) Value;
+
+    int Exponent = 63 - __builtin_clzll(Value);
+    int Bucket = 4 * (Exponent - 1) + (int) ((Value >> (Exponent - 2)) & 3);
+    return Bucket < AX_EVENT_HISTOGRAM_BUCKETS ? Bucket : AX_EVENT_HISTOGRAM_BUCKETS - 1;
+}
+
+/* NOTE(koekeishiya): Returns the largest value that falls in the given bucket. */
+internal inline uint64_t
+AXLibGetHistogramBucketValue(int Bucket)
+{
+    if(Bucket < 4)
+        return (uint64_t) Bucket;
+
+    int Exponent = Bucket / 4 + 1;
+    uint64_t Base = ((uint64_t) 4 | (Bucket % 4)) << (Exponent - 2);
+    return Base + ((uint64_t) 1 << (Exponent - 2)) - 1;
+}
+
+void AXLibRecordHistogramValue(ax_event_histogram *Histogram, uint64_t Value)
+{
+    ++Histogram->Count;
+    Histogram->Total += Value;
+    if(Value > Histogram->Max)
+        Histogram->Max = Value;
+
+    ++Histogram->Buckets[AXLibGetHistogramBucket(Value)];
+}
+
+uint64_t AXLibGetHistogramPercentile(ax_event_histogram *Histogram, double Percentile)
+{
+    if(Histogram->Count == 0)
+        return 0;
+
+    uint64_t Rank = (uint64_t) (Histogram->Count * Percentile / 100.0 + 0.5);
+    if(Rank == 0)
+        Rank = 1;
+
+    uint64_t Seen = 0;
+    for(int Bucket = 0; Bucket < AX_EVENT_HISTOGRAM_BUCKETS; ++Bucket)
+    {
+        Seen += Histogram->Buckets[Bucket];
+        if(Seen >= Rank)
+        {
+            uint64_t Value = AXLibGetHistogramBucketValue(Bucket);
+            return Value < Histogram->Max ? Value : Histogram->Max;
+        }
+    }
+
+    return Histogram->Max;
+}
+
+/* NOTE(koekeishiya): Timings are keyed by the event name. The same name can be a different
+ *                    literal in every translation unit, so names are hashed and compared by
+ *                    their contents; the pointer check only skips the strcmp in the common
+ *                    case. Once the table is full, new names are not recorded. */
+internal ax_event_timing *
+AXLibGetEventTiming(const char *Name)
+{
+    uint32_t Hash = 2166136261u;
+    for(const char *At = Name; *At; ++At)
+        Hash = (Hash ^ (uint8_t) *At) * 16777619u;
+
+    for(int Probe = 0; Probe < AX_EVENT_TIMING_SLOTS; ++Probe)
+    {
+        ax_event_timing *Timing = &EventLoop.Timings[(Hash + Probe) & (AX_EVENT_TIMING_SLOTS - 1)];
+        if(Timing->Name && (Timing->Name == Name || strcmp(Timing->Name, Name) == 0))
+            return Timing;
+
+        if(!Timing->Name)
+        {
+            Timing->Name = Name;
+            return Timing;
+        }
+    }
+
+    return NULL;
+}
+
+internal void
+AXLibReportSlowHandler(ax_event *Event, uint64_t Runtime)
+{
+    __atomic_add_fetch(&EventLoop.SlowHandlers, 1, __ATOMIC_RELAXED);
+    fprintf(stderr, "AXLibProcessEventQueue() slow handler %s: %llu us", Event->Name,
+            (unsigned long long) Runtime);
+
+    switch(Event->Payload.Type)
+    {
+        case AXPayload_WindowID: { fprintf(stderr, ", window %u", Event->Payload.WindowID); } break;
+        case AXPayload_PID: { fprintf(stderr, ", pid %d", (int) Event->Payload.PID); } break;
+        case AXPayload_SockFD: { fprintf(stderr, ", socket %d", Event->Payload.SockFD); } break;
+        case AXPayload_Args:
+        {
+            fprintf(stderr, ", args");
+            for(int Index = 0; Index < AX_EVENT_PAYLOAD_ARGS; ++Index)
+                fprintf(stderr, " %d", Event->Payload.Args[Index]);
+        } break;
+        default: {} break;
+    }
+
+    fprintf(stderr, "\n");
+}
+
+/* NOTE(koekeishiya): Wait is the time from AXLibAddEvent until the handler starts, so a coalesced
+ *                    event is measured from the first event it replaced. Only called by the
+ *                    worker, or by AXLibReplayEventLog, with StateLock held. */
+void AXLibRunEventHandler(ax_event *Event)
+{
+    if(!Event->Name)
+        Event->Name = AXLibGetEventTypeName(Event->Type);
+
+    uint64_t Reads = 0, Writes = 0;
+    bool Recording = AXLibBeginEventRecord();
+    if(Recording)
+        AXLibGetElementCallCount(&Reads, &Writes);
+
+    if(Event->Type != AXEvent_MouseMoved)
+        ++EventLoop.StateEvents;
+
+    uint64_t Start = AXLibGetTimestamp();
+    (*Event->Handle)(Event);
+    uint64_t End = AXLibGetTimestamp();
+
+    if(Recording)
+    {
+        uint64_t EndReads, EndWrites;
+        AXLibGetElementCallCount(&EndReads, &EndWrites);
+        AXLibRecordEvent(Event, Start - Event->Timestamp, End - Start,
+                         (uint32_t) (EndReads - Reads), (uint32_t) (EndWrites - Writes), 0);
+    }
+
+    uint64_t Wait = (Start - Event->Timestamp) / 1000;
+    uint64_t Runtime = (End - Start) / 1000;
+
+    ax_event_timing *Timing = AXLibGetEventTiming(Event->Name);
+    if(Timing)
+    {
+        AXLibRecordHistogramValue(&Timing->Wait, Wait);
+        AXLibRecordHistogramValue(&Timing->Runtime, Runtime);
+    }
+
+    uint64_t Threshold = EventLoop.SlowHandlerThreshold ? EventLoop.SlowHandlerThreshold
+                                                        : AX_EVENT_SLOW_HANDLER_THRESHOLD;
+    if(Runtime >= Threshold)
+        AXLibReportSlowHandler(Event, Runtime);
+}
+
+/* NOTE(koekeishiya): Runs work that does not come through the queue, but changes state, as a
+ *                    recorded handler of its own. */
+internal void
+AXLibRunRecordedSource(ax_event *Event)
+{
+    if(!AXLibBeginEventRecord())
+    {
+        (*Event->Handle)(Event);
+        return;
+    }
+
+    uint64_t Reads, Writes, EndReads, EndWrites;
+    AXLibGetElementCallCount(&Reads, &Writes);
+
+    Event->Timestamp = AXLibGetTimestamp();
+    (*Event->Handle)(Event);
+    uint64_t End = AXLibGetTimestamp();
+
+    AXLibGetElementCallCount(&EndReads, &EndWrites);
+    AXLibRecordEvent(Event, 0, End - Event->Timestamp, (uint32_t) (EndReads - Reads),
+                     (uint32_t) (EndWrites - Writes), AX_EVENT_RECORD_SOURCE);
+}
+
+/* NOTE(koekeishiya): For the window-server callbacks that change state on the thread they are
+ *                    delivered on, instead of queueing an event. The handler runs with StateLock
+ *                    held once the event loop is started, and is recorded when events are, so that
+ *                    AXLibReplayEventLog can run it again in the same order as the queued events.
+ *                    Must not be called from an event handler. */
+void AXLibRunEventSource(ax_event *Event)
+{
+    bool Locked = EventLoop.Running;
+    if(Locked)
+        pthread_mutex_lock(&EventLoop.StateLock);
+
+    AXLibRunRecordedSource(Event);
+
+    if(Locked)
+        pthread_mutex_unlock(&EventLoop.StateLock);
+}
+
+EVENT_CALLBACK(AXLibRunEventBatch)
+{
+    if(EventLoop.BatchCallback)
+        (*EventLoop.BatchCallback)();
+}
+
+/* NOTE(koekeishiya): Only read these from the worker thread, i.e. from an event handler. */
+ax_event_timing *AXLibGetEventTimings()
+{
+    return EventLoop.Timings;
+}
+
+void AXLibSetSlowHandlerThreshold(uint64_t Microseconds)
+{
+    EventLoop.SlowHandlerThreshold = Microseconds;
+}
+
+/* NOTE(koekeishiya): The callback is run by the worker, with StateLock held, every time it has
+ *                    emptied the queue after handling at least one event, right before it goes
+ *                    to sleep. Must be set before the event loop is started. */
+void AXLibSetEventBatchCallback(EventBatchCallback *Callback)
+{
+    EventLoop.BatchCallback = Callback;
+}
+
+/* NOTE(koekeishiya): Number of events handled so far, not counting AXEvent_MouseMoved. A moved
+ *                    cursor does not change what AXLib knows about windows, so a batch callback
+ *                    can compare this count to skip work after a batch that only moved the cursor.
+ *                    Only read this from the worker thread. */
+uint64_t AXLibGetStateEventCount()
+{
+    return EventLoop.StateEvents;
+}
+
+/* NOTE(koekeishiya): pthread_cond_timedwait takes an absolute time of day. */
+internal struct timespec
+AXLibGetWaitDeadline(uint64_t Microseconds)
+{
+    struct timeval Now;
+    gettimeofday(&Now, NULL);
+
+    Microseconds += (uint64_t) Now.tv_usec;
+    struct timespec Deadline;
+    Deadline.tv_sec = Now.tv_sec + (time_t) (Microseconds / 1000000);
+    Deadline.tv_nsec = (long) (Microseconds % 1000000) * 1000;
+    return Deadline;
+}
+
+internal inline bool
+AXLibIsTimerDue()
+{
+    uint64_t Deadline = AXLibGetTimerDeadline();
+    return Deadline != 0 && Deadline <= AXLibGetTimestamp();
+}
+
+/* NOTE(koekeishiya): Parks the worker until an event is queued or deferred, or until the next timer is due. */
+internal void
+AXLibParkEventLoop()
+{
+    pthread_mutex_lock(&EventLoop.WorkerLock);
+    __atomic_store_n(&EventLoop.Parked, true, __ATOMIC_SEQ_CST);
+    while(AXLibIsEventQueueEmpty() && EventLoop.Running && !AXLibIsTimerDue() &&
+          !__atomic_load_n(&EventLoop.DeferredInput, __ATOMIC_SEQ_CST))
+    {
+        uint64_t Deadline = AXLibGetTimerDeadline();
+        if(Deadline)
+        {
+            uint64_t Now = AXLibGetTimestamp();
+            struct timespec Time = AXLibGetWaitDeadline(Deadline > Now ? (Deadline - Now + 999) / 1000 : 0);
+            pthread_cond_timedwait(&EventLoop.State, &EventLoop.WorkerLock, &Time);
+        }
+        else
+        {
+            pthread_cond_wait(&EventLoop.State, &EventLoop.WorkerLock);
+        }
+    }
+    __atomic_store_n(&EventLoop.Parked, false, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&EventLoop.WorkerLock);
+}
+
+/* NOTE(koekeishiya): Called from the space and display notifications, which is the only place
+ *                    the window server is asked about space transitions. The notification has
+ *                    usually arrived after the animation finished, in which case a worker that
+ *                    waits for it is woken right away. Otherwise the same check runs again on the
+ *                    main queue after AX_SPACE_TRANSITION_RECHECK_DELAY microseconds, until the
+ *                    animation has finished. Only one such check is queued at a time. */
+internal bool SpaceTransitionRecheck;
+
+internal void
+AXLibRecheckSpaceTransition(void *)
+{
+    __atomic_store_n(&SpaceTransitionRecheck, false, __ATOMIC_SEQ_CST);
+    AXLibUpdateSpaceTransition();
+}
+
+void AXLibUpdateSpaceTransition()
+{
+    pthread_mutex_lock(&EventLoop.WorkerLock);
+    bool InProgress = AXLibRefreshSpaceTransition();
+    if(!InProgress)
+        pthread_cond_broadcast(&EventLoop.State);
+    pthread_mutex_unlock(&EventLoop.WorkerLock);
+
+    if(InProgress && !__atomic_exchange_n(&SpaceTransitionRecheck, true, __ATOMIC_SEQ_CST))
+    {
+        dispatch_time_t When = dispatch_time(DISPATCH_TIME_NOW, AX_SPACE_TRANSITION_RECHECK_DELAY * NSEC_PER_USEC);
+        dispatch_after_f(When, dispatch_get_main_queue(), NULL, &AXLibRecheckSpaceTransition);
+    }
+}
+
+/* NOTE(koekeishiya): The worker sleeps while a space transition is in progress, until
+ *                    AXLibUpdateSpaceTransition sees the animation end. Parked is not set,
+ *                    so new events do not wake the worker while it waits. */
+internal void
+AXLibWaitForSpaceTransition()
+{
+    pthread_mutex_lock(&EventLoop.WorkerLock);
+    while(EventLoop.Running && AXLibIsSpaceTransitionInProgress())
+        pthread_cond_wait(&EventLoop.State, &EventLoop.WorkerLock);
+    pthread_mutex_unlock(&EventLoop.WorkerLock);
+}
+
+/* NOTE(koekeishiya): Handles one event of every type that was deferred since the last call, so the
+ *                    newest cursor position is never lost when the ring overflows. */
+internal bool
+AXLibRunDeferredInput()
+{
+    uint32_t Deferred = __atomic_exchange_n(&EventLoop.DeferredInput, 0, __ATOMIC_ACQUIRE);
+    if(!Deferred)
+        return false;
+
+    for(int Type = AXEvent_MouseMoved; Type < AXEvent_Count; ++Type)
+    {
+        if(!(Deferred & (1u << (Type - AXEvent_MouseMoved))))
+            continue;
+
+        ax_event Event = {};
+        Event.Type = (ax_event_type) Type;
+        Event.Lane = AXEventLane_Interactive;
+        Event.Handle = __atomic_load_n(&EventLoop.DeferredHandle[Type], __ATOMIC_ACQUIRE);
+        Event.Payload = AXLibEmptyPayload();
+        Event.Timestamp = AXLibGetTimestamp();
+
+        pthread_mutex_lock(&EventLoop.StateLock);
+        AXLibRunEventHandler(&Event);
+        pthread_mutex_unlock(&EventLoop.StateLock);
+    }
+
+    return true;
+}
+
+/* NOTE(koekeishiya): Uses dynamic dispatch to process events of any type.
+ *                    StateLock is only held while a handler runs, so that
+ *                    AXLibPauseEventLoop can interleave with the worker.
+ *                    Handlers read the cached space transition state, which
+ *                    only the space and display notifications update. */
 internal void *
 AXLibProcessEventQueue(void *)
 {
     while(EventLoop.Running)
     {
-        pthread_mutex_lock(&EventLoop.StateLock);
-        while(!EventLoop.Queue.empty())
+        AXLibExpireTimers();
+
+        bool Handled = false;
+        while(!AXLibIsEventQueueEmpty() && EventLoop.Running)
         {
-            if(!AXLibIsSpaceTransitionInProgress())
-            {
-                pthread_mutex_lock(&EventLoop.WorkerLock);
-                ax_event Event = EventLoop.Queue.front();
-                EventLoop.Queue.pop();
-                pthread_mutex_unlock(&EventLoop.WorkerLock);
+            if(AXLibIsSpaceTransitionInProgress())
+                AXLibWaitForSpaceTransition();
+
+            if(AXLibIsTimerDue())
+                AXLibExpireTimers();
 
-                (*Event.Handle)(&Event);
+            ax_event Event;
+            if(AXLibPopEvent(&Event))
+            {
+                AXLibReleaseCoalescedEvent(&Event);
+                pthread_mutex_lock(&EventLoop.StateLock);
+                AXLibRunEventHandler(&Event);
+                pthread_mutex_unlock(&EventLoop.StateLock);
+                AXLibReleaseEventPayload(&Event.Payload);
+                Handled = true;
             }
         }
 
-        while(EventLoop.Queue.empty() && EventLoop.Running)
-            pthread_cond_wait(&EventLoop.State, &EventLoop.StateLock);
+        if(AXLibRunDeferredInput())
+            Handled = true;
 
-        pthread_mutex_unlock(&EventLoop.StateLock);
+        if(Handled && EventLoop.BatchCallback)
+        {
+            ax_event Event = {};
+            Event.Name = "AXLibEventBatch";
+            Event.Handle = &AXLibRunEventBatch;
+            pthread_mutex_lock(&EventLoop.StateLock);
+            AXLibRunRecordedSource(&Event);
+            pthread_mutex_unlock(&EventLoop.StateLock);
+        }
+
+        AXLibParkEventLoop();
     }
 
     return NULL;
 }
 
-/* NOTE(koekeishiya): Initialize required mutexes and condition for the event-loop */
+/* NOTE(koekeishiya): Blocks of AX_EVENT_PAYLOAD_BLOCK_SIZE bytes are recycled through a free-list,
+ *                    larger payloads go straight to the allocator. Only used by the rare events
+ *                    whose payload does not fit inline. */
+#define AX_EVENT_PAYLOAD_BLOCK_SIZE 256
+void *AXLibAllocateEventPayload(ax_event_payload *Payload, size_t Size)
+{
+    void *Data = NULL;
+    if(Size <= AX_EVENT_PAYLOAD_BLOCK_SIZE)
+    {
+        pthread_mutex_lock(&EventLoop.PoolLock);
+        if(!EventLoop.Pool.empty())
+        {
+            Data = EventLoop.Pool.back();
+            EventLoop.Pool.pop_back();
+        }
+        pthread_mutex_unlock(&EventLoop.PoolLock);
+
+        if(!Data)
+            Data = malloc(AX_EVENT_PAYLOAD_BLOCK_SIZE);
+    }
+    else
+    {
+        Data = malloc(Size);
+    }
+
+    Payload->Type = AXPayload_Block;
+    Payload->Block.Data = Data;
+    Payload->Block.Size = Size;
+    return Data;
+}
+
+void AXLibReleaseEventPayload(ax_event_payload *Payload)
+{
+    if(Payload->Type == AXPayload_Block && Payload->Block.Data)
+    {
+        if(Payload->Block.Size <= AX_EVENT_PAYLOAD_BLOCK_SIZE)
+        {
+            pthread_mutex_lock(&EventLoop.PoolLock);
+            EventLoop.Pool.push_back(Payload->Block.Data);
+            pthread_mutex_unlock(&EventLoop.PoolLock);
+        }
+        else
+        {
+            free(Payload->Block.Data);
+        }
+
+        Payload->Block.Data = NULL;
+    }
+}
+
+void AXLibGetEventLoopStatistics(ax_event_loop_statistics *Statistics)
+{
+    for(int Type = 0; Type < AXEvent_Count; ++Type)
+        Statistics->Coalesced[Type] = __atomic_load_n(&EventLoop.Coalesced[Type], __ATOMIC_RELAXED);
+
+    for(int Index = 0; Index < AXEventLane_Count; ++Index)
+    {
+        ax_event_lane *Lane = &EventLoop.Lanes[Index];
+        uint64_t Head = __atomic_load_n(&Lane->Ring.Head, __ATOMIC_RELAXED);
+        uint64_t Tail = __atomic_load_n(&Lane->Ring.Tail, __ATOMIC_RELAXED);
+        Statistics->Depth[Index] = (Head > Tail ? Head - Tail : 0) +
+                                   __atomic_load_n(&Lane->OverflowCount, __ATOMIC_RELAXED);
+        Statistics->MaxDepth[Index] = __atomic_load_n(&Lane->MaxDepth, __ATOMIC_RELAXED);
+        Statistics->Processed[Index] = __atomic_load_n(&Lane->Processed, __ATOMIC_RELAXED);
+    }
+
+    Statistics->SlowHandlers = __atomic_load_n(&EventLoop.SlowHandlers, __ATOMIC_RELAXED);
+
+    Statistics->Dropped = __atomic_load_n(&EventLoop.Dropped, __ATOMIC_RELAXED);
+    Statistics->Spilled = __atomic_load_n(&EventLoop.Spilled, __ATOMIC_RELAXED);
+}
+
+const char *AXLibGetEventLaneName(ax_event_lane_type Lane)
+{
+    switch(Lane)
+    {
+        case AXEventLane_Interactive: return "interactive";
+        case AXEventLane_Background: return "background";
+        default: return "none";
+    }
+}
+
+const char *AXLibGetEventTypeName(ax_event_type Type)
+{
+    switch(Type)
+    {
+        case AXEvent_ApplicationLaunched: return "application_launched";
+        case AXEvent_ApplicationTerminated: return "application_terminated";
+        case AXEvent_ApplicationActivated: return "application_activated";
+        case AXEvent_ApplicationVisible: return "application_visible";
+        case AXEvent_ApplicationHidden: return "application_hidden";
+        case AXEvent_WindowCreated: return "window_created";
+        case AXEvent_WindowDestroyed: return "window_destroyed";
+        case AXEvent_WindowFocused: return "window_focused";
+        case AXEvent_WindowMoved: return "window_moved";
+        case AXEvent_WindowResized: return "window_resized";
+        case AXEvent_WindowMinimized: return "window_minimized";
+        case AXEvent_WindowDeminimized: return "window_deminimized";
+        case AXEvent_WindowTitleChanged: return "window_title_changed";
+        case AXEvent_DisplayAdded: return "display_added";
+        case AXEvent_DisplayRemoved: return "display_removed";
+        case AXEvent_DisplayMoved: return "display_moved";
+        case AXEvent_DisplayResized: return "display_resized";
+        case AXEvent_DisplayChanged: return "display_changed";
+        case AXEvent_SpaceChanged: return "space_changed";
+        case AXEvent_MouseMoved: return "mouse_moved";
+        case AXEvent_LeftMouseDragged: return "left_mouse_dragged";
+        case AXEvent_LeftMouseDown: return "left_mouse_down";
+        case AXEvent_LeftMouseUp: return "left_mouse_up";
+        case AXEvent_RightMouseDragged: return "right_mouse_dragged";
+        case AXEvent_RightMouseDown: return "right_mouse_down";
+        case AXEvent_RightMouseUp: return "right_mouse_up";
+        default: return "none";
+    }
+}
+
+/* NOTE(koekeishiya): Must be called before AXLibStartEventLoop. The capacity is rounded up to a power of two. */
+void AXLibConfigureEventLoop(uint32_t Capacity, ax_event_overflow Overflow)
+{
+    if(!EventLoop.Running)
+    {
+        EventLoop.Capacity = Capacity;
+        EventLoop.Overflow = Overflow;
+    }
+}
+
+internal bool
+AXLibInitializeEventRing(ax_event_ring *Ring, uint32_t Capacity)
+{
+    uint64_t Size = 2;
+    while(Size < Capacity)
+        Size <<= 1;
+
+    Ring->Slots = (ax_event_slot *) malloc(Size * sizeof(ax_event_slot));
+    if(!Ring->Slots)
+        return false;
+
+    for(uint64_t Index = 0; Index < Size; ++Index)
+        Ring->Slots[Index].Sequence = Index;
+
+    Ring->Mask = Size - 1;
+    Ring->Head = 0;
+    Ring->Tail = 0;
+    return true;
+}
+
+/* NOTE(koekeishiya): Initialize required mutexes, conditions and the ring for the event-loop */
 internal bool
 AXLibInitializeEventLoop()
 {
@@ -65,23 +966,78 @@ AXLibInitializeEventLoop()
        return false;
    }
 
+   if(pthread_mutex_init(&EventLoop.OverflowLock, NULL) != 0)
+   {
+       pthread_mutex_destroy(&EventLoop.WorkerLock);
+       pthread_mutex_destroy(&EventLoop.StateLock);
+       return false;
+   }
+
+   if(pthread_mutex_init(&EventLoop.PoolLock, NULL) != 0)
+   {
+       pthread_mutex_destroy(&EventLoop.WorkerLock);
+       pthread_mutex_destroy(&EventLoop.StateLock);
+       pthread_mutex_destroy(&EventLoop.OverflowLock);
+       return false;
+   }
+
    if(pthread_cond_init(&EventLoop.State, NULL) != 0)
    {
         pthread_mutex_destroy(&EventLoop.WorkerLock);
         pthread_mutex_destroy(&EventLoop.StateLock);
+        pthread_mutex_destroy(&EventLoop.OverflowLock);
+        pthread_mutex_destroy(&EventLoop.PoolLock);
+        return false;
+   }
+
+   if(pthread_cond_init(&EventLoop.Room, NULL) != 0)
+   {
+        pthread_cond_destroy(&EventLoop.State);
+        pthread_mutex_destroy(&EventLoop.WorkerLock);
+        pthread_mutex_destroy(&EventLoop.StateLock);
+        pthread_mutex_destroy(&EventLoop.OverflowLock);
+        pthread_mutex_destroy(&EventLoop.PoolLock);
+        return false;
+   }
+
+   uint32_t Capacity = EventLoop.Capacity ? EventLoop.Capacity : AX_EVENT_QUEUE_CAPACITY;
+   if(!AXLibInitializeEventRing(&EventLoop.Lanes[AXEventLane_Interactive].Ring, Capacity) ||
+      !AXLibInitializeEventRing(&EventLoop.Lanes[AXEventLane_Background].Ring, Capacity))
+   {
+        free(EventLoop.Lanes[AXEventLane_Interactive].Ring.Slots);
+        EventLoop.Lanes[AXEventLane_Interactive].Ring.Slots = NULL;
+        pthread_cond_destroy(&EventLoop.Room);
+        pthread_cond_destroy(&EventLoop.State);
+        pthread_mutex_destroy(&EventLoop.WorkerLock);
+        pthread_mutex_destroy(&EventLoop.StateLock);
+        pthread_mutex_destroy(&EventLoop.OverflowLock);
+        pthread_mutex_destroy(&EventLoop.PoolLock);
         return false;
    }
 
    return true;
 }
 
-/* NOTE(koekeishiya): Destroy mutexes and condition used by the event-loop */
+/* NOTE(koekeishiya): Destroy mutexes, conditions and the ring used by the event-loop */
 internal void
 AXLibTerminateEventLoop()
 {
+    pthread_cond_destroy(&EventLoop.Room);
     pthread_cond_destroy(&EventLoop.State);
+    pthread_mutex_destroy(&EventLoop.PoolLock);
+    pthread_mutex_destroy(&EventLoop.OverflowLock);
     pthread_mutex_destroy(&EventLoop.StateLock);
     pthread_mutex_destroy(&EventLoop.WorkerLock);
+
+    for(int Index = 0; Index < AXEventLane_Count; ++Index)
+    {
+        free(EventLoop.Lanes[Index].Ring.Slots);
+        EventLoop.Lanes[Index].Ring.Slots = NULL;
+    }
+
+    for(std::size_t Index = 0; Index < EventLoop.Pool.size(); ++Index)
+        free(EventLoop.Pool[Index]);
+    EventLoop.Pool.clear();
 }
 
 void AXLibPauseEventLoop()
@@ -108,6 +1064,7 @@ void AXLibResumeEventLoop()
 
 bool AXLibStartEventLoop()
 {
+    AXLibInitializeTimestamp();
     if(!EventLoop.Running && AXLibInitializeEventLoop())
     {
         EventLoop.Running = true;
@@ -123,7 +1080,15 @@ void AXLibStopEventLoop()
     if(EventLoop.Running)
     {
         EventLoop.Running = false;
+
+        pthread_mutex_lock(&EventLoop.WorkerLock);
         pthread_cond_signal(&EventLoop.State);
+        pthread_mutex_unlock(&EventLoop.WorkerLock);
+
+        pthread_mutex_lock(&EventLoop.OverflowLock);
+        pthread_cond_broadcast(&EventLoop.Room);
+        pthread_mutex_unlock(&EventLoop.OverflowLock);
+
         pthread_join(EventLoop.Worker, NULL);
         AXLibTerminateEventLoop();
     }
@@ -2,13 +2,21 @@
 #define AXLIB_EVENT_H
 
 #include <pthread.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
 #include <queue>
+#include <vector>
 
 struct ax_event;
+struct ax_display;
 
 #define EVENT_CALLBACK(name) void name(ax_event *Event)
 typedef EVENT_CALLBACK(EventCallback);
 
+#define EVENT_BATCH_CALLBACK(name) void name()
+typedef EVENT_BATCH_CALLBACK(EventBatchCallback);
+
 /* NOTE(koekeishiya): Declare ax_event_type callbacks as external functions.
  *                    These callbacks should be defined in user-code as necessary. */
 extern EVENT_CALLBACK(Callback_AXEvent_ApplicationLaunched);
@@ -44,6 +52,8 @@ extern EVENT_CALLBACK(Callback_AXEvent_RightMouseUp);
 
 enum ax_event_type
 {
+    AXEvent_None,
+
     AXEvent_ApplicationLaunched,
     AXEvent_ApplicationTerminated,
     AXEvent_ApplicationActivated,
@@ -75,15 +85,176 @@ enum ax_event_type
     AXEvent_RightMouseDragged,
     AXEvent_RightMouseDown,
     AXEvent_RightMouseUp,
+
+    AXEvent_Count
+};
+
+enum ax_event_payload_type
+{
+    AXPayload_None,
+    AXPayload_WindowID,
+    AXPayload_PID,
+    AXPayload_Display,
+    AXPayload_SockFD,
+    AXPayload_Args,
+    AXPayload_Block,
+};
+
+struct ax_event_block
+{
+    void *Data;
+    size_t Size;
+};
+
+/* NOTE(koekeishiya): Events carry their payload by value. Payloads that do not fit inline
+ *                    use a block from AXLibAllocateEventPayload, which the event loop gives
+ *                    back once the handler has returned or the event has been dropped. */
+#define AX_EVENT_PAYLOAD_ARGS 4
+struct ax_event_payload
+{
+    ax_event_payload_type Type;
+    union
+    {
+        uint32_t WindowID;
+        pid_t PID;
+        ax_display *Display;
+        int SockFD;
+        int Args[AX_EVENT_PAYLOAD_ARGS];
+        ax_event_block Block;
+    };
+};
+
+/* NOTE(koekeishiya): Input and IPC events are interactive, window-server notifications are
+ *                    background work. Events constructed by user-code default to interactive. */
+enum ax_event_lane_type
+{
+    AXEventLane_Interactive,
+    AXEventLane_Background,
+
+    AXEventLane_Count
 };
 
+/* NOTE(koekeishiya): Pending points to the coalescing slot of the event while it is queued,
+ *                    or NULL if it is not tracked. Timestamp is the time the event was queued.
+ *                    Both are set by the event loop, not by producers. */
 struct ax_event
 {
+    ax_event_type Type;
+    ax_event_lane_type Lane;
+    const char *Name;
     EventCallback *Handle;
     bool Intrinsic;
-    void *Context;
+    ax_event_payload Payload;
+    uint64_t *Pending;
+    uint64_t Timestamp;
+};
+
+inline ax_event_payload
+AXLibEmptyPayload()
+{
+    ax_event_payload Payload = {};
+    Payload.Type = AXPayload_None;
+    return Payload;
+}
+
+inline ax_event_payload
+AXLibWindowPayload(uint32_t WindowID)
+{
+    ax_event_payload Payload = {};
+    Payload.Type = AXPayload_WindowID;
+    Payload.WindowID = WindowID;
+    return Payload;
+}
+
+inline ax_event_payload
+AXLibPIDPayload(pid_t PID)
+{
+    ax_event_payload Payload = {};
+    Payload.Type = AXPayload_PID;
+    Payload.PID = PID;
+    return Payload;
+}
+
+inline ax_event_payload
+AXLibDisplayPayload(ax_display *Display)
+{
+    ax_event_payload Payload = {};
+    Payload.Type = AXPayload_Display;
+    Payload.Display = Display;
+    return Payload;
+}
+
+/* NOTE(koekeishiya): What AXLibAddEvent does when the ring is full.
+ *                    DeferInput:      mouse-move and drag events are not queued. Their handlers
+ *                                     read the current cursor, so only the type is remembered and
+ *                                     one event of each remembered type is handled after the
+ *                                     worker has drained the queue. Everything else is spilled (default).
+ *                    Grow:            spill the event to an unbounded overflow queue.
+ *                    Block:           wait until the worker has made room. */
+enum ax_event_overflow
+{
+    AXEventOverflow_DeferInput,
+    AXEventOverflow_Grow,
+    AXEventOverflow_Block,
 };
 
+#define AX_EVENT_QUEUE_CAPACITY 1024
+#define AX_EVENT_COALESCE_SLOTS 256
+struct ax_event_slot
+{
+    uint64_t Sequence;
+    ax_event Event;
+};
+
+/* NOTE(koekeishiya): Bounded multi-producer / single-consumer ring. Producers claim a slot by
+ *                    advancing Head and publish it through the sequence number of the slot.
+ *                    Only the worker reads Tail. */
+struct ax_event_ring
+{
+    ax_event_slot *Slots;
+    uint64_t Mask;
+    uint64_t Head;
+    uint64_t Tail;
+};
+
+/* NOTE(koekeishiya): Every lane has its own ring and overflow queue. */
+struct ax_event_lane
+{
+    ax_event_ring Ring;
+    std::queue<ax_event> OverflowQueue;
+    uint32_t OverflowCount;
+    uint64_t Processed;
+    uint64_t MaxDepth;
+};
+
+/* NOTE(koekeishiya): Log-linear histogram of durations in microseconds. Every power of two is
+ *                    split in four buckets, so a recorded value is off by at most 25%. */
+#define AX_EVENT_HISTOGRAM_BUCKETS 128
+struct ax_event_histogram
+{
+    uint64_t Count;
+    uint64_t Total;
+    uint64_t Max;
+    uint64_t Buckets[AX_EVENT_HISTOGRAM_BUCKETS];
+};
+
+/* NOTE(koekeishiya): Time spent in the queue and in the handler, per event name. Only the
+ *                    worker thread writes or reads these, so they need no synchronization. */
+#define AX_EVENT_TIMING_SLOTS 128
+struct ax_event_timing
+{
+    const char *Name;
+    ax_event_histogram Wait;
+    ax_event_histogram Runtime;
+};
+
+#define AX_EVENT_SLOW_HANDLER_THRESHOLD 50000
+#define AX_SPACE_TRANSITION_RECHECK_DELAY 100000
+
+/* NOTE(koekeishiya): The worker prefers the interactive lane, but after this many interactive
+ *                    events in a row it takes one background event if there is one waiting. */
+#define AX_EVENT_INTERACTIVE_BURST 8
+
 struct ax_event_loop
 {
     pthread_cond_t State;
@@ -91,9 +262,48 @@ struct ax_event_loop
     pthread_mutex_t WorkerLock;
     pthread_t Worker;
     bool Running;
-    std::queue<ax_event> Queue;
+    bool Parked;
+
+    uint32_t Capacity;
+    ax_event_overflow Overflow;
+    ax_event_lane Lanes[AXEventLane_Count];
+    uint32_t InteractiveBurst;
+
+    pthread_cond_t Room;
+    pthread_mutex_t OverflowLock;
+    uint32_t Blocked;
+
+    uint64_t Coalesce[AX_EVENT_COALESCE_SLOTS];
+    uint64_t Coalesced[AXEvent_Count];
+
+    pthread_mutex_t PoolLock;
+    std::vector<void *> Pool;
+
+    ax_event_timing Timings[AX_EVENT_TIMING_SLOTS];
+    uint64_t SlowHandlerThreshold;
+    uint64_t SlowHandlers;
+
+    uint64_t Dropped;
+    uint64_t Spilled;
+    uint32_t DeferredInput;
+    EventCallback *DeferredHandle[AXEvent_Count];
+    uint64_t StateEvents;
+
+    EventBatchCallback *BatchCallback;
+};
+
+struct ax_event_loop_statistics
+{
+    uint64_t Coalesced[AXEvent_Count];
+    uint64_t Depth[AXEventLane_Count];
+    uint64_t MaxDepth[AXEventLane_Count];
+    uint64_t Processed[AXEventLane_Count];
+    uint64_t SlowHandlers;
+    uint64_t Dropped;
+    uint64_t Spilled;
 };
 
+void AXLibConfigureEventLoop(uint32_t Capacity, ax_event_overflow Overflow);
 bool AXLibStartEventLoop();
 void AXLibStopEventLoop();
 
@@ -101,11 +311,34 @@ void AXLibPauseEventLoop();
 void AXLibResumeEventLoop();
 
 void AXLibAddEvent(ax_event Event);
+void AXLibRunEventHandler(ax_event *Event);
+void AXLibRunEventSource(ax_event *Event);
+EVENT_CALLBACK(AXLibRunEventBatch);
+void *AXLibAllocateEventPayload(ax_event_payload *Payload, size_t Size);
+void AXLibReleaseEventPayload(ax_event_payload *Payload);
+void AXLibGetEventLoopStatistics(ax_event_loop_statistics *Statistics);
+const char *AXLibGetEventTypeName(ax_event_type Type);
+const char *AXLibGetEventLaneName(ax_event_lane_type Lane);
+
+void AXLibWakeEventLoop();
+void AXLibUpdateSpaceTransition();
+void AXLibInitializeTimestamp();
+uint64_t AXLibGetTimestamp();
+uint64_t AXLibGetHandlerTimestamp();
+int64_t AXLibGetHandlerValue(int64_t Value);
+void AXLibSetSlowHandlerThreshold(uint64_t Microseconds);
+void AXLibSetEventBatchCallback(EventBatchCallback *Callback);
+uint64_t AXLibGetStateEventCount();
+ax_event_timing *AXLibGetEventTimings();
+void AXLibRecordHistogramValue(ax_event_histogram *Histogram, uint64_t Value);
+uint64_t AXLibGetHistogramPercentile(ax_event_histogram *Histogram, double Percentile);
 
 /* NOTE(koekeishiya): Construct an ax_event with the appropriate callback through macro expansion. */
-#define AXLibConstructEvent(EventType, EventContext, EventIntrinsic) \
+#define AXLibConstructEvent(EventType, EventPayload, EventIntrinsic) \
     do { ax_event Event = {}; \
-         Event.Context = EventContext; \
+         Event.Type = EventType; \
+         Event.Name = #EventType; \
+         Event.Payload = EventPayload; \
          Event.Intrinsic = EventIntrinsic; \
          Event.Handle = &Callback_##EventType; \
          AXLibAddEvent(Event); \
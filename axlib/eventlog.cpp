@@ -0,0 +1,636 @@
+#include "eventlog.h"
+#include "axlib.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define internal static
+
+struct ax_event_log
+{
+    FILE *Handle;
+    uint64_t Start;
+    std::vector<const char *> Names;
+};
+
+/* NOTE(koekeishiya): The responses of the record that is being written or replayed. Every record
+ *                    is written or replayed with StateLock held, or before the event loop is
+ *                    started, so there is only ever one. Queries from any other thread, such as
+ *                    the workspace notifications on the main thread, are not part of it, which
+ *                    is what EventTapeOwner is for. */
+struct ax_event_tape
+{
+    std::string Data;
+    std::size_t At;
+    const char *Name;
+    bool Replaying;
+    uint64_t Mismatches;
+};
+
+internal ax_event_log EventLog = {};
+internal ax_event_tape EventTape = {};
+internal __thread bool EventTapeOwner;
+internal std::map<std::string, EventCallback *> ReplayHandlers;
+
+/* NOTE(koekeishiya): Only called from the worker thread, or before the event loop is started. */
+bool AXLibStartEventRecording(const char *Path)
+{
+    AXLibStopEventRecording();
+    AXLibInitializeTimestamp();
+
+    FILE *Handle = fopen(Path, "wb");
+    if(!Handle)
+        return false;
+
+    uint32_t Header[2] = { AX_EVENT_LOG_MAGIC, AX_EVENT_LOG_VERSION };
+    if(fwrite(Header, sizeof(Header), 1, Handle) != 1)
+    {
+        fclose(Handle);
+        return false;
+    }
+
+    EventLog.Handle = Handle;
+    EventLog.Start = AXLibGetTimestamp();
+    EventLog.Names.clear();
+    return true;
+}
+
+void AXLibStopEventRecording()
+{
+    if(EventLog.Handle)
+    {
+        fclose(EventLog.Handle);
+        EventLog.Handle = NULL;
+    }
+}
+
+bool AXLibIsRecordingEvents()
+{
+    return EventLog.Handle != NULL;
+}
+
+/* NOTE(koekeishiya): Called right before a handler runs. Returns true if the handler is to be
+ *                    recorded, in which case the responses it observes are kept until the
+ *                    record is written by AXLibRecordEvent. A handler that runs inside another
+ *                    one is part of the record of the outer handler. */
+bool AXLibBeginEventRecord()
+{
+    if(!EventLog.Handle || EventTapeOwner)
+        return false;
+
+    EventTape.Data.clear();
+    EventTapeOwner = true;
+    return true;
+}
+
+void AXLibRecordResponse(ax_event_query Query, const void *Data, uint32_t Size)
+{
+    if(!EventTapeOwner || EventTape.Replaying)
+        return;
+
+    ax_event_response Response = {};
+    Response.Query = (uint16_t) Query;
+    Response.Size = Size;
+    EventTape.Data.append((const char *) &Response, sizeof(Response));
+    if(Size)
+        EventTape.Data.append((const char *) Data, Size);
+}
+
+/* NOTE(koekeishiya): A string is written with its terminating null, so that a response of
+ *                    zero bytes is a NULL string. */
+void AXLibRecordResponse(ax_event_query Query, CFStringRef String)
+{
+    if(!EventTapeOwner || EventTape.Replaying)
+        return;
+
+    char *Value = String ? CopyCFStringToC(String, true) : NULL;
+    AXLibRecordResponse(Query, Value, Value ? (uint32_t) strlen(Value) + 1 : 0);
+    free(Value);
+}
+
+internal bool
+AXLibPeekResponse(ax_event_query Query, ax_event_response *Response)
+{
+    if(!EventTapeOwner || !EventTape.Replaying)
+        return false;
+
+    if(EventTape.At + sizeof(ax_event_response) <= EventTape.Data.size())
+    {
+        memcpy(Response, EventTape.Data.data() + EventTape.At, sizeof(ax_event_response));
+        if(Response->Query == Query &&
+           EventTape.At + sizeof(ax_event_response) + Response->Size <= EventTape.Data.size())
+            return true;
+    }
+
+    fprintf(stderr, "AXLibReplayEventLog() %s: query %d was not recorded here\n", EventTape.Name, Query);
+    ++EventTape.Mismatches;
+    return false;
+}
+
+/* NOTE(koekeishiya): Returns true and the recorded response if a handler is being replayed and
+ *                    the next response of its record is for this query. Otherwise the caller
+ *                    asks the window system, and should record what it got. */
+bool AXLibReplayResponse(ax_event_query Query, void *Data, uint32_t Size)
+{
+    ax_event_response Response;
+    if(!AXLibPeekResponse(Query, &Response))
+        return false;
+
+    if(Response.Size != Size)
+    {
+        fprintf(stderr, "AXLibReplayEventLog() %s: query %d has %u bytes, expected %u\n",
+                EventTape.Name, Query, Response.Size, Size);
+        ++EventTape.Mismatches;
+        return false;
+    }
+
+    memcpy(Data, EventTape.Data.data() + EventTape.At + sizeof(Response), Size);
+    EventTape.At += sizeof(Response) + Size;
+    return true;
+}
+
+bool AXLibReplayResponse(ax_event_query Query, std::string *Data)
+{
+    ax_event_response Response;
+    if(!AXLibPeekResponse(Query, &Response))
+        return false;
+
+    Data->assign(EventTape.Data.data() + EventTape.At + sizeof(Response), Response.Size);
+    EventTape.At += sizeof(Response) + Response.Size;
+    return true;
+}
+
+/* NOTE(koekeishiya): Writes that a handler makes to the window system are skipped while it is
+ *                    replayed, unless their result was recorded. */
+bool AXLibIsReplayingEvents()
+{
+    return EventTapeOwner && EventTape.Replaying;
+}
+
+/* NOTE(koekeishiya): Stands in for an element that the recorded handler was given by the window
+ *                    system. Everything the handler asks about it is answered from the log. */
+AXUIElementRef AXLibReplayElement()
+{
+    return AXUIElementCreateApplication(0);
+}
+
+struct ax_display_response
+{
+    CGDirectDisplayID ID;
+    uint32_t ArrangementID;
+    CGRect Frame;
+    CGSSpaceID Space;
+    uint32_t Spaces;
+    uint32_t IdentifierLength;
+};
+
+struct ax_space_response
+{
+    CGSSpaceID ID;
+    CGSSpaceType Type;
+    uint32_t IdentifierLength;
+};
+
+/* NOTE(koekeishiya): The displays are written as one response: an ax_display_response per display
+ *                    followed by its identifier, then an ax_space_response per space followed by
+ *                    its identifier. */
+void AXLibRecordDisplays(std::map<CGDirectDisplayID, ax_display> *Displays)
+{
+    if(!EventTapeOwner || EventTape.Replaying)
+        return;
+
+    std::string Data;
+    std::map<CGDirectDisplayID, ax_display>::iterator It;
+    for(It = Displays->begin(); It != Displays->end(); ++It)
+    {
+        ax_display *Display = &It->second;
+        char *Identifier = Display->Identifier ? CopyCFStringToC(Display->Identifier, true) : NULL;
+
+        ax_display_response Response = {};
+        Response.ID = Display->ID;
+        Response.ArrangementID = Display->ArrangementID;
+        Response.Frame = Display->Frame;
+        Response.Space = Display->Space ? Display->Space->ID : 0;
+        Response.Spaces = (uint32_t) Display->Spaces.size();
+        Response.IdentifierLength = Identifier ? (uint32_t) strlen(Identifier) : 0;
+        Data.append((const char *) &Response, sizeof(Response));
+        Data.append(Identifier ? Identifier : "", Response.IdentifierLength);
+        free(Identifier);
+
+        std::map<CGSSpaceID, ax_space>::iterator SpaceIt;
+        for(SpaceIt = Display->Spaces.begin(); SpaceIt != Display->Spaces.end(); ++SpaceIt)
+        {
+            ax_space_response Space = {};
+            Space.ID = SpaceIt->second.ID;
+            Space.Type = SpaceIt->second.Type;
+            Space.IdentifierLength = (uint32_t) SpaceIt->second.Identifier.size();
+            Data.append((const char *) &Space, sizeof(Space));
+            Data.append(SpaceIt->second.Identifier);
+        }
+    }
+
+    AXLibRecordResponse(AXQuery_Displays, Data.data(), (uint32_t) Data.size());
+}
+
+internal bool
+AXLibReadResponse(std::string *Data, std::size_t *At, void *Value, std::size_t Size)
+{
+    if(*At + Size > Data->size())
+        return false;
+
+    memcpy(Value, Data->data() + *At, Size);
+    *At += Size;
+    return true;
+}
+
+bool AXLibReplayDisplays(std::map<CGDirectDisplayID, ax_display> *Displays)
+{
+    std::string Data;
+    if(!AXLibReplayResponse(AXQuery_Displays, &Data))
+        return false;
+
+    std::size_t At = 0;
+    ax_display_response Response;
+    while(AXLibReadResponse(&Data, &At, &Response, sizeof(Response)))
+    {
+        std::string Identifier(Response.IdentifierLength, '\0');
+        if(Response.IdentifierLength)
+            AXLibReadResponse(&Data, &At, &Identifier[0], Response.IdentifierLength);
+
+        ax_display *Display = &(*Displays)[Response.ID];
+        Display->ID = Response.ID;
+        Display->ArrangementID = Response.ArrangementID;
+        Display->Frame = Response.Frame;
+        Display->Identifier = CFStringCreateWithCString(NULL, Identifier.c_str(), kCFStringEncodingUTF8);
+
+        for(uint32_t Index = 0; Index < Response.Spaces; ++Index)
+        {
+            ax_space_response Space;
+            if(!AXLibReadResponse(&Data, &At, &Space, sizeof(Space)))
+                break;
+
+            ax_space *Entry = &Display->Spaces[Space.ID];
+            Entry->ID = Space.ID;
+            Entry->Type = Space.Type;
+            Entry->Identifier.assign(Space.IdentifierLength, '\0');
+            if(Space.IdentifierLength)
+                AXLibReadResponse(&Data, &At, &Entry->Identifier[0], Space.IdentifierLength);
+        }
+
+        Display->Space = &Display->Spaces[Response.Space];
+        Display->PrevSpace = Display->Space;
+    }
+
+    return true;
+}
+
+/* NOTE(koekeishiya): A display is written as its arrangement id plus one, the pointer is
+ *                    meaningless to any other process. The main display is arrangement 0. */
+internal uint32_t
+AXLibGetEventRecordPayload(ax_event_payload *Payload, const void **Data, uint32_t *Value)
+{
+    switch(Payload->Type)
+    {
+        case AXPayload_WindowID: { *Value = Payload->WindowID; } break;
+        case AXPayload_PID: { *Value = (uint32_t) Payload->PID; } break;
+        case AXPayload_SockFD: { *Value = (uint32_t) Payload->SockFD; } break;
+        case AXPayload_Display: { *Value = Payload->Display ? Payload->Display->ArrangementID + 1 : 0; } break;
+        case AXPayload_Args:
+        {
+            *Data = Payload->Args;
+            return sizeof(Payload->Args);
+        } break;
+        case AXPayload_Block:
+        {
+            *Data = Payload->Block.Data;
+            return (uint32_t) Payload->Block.Size;
+        } break;
+        default:
+        {
+            return 0;
+        } break;
+    }
+
+    *Data = Value;
+    return sizeof(uint32_t);
+}
+
+/* NOTE(koekeishiya): Writes the record of a handler that AXLibBeginEventRecord returned true for. */
+void AXLibRecordEvent(ax_event *Event, uint64_t Wait, uint64_t Runtime, uint32_t Reads, uint32_t Writes, uint8_t Flags)
+{
+    EventTapeOwner = false;
+    if(!EventLog.Handle)
+        return;
+
+    ax_event_record Record = {};
+    Record.Timestamp = Event->Timestamp > EventLog.Start ? Event->Timestamp - EventLog.Start : 0;
+    Record.Wait = Wait;
+    Record.Runtime = Runtime;
+    Record.Reads = Reads;
+    Record.Writes = Writes;
+    Record.Type = (uint16_t) Event->Type;
+    Record.PayloadType = (uint8_t) Event->Payload.Type;
+    Record.Flags = Flags | (Event->Intrinsic ? AX_EVENT_RECORD_INTRINSIC : 0);
+    Record.ResponseSize = (uint32_t) EventTape.Data.size();
+
+    std::size_t Name = 0;
+    while(Name < EventLog.Names.size() && EventLog.Names[Name] != Event->Name)
+        ++Name;
+
+    if(Name == EventLog.Names.size())
+    {
+        EventLog.Names.push_back(Event->Name);
+        Record.NameLength = (uint8_t) strnlen(Event->Name, 255);
+    }
+
+    Record.Name = (uint16_t) Name;
+
+    uint32_t Value = 0;
+    const void *Data = NULL;
+    Record.PayloadSize = AXLibGetEventRecordPayload(&Event->Payload, &Data, &Value);
+
+    bool Result = fwrite(&Record, sizeof(Record), 1, EventLog.Handle) == 1;
+    if(Result && Record.NameLength)
+        Result = fwrite(Event->Name, Record.NameLength, 1, EventLog.Handle) == 1;
+    if(Result && Record.PayloadSize)
+        Result = fwrite(Data, Record.PayloadSize, 1, EventLog.Handle) == 1;
+    if(Result && Record.ResponseSize)
+        Result = fwrite(EventTape.Data.data(), Record.ResponseSize, 1, EventLog.Handle) == 1;
+
+    if(!Result)
+    {
+        fprintf(stderr, "AXLibRecordEvent() failed to write event log, recording stopped\n");
+        AXLibStopEventRecording();
+    }
+}
+
+/* NOTE(koekeishiya): Reads a log written by AXLibRecordEvent and collects the recorded timings
+ *                    and AX calls per event name. No handler is run, see AXLibReplayEventLog. */
+bool AXLibReadEventLog(const char *Path, ax_event_log_summary *Summary)
+{
+    FILE *Handle = fopen(Path, "rb");
+    if(!Handle)
+        return false;
+
+    uint32_t Header[2];
+    if(fread(Header, sizeof(Header), 1, Handle) != 1 ||
+       Header[0] != AX_EVENT_LOG_MAGIC || Header[1] == 0 || Header[1] > AX_EVENT_LOG_VERSION)
+    {
+        fclose(Handle);
+        return false;
+    }
+
+    bool Result = true;
+    ax_event_record Record;
+    while(fread(&Record, sizeof(Record), 1, Handle) == 1)
+    {
+        if(Record.NameLength)
+        {
+            char Name[256];
+            if(Record.Name != Summary->Timings.size() || fread(Name, Record.NameLength, 1, Handle) != 1)
+            {
+                Result = false;
+                break;
+            }
+
+            Summary->Timings.push_back(ax_event_log_timing());
+            Summary->Timings.back().Name = std::string(Name, Record.NameLength);
+        }
+
+        uint32_t Skip = Record.PayloadSize + Record.ResponseSize;
+        if(Record.Name >= Summary->Timings.size() ||
+           (Skip && fseek(Handle, Skip, SEEK_CUR) != 0))
+        {
+            Result = false;
+            break;
+        }
+
+        ax_event_log_timing *Timing = &Summary->Timings[Record.Name];
+        Timing->Reads += Record.Reads;
+        Timing->Writes += Record.Writes;
+        AXLibRecordHistogramValue(&Timing->Wait, Record.Wait / 1000);
+        AXLibRecordHistogramValue(&Timing->Runtime, Record.Runtime / 1000);
+
+        ++Summary->Events;
+        Summary->Runtime += Record.Runtime;
+        Summary->Reads += Record.Reads;
+        Summary->Writes += Record.Writes;
+    }
+
+    fclose(Handle);
+    return Result;
+}
+
+/* NOTE(koekeishiya): Handlers of records that do not carry an ax_event_type are found by the
+ *                    name they were recorded under. User-code registers the names of its own
+ *                    events and sources before calling AXLibReplayEventLog. */
+void AXLibRegisterReplayHandler(const char *Name, EventCallback *Handle)
+{
+    ReplayHandlers[Name] = Handle;
+}
+
+internal void
+AXLibRegisterDefaultReplayHandlers()
+{
+    AXLibRegisterReplayHandler("AXLibEventBatch", &AXLibRunEventBatch);
+    AXLibRegisterReplayHandler("AXLibInitializeState", &AXLibInitializeState);
+    AXLibRegisterReplayHandler("AXLibApplicationNotification", &AXLibApplicationNotification);
+    AXLibRegisterReplayHandler("AXLibInitializeApplication", &AXLibInitializeApplicationTimer);
+    AXLibRegisterReplayHandler("AXLibSaveApplicationReadiness", &AXLibSaveApplicationReadinessTimer);
+    AXLibRegisterReplayHandler("AXLibCarbonApplicationEvent", &AXLibCarbonApplicationEvent);
+    AXLibRegisterReplayHandler("SharedWorkspaceActiveSpaceChanged", &SharedWorkspaceActiveSpaceChanged);
+    AXLibRegisterReplayHandler("SharedWorkspaceApplicationActivated", &SharedWorkspaceApplicationActivated);
+}
+
+#define AX_REPLAY_CALLBACK(EventType) case EventType: return &Callback_##EventType
+internal EventCallback *
+AXLibGetReplayHandler(ax_event_type Type, const char *Name)
+{
+    switch(Type)
+    {
+        AX_REPLAY_CALLBACK(AXEvent_ApplicationLaunched);
+        AX_REPLAY_CALLBACK(AXEvent_ApplicationTerminated);
+        AX_REPLAY_CALLBACK(AXEvent_ApplicationActivated);
+        AX_REPLAY_CALLBACK(AXEvent_ApplicationVisible);
+        AX_REPLAY_CALLBACK(AXEvent_ApplicationHidden);
+        AX_REPLAY_CALLBACK(AXEvent_WindowCreated);
+        AX_REPLAY_CALLBACK(AXEvent_WindowDestroyed);
+        AX_REPLAY_CALLBACK(AXEvent_WindowFocused);
+        AX_REPLAY_CALLBACK(AXEvent_WindowMoved);
+        AX_REPLAY_CALLBACK(AXEvent_WindowResized);
+        AX_REPLAY_CALLBACK(AXEvent_WindowMinimized);
+        AX_REPLAY_CALLBACK(AXEvent_WindowDeminimized);
+        AX_REPLAY_CALLBACK(AXEvent_WindowTitleChanged);
+        AX_REPLAY_CALLBACK(AXEvent_DisplayAdded);
+        AX_REPLAY_CALLBACK(AXEvent_DisplayRemoved);
+        AX_REPLAY_CALLBACK(AXEvent_DisplayMoved);
+        AX_REPLAY_CALLBACK(AXEvent_DisplayResized);
+        AX_REPLAY_CALLBACK(AXEvent_DisplayChanged);
+        AX_REPLAY_CALLBACK(AXEvent_SpaceChanged);
+        AX_REPLAY_CALLBACK(AXEvent_MouseMoved);
+        AX_REPLAY_CALLBACK(AXEvent_LeftMouseDragged);
+        AX_REPLAY_CALLBACK(AXEvent_LeftMouseDown);
+        AX_REPLAY_CALLBACK(AXEvent_LeftMouseUp);
+        AX_REPLAY_CALLBACK(AXEvent_RightMouseDragged);
+        AX_REPLAY_CALLBACK(AXEvent_RightMouseDown);
+        AX_REPLAY_CALLBACK(AXEvent_RightMouseUp);
+        default: {} break;
+    }
+
+    std::map<std::string, EventCallback *>::iterator It = ReplayHandlers.find(Name);
+    return It != ReplayHandlers.end() ? It->second : NULL;
+}
+#undef AX_REPLAY_CALLBACK
+
+internal bool
+AXLibReplayEventPayload(ax_event_payload *Payload, ax_event_payload_type Type, std::string *Data)
+{
+    uint32_t Value = 0;
+    if(Type != AXPayload_Args && Type != AXPayload_Block && Type != AXPayload_None)
+    {
+        if(Data->size() != sizeof(uint32_t))
+            return false;
+
+        memcpy(&Value, Data->data(), sizeof(uint32_t));
+    }
+
+    Payload->Type = Type;
+    switch(Type)
+    {
+        case AXPayload_None: {} break;
+        case AXPayload_WindowID: { Payload->WindowID = Value; } break;
+        case AXPayload_PID: { Payload->PID = (pid_t) Value; } break;
+        case AXPayload_SockFD: { Payload->SockFD = (int) Value; } break;
+        case AXPayload_Display: { Payload->Display = Value ? AXLibArrangementDisplay(Value - 1) : NULL; } break;
+        case AXPayload_Args:
+        {
+            if(Data->size() != sizeof(Payload->Args))
+                return false;
+
+            memcpy(Payload->Args, Data->data(), sizeof(Payload->Args));
+        } break;
+        case AXPayload_Block:
+        {
+            void *Block = AXLibAllocateEventPayload(Payload, Data->size());
+            memcpy(Block, Data->data(), Data->size());
+        } break;
+        default:
+        {
+            return false;
+        } break;
+    }
+
+    return true;
+}
+
+internal uint64_t
+AXLibCountUnusedResponses()
+{
+    uint64_t Count = 0;
+    std::size_t At = EventTape.At;
+    ax_event_response Response;
+    while(AXLibReadResponse(&EventTape.Data, &At, &Response, sizeof(Response)))
+    {
+        At += Response.Size;
+        ++Count;
+    }
+
+    return Count;
+}
+
+/* NOTE(koekeishiya): Runs the handlers of a log written by AXLibRecordEvent again, in the order
+ *                    they were recorded, with the AX and CGS responses that were recorded with
+ *                    them instead of those of the live session. The event loop must not be
+ *                    running, the handlers are run on the calling thread. Names are kept for
+ *                    the lifetime of the process, the event timings point to them. */
+bool AXLibReplayEventLog(const char *Path, ax_event_replay *Replay)
+{
+    FILE *Handle = fopen(Path, "rb");
+    if(!Handle)
+        return false;
+
+    uint32_t Header[2];
+    if(fread(Header, sizeof(Header), 1, Handle) != 1 ||
+       Header[0] != AX_EVENT_LOG_MAGIC || Header[1] != AX_EVENT_LOG_VERSION)
+    {
+        fclose(Handle);
+        return false;
+    }
+
+    AXLibRegisterDefaultReplayHandlers();
+    AXLibInitializeTimestamp();
+    EventTape.Mismatches = 0;
+
+    bool Result = true;
+    std::vector<const char *> Names;
+    ax_event_record Record;
+    while(fread(&Record, sizeof(Record), 1, Handle) == 1)
+    {
+        if(Record.NameLength)
+        {
+            char Name[256];
+            if(Record.Name != Names.size() || fread(Name, Record.NameLength, 1, Handle) != 1)
+            {
+                Result = false;
+                break;
+            }
+
+            Names.push_back(strdup(std::string(Name, Record.NameLength).c_str()));
+        }
+
+        std::string Payload(Record.PayloadSize, '\0');
+        std::string Responses(Record.ResponseSize, '\0');
+        if(Record.Name >= Names.size() ||
+           (Record.PayloadSize && fread(&Payload[0], Record.PayloadSize, 1, Handle) != 1) ||
+           (Record.ResponseSize && fread(&Responses[0], Record.ResponseSize, 1, Handle) != 1))
+        {
+            Result = false;
+            break;
+        }
+
+        ax_event Event = {};
+        Event.Type = (ax_event_type) Record.Type;
+        Event.Name = Names[Record.Name];
+        Event.Intrinsic = Record.Flags & AX_EVENT_RECORD_INTRINSIC;
+        Event.Handle = AXLibGetReplayHandler(Event.Type, Event.Name);
+        if(!Event.Handle)
+        {
+            ++Replay->Skipped;
+            continue;
+        }
+
+        if(!AXLibReplayEventPayload(&Event.Payload, (ax_event_payload_type) Record.PayloadType, &Payload))
+        {
+            Result = false;
+            break;
+        }
+
+        EventTape.Data.swap(Responses);
+        EventTape.At = 0;
+        EventTape.Name = Event.Name;
+        EventTape.Replaying = true;
+        EventTapeOwner = true;
+
+        Event.Timestamp = AXLibGetTimestamp();
+        if(Record.Flags & AX_EVENT_RECORD_SOURCE)
+            (*Event.Handle)(&Event);
+        else
+            AXLibRunEventHandler(&Event);
+
+        EventTapeOwner = false;
+        EventTape.Replaying = false;
+        uint64_t Unused = AXLibCountUnusedResponses();
+        if(Unused)
+            fprintf(stderr, "AXLibReplayEventLog() %s: %llu responses were not asked for\n",
+                    Event.Name, (unsigned long long) Unused);
+
+        Replay->Unused += Unused;
+        AXLibReleaseEventPayload(&Event.Payload);
+        ++Replay->Events;
+    }
+
+    Replay->Mismatches += EventTape.Mismatches;
+    fclose(Handle);
+    return Result;
+}
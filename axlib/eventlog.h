@@ -0,0 +1,148 @@
+#ifndef AXLIB_EVENTLOG_H
+#define AXLIB_EVENTLOG_H
+
+#include "event.h"
+#include "display.h"
+#include <string>
+
+/* NOTE(koekeishiya): An event log starts with AX_EVENT_LOG_MAGIC and AX_EVENT_LOG_VERSION,
+ *                    followed by one ax_event_record per handled event. A record is followed
+ *                    by the name of the event if this is the first record that uses the name,
+ *                    then by PayloadSize bytes of payload and ResponseSize bytes of responses.
+ *                    Names are referred to by the order in which they were first written.
+ *                    Times are in nanoseconds. Version 1 logs have no responses and are
+ *                    otherwise the same. */
+#define AX_EVENT_LOG_MAGIC 0x56455841
+#define AX_EVENT_LOG_VERSION 2
+
+/* NOTE(koekeishiya): The record was written by AXLibRunEventSource, not by the event loop. */
+#define AX_EVENT_RECORD_SOURCE (1 << 0)
+
+/* NOTE(koekeishiya): The event was caused by a write of AXLib, ax_event::Intrinsic. */
+#define AX_EVENT_RECORD_INTRINSIC (1 << 1)
+
+struct ax_event_record
+{
+    uint64_t Timestamp;
+    uint64_t Wait;
+    uint64_t Runtime;
+    uint32_t Reads;
+    uint32_t Writes;
+    uint32_t PayloadSize;
+    uint16_t Type;
+    uint16_t Name;
+    uint8_t PayloadType;
+    uint8_t NameLength;
+    uint8_t Flags;
+    uint8_t Padding;
+    uint32_t ResponseSize;
+};
+
+/* NOTE(koekeishiya): Every AX, CGS and workspace query that a handler makes, and every write
+ *                    whose result it looks at, is written to the log as one ax_event_response
+ *                    followed by Size bytes of data, in the order the handler made them. */
+enum ax_event_query
+{
+    AXQuery_WindowID,
+    AXQuery_WindowTitle,
+    AXQuery_WindowPosition,
+    AXQuery_WindowSize,
+    AXQuery_WindowRole,
+    AXQuery_WindowSubrole,
+    AXQuery_WindowMinimized,
+    AXQuery_WindowFullscreen,
+    AXQuery_WindowMovable,
+    AXQuery_WindowResizable,
+    AXQuery_WindowWrite,
+
+    AXQuery_ApplicationWindows,
+    AXQuery_ApplicationActive,
+    AXQuery_ApplicationHidden,
+    AXQuery_FocusedApplication,
+    AXQuery_FocusedWindow,
+    AXQuery_RunningApplications,
+    AXQuery_ProcessSerialNumber,
+    AXQuery_ProcessInformation,
+    AXQuery_ProcessID,
+    AXQuery_ApplicationLaunchElapsed,
+
+    AXQuery_ObserverCreate,
+    AXQuery_ObserverNotification,
+
+    AXQuery_Cursor,
+    AXQuery_OnScreenWindows,
+    AXQuery_WindowBelowCursor,
+
+    AXQuery_Displays,
+    AXQuery_MainDisplay,
+    AXQuery_ActiveSpace,
+    AXQuery_SpaceInformation,
+    AXQuery_SpaceHasWindow,
+    AXQuery_StickyWindow,
+    AXQuery_DesktopID,
+    AXQuery_SpaceID,
+    AXQuery_SpacesCount,
+
+    AXQuery_Timestamp,
+    AXQuery_HandlerValue,
+
+    AXQuery_Count
+};
+
+struct ax_event_response
+{
+    uint16_t Query;
+    uint16_t Padding;
+    uint32_t Size;
+};
+
+struct ax_event_log_timing
+{
+    std::string Name;
+    uint64_t Reads;
+    uint64_t Writes;
+    ax_event_histogram Wait;
+    ax_event_histogram Runtime;
+};
+
+struct ax_event_log_summary
+{
+    std::vector<ax_event_log_timing> Timings;
+    uint64_t Events;
+    uint64_t Runtime;
+    uint64_t Reads;
+    uint64_t Writes;
+};
+
+/* NOTE(koekeishiya): Skipped counts records without a registered handler. Mismatches counts
+ *                    queries that were not the next recorded response, those go to the live
+ *                    window system instead. Unused counts responses no query asked for. */
+struct ax_event_replay
+{
+    uint64_t Events;
+    uint64_t Skipped;
+    uint64_t Mismatches;
+    uint64_t Unused;
+};
+
+bool AXLibStartEventRecording(const char *Path);
+void AXLibStopEventRecording();
+bool AXLibIsRecordingEvents();
+bool AXLibBeginEventRecord();
+void AXLibRecordEvent(ax_event *Event, uint64_t Wait, uint64_t Runtime, uint32_t Reads, uint32_t Writes, uint8_t Flags);
+
+void AXLibRecordResponse(ax_event_query Query, const void *Data, uint32_t Size);
+void AXLibRecordResponse(ax_event_query Query, CFStringRef String);
+bool AXLibReplayResponse(ax_event_query Query, void *Data, uint32_t Size);
+bool AXLibReplayResponse(ax_event_query Query, std::string *Data);
+bool AXLibIsReplayingEvents();
+AXUIElementRef AXLibReplayElement();
+
+void AXLibRecordDisplays(std::map<CGDirectDisplayID, ax_display> *Displays);
+bool AXLibReplayDisplays(std::map<CGDirectDisplayID, ax_display> *Displays);
+
+bool AXLibReadEventLog(const char *Path, ax_event_log_summary *Summary);
+void AXLibRegisterReplayHandler(const char *Name, EventCallback *Handle);
+bool AXLibReplayEventLog(const char *Path, ax_event_replay *Replay);
+
+#endif
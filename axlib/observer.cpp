@@ -1,32 +1,55 @@
 #include "observer.h"
 #include "application.h"
+#include "eventlog.h"
 
+/* NOTE(koekeishiya): A replayed observer has no AXObserverRef, only the recorded results of
+ *                    creating it and of adding notifications to it. */
 void AXLibConstructObserver(ax_application *Application, ObserverCallback Callback)
 {
+    bool Valid;
+    Application->Observer.Application = Application;
+    if(AXLibReplayResponse(AXQuery_ObserverCreate, &Valid, sizeof(Valid)))
+    {
+        Application->Observer.Ref = NULL;
+        Application->Observer.Valid = Valid;
+        return;
+    }
+
     AXError Result = AXObserverCreate(Application->PID, Callback, &Application->Observer.Ref);
     Application->Observer.Valid = (Result == kAXErrorSuccess);
-    Application->Observer.Application = Application;
+    AXLibRecordResponse(AXQuery_ObserverCreate, &Application->Observer.Valid, sizeof(bool));
 }
 
 void AXLibStartObserver(ax_observer *Observer)
 {
+    if(!Observer->Ref)
+        return;
+
     if(!CFRunLoopContainsSource(CFRunLoopGetMain(), AXObserverGetRunLoopSource(Observer->Ref), kCFRunLoopDefaultMode))
         CFRunLoopAddSource(CFRunLoopGetMain(), AXObserverGetRunLoopSource(Observer->Ref), kCFRunLoopDefaultMode);
 }
 
 AXError AXLibAddObserverNotification(ax_observer *Observer, AXUIElementRef Ref, CFStringRef Notification, void *Reference)
 {
-    return AXObserverAddNotification(Observer->Ref, Ref, Notification, Reference);
+    AXError Result;
+    if(AXLibReplayResponse(AXQuery_ObserverNotification, &Result, sizeof(Result)))
+        return Result;
+
+    Result = AXObserverAddNotification(Observer->Ref, Ref, Notification, Reference);
+    AXLibRecordResponse(AXQuery_ObserverNotification, &Result, sizeof(Result));
+    return Result;
 }
 
 void AXLibRemoveObserverNotification(ax_observer *Observer, AXUIElementRef Ref, CFStringRef Notification)
 {
-    AXObserverRemoveNotification(Observer->Ref, Ref, Notification);
+    if(Observer->Ref)
+        AXObserverRemoveNotification(Observer->Ref, Ref, Notification);
 }
 
 void AXLibStopObserver(ax_observer *Observer)
 {
-    CFRunLoopSourceInvalidate(AXObserverGetRunLoopSource(Observer->Ref));
+    if(Observer->Ref)
+        CFRunLoopSourceInvalidate(AXObserverGetRunLoopSource(Observer->Ref));
 }
 
 void AXLibDestroyObserver(ax_observer *Observer)
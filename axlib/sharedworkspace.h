@@ -7,6 +7,7 @@
 #include <map>
 
 #include "application.h"
+#include "event.h"
 
 typedef std::map<pid_t, std::string> shared_ws_map;
 typedef std::map<pid_t, std::string>::iterator shared_ws_map_iter;
@@ -18,4 +19,7 @@ void SharedWorkspaceActivateApplication(pid_t PID);
 bool SharedWorkspaceIsApplicationActive(pid_t PID);
 bool SharedWorkspaceIsApplicationHidden(pid_t PID);
 
+EVENT_CALLBACK(SharedWorkspaceActiveSpaceChanged);
+EVENT_CALLBACK(SharedWorkspaceApplicationActivated);
+
 #endif
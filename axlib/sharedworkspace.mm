@@ -125,59 +125,26 @@ bool SharedWorkspaceIsApplicationHidden(pid_t PID)
 
 - (void)activeDisplayDidChange:(NSNotification *)notification
 {
-    AXLibConstructEvent(AXEvent_DisplayChanged, NULL, false);
+    AXLibConstructEvent(AXEvent_DisplayChanged, AXLibEmptyPayload(), false);
+    AXLibUpdateSpaceTransition();
 }
 
 - (void)activeSpaceDidChange:(NSNotification *)notification
 {
-    /* NOTE(koekeishiya): OSX APIs are horrible, so we need to detect which display
-                          this event was triggered for. */
-    ax_display *MainDisplay = AXLibMainDisplay();
-    ax_display *Display = MainDisplay;
-    do
-    {
-        ax_space *PrevSpace = Display->Space;
-        Display->Space = AXLibGetActiveSpace(Display);
-        Display->PrevSpace = PrevSpace;
-        if(Display->Space != Display->PrevSpace)
-            break;
-
-        Display = AXLibNextDisplay(Display);
-    } while(Display != MainDisplay);
-
-    AXLibConstructEvent(AXEvent_SpaceChanged, Display, false);
+    ax_event Event = {};
+    Event.Name = "SharedWorkspaceActiveSpaceChanged";
+    Event.Handle = &SharedWorkspaceActiveSpaceChanged;
+    AXLibRunEventSource(&Event);
+    AXLibUpdateSpaceTransition();
 }
 
 - (void)didActivateApplication:(NSNotification *)notification
 {
-    pid_t PID = [[notification.userInfo objectForKey:NSWorkspaceApplicationKey] processIdentifier];
-    ax_application_map *Applications = BeginAXLibApplications();
-    if(Applications->find(PID) != Applications->end())
-    {
-        ax_application *Application = (*Applications)[PID];
-
-        if(AXLibHasFlags(Application, AXApplication_PrepIgnoreFocus))
-        {
-            AXLibClearFlags(Application, AXApplication_PrepIgnoreFocus);
-            AXLibAddFlags(Application, AXApplication_IgnoreFocus);
-        }
-
-        /* NOTE(koekeishiya): When an application that is already running, but has no open windows, is activated,
-                              or a window is deminimized, we receive 'didApplicationActivate' notification first.
-                              We have to preserve our insertion point and flag this application for activation at a later point in time. */
-        if((!Application->Focus) ||
-           (AXLibHasFlags(Application->Focus, AXWindow_Minimized)))
-        {
-            AXLibAddFlags(Application, AXApplication_Activate);
-        }
-        else
-        {
-            pid_t *ApplicationPID = (pid_t *) malloc(sizeof(pid_t));
-            *ApplicationPID = Application->PID;
-            AXLibConstructEvent(AXEvent_ApplicationActivated, ApplicationPID, false);
-        }
-    }
-    EndAXLibApplications();
+    ax_event Event = {};
+    Event.Name = "SharedWorkspaceApplicationActivated";
+    Event.Handle = &SharedWorkspaceApplicationActivated;
+    Event.Payload = AXLibPIDPayload([[notification.userInfo objectForKey:NSWorkspaceApplicationKey] processIdentifier]);
+    AXLibRunEventSource(&Event);
 }
 
 - (void)didHideApplication:(NSNotification *)notification
@@ -188,9 +155,7 @@ bool SharedWorkspaceIsApplicationHidden(pid_t PID)
     {
         ax_application *Application = (*Applications)[PID];
 
-        pid_t *ApplicationPID = (pid_t *) malloc(sizeof(pid_t));
-        *ApplicationPID = Application->PID;
-        AXLibConstructEvent(AXEvent_ApplicationHidden, ApplicationPID, false);
+        AXLibConstructEvent(AXEvent_ApplicationHidden, AXLibPIDPayload(Application->PID), false);
     }
     EndAXLibApplications();
 }
@@ -203,9 +168,7 @@ bool SharedWorkspaceIsApplicationHidden(pid_t PID)
     {
         ax_application *Application = (*Applications)[PID];
 
-        pid_t *ApplicationPID = (pid_t *) malloc(sizeof(pid_t));
-        *ApplicationPID = Application->PID;
-        AXLibConstructEvent(AXEvent_ApplicationVisible, ApplicationPID, false);
+        AXLibConstructEvent(AXEvent_ApplicationVisible, AXLibPIDPayload(Application->PID), false);
     }
     EndAXLibApplications();
 }
@@ -0,0 +1,341 @@
+#include "timer.h"
+
+#define internal static
+
+internal ax_timer_wheel TimerWheel = {};
+internal pthread_mutex_t TimerLock = PTHREAD_MUTEX_INITIALIZER;
+
+internal inline uint64_t
+AXLibGetTimerTick()
+{
+    return (AXLibGetTimestamp() - TimerWheel.Start) / AX_TIMER_TICK;
+}
+
+internal void
+AXLibInitializeTimerWheel()
+{
+    TimerWheel.Start = AXLibGetTimestamp();
+    TimerWheel.Now = 0;
+    for(int Level = 0; Level < AX_TIMER_LEVELS; ++Level)
+    {
+        for(int Slot = 0; Slot < AX_TIMER_SLOTS; ++Slot)
+            TimerWheel.Slots[Level][Slot] = AX_TIMER_NONE;
+    }
+}
+
+internal void
+AXLibLinkTimer(uint32_t Index, int Level, int Slot)
+{
+    ax_timer *Timer = &TimerWheel.Timers[Index];
+    uint32_t Head = TimerWheel.Slots[Level][Slot];
+
+    Timer->Level = (uint8_t) Level;
+    Timer->Slot = (uint8_t) Slot;
+    Timer->Prev = AX_TIMER_NONE;
+    Timer->Next = Head;
+
+    if(Head != AX_TIMER_NONE)
+        TimerWheel.Timers[Head].Prev = Index;
+
+    TimerWheel.Slots[Level][Slot] = Index;
+    TimerWheel.Occupied[Level] |= (uint64_t) 1 << Slot;
+}
+
+internal void
+AXLibUnlinkTimer(uint32_t Index)
+{
+    ax_timer *Timer = &TimerWheel.Timers[Index];
+    if(Timer->Prev != AX_TIMER_NONE)
+        TimerWheel.Timers[Timer->Prev].Next = Timer->Next;
+    else
+        TimerWheel.Slots[Timer->Level][Timer->Slot] = Timer->Next;
+
+    if(Timer->Next != AX_TIMER_NONE)
+        TimerWheel.Timers[Timer->Next].Prev = Timer->Prev;
+
+    if(TimerWheel.Slots[Timer->Level][Timer->Slot] == AX_TIMER_NONE)
+        TimerWheel.Occupied[Timer->Level] &= ~((uint64_t) 1 << Timer->Slot);
+}
+
+/* NOTE(koekeishiya): A timer goes in the lowest level whose range covers the time until it
+ *                    expires. Higher levels are cascaded into lower ones as the wheel turns. */
+internal void
+AXLibInsertTimer(uint32_t Index)
+{
+    ax_timer *Timer = &TimerWheel.Timers[Index];
+    if(Timer->Expires <= TimerWheel.Now)
+        Timer->Expires = TimerWheel.Now + 1;
+
+    uint64_t Range = (uint64_t) 1 << (AX_TIMER_SLOT_BITS * AX_TIMER_LEVELS);
+    uint64_t Delta = Timer->Expires - TimerWheel.Now;
+    uint64_t Expires = Delta < Range ? Timer->Expires : TimerWheel.Now + Range - 1;
+
+    int Level = 0;
+    while(Level < AX_TIMER_LEVELS - 1 &&
+          Delta >= ((uint64_t) 1 << (AX_TIMER_SLOT_BITS * (Level + 1))))
+        ++Level;
+
+    int Slot = (int) ((Expires >> (AX_TIMER_SLOT_BITS * Level)) & (AX_TIMER_SLOTS - 1));
+    AXLibLinkTimer(Index, Level, Slot);
+}
+
+internal void
+AXLibFreeTimer(uint32_t Index)
+{
+    ax_timer *Timer = &TimerWheel.Timers[Index];
+    Timer->Active = false;
+    if(++Timer->Generation == 0)
+        Timer->Generation = 1;
+
+    TimerWheel.Free.push_back(Index);
+    --TimerWheel.Count;
+}
+
+/* NOTE(koekeishiya): Cascading happens right before the current slot of the first level is
+ *                    fired, so a timer that expires on this very tick goes in that slot. */
+internal void
+AXLibCascadeTimers(int Level, int Slot)
+{
+    uint32_t Index = TimerWheel.Slots[Level][Slot];
+    TimerWheel.Slots[Level][Slot] = AX_TIMER_NONE;
+    TimerWheel.Occupied[Level] &= ~((uint64_t) 1 << Slot);
+
+    while(Index != AX_TIMER_NONE)
+    {
+        uint32_t Next = TimerWheel.Timers[Index].Next;
+        if(TimerWheel.Timers[Index].Expires == TimerWheel.Now)
+            AXLibLinkTimer(Index, 0, (int) (TimerWheel.Now & (AX_TIMER_SLOTS - 1)));
+        else
+            AXLibInsertTimer(Index);
+
+        Index = Next;
+    }
+}
+
+/* NOTE(koekeishiya): Periodic timers are put back before their event is handed out, so a
+ *                    handler that cancels its own timer always finds it. */
+internal void
+AXLibFireTimers(int Slot, std::vector<ax_event> &Events)
+{
+    uint32_t Index = TimerWheel.Slots[0][Slot];
+    TimerWheel.Slots[0][Slot] = AX_TIMER_NONE;
+    TimerWheel.Occupied[0] &= ~((uint64_t) 1 << Slot);
+
+    while(Index != AX_TIMER_NONE)
+    {
+        ax_timer *Timer = &TimerWheel.Timers[Index];
+        uint32_t Next = Timer->Next;
+
+        Events.push_back(Timer->Event);
+        if(Timer->Interval)
+        {
+            Timer->Expires += Timer->Interval;
+            AXLibInsertTimer(Index);
+        }
+        else
+        {
+            AXLibFreeTimer(Index);
+        }
+
+        Index = Next;
+    }
+}
+
+/* NOTE(koekeishiya): Turns the wheel one tick at a time, but skips ahead to the next cascade
+ *                    while the first level is empty, so catching up after a long sleep is cheap. */
+internal void
+AXLibAdvanceTimerWheel(uint64_t Target, std::vector<ax_event> &Events)
+{
+    while(TimerWheel.Now < Target)
+    {
+        if(TimerWheel.Count == 0)
+        {
+            TimerWheel.Now = Target;
+            break;
+        }
+
+        if(TimerWheel.Occupied[0] == 0)
+        {
+            uint64_t Boundary = TimerWheel.Now | (AX_TIMER_SLOTS - 1);
+            if(Boundary >= Target)
+            {
+                TimerWheel.Now = Target;
+                break;
+            }
+
+            TimerWheel.Now = Boundary;
+        }
+
+        int Slot = (int) (++TimerWheel.Now & (AX_TIMER_SLOTS - 1));
+        if(Slot == 0)
+        {
+            for(int Level = 1; Level < AX_TIMER_LEVELS; ++Level)
+            {
+                int Index = (int) ((TimerWheel.Now >> (AX_TIMER_SLOT_BITS * Level)) & (AX_TIMER_SLOTS - 1));
+                AXLibCascadeTimers(Level, Index);
+                if(Index != 0)
+                    break;
+            }
+        }
+
+        AXLibFireTimers(Slot, Events);
+    }
+}
+
+/* NOTE(koekeishiya): The deadline is the time at which the wheel must be turned next, either
+ *                    because a timer in the first level expires or because a higher level has
+ *                    to be cascaded. It is read by the event loop without taking the lock. */
+internal void
+AXLibUpdateTimerDeadline()
+{
+    uint64_t Deadline = 0;
+    if(TimerWheel.Count != 0)
+    {
+        uint64_t Tick;
+        if(TimerWheel.Occupied[0])
+        {
+            int Current = (int) ((TimerWheel.Now + 1) & (AX_TIMER_SLOTS - 1));
+            uint64_t Bits = TimerWheel.Occupied[0];
+            uint64_t Rotated = Current ? (Bits >> Current) | (Bits << (AX_TIMER_SLOTS - Current)) : Bits;
+            Tick = TimerWheel.Now + 1 + __builtin_ctzll(Rotated);
+        }
+        else
+        {
+            Tick = (TimerWheel.Now | (AX_TIMER_SLOTS - 1)) + 1;
+        }
+
+        Deadline = TimerWheel.Start + Tick * AX_TIMER_TICK;
+    }
+
+    __atomic_store_n(&TimerWheel.Deadline, Deadline, __ATOMIC_SEQ_CST);
+}
+
+internal ax_timer *
+AXLibGetTimer(ax_timer_id TimerID)
+{
+    uint32_t Index = (uint32_t) TimerID;
+    uint32_t Generation = (uint32_t) (TimerID >> 32);
+
+    if(Index < TimerWheel.Timers.size())
+    {
+        ax_timer *Timer = &TimerWheel.Timers[Index];
+        if(Timer->Active && Timer->Generation == Generation)
+            return Timer;
+    }
+
+    return NULL;
+}
+
+/* NOTE(koekeishiya): Must be thread-safe! The event is passed to AXLibAddEvent when the timer
+ *                    expires. A periodic timer hands out a copy every time it expires, so its
+ *                    payload can not be a block. Delay and Interval are in milliseconds. */
+ax_timer_id AXLibScheduleEvent(ax_event Event, uint32_t Delay, uint32_t Interval)
+{
+    if(!Event.Handle || (Interval && Event.Payload.Type == AXPayload_Block))
+    {
+        AXLibReleaseEventPayload(&Event.Payload);
+        return 0;
+    }
+
+    pthread_mutex_lock(&TimerLock);
+    if(TimerWheel.Start == 0)
+        AXLibInitializeTimerWheel();
+
+    uint64_t Now = AXLibGetTimerTick();
+    if(TimerWheel.Count == 0)
+        TimerWheel.Now = Now;
+
+    uint32_t Index;
+    if(!TimerWheel.Free.empty())
+    {
+        Index = TimerWheel.Free.back();
+        TimerWheel.Free.pop_back();
+    }
+    else
+    {
+        Index = (uint32_t) TimerWheel.Timers.size();
+        TimerWheel.Timers.push_back(ax_timer());
+        TimerWheel.Timers[Index].Generation = 1;
+    }
+
+    ax_timer *Timer = &TimerWheel.Timers[Index];
+    Timer->Expires = Now + Delay;
+    Timer->Interval = Interval;
+    Timer->Active = true;
+    Timer->Event = Event;
+    Timer->Event.Pending = NULL;
+
+    ++TimerWheel.Count;
+    AXLibInsertTimer(Index);
+    AXLibUpdateTimerDeadline();
+
+    ax_timer_id Result = ((uint64_t) Timer->Generation << 32) | Index;
+    pthread_mutex_unlock(&TimerLock);
+
+    AXLibWakeEventLoop();
+    return Result;
+}
+
+/* NOTE(koekeishiya): Pushes the timer back so that it expires Delay milliseconds from now.
+ *                    Used to debounce: reschedule on every trigger, handle when it goes quiet. */
+bool AXLibRescheduleEvent(ax_timer_id TimerID, uint32_t Delay)
+{
+    pthread_mutex_lock(&TimerLock);
+    ax_timer *Timer = AXLibGetTimer(TimerID);
+    if(Timer)
+    {
+        uint32_t Index = (uint32_t) TimerID;
+        AXLibUnlinkTimer(Index);
+        Timer->Expires = AXLibGetTimerTick() + Delay;
+        AXLibInsertTimer(Index);
+        AXLibUpdateTimerDeadline();
+    }
+    pthread_mutex_unlock(&TimerLock);
+
+    if(Timer)
+        AXLibWakeEventLoop();
+
+    return Timer != NULL;
+}
+
+bool AXLibCancelEvent(ax_timer_id TimerID)
+{
+    pthread_mutex_lock(&TimerLock);
+    ax_timer *Timer = AXLibGetTimer(TimerID);
+    if(Timer)
+    {
+        uint32_t Index = (uint32_t) TimerID;
+        AXLibUnlinkTimer(Index);
+        AXLibReleaseEventPayload(&Timer->Event.Payload);
+        AXLibFreeTimer(Index);
+        AXLibUpdateTimerDeadline();
+    }
+    pthread_mutex_unlock(&TimerLock);
+
+    return Timer != NULL;
+}
+
+/* NOTE(koekeishiya): Returns the mach_absolute_time based timestamp, in nanoseconds, at which
+ *                    AXLibExpireTimers should be called next, or 0 if no timer is scheduled. */
+uint64_t AXLibGetTimerDeadline()
+{
+    return __atomic_load_n(&TimerWheel.Deadline, __ATOMIC_SEQ_CST);
+}
+
+/* NOTE(koekeishiya): Called by the event loop. Expired events are queued after the lock is
+ *                    released, so that a full queue can not block a thread that schedules. */
+void AXLibExpireTimers()
+{
+    std::vector<ax_event> Events;
+
+    pthread_mutex_lock(&TimerLock);
+    if(TimerWheel.Start != 0)
+    {
+        AXLibAdvanceTimerWheel(AXLibGetTimerTick(), Events);
+        AXLibUpdateTimerDeadline();
+    }
+    pthread_mutex_unlock(&TimerLock);
+
+    for(std::size_t Index = 0; Index < Events.size(); ++Index)
+        AXLibAddEvent(Events[Index]);
+}
@@ -0,0 +1,81 @@
+#ifndef AXLIB_TIMER_H
+#define AXLIB_TIMER_H
+
+#include "event.h"
+
+/* NOTE(koekeishiya): Hierarchical timer wheel with AX_TIMER_LEVELS levels of AX_TIMER_SLOTS
+ *                    slots. A tick is AX_TIMER_TICK nanoseconds, so the first level covers
+ *                    64ms, the second 4s, the third 4m and the fourth 4.6h. A timer further
+ *                    out than that is parked in the last slot and put back when it comes up.
+ *                    Timers live in a pool and are linked into their slot by index, which
+ *                    makes schedule and cancel O(1). An ax_timer_id of 0 is never valid. */
+#define AX_TIMER_TICK 1000000
+#define AX_TIMER_LEVELS 4
+#define AX_TIMER_SLOT_BITS 6
+#define AX_TIMER_SLOTS (1 << AX_TIMER_SLOT_BITS)
+#define AX_TIMER_NONE 0xFFFFFFFF
+
+typedef uint64_t ax_timer_id;
+
+struct ax_timer
+{
+    uint64_t Expires;
+    uint64_t Interval;
+    uint32_t Generation;
+    uint32_t Prev;
+    uint32_t Next;
+    uint8_t Level;
+    uint8_t Slot;
+    bool Active;
+    ax_event Event;
+};
+
+struct ax_timer_wheel
+{
+    uint64_t Start;
+    uint64_t Now;
+    uint64_t Deadline;
+    uint32_t Count;
+
+    uint32_t Slots[AX_TIMER_LEVELS][AX_TIMER_SLOTS];
+    uint64_t Occupied[AX_TIMER_LEVELS];
+
+    std::vector<ax_timer> Timers;
+    std::vector<uint32_t> Free;
+};
+
+ax_timer_id AXLibScheduleEvent(ax_event Event, uint32_t Delay, uint32_t Interval);
+bool AXLibRescheduleEvent(ax_timer_id Timer, uint32_t Delay);
+bool AXLibCancelEvent(ax_timer_id Timer);
+
+uint64_t AXLibGetTimerDeadline();
+void AXLibExpireTimers();
+
+/* NOTE(koekeishiya): Events that are not an ax_event_type, such as those defined by user-code,
+ *                    are scheduled as AXEvent_None, the same as AXLibAddEvent expects them. */
+inline ax_event_type
+AXLibGetTimerEventType(ax_event_type Type)
+{
+    return Type;
+}
+
+inline ax_event_type
+AXLibGetTimerEventType(int)
+{
+    return AXEvent_None;
+}
+
+/* NOTE(koekeishiya): Delay and Interval are in milliseconds. An Interval of 0 makes a one-shot
+ *                    timer. The id of the timer is stored in TimerID, so that it can be
+ *                    cancelled or pushed back (debounced) later. */
+#define AXLibConstructTimerEvent(EventType, EventPayload, EventIntrinsic, Delay, Interval, TimerID) \
+    do { ax_event Event = {}; \
+         Event.Type = AXLibGetTimerEventType(EventType); \
+         Event.Name = #EventType; \
+         Event.Payload = EventPayload; \
+         Event.Intrinsic = EventIntrinsic; \
+         Event.Handle = &Callback_##EventType; \
+         TimerID = AXLibScheduleEvent(Event, Delay, Interval); \
+       } while(0)
+
+#endif
@@ -14,6 +14,7 @@
 #include "tree.h"
 #include "border.h"
 #include "serializer.h"
+#include "history.h"
 #include "scratchpad.h"
 #include "cursor.h"
 #include "event.h"
@@ -431,6 +432,108 @@ KwmParseConfigOptionSplitRatio(tokenizer *Tokenizer)
     }
 }
 
+internal void
+KwmParseConfigOptionMaxConnections(tokenizer *Tokenizer)
+{
+    if(RequireToken(Tokenizer, Token_Dash))
+    {
+        token Token = GetToken(Tokenizer);
+        if(TokenEquals(Token, "connections"))
+        {
+            token Token = GetToken(Tokenizer);
+            switch(Token.Type)
+            {
+                case Token_Digit:
+                {
+                    double Value = ConvertStringToDouble(std::string(Token.Text, Token.TextLength));
+                    if(Value >= 1.0)
+                    {
+                        KwmSetDaemonConnectionLimit((int) Value);
+                    }
+                } break;
+                default:
+                {
+                    ReportInvalidCommand("Unknown command 'config max-connections " + std::string(Token.Text, Token.TextLength) + "'");
+                } break;
+            }
+        }
+        else
+            ReportInvalidCommand("Unknown command 'config max-" + std::string(Token.Text, Token.TextLength) + "'");
+    }
+    else
+    {
+        ReportInvalidCommand("Expected token '-' after 'config max'");
+    }
+}
+
+internal void
+KwmParseConfigOptionLaunchTimeout(tokenizer *Tokenizer)
+{
+    if(RequireToken(Tokenizer, Token_Dash))
+    {
+        token Token = GetToken(Tokenizer);
+        if(TokenEquals(Token, "timeout"))
+        {
+            token Token = GetToken(Tokenizer);
+            switch(Token.Type)
+            {
+                case Token_Digit:
+                {
+                    double Value = ConvertStringToDouble(std::string(Token.Text, Token.TextLength));
+                    if(Value > 0.0)
+                    {
+                        AXLibSetApplicationProbeDeadline((uint32_t) Value);
+                    }
+                } break;
+                default:
+                {
+                    ReportInvalidCommand("Unknown command 'config launch-timeout " + std::string(Token.Text, Token.TextLength) + "'");
+                } break;
+            }
+        }
+        else
+            ReportInvalidCommand("Unknown command 'config launch-" + std::string(Token.Text, Token.TextLength) + "'");
+    }
+    else
+    {
+        ReportInvalidCommand("Expected token '-' after 'config launch'");
+    }
+}
+
+internal void
+KwmParseConfigOptionSlowHandler(tokenizer *Tokenizer)
+{
+    if(RequireToken(Tokenizer, Token_Dash))
+    {
+        token Token = GetToken(Tokenizer);
+        if(TokenEquals(Token, "handler"))
+        {
+            token Token = GetToken(Tokenizer);
+            switch(Token.Type)
+            {
+                case Token_Digit:
+                {
+                    double Value = ConvertStringToDouble(std::string(Token.Text, Token.TextLength));
+                    if(Value > 0.0)
+                    {
+                        AXLibSetSlowHandlerThreshold((uint64_t) (Value * 1000.0));
+                    }
+                } break;
+                default:
+                {
+                    ReportInvalidCommand("Unknown command 'config slow-handler " + std::string(Token.Text, Token.TextLength) + "'");
+                } break;
+            }
+        }
+        else
+            ReportInvalidCommand("Unknown command 'config slow-" + std::string(Token.Text, Token.TextLength) + "'");
+    }
+    else
+    {
+        ReportInvalidCommand("Expected token '-' after 'config slow'");
+    }
+}
+
 internal void
 KwmParseConfigOptionOptimalRatio(tokenizer *Tokenizer)
 {
@@ -888,6 +991,12 @@ KwmParseConfigOption(tokenizer *Tokenizer)
                 KwmParseConfigOptionSplitRatio(Tokenizer);
             else if(TokenEquals(Token, "optimal"))
                 KwmParseConfigOptionOptimalRatio(Tokenizer);
+            else if(TokenEquals(Token, "slow"))
+                KwmParseConfigOptionSlowHandler(Tokenizer);
+            else if(TokenEquals(Token, "launch"))
+                KwmParseConfigOptionLaunchTimeout(Tokenizer);
+            else if(TokenEquals(Token, "max"))
+                KwmParseConfigOptionMaxConnections(Tokenizer);
             else if(TokenEquals(Token, "spawn"))
                 KwmParseConfigOptionSpawn(Tokenizer);
             else if(TokenEquals(Token, "border"))
@@ -908,6 +1017,32 @@ KwmParseConfigOption(tokenizer *Tokenizer)
     }
 }
 
+/* NOTE(koekeishiya): Looks ahead at the option of a 'window' command without consuming it.
+ * Recording the tree costs two walks over it, so commands that only change the focus or the
+ * marked window are not recorded. */
+internal bool
+IsTreeMutatingWindowOption(tokenizer Tokenizer)
+{
+    if(!RequireToken(&Tokenizer, Token_Dash))
+        return false;
+
+    token Token = GetToken(&Tokenizer);
+    return !TokenEquals(Token, "f") &&
+           !TokenEquals(Token, "fm") &&
+           !TokenEquals(Token, "mk");
+}
+
+/* NOTE(koekeishiya): 'tree save' does not change the tree, 'tree undo' and 'tree redo' move
+ * through the history themselves and 'tree restore' starts a new one. */
+internal bool
+IsTreeMutatingTreeOption(tokenizer Tokenizer)
+{
+    token Token = GetToken(&Tokenizer);
+    return Token.Type == Token_Dash ||
+           TokenEquals(Token, "rotate") ||
+           TokenEquals(Token, "equalize");
+}
+
 internal void
 KwmParseWindowOption(tokenizer *Tokenizer)
 {
@@ -1249,6 +1384,14 @@ KwmParseTreeOption(tokenizer *Tokenizer)
         else
             ReportInvalidCommand("Invalid command 'tree restore " + std::string(Token.Text, Token.TextLength) + "'");
     }
+    else if(TokenEquals(Token, "undo"))
+    {
+        UndoTreeHistory(AXLibMainDisplay());
+    }
+    else if(TokenEquals(Token, "redo"))
+    {
+        RedoTreeHistory(AXLibMainDisplay());
+    }
     else
     {
         ReportInvalidCommand("Unknown command 'tree " + std::string(Token.Text, Token.TextLength) + "'");
@@ -1463,18 +1606,18 @@ KwmParseQueryOption(tokenizer *Tokenizer)
     {
         token Selector = GetToken(Tokenizer);
         if(TokenEquals(Selector, "mode"))
-            KwmConstructEvent(KWMEvent_QueryTilingMode, KwmCreateContext(ClientSockFD));
+            KwmRunEvent(KWMEvent_QueryTilingMode, KwmCreatePayload(ClientSockFD));
         else if(TokenEquals(Selector,"spawn"))
-            KwmConstructEvent(KWMEvent_QuerySpawnPosition, KwmCreateContext(ClientSockFD));
+            KwmRunEvent(KWMEvent_QuerySpawnPosition, KwmCreatePayload(ClientSockFD));
         else if(TokenEquals(Selector, "split"))
         {
             if(RequireToken(Tokenizer, Token_Dash))
             {
                 token Token = GetToken(Tokenizer);
                 if(TokenEquals(Token, "mode"))
-                    KwmConstructEvent(KWMEvent_QuerySplitMode, KwmCreateContext(ClientSockFD));
+                    KwmRunEvent(KWMEvent_QuerySplitMode, KwmCreatePayload(ClientSockFD));
                 else if(TokenEquals(Token, "ratio"))
-                    KwmConstructEvent(KWMEvent_QuerySplitRatio, KwmCreateContext(ClientSockFD));
+                    KwmRunEvent(KWMEvent_QuerySplitRatio, KwmCreatePayload(ClientSockFD));
                 else
                     ReportInvalidCommand("Unknown command 'query split-" + std::string(Token.Text, Token.TextLength) + "'");
             }
@@ -1495,43 +1638,39 @@ KwmParseQueryOption(tokenizer *Tokenizer)
         {
             token Token = GetToken(Tokenizer);
             if(TokenEquals(Token, "id"))
-                KwmConstructEvent(KWMEvent_QueryFocusedWindowId, KwmCreateContext(ClientSockFD));
+                KwmRunEvent(KWMEvent_QueryFocusedWindowId, KwmCreatePayload(ClientSockFD));
             else if(TokenEquals(Token, "name"))
-                KwmConstructEvent(KWMEvent_QueryFocusedWindowName, KwmCreateContext(ClientSockFD));
+                KwmRunEvent(KWMEvent_QueryFocusedWindowName, KwmCreatePayload(ClientSockFD));
             else if(TokenEquals(Token, "split"))
-                KwmConstructEvent(KWMEvent_QueryFocusedWindowSplit, KwmCreateContext(ClientSockFD));
+                KwmRunEvent(KWMEvent_QueryFocusedWindowSplit, KwmCreatePayload(ClientSockFD));
             else if(TokenEquals(Token, "float"))
-                KwmConstructEvent(KWMEvent_QueryFocusedWindowFloat, KwmCreateContext(ClientSockFD));
+                KwmRunEvent(KWMEvent_QueryFocusedWindowFloat, KwmCreatePayload(ClientSockFD));
             else
             {
-                int *Args = (int *) malloc(sizeof(int) * 2);
-                *Args = ClientSockFD;
-
+                int Degrees = 0;
                 if(TokenEquals(Token, "north"))
-                    *(Args + 1) = 0;
+                    Degrees = 0;
                 else if(TokenEquals(Token, "east"))
-                    *(Args + 1) = 90;
+                    Degrees = 90;
                 else if(TokenEquals(Token, "south"))
-                    *(Args + 1) = 180;
+                    Degrees = 180;
                 else if(TokenEquals(Token, "west"))
-                    *(Args + 1) = 270;
-                else
-                    *(Args + 1) = 0;
+                    Degrees = 270;
 
-                KwmConstructEvent(KWMEvent_QueryWindowIdInDirectionOfFocusedWindow, Args);
+                KwmRunEvent(KWMEvent_QueryWindowIdInDirectionOfFocusedWindow, KwmCreatePayload(ClientSockFD, Degrees));
             }
         }
         else if(TokenEquals(Token, "marked"))
         {
             token Token = GetToken(Tokenizer);
             if(TokenEquals(Token, "id"))
-                KwmConstructEvent(KWMEvent_QueryMarkedWindowId, KwmCreateContext(ClientSockFD));
+                KwmRunEvent(KWMEvent_QueryMarkedWindowId, KwmCreatePayload(ClientSockFD));
             else if(TokenEquals(Token, "name"))
-                KwmConstructEvent(KWMEvent_QueryMarkedWindowName, KwmCreateContext(ClientSockFD));
+                KwmRunEvent(KWMEvent_QueryMarkedWindowName, KwmCreatePayload(ClientSockFD));
             else if(TokenEquals(Token, "split"))
-                KwmConstructEvent(KWMEvent_QueryMarkedWindowSplit, KwmCreateContext(ClientSockFD));
+                KwmRunEvent(KWMEvent_QueryMarkedWindowSplit, KwmCreatePayload(ClientSockFD));
             else if(TokenEquals(Token, "float"))
-                KwmConstructEvent(KWMEvent_QueryMarkedWindowFloat, KwmCreateContext(ClientSockFD));
+                KwmRunEvent(KWMEvent_QueryMarkedWindowFloat, KwmCreatePayload(ClientSockFD));
             else
                 ReportInvalidCommand("Unknown command 'query window marked " + std::string(Token.Text, Token.TextLength) + "'");
         }
@@ -1548,11 +1687,9 @@ KwmParseQueryOption(tokenizer *Tokenizer)
 
             if(Valid)
             {
-                int *Args = (int *) malloc(sizeof(int) * 3);
-                *Args = ClientSockFD;
-                *(Args + 1) = ConvertStringToInt(std::string(Token1.Text, Token1.TextLength));
-                *(Args + 2) = ConvertStringToInt(std::string(Token2.Text, Token2.TextLength));
-                KwmConstructEvent(KWMEvent_QueryParentNodeState, Args);
+                int FirstID = ConvertStringToInt(std::string(Token1.Text, Token1.TextLength));
+                int SecondID = ConvertStringToInt(std::string(Token2.Text, Token2.TextLength));
+                KwmRunEvent(KWMEvent_QueryParentNodeState, KwmCreatePayload(ClientSockFD, FirstID, SecondID));
             }
         }
         else if(TokenEquals(Token, "child"))
@@ -1567,15 +1704,13 @@ KwmParseQueryOption(tokenizer *Tokenizer)
 
             if(Valid)
             {
-                int *Args = (int *) malloc(sizeof(int) * 2);
-                *Args = ClientSockFD;
-                *(Args + 1) = ConvertStringToInt(std::string(Token.Text, Token.TextLength));
-                KwmConstructEvent(KWMEvent_QueryNodePosition, Args);
+                int WindowID = ConvertStringToInt(std::string(Token.Text, Token.TextLength));
+                KwmRunEvent(KWMEvent_QueryNodePosition, KwmCreatePayload(ClientSockFD, WindowID));
             }
         }
         else if(TokenEquals(Token, "list"))
         {
-            KwmConstructEvent(KWMEvent_QueryWindowList, KwmCreateContext(ClientSockFD));
+            KwmRunEvent(KWMEvent_QueryWindowList, KwmCreatePayload(ClientSockFD));
         }
         else
         {
@@ -1588,7 +1723,7 @@ KwmParseQueryOption(tokenizer *Tokenizer)
         {
             token Token = GetToken(Tokenizer);
             if(TokenEquals(Token, "focus"))
-                KwmConstructEvent(KWMEvent_QueryCycleFocus, KwmCreateContext(ClientSockFD));
+                KwmRunEvent(KWMEvent_QueryCycleFocus, KwmCreatePayload(ClientSockFD));
             else
                 ReportInvalidCommand("Unknown command 'query cycle-" + std::string(Token.Text, Token.TextLength) + "'");
         }
@@ -1608,7 +1743,7 @@ KwmParseQueryOption(tokenizer *Tokenizer)
                 {
                     token Token = GetToken(Tokenizer);
                     if(TokenEquals(Token, "resizable"))
-                        KwmConstructEvent(KWMEvent_QueryFloatNonResizable, KwmCreateContext(ClientSockFD));
+                        KwmRunEvent(KWMEvent_QueryFloatNonResizable, KwmCreatePayload(ClientSockFD));
                     else
                         ReportInvalidCommand("Unknown command 'query float-non-" + std::string(Token.Text, Token.TextLength) + "'");
                 }
@@ -1638,7 +1773,7 @@ KwmParseQueryOption(tokenizer *Tokenizer)
                 {
                     token Token = GetToken(Tokenizer);
                     if(TokenEquals(Token, "container"))
-                        KwmConstructEvent(KWMEvent_QueryLockToContainer, KwmCreateContext(ClientSockFD));
+                        KwmRunEvent(KWMEvent_QueryLockToContainer, KwmCreatePayload(ClientSockFD));
                     else
                         ReportInvalidCommand("Unknown command 'query lock-to-" + std::string(Token.Text, Token.TextLength) + "'");
                 }
@@ -1668,7 +1803,7 @@ KwmParseQueryOption(tokenizer *Tokenizer)
                 {
                     token Token = GetToken(Tokenizer);
                     if(TokenEquals(Token, "float"))
-                        KwmConstructEvent(KWMEvent_QueryStandbyOnFloat, KwmCreateContext(ClientSockFD));
+                        KwmRunEvent(KWMEvent_QueryStandbyOnFloat, KwmCreatePayload(ClientSockFD));
                     else
                         ReportInvalidCommand("Unknown command 'query standby-on-" + std::string(Token.Text, Token.TextLength) + "'");
                 }
@@ -1698,7 +1833,7 @@ KwmParseQueryOption(tokenizer *Tokenizer)
                 {
                     token Token = GetToken(Tokenizer);
                     if(TokenEquals(Token, "mouse"))
-                        KwmConstructEvent(KWMEvent_QueryFocusFollowsMouse, KwmCreateContext(ClientSockFD));
+                        KwmRunEvent(KWMEvent_QueryFocusFollowsMouse, KwmCreatePayload(ClientSockFD));
                     else
                         ReportInvalidCommand("Unknown command 'query focus-follows-" + std::string(Token.Text, Token.TextLength) + "'");
                 }
@@ -1728,7 +1863,7 @@ KwmParseQueryOption(tokenizer *Tokenizer)
                 {
                     token Token = GetToken(Tokenizer);
                     if(TokenEquals(Token, "focus"))
-                        KwmConstructEvent(KWMEvent_QueryMouseFollowsFocus, KwmCreateContext(ClientSockFD));
+                        KwmRunEvent(KWMEvent_QueryMouseFollowsFocus, KwmCreatePayload(ClientSockFD));
                     else
                         ReportInvalidCommand("Unknown command 'query mouse-follows-" + std::string(Token.Text, Token.TextLength) + "'");
                 }
@@ -1752,13 +1887,29 @@ KwmParseQueryOption(tokenizer *Tokenizer)
         token Token = GetToken(Tokenizer);
         if(TokenEquals(Token, "list"))
         {
-            KwmConstructEvent(KWMEvent_QueryScratchpad, KwmCreateContext(ClientSockFD));
+            KwmRunEvent(KWMEvent_QueryScratchpad, KwmCreatePayload(ClientSockFD));
         }
         else
         {
             ReportInvalidCommand("Unknown command 'query scratchpad " + std::string(Token.Text, Token.TextLength) + "'");
         }
     }
+    else if(TokenEquals(Token, "events"))
+    {
+        token Token = GetToken(Tokenizer);
+        if(TokenEquals(Token, "coalesced"))
+            KwmRunEvent(KWMEvent_QueryEventsCoalesced, KwmCreatePayload(ClientSockFD));
+        else if(TokenEquals(Token, "lanes"))
+            KwmRunEvent(KWMEvent_QueryEventsLanes, KwmCreatePayload(ClientSockFD));
+        else if(TokenEquals(Token, "latency"))
+            KwmRunEvent(KWMEvent_QueryEventsLatency, KwmCreatePayload(ClientSockFD));
+        else if(TokenEquals(Token, "launch"))
+            KwmRunEvent(KWMEvent_QueryEventsLaunch, KwmCreatePayload(ClientSockFD));
+        else if(TokenEquals(Token, "burst"))
+            KwmRunEvent(KWMEvent_QueryEventsBurst, KwmCreatePayload(ClientSockFD));
+        else
+            ReportInvalidCommand("Unknown command 'query events " + std::string(Token.Text, Token.TextLength) + "'");
+    }
     else if(TokenEquals(Token, "space"))
     {
         token Token = GetToken(Tokenizer);
@@ -1766,13 +1917,15 @@ KwmParseQueryOption(tokenizer *Tokenizer)
         {
             token Token = GetToken(Tokenizer);
             if(TokenEquals(Token, "tag"))
-                KwmConstructEvent(KWMEvent_QueryCurrentSpaceTag, KwmCreateContext(ClientSockFD));
+                KwmRunEvent(KWMEvent_QueryCurrentSpaceTag, KwmCreatePayload(ClientSockFD));
             else if(TokenEquals(Token, "name"))
-                KwmConstructEvent(KWMEvent_QueryCurrentSpaceName, KwmCreateContext(ClientSockFD));
+                KwmRunEvent(KWMEvent_QueryCurrentSpaceName, KwmCreatePayload(ClientSockFD));
             else if(TokenEquals(Token, "id"))
-                KwmConstructEvent(KWMEvent_QueryCurrentSpaceId, KwmCreateContext(ClientSockFD));
+                KwmRunEvent(KWMEvent_QueryCurrentSpaceId, KwmCreatePayload(ClientSockFD));
             else if(TokenEquals(Token, "mode"))
-                KwmConstructEvent(KWMEvent_QueryCurrentSpaceMode, KwmCreateContext(ClientSockFD));
+                KwmRunEvent(KWMEvent_QueryCurrentSpaceMode, KwmCreatePayload(ClientSockFD));
+            else if(TokenEquals(Token, "allocator"))
+                KwmRunEvent(KWMEvent_QueryCurrentSpaceAllocator, KwmCreatePayload(ClientSockFD));
             else
                 ReportInvalidCommand("Unknown command 'query space active " + std::string(Token.Text, Token.TextLength) + "'");
         }
@@ -1780,15 +1933,15 @@ KwmParseQueryOption(tokenizer *Tokenizer)
         {
             token Token = GetToken(Tokenizer);
             if(TokenEquals(Token, "name"))
-                KwmConstructEvent(KWMEvent_QueryPreviousSpaceName, KwmCreateContext(ClientSockFD));
+                KwmRunEvent(KWMEvent_QueryPreviousSpaceName, KwmCreatePayload(ClientSockFD));
             else if(TokenEquals(Token, "id"))
-                KwmConstructEvent(KWMEvent_QueryPreviousSpaceId, KwmCreateContext(ClientSockFD));
+                KwmRunEvent(KWMEvent_QueryPreviousSpaceId, KwmCreatePayload(ClientSockFD));
             else
                 ReportInvalidCommand("Unknown command 'query space previous " + std::string(Token.Text, Token.TextLength) + "'");
         }
         else if(TokenEquals(Token, "list"))
         {
-            KwmConstructEvent(KWMEvent_QuerySpaces, KwmCreateContext(ClientSockFD));
+            KwmRunEvent(KWMEvent_QuerySpaces, KwmCreatePayload(ClientSockFD));
         }
         else
         {
@@ -1799,17 +1952,15 @@ KwmParseQueryOption(tokenizer *Tokenizer)
     {
         token Token = GetToken(Tokenizer);
         if(TokenEquals(Token, "focused"))
-            KwmConstructEvent(KWMEvent_QueryFocusedBorder, KwmCreateContext(ClientSockFD));
+            KwmRunEvent(KWMEvent_QueryFocusedBorder, KwmCreatePayload(ClientSockFD));
         else if(TokenEquals(Token, "marked"))
-            KwmConstructEvent(KWMEvent_QueryMarkedBorder, KwmCreateContext(ClientSockFD));
+            KwmRunEvent(KWMEvent_QueryMarkedBorder, KwmCreatePayload(ClientSockFD));
         else
             ReportInvalidCommand("Unknown command 'query border " + std::string(Token.Text, Token.TextLength) + "'");
     }
     else
     {
         ReportInvalidCommand("Unknown command 'query " + std::string(Token.Text, Token.TextLength) + "'");
-        shutdown(ClientSockFD, SHUT_RDWR);
-        close(ClientSockFD);
     }
 }
 
@@ -1828,9 +1979,25 @@ void KwmParseKwmc(tokenizer *Tokenizer, int SockFD)
             if(TokenEquals(Token, "config"))
                 KwmParseConfigOption(Tokenizer);
             else if(TokenEquals(Token, "window"))
+            {
+                bool Record = IsTreeMutatingWindowOption(*Tokenizer);
+                if(Record)
+                    RecordTreeHistory(AXLibMainDisplay(), false);
+
                 KwmParseWindowOption(Tokenizer);
+                if(Record)
+                    RecordTreeHistory(AXLibMainDisplay(), true);
+            }
             else if(TokenEquals(Token, "tree"))
+            {
+                bool Record = IsTreeMutatingTreeOption(*Tokenizer);
+                if(Record)
+                    RecordTreeHistory(AXLibMainDisplay(), false);
+
                 KwmParseTreeOption(Tokenizer);
+                if(Record)
+                    RecordTreeHistory(AXLibMainDisplay(), true);
+            }
             else if(TokenEquals(Token, "display"))
                 KwmParseDisplayOption(Tokenizer);
             else if(TokenEquals(Token, "space"))
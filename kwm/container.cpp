@@ -1,6 +1,8 @@
 #include "container.h"
 #include "node.h"
 #include "space.h"
+#include "tree.h"
+#include "window.h"
 
 #define internal static
 
@@ -8,61 +10,85 @@ extern std::map<std::string, space_info> WindowTree;
 extern kwm_settings KWMSettings;
 
 internal node_container
-LeftVerticalContainerSplit(ax_display *Display, tree_node *Node)
+LeftVerticalContainerSplit(space_info *SpaceInfo, node_container *Container, double SplitRatio)
 {
-    space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
     node_container LeftContainer;
 
-    LeftContainer.X = Node->Container.X;
-    LeftContainer.Y = Node->Container.Y;
-    LeftContainer.Width = (Node->Container.Width * Node->SplitRatio) - (SpaceInfo->Settings.Offset.VerticalGap / 2);
-    LeftContainer.Height = Node->Container.Height;
+    LeftContainer.X = Container->X;
+    LeftContainer.Y = Container->Y;
+    LeftContainer.Width = (Container->Width * SplitRatio) - (SpaceInfo->Settings.Offset.VerticalGap / 2);
+    LeftContainer.Height = Container->Height;
 
     return LeftContainer;
 }
 
 internal node_container
-RightVerticalContainerSplit(ax_display *Display, tree_node *Node)
+RightVerticalContainerSplit(space_info *SpaceInfo, node_container *Container, double SplitRatio)
 {
-    space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
     node_container RightContainer;
 
-    RightContainer.X = Node->Container.X + (Node->Container.Width * Node->SplitRatio) + (SpaceInfo->Settings.Offset.VerticalGap / 2);
-    RightContainer.Y = Node->Container.Y;
-    RightContainer.Width = (Node->Container.Width * (1 - Node->SplitRatio)) - (SpaceInfo->Settings.Offset.VerticalGap / 2);
-    RightContainer.Height = Node->Container.Height;
+    RightContainer.X = Container->X + (Container->Width * SplitRatio) + (SpaceInfo->Settings.Offset.VerticalGap / 2);
+    RightContainer.Y = Container->Y;
+    RightContainer.Width = (Container->Width * (1 - SplitRatio)) - (SpaceInfo->Settings.Offset.VerticalGap / 2);
+    RightContainer.Height = Container->Height;
 
     return RightContainer;
 }
 
 internal node_container
-UpperHorizontalContainerSplit(ax_display *Display, tree_node *Node)
+UpperHorizontalContainerSplit(space_info *SpaceInfo, node_container *Container, double SplitRatio)
 {
-    space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
     node_container UpperContainer;
 
-    UpperContainer.X = Node->Container.X;
-    UpperContainer.Y = Node->Container.Y;
-    UpperContainer.Width = Node->Container.Width;
-    UpperContainer.Height = (Node->Container.Height * Node->SplitRatio) - (SpaceInfo->Settings.Offset.HorizontalGap / 2);
+    UpperContainer.X = Container->X;
+    UpperContainer.Y = Container->Y;
+    UpperContainer.Width = Container->Width;
+    UpperContainer.Height = (Container->Height * SplitRatio) - (SpaceInfo->Settings.Offset.HorizontalGap / 2);
 
     return UpperContainer;
 }
 
 internal node_container
-LowerHorizontalContainerSplit(ax_display *Display, tree_node *Node)
+LowerHorizontalContainerSplit(space_info *SpaceInfo, node_container *Container, double SplitRatio)
 {
-    space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
     node_container LowerContainer;
 
-    LowerContainer.X = Node->Container.X;
-    LowerContainer.Y = Node->Container.Y + (Node->Container.Height * Node->SplitRatio) + (SpaceInfo->Settings.Offset.HorizontalGap / 2);
-    LowerContainer.Width = Node->Container.Width;
-    LowerContainer.Height = (Node->Container.Height * (1 - Node->SplitRatio)) - (SpaceInfo->Settings.Offset.HorizontalGap / 2);
+    LowerContainer.X = Container->X;
+    LowerContainer.Y = Container->Y + (Container->Height * SplitRatio) + (SpaceInfo->Settings.Offset.HorizontalGap / 2);
+    LowerContainer.Width = Container->Width;
+    LowerContainer.Height = (Container->Height * (1 - SplitRatio)) - (SpaceInfo->Settings.Offset.HorizontalGap / 2);
 
     return LowerContainer;
 }
 
+internal bool
+SplitNodeContainer(space_info *SpaceInfo, node_container *Parent, double SplitRatio,
+                   container_type Type, node_container *Result)
+{
+    switch(Type)
+    {
+        case CONTAINER_LEFT:
+        {
+            *Result = LeftVerticalContainerSplit(SpaceInfo, Parent, SplitRatio);
+        } break;
+        case CONTAINER_RIGHT:
+        {
+            *Result = RightVerticalContainerSplit(SpaceInfo, Parent, SplitRatio);
+        } break;
+        case CONTAINER_UPPER:
+        {
+            *Result = UpperHorizontalContainerSplit(SpaceInfo, Parent, SplitRatio);
+        } break;
+        case CONTAINER_LOWER:
+        {
+            *Result = LowerHorizontalContainerSplit(SpaceInfo, Parent, SplitRatio);
+        } break;
+        default: { /* NOTE(koekeishiya): No container specified. */ return false; } break;
+    }
+
+    return true;
+}
+
 void SetRootNodeContainer(ax_display *Display, tree_node *Node)
 {
     space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
@@ -88,29 +114,12 @@ void SetLinkNodeContainer(ax_display *Display, link_node *Link)
 
 void CreateNodeContainer(ax_display *Display, tree_node *Node, container_type Type)
 {
+    space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
     if(Node->SplitRatio == 0)
         Node->SplitRatio = KWMSettings.SplitRatio;
 
-    switch(Type)
-    {
-        case CONTAINER_LEFT:
-        {
-            Node->Container = LeftVerticalContainerSplit(Display, Node->Parent);
-        } break;
-        case CONTAINER_RIGHT:
-        {
-            Node->Container = RightVerticalContainerSplit(Display, Node->Parent);
-        } break;
-        case CONTAINER_UPPER:
-        {
-            Node->Container = UpperHorizontalContainerSplit(Display, Node->Parent);
-        } break;
-        case CONTAINER_LOWER:
-        {
-            Node->Container = LowerHorizontalContainerSplit(Display, Node->Parent);
-        } break;
-        default: { /* NOTE(koekeishiya): No container specified. */} break;
-    }
+    if(Node->Parent)
+        SplitNodeContainer(SpaceInfo, &Node->Parent->Container, Node->Parent->SplitRatio, Type, &Node->Container);
 
     if(Node->SplitMode == SPLIT_NONE)
         Node->SplitMode = GetOptimalSplitMode(Node);
@@ -152,6 +161,146 @@ void ResizeNodeContainer(ax_display *Display, tree_node *Node)
     }
 }
 
+void MarkNodeSplitDirty(tree_node *Node)
+{
+    if(Node)
+    {
+        Node->Dirty |= NodeDirty_Split;
+        tree_node *Parent = Node->Parent;
+        while(Parent && !(Parent->Dirty & NodeDirty_SplitBelow))
+        {
+            Parent->Dirty |= NodeDirty_SplitBelow;
+            Parent = Parent->Parent;
+        }
+    }
+}
+
+void MarkNodeGeometryDirty(tree_node *Node)
+{
+    if(Node)
+    {
+        Node->Dirty |= NodeDirty_Geometry;
+        tree_node *Parent = Node->Parent;
+        while(Parent && !(Parent->Dirty & NodeDirty_GeometryBelow))
+        {
+            Parent->Dirty |= NodeDirty_GeometryBelow;
+            Parent = Parent->Parent;
+        }
+    }
+}
+
+/* NOTE(koekeishiya): Marking sets the Below flag on every ancestor, but a pass only clears the
+ * flags of the subtree it started at. Called after such a pass, walks up from its root and
+ * clears the Below flag of every ancestor that has nothing else dirty below it. */
+void ClearDirtyNodeAncestors(tree_node *Node, uint32_t Flag, uint32_t Below)
+{
+    while(Node && Node->Parent && !(Node->Dirty & (Flag | Below)))
+    {
+        tree_node *Parent = Node->Parent;
+        tree_node *Sibling = Parent->LeftChild == Node ? Parent->RightChild : Parent->LeftChild;
+        if(Sibling && (Sibling->Dirty & (Flag | Below)))
+            break;
+
+        Parent->Dirty &= ~Below;
+        Node = Parent;
+    }
+}
+
+#define CONTAINER_AXIS_X (1 << 0)
+#define CONTAINER_AXIS_Y (1 << 1)
+
+internal inline uint32_t
+GetChangedContainerAxes(node_container *A, node_container *B)
+{
+    uint32_t Result = 0;
+    if(A->X != B->X || A->Width != B->Width)
+        Result |= CONTAINER_AXIS_X;
+    if(A->Y != B->Y || A->Height != B->Height)
+        Result |= CONTAINER_AXIS_Y;
+
+    return Result;
+}
+
+internal inline uint32_t
+GetSplitAxisOfContainerType(container_type Type)
+{
+    if(Type == CONTAINER_LEFT || Type == CONTAINER_RIGHT)
+        return CONTAINER_AXIS_X;
+    if(Type == CONTAINER_UPPER || Type == CONTAINER_LOWER)
+        return CONTAINER_AXIS_Y;
+
+    return CONTAINER_AXIS_X | CONTAINER_AXIS_Y;
+}
+
+/* NOTE(koekeishiya): A child only derives its extent along the split axis of its parent
+ * from the split ratio; along the other axis it is an exact copy of the parent. When the
+ * parent only changed along that other axis, the child is updated by copying the changed
+ * extent instead of being split again. A child whose container did not change at all, and
+ * that has nothing dirty below it, is not visited. */
+internal void
+UpdateChildNodeContainers(space_info *SpaceInfo, tree_node *Node, uint32_t ChangedAxes)
+{
+    bool Split = Node->Dirty & NodeDirty_Split;
+    bool SplitBelow = Node->Dirty & NodeDirty_SplitBelow;
+    Node->Dirty &= ~(NodeDirty_Split | NodeDirty_SplitBelow);
+
+    if(!Node->LeftChild || !Node->RightChild)
+        return;
+
+    uint32_t SplitAxis = GetSplitAxisOfContainerType(Node->LeftChild->Container.Type);
+    bool Resplit = Split || (ChangedAxes & SplitAxis);
+
+    tree_node *Children[2] = { Node->LeftChild, Node->RightChild };
+    for(int Index = 0; Index < 2; ++Index)
+    {
+        tree_node *Child = Children[Index];
+        node_container Previous = Child->Container;
+
+        if(Resplit)
+        {
+            if(Child->SplitRatio == 0)
+                Child->SplitRatio = KWMSettings.SplitRatio;
+
+            SplitNodeContainer(SpaceInfo, &Node->Container, Node->SplitRatio, Child->Container.Type, &Child->Container);
+            Child->Container.Type = Previous.Type;
+        }
+        else
+        {
+            if(ChangedAxes & CONTAINER_AXIS_X)
+            {
+                Child->Container.X = Node->Container.X;
+                Child->Container.Width = Node->Container.Width;
+            }
+
+            if(ChangedAxes & CONTAINER_AXIS_Y)
+            {
+                Child->Container.Y = Node->Container.Y;
+                Child->Container.Height = Node->Container.Height;
+            }
+        }
+
+        uint32_t ChildChangedAxes = GetChangedContainerAxes(&Previous, &Child->Container);
+        if(ChildChangedAxes)
+        {
+            MarkNodeGeometryDirty(Child);
+            ResizeLinkNodeContainers(Child);
+        }
+
+        if(ChildChangedAxes || (SplitBelow && (Child->Dirty & (NodeDirty_Split | NodeDirty_SplitBelow))))
+            UpdateChildNodeContainers(SpaceInfo, Child, ChildChangedAxes);
+    }
+}
+
+void UpdateDirtyNodeContainers(ax_display *Display, tree_node *Node)
+{
+    if(Node)
+    {
+        space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
+        UpdateChildNodeContainers(SpaceInfo, Node, 0);
+        ClearDirtyNodeAncestors(Node, NodeDirty_Split, NodeDirty_SplitBelow);
+    }
+}
+
 void ResizeLinkNodeContainers(tree_node *Root)
 {
     if(Root)
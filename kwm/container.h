@@ -10,6 +10,10 @@ void CreateNodeContainer(ax_display *Display, tree_node *Node, container_type Ty
 void CreateNodeContainerPair(ax_display *Display, tree_node *LeftNode, tree_node *RightNode, split_type SplitMode);
 void ResizeNodeContainer(ax_display *Display, tree_node *Node);
 void ResizeLinkNodeContainers(tree_node *Root);
+void MarkNodeSplitDirty(tree_node *Node);
+void MarkNodeGeometryDirty(tree_node *Node);
+void ClearDirtyNodeAncestors(tree_node *Node, uint32_t Flag, uint32_t Below);
+void UpdateDirtyNodeContainers(ax_display *Display, tree_node *Node);
 void CreateNodeContainers(ax_display *Display, tree_node *Node, bool OptimalSplit);
 void CreateDeserializedNodeContainer(ax_display *Display, tree_node *Node);
 
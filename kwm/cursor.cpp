@@ -2,6 +2,7 @@
 #include "window.h"
 #include "node.h"
 #include "tree.h"
+#include "history.h"
 #include "space.h"
 #include "border.h"
 #include "../axlib/axlib.h"
@@ -37,20 +38,10 @@ internal tree_node *MarkedNode = NULL;
 internal std::vector<resize_indicator_border> ResizeIndicatorBorders;
 internal resize_state_struct ResizeState = {};
 
-internal inline CGPoint
-GetCursorPos()
-{
-    CGEventRef Event = CGEventCreate(NULL);
-    CGPoint Cursor = CGEventGetLocation(Event);
-    CFRelease(Event);
-
-    return Cursor;
-}
-
 internal bool
 IsCursorInsideRect(double X, double Y, double Width, double Height)
 {
-    CGPoint Cursor = GetCursorPos();
+    CGPoint Cursor = AXLibGetCursorPos();
     if(Cursor.x >= X &&
        Cursor.x <= X + Width &&
        Cursor.y >= Y &&
@@ -108,10 +99,13 @@ EVENT_CALLBACK(Callback_AXEvent_LeftMouseUp)
         {
             if(MarkedNode && MarkedNode->WindowID != Window->ID)
             {
-                tree_node *Node = GetTreeNodeFromWindowIDOrLinkNode(WindowTree[WindowDisplay->Space->Identifier].RootNode, Window->ID);
+                space_info *SpaceInfo = &WindowTree[WindowDisplay->Space->Identifier];
+                tree_node *Node = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo, Window->ID);
                 if(Node)
                 {
-                    SwapNodeWindowIDs(Node, MarkedNode);
+                    RecordTreeHistory(SpaceInfo, false);
+                    SwapNodeWindowIDs(SpaceInfo, Node, MarkedNode);
+                    RecordTreeHistory(SpaceInfo, true);
                 }
             }
         }
@@ -130,7 +124,7 @@ EVENT_CALLBACK(Callback_AXEvent_LeftMouseDragged)
          * was triggered on top of a window. Thus, we assume that the FocusedApplication
          * and its Focus can never be NULL here. */
 
-        CGPoint Cursor = GetCursorPos();
+        CGPoint Cursor = AXLibGetCursorPos();
         ax_window *Window = FocusedApplication->Focus;
         if(AXLibHasFlags(Window, AXWindow_Floating))
         {
@@ -213,9 +207,10 @@ FreeResizedNodeBorders()
 
 EVENT_CALLBACK(Callback_AXEvent_RightMouseDown)
 {
-    CGPoint CursorPos = GetCursorPos();
+    CGPoint CursorPos = AXLibGetCursorPos();
     ax_display *CursorDisplay = AXLibCursorDisplay();
-    tree_node *Root = WindowTree[CursorDisplay->Space->Identifier].RootNode;
+    space_info *SpaceInfo = &WindowTree[CursorDisplay->Space->Identifier];
+    tree_node *Root = SpaceInfo->RootNode;
     tree_node *NodeBelowCursor = GetTreeNodeForPoint(Root, &CursorPos);
 
     if(!NodeBelowCursor)
@@ -256,12 +251,12 @@ EVENT_CALLBACK(Callback_AXEvent_RightMouseDown)
         HorizontalNeighbour = NULL;
 
     tree_node *VerticalTarget = (VerticalNeighbour)
-        ? GetTreeNodeFromWindowIDOrLinkNode(Root, VerticalNeighbour->ID)
+        ? GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo, VerticalNeighbour->ID)
         : NULL;
     ResizeState.VerticalAncestor = FindLowestCommonAncestor(NodeBelowCursor, VerticalTarget);
 
     tree_node *HorizontalTarget = (HorizontalNeighbour)
-        ? GetTreeNodeFromWindowIDOrLinkNode(Root, HorizontalNeighbour->ID)
+        ? GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo, HorizontalNeighbour->ID)
         : NULL;
     ResizeState.HorizontalAncestor = FindLowestCommonAncestor(NodeBelowCursor, HorizontalTarget);
 
@@ -292,8 +287,8 @@ EVENT_CALLBACK(Callback_AXEvent_RightMouseUp)
         DEBUG("AXEvent_RightMouseUp");
 
         FreeResizedNodeBorders();
-        ApplyTreeNodeContainer(ResizeState.HorizontalAncestor);
-        ApplyTreeNodeContainer(ResizeState.VerticalAncestor);
+        ApplyDirtyNodeContainers(ResizeState.HorizontalAncestor);
+        ApplyDirtyNodeContainers(ResizeState.VerticalAncestor);
         ResizeState = resize_state_struct();
         DragResizeNode = false;
     }
@@ -303,7 +298,7 @@ EVENT_CALLBACK(Callback_AXEvent_RightMouseDragged)
 {
     if(DragResizeNode)
     {
-        CGPoint CursorPos = GetCursorPos();
+        CGPoint CursorPos = AXLibGetCursorPos();
         local_persist double SplitRatioMinDifference = 0.002;
 
         DEBUG("AXEvent_RightMouseDragged");
@@ -336,8 +331,8 @@ void MoveCursorToCenterOfTreeNode(tree_node *Node)
        (!IsCursorInsideRect(Node->Container.X, Node->Container.Y,
                             Node->Container.Width, Node->Container.Height)))
     {
-        CGWarpMouseCursorPosition(CGPointMake(Node->Container.X + Node->Container.Width / 2,
-                                              Node->Container.Y + Node->Container.Height / 2));
+        AXLibSetCursorPos(CGPointMake(Node->Container.X + Node->Container.Width / 2,
+                                      Node->Container.Y + Node->Container.Height / 2));
     }
 }
 
@@ -347,8 +342,8 @@ void MoveCursorToCenterOfLinkNode(link_node *Link)
        (!IsCursorInsideRect(Link->Container.X, Link->Container.Y,
                             Link->Container.Width, Link->Container.Height)))
     {
-        CGWarpMouseCursorPosition(CGPointMake(Link->Container.X + Link->Container.Width / 2,
-                                              Link->Container.Y + Link->Container.Height / 2));
+        AXLibSetCursorPos(CGPointMake(Link->Container.X + Link->Container.Width / 2,
+                                      Link->Container.Y + Link->Container.Height / 2));
     }
 }
 
@@ -358,8 +353,8 @@ void MoveCursorToCenterOfWindow(ax_window *Window)
        (!IsCursorInsideRect(Window->Position.x, Window->Position.y,
                             Window->Size.width, Window->Size.height)))
     {
-        CGWarpMouseCursorPosition(CGPointMake(Window->Position.x + Window->Size.width / 2,
-                                              Window->Position.y + Window->Size.height / 2));
+        AXLibSetCursorPos(CGPointMake(Window->Position.x + Window->Size.width / 2,
+                                      Window->Position.y + Window->Size.height / 2));
     }
 }
 
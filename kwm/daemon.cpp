@@ -1,81 +1,835 @@
 #include "daemon.h"
-#include "interpreter.h"
+#include "poller.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <map>
+#include <vector>
+
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif
 
 #define internal static
 
-internal int KwmSockFD;
+struct kwm_response
+{
+    int ClientID;
+    bool Active;
+    std::string Body;
+};
+
+/* NOTE(koekeishiya): A reply with a ClientID of 0 is a notification for every client that is
+ * subscribed to one of its Topics. */
+struct kwm_reply
+{
+    int ClientID;
+    bool Close;
+    bool Subscribe;
+    uint32_t Topics;
+    std::string Header;
+    std::string Body;
+};
+
+internal int KwmUnixSockFD = -1;
+internal int KwmTCPSockFD = -1;
+internal std::string KwmSocketPath;
 internal bool KwmDaemonIsRunning;
 internal int KwmDaemonPort = 3020;
 internal pthread_t KwmDaemonThread;
+internal int KwmMaxClients = KWM_DEFAULT_MAX_CLIENTS;
+internal kwm_daemon_handler KwmDaemonHandler;
+
+internal kwm_poller Poller = { -1 };
+internal int WakePipe[2] = { -1, -1 };
+internal int NextClientID = 1;
+internal std::map<int, kwm_client *> Clients;
+internal std::map<int, kwm_client *> ClientIDs;
+internal uint32_t SubscribedTopics;
+internal uint32_t ConnectedClients;
+internal uint64_t QueuedCommands;
+
+internal pthread_mutex_t ReplyLock = PTHREAD_MUTEX_INITIALIZER;
+internal std::vector<kwm_reply> Replies;
+internal kwm_response Response;
+
+internal bool
+KwmSetNonBlocking(int FD)
+{
+    int Flags = fcntl(FD, F_GETFL, 0);
+    return Flags != -1 && fcntl(FD, F_SETFL, Flags | O_NONBLOCK) != -1;
+}
+
+internal inline uint64_t
+KwmGetTimeMs()
+{
+#ifdef __APPLE__
+    static mach_timebase_info_data_t Timebase;
+    if(Timebase.denom == 0)
+        mach_timebase_info(&Timebase);
+
+    return mach_absolute_time() * Timebase.numer / Timebase.denom / 1000000;
+#else
+    timespec Time;
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    return (uint64_t) Time.tv_sec * 1000 + Time.tv_nsec / 1000000;
+#endif
+}
+
+/* NOTE(koekeishiya): Consumed bytes are dropped once they make up a full chunk, so a
+ * buffer never grows much past the commands that have not been read yet. */
+internal void
+KwmCompactReader(kwm_socket_reader *Reader)
+{
+    if(Reader->Cursor == Reader->Buffer.size())
+    {
+        Reader->Buffer.clear();
+        Reader->Cursor = 0;
+    }
+    else if(Reader->Cursor >= KWM_SOCKET_CHUNK)
+    {
+        Reader->Buffer.erase(0, Reader->Cursor);
+        Reader->Cursor = 0;
+    }
+}
+
+internal bool
+KwmParseLine(kwm_socket_reader *Reader, std::string *Line)
+{
+    std::size_t End = Reader->Buffer.find('\n', Reader->Cursor);
+    if(End == std::string::npos)
+        return false;
+
+    Line->assign(Reader->Buffer, Reader->Cursor, End - Reader->Cursor);
+    Reader->Cursor = End + 1;
+    return true;
+}
+
+/* NOTE(koekeishiya): Returns 1 if a command was read, 0 if more input is needed and -1 if the
+ * input is malformed. A length-delimited command is only consumed once all of it is here.
+ * Empty lines between commands are skipped. */
+internal int
+KwmParseCommand(kwm_socket_reader *Reader, std::string *Command)
+{
+    while(true)
+    {
+        std::size_t End = Reader->Buffer.find('\n', Reader->Cursor);
+        if(End == std::string::npos)
+            return 0;
+
+        if(End == Reader->Cursor)
+        {
+            ++Reader->Cursor;
+            continue;
+        }
+
+        if(Reader->Buffer[Reader->Cursor] != '#')
+        {
+            KwmParseLine(Reader, Command);
+            return 1;
+        }
+
+        const char *Start = Reader->Buffer.c_str() + Reader->Cursor + 1;
+        char *Last;
+        unsigned long Length = strtoul(Start, &Last, 10);
+        if(Last == Start || *Last != '\n')
+            return -1;
+
+        if(Reader->Buffer.size() - (End + 1) < Length)
+            return 0;
+
+        Command->assign(Reader->Buffer, End + 1, Length);
+        Reader->Cursor = End + 1 + Length;
+        return 1;
+    }
+}
+
+internal void
+KwmQueueOutput(kwm_client *Client, std::string Data)
+{
+    if(!Data.empty())
+    {
+        Client->OutputSize += Data.size();
+        Client->Output.push_back(Data);
+    }
+}
+
+/* NOTE(koekeishiya): Tells a subscriber how many notifications it missed, before the next one
+ * it is sent or as soon as it has caught up, whichever comes first. */
+internal void
+KwmQueueDropped(kwm_client *Client)
+{
+    if(Client->Dropped)
+    {
+        KwmQueueOutput(Client, "dropped " + std::to_string(Client->Dropped) + "\n");
+        Client->Dropped = 0;
+    }
+}
+
+internal void
+KwmWatchClient(kwm_client *Client)
+{
+    uint32_t Events = 0;
+    if(!Client->InputDone && Client->Pending < KWM_CLIENT_MAX_PENDING)
+        Events |= KWM_POLLER_READ;
+    if(!Client->Output.empty())
+        Events |= KWM_POLLER_WRITE;
+
+    if(Events != Client->Watching)
+    {
+        KwmPollerWatch(&Poller, Client->SockFD, Events);
+        Client->Watching = Events;
+    }
+}
+
+internal void
+KwmUpdateSubscribedTopics()
+{
+    uint32_t Topics = 0;
+    for(std::map<int, kwm_client *>::iterator It = Clients.begin(); It != Clients.end(); ++It)
+        Topics |= It->second->Topics;
+
+    __atomic_store_n(&SubscribedTopics, Topics, __ATOMIC_RELAXED);
+}
+
+internal void
+KwmDestroyClient(kwm_client *Client)
+{
+    KwmPollerForget(&Poller, Client->SockFD);
+    shutdown(Client->SockFD, SHUT_RDWR);
+    close(Client->SockFD);
+
+    Clients.erase(Client->SockFD);
+    __atomic_store_n(&ConnectedClients, (uint32_t) Clients.size(), __ATOMIC_RELAXED);
+    ClientIDs.erase(Client->ID);
+    if(Client->Topics)
+        KwmUpdateSubscribedTopics();
+
+    delete Client;
+}
+
+/* NOTE(koekeishiya): Returns false if the client was destroyed. A client is done once its
+ * replies are out and it either asked to be closed or has no more commands coming. */
+internal bool
+KwmUpdateClient(kwm_client *Client)
+{
+    if(Client->Output.empty() &&
+       (Client->Closing || (Client->InputDone && Client->Pending == 0)))
+    {
+        KwmDestroyClient(Client);
+        return false;
+    }
+
+    KwmWatchClient(Client);
+    return true;
+}
+
+/* NOTE(koekeishiya): Sends as much of the queued output as the socket takes, in one writev. */
+internal bool
+KwmFlushClient(kwm_client *Client)
+{
+    while(!Client->Output.empty())
+    {
+        struct iovec Vector[16];
+        int Count = 0;
+        for(std::deque<std::string>::iterator It = Client->Output.begin();
+            It != Client->Output.end() && Count < 16;
+            ++It, ++Count)
+        {
+            std::size_t Offset = Count == 0 ? Client->OutputCursor : 0;
+            Vector[Count].iov_base = (void *) (It->c_str() + Offset);
+            Vector[Count].iov_len = It->size() - Offset;
+        }
+
+        ssize_t Bytes = writev(Client->SockFD, Vector, Count);
+        if(Bytes == -1)
+        {
+            if(errno == EINTR)
+                continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            KwmDestroyClient(Client);
+            return false;
+        }
+
+        Client->LastActive = KwmGetTimeMs();
+        Client->OutputSize -= Bytes;
+        std::size_t Written = Bytes;
+        while(Written > 0)
+        {
+            std::size_t Remaining = Client->Output.front().size() - Client->OutputCursor;
+            if(Written < Remaining)
+            {
+                Client->OutputCursor += Written;
+                break;
+            }
+
+            Written -= Remaining;
+            Client->Output.pop_front();
+            Client->OutputCursor = 0;
+        }
+    }
+
+    if(Client->Output.empty() && Client->Dropped)
+    {
+        KwmQueueDropped(Client);
+        return KwmFlushClient(Client);
+    }
+
+    return KwmUpdateClient(Client);
+}
+
+/* NOTE(koekeishiya): Every command is counted, so that a query is only answered from a state
+ * snapshot that was taken after all of the commands queued before it have been handled. */
+internal void
+KwmQueueClientCommand(kwm_client *Client, std::string Command)
+{
+    ++Client->Pending;
+    ++QueuedCommands;
+    (*KwmDaemonHandler.Command)(Command, Client->ID, Client->Pipelined);
+}
+
+/* NOTE(koekeishiya): A query is answered on this thread by the Query of the handler, so it
+ * does not wait behind the events that are queued. Queries that it can not answer, and
+ * queries that follow a command of the same client that is still pending, are queued like
+ * any other command so that replies stay in order. */
+internal bool
+KwmAnswerQuery(kwm_client *Client, std::string Command)
+{
+    std::string Output;
+    if(Client->Pending != 0 || !KwmDaemonHandler.Query ||
+       !(*KwmDaemonHandler.Query)(Command, QueuedCommands, &Output))
+        return false;
+
+    if(Client->Pipelined)
+        KwmQueueOutput(Client, std::to_string(Output.size()) + "\n");
+    else
+        Client->Closing = true;
+
+    KwmQueueOutput(Client, Output);
+    return true;
+}
+
+/* NOTE(koekeishiya): The first line decides how the connection is used. A plain command is
+ * the only one the connection carries. After the handshake, every complete command is queued
+ * right away, so a pipelined client never waits for one reply before its next command is read. */
+internal bool
+KwmProcessClientInput(kwm_client *Client)
+{
+    if(Client->Topics)
+    {
+        Client->Reader.Buffer.clear();
+        Client->Reader.Cursor = 0;
+        return true;
+    }
+
+    std::string Command;
+    if(!Client->Started && KwmParseLine(&Client->Reader, &Command))
+    {
+        Client->Started = true;
+        if(Command == KWM_PIPELINE_HANDSHAKE)
+        {
+            Client->Pipelined = true;
+        }
+        else
+        {
+            Client->InputDone = true;
+            if(KwmAnswerQuery(Client, Command))
+                return KwmFlushClient(Client);
+
+            KwmQueueClientCommand(Client, Command);
+            return true;
+        }
+    }
+
+    int Result = 0;
+    bool Answered = false;
+    while(Client->Pipelined && Client->Pending < KWM_CLIENT_MAX_PENDING &&
+          (Result = KwmParseCommand(&Client->Reader, &Command)) == 1)
+    {
+        if(KwmAnswerQuery(Client, Command))
+            Answered = true;
+        else
+            KwmQueueClientCommand(Client, Command);
+    }
+
+    KwmCompactReader(&Client->Reader);
+    if(Result == -1 || Client->Reader.Buffer.size() - Client->Reader.Cursor > KWM_CLIENT_MAX_INPUT)
+    {
+        KwmDestroyClient(Client);
+        return false;
+    }
+
+    return Answered ? KwmFlushClient(Client) : true;
+}
+
+/* NOTE(koekeishiya): A command that is cut short by the client closing its side is still run,
+ * so that 'printf command | nc' keeps working. */
+internal void
+KwmReadClient(kwm_client *Client)
+{
+    while(!Client->InputDone && Client->Pending < KWM_CLIENT_MAX_PENDING)
+    {
+        char Chunk[KWM_SOCKET_CHUNK];
+        ssize_t Bytes = recv(Client->SockFD, Chunk, sizeof(Chunk), 0);
+        if(Bytes > 0)
+        {
+            Client->LastActive = KwmGetTimeMs();
+            Client->Reader.Buffer.append(Chunk, Bytes);
+            if(!KwmProcessClientInput(Client))
+                return;
+
+            continue;
+        }
+
+        if(Bytes == -1 && errno == EINTR)
+            continue;
+        if(Bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
 
-std::string KwmReadFromSocket(int ClientSockFD)
+        kwm_socket_reader *Reader = &Client->Reader;
+        if(Reader->Cursor != Reader->Buffer.size() && Reader->Buffer[Reader->Cursor] != '#')
+        {
+            Reader->Buffer += '\n';
+            if(!KwmProcessClientInput(Client))
+                return;
+        }
+
+        Client->InputDone = true;
+    }
+
+    KwmUpdateClient(Client);
+}
+
+/* NOTE(koekeishiya): Only the user that runs kwm may talk to it through the unix socket.
+ * Connections over tcp can not be checked, which is why that transport is opt-in. */
+internal bool
+KwmIsTrustedPeer(int ClientSockFD)
 {
-    char Cur;
-    std::string Message;
-    while(recv(ClientSockFD, &Cur, 1, 0))
+#ifdef __linux__
+    struct ucred Credentials;
+    socklen_t Size = sizeof(Credentials);
+    return getsockopt(ClientSockFD, SOL_SOCKET, SO_PEERCRED, &Credentials, &Size) == 0 &&
+           Credentials.uid == geteuid();
+#else
+    uid_t UID;
+    gid_t GID;
+    return getpeereid(ClientSockFD, &UID, &GID) == 0 && UID == geteuid();
+#endif
+}
+
+/* NOTE(koekeishiya): Connections beyond the limit are closed right away instead of being left
+ * in the backlog, so that the client fails fast. */
+internal void
+KwmAcceptClients(int ListenSockFD)
+{
+    while(true)
     {
-        if(Cur == '\n')
+        int ClientSockFD = accept(ListenSockFD, NULL, NULL);
+        if(ClientSockFD == -1)
+        {
+            if(errno == EINTR || errno == ECONNABORTED)
+                continue;
+
             break;
-        Message += Cur;
+        }
+
+        int MaxClients = __atomic_load_n(&KwmMaxClients, __ATOMIC_RELAXED);
+        if((int) Clients.size() >= MaxClients ||
+           (ListenSockFD == KwmUnixSockFD && !KwmIsTrustedPeer(ClientSockFD)) ||
+           !KwmSetNonBlocking(ClientSockFD))
+        {
+            close(ClientSockFD);
+            continue;
+        }
+
+        kwm_client *Client = new kwm_client();
+        Client->ID = NextClientID;
+        Client->SockFD = ClientSockFD;
+        Client->LastActive = KwmGetTimeMs();
+        NextClientID = NextClientID == 0x7FFFFFFF ? 1 : NextClientID + 1;
+
+        Clients[ClientSockFD] = Client;
+        ClientIDs[Client->ID] = Client;
+        __atomic_store_n(&ConnectedClients, (uint32_t) Clients.size(), __ATOMIC_RELAXED);
+        KwmWatchClient(Client);
     }
-    return Message;
 }
 
-void KwmWriteToSocket(std::string Msg, int ClientSockFD)
+internal void
+KwmPostReply(kwm_reply Reply)
+{
+    pthread_mutex_lock(&ReplyLock);
+    Replies.push_back(Reply);
+    pthread_mutex_unlock(&ReplyLock);
+
+    char Byte = 0;
+    write(WakePipe[1], &Byte, 1);
+}
+
+internal void
+KwmPostReply(int ClientID, std::string Header, std::string Body, bool Close)
+{
+    kwm_reply Reply = {};
+    Reply.ClientID = ClientID;
+    Reply.Close = Close;
+    Reply.Header = Header;
+    Reply.Body = Body;
+    KwmPostReply(Reply);
+}
+
+internal void
+KwmProcessNotification(kwm_reply *Reply)
+{
+    std::vector<kwm_client *> Subscribers;
+    for(std::map<int, kwm_client *>::iterator It = Clients.begin(); It != Clients.end(); ++It)
+    {
+        if(It->second->Topics & Reply->Topics)
+            Subscribers.push_back(It->second);
+    }
+
+    for(std::size_t Index = 0; Index < Subscribers.size(); ++Index)
+    {
+        kwm_client *Client = Subscribers[Index];
+        if(Client->OutputSize > KWM_SUBSCRIBER_MAX_OUTPUT)
+        {
+            ++Client->Dropped;
+            continue;
+        }
+
+        KwmQueueDropped(Client);
+        KwmQueueOutput(Client, Reply->Body);
+        KwmFlushClient(Client);
+    }
+}
+
+/* NOTE(koekeishiya): A reply to a client that has already been closed, or that asked to be
+ * closed by an earlier reply, is dropped. */
+internal void
+KwmProcessReplies()
 {
-    send(ClientSockFD, Msg.c_str(), Msg.size(), 0);
-    shutdown(ClientSockFD, SHUT_RDWR);
-    close(ClientSockFD);
+    char Drain[64];
+    while(read(WakePipe[0], Drain, sizeof(Drain)) > 0);
+
+    std::vector<kwm_reply> Ready;
+    pthread_mutex_lock(&ReplyLock);
+    Ready.swap(Replies);
+    pthread_mutex_unlock(&ReplyLock);
+
+    for(std::size_t Index = 0; Index < Ready.size(); ++Index)
+    {
+        kwm_reply *Reply = &Ready[Index];
+        if(Reply->ClientID == 0)
+        {
+            KwmProcessNotification(Reply);
+            continue;
+        }
+
+        std::map<int, kwm_client *>::iterator It = ClientIDs.find(Reply->ClientID);
+        if(It == ClientIDs.end() || It->second->Closing)
+            continue;
+
+        kwm_client *Client = It->second;
+        if(Client->Pending)
+            --Client->Pending;
+        KwmQueueOutput(Client, Reply->Header);
+        KwmQueueOutput(Client, Reply->Body);
+
+        if(Reply->Subscribe)
+        {
+            Client->Topics = Reply->Topics;
+            Client->InputDone = false;
+            KwmUpdateSubscribedTopics();
+        }
+
+        Client->Closing = Reply->Close;
+        Client->LastActive = KwmGetTimeMs();
+        if(!KwmFlushClient(Client) || !Client->Pipelined || Client->InputDone)
+            continue;
+
+        if(KwmProcessClientInput(Client))
+            KwmUpdateClient(Client);
+    }
+}
+
+internal void
+KwmCloseIdleClients()
+{
+    uint64_t Now = KwmGetTimeMs();
+    std::vector<kwm_client *> Idle;
+    for(std::map<int, kwm_client *>::iterator It = Clients.begin(); It != Clients.end(); ++It)
+    {
+        kwm_client *Client = It->second;
+        if(!Client->Topics && !Client->Pending && Client->Output.empty() &&
+           Now - Client->LastActive > KWM_CLIENT_IDLE_TIMEOUT)
+            Idle.push_back(Client);
+    }
+
+    for(std::size_t Index = 0; Index < Idle.size(); ++Index)
+        KwmDestroyClient(Idle[Index]);
 }
 
+/* NOTE(koekeishiya): The daemon thread only ever waits in KwmPollerWait. Clients are read and
+ * written as far as their sockets allow, so a client that stalls holds up nobody but itself.
+ * Replies are handed over by the worker through Replies, followed by a byte on WakePipe. */
 internal void *
 KwmDaemonHandleConnectionBG(void *)
 {
+    kwm_poller_event Events[64];
+    uint64_t LastSweep = KwmGetTimeMs();
+
     while(KwmDaemonIsRunning)
     {
-        int ClientSockFD;
-        struct sockaddr_in ClientAddr;
-        socklen_t SinSize = sizeof(struct sockaddr);
+        int Count = KwmPollerWait(&Poller, Events, 64, Clients.empty() ? -1 : 1000);
+        if(Count == -1)
+        {
+            fprintf(stderr, "KwmDaemonHandleConnectionBG() poller failed: %s\n", strerror(errno));
+            usleep(KWM_POLLER_ERROR_BACKOFF);
+            continue;
+        }
+
+        for(int Index = 0; Index < Count; ++Index)
+        {
+            int FD = Events[Index].FD;
+            if(FD == WakePipe[0])
+            {
+                KwmProcessReplies();
+            }
+            else if(FD == KwmUnixSockFD || FD == KwmTCPSockFD)
+            {
+                KwmAcceptClients(FD);
+            }
+            else
+            {
+                std::map<int, kwm_client *>::iterator It = Clients.find(FD);
+                if(It == Clients.end())
+                    continue;
 
-        ClientSockFD = accept(KwmSockFD, (struct sockaddr*)&ClientAddr, &SinSize);
-        if(ClientSockFD != -1)
+                kwm_client *Client = It->second;
+                if(Events[Index].Events & KWM_POLLER_WRITE)
+                {
+                    if(!KwmFlushClient(Client))
+                        continue;
+                }
+
+                if(Events[Index].Events & KWM_POLLER_READ)
+                    KwmReadClient(Client);
+            }
+        }
+
+        uint64_t Now = KwmGetTimeMs();
+        if(Now - LastSweep >= 1000)
         {
-            std::string Message = KwmReadFromSocket(ClientSockFD);
-            KwmInterpretCommand(Message, ClientSockFD);
+            KwmCloseIdleClients();
+            LastSweep = Now;
         }
     }
 
     return NULL;
 }
 
-void KwmTerminateDaemon()
+/* NOTE(koekeishiya): While a pipelined command runs, its replies are collected and sent
+ * as a single frame by KwmEndResponse, and the connection is left open. */
+void KwmWriteToSocket(std::string Msg, int ClientSockFD)
 {
-    KwmDaemonIsRunning = false;
-    close(KwmSockFD);
+    if(Response.Active && Response.ClientID == ClientSockFD)
+        Response.Body += Msg;
+    else
+        KwmPostReply(ClientSockFD, "", Msg, true);
+}
+
+void KwmCloseSocket(int ClientSockFD)
+{
+    if(!Response.Active || Response.ClientID != ClientSockFD)
+        KwmPostReply(ClientSockFD, "", "", true);
+}
+
+/* NOTE(koekeishiya): Only called from the worker thread. */
+void KwmBeginResponse(int ClientSockFD)
+{
+    Response.ClientID = ClientSockFD;
+    Response.Active = true;
+    Response.Body.clear();
+}
+
+void KwmEndResponse()
+{
+    if(!Response.Active)
+        return;
+
+    Response.Active = false;
+    KwmPostReply(Response.ClientID, std::to_string(Response.Body.size()) + "\n", Response.Body, false);
+}
+
+bool KwmIsResponseActive(int ClientSockFD)
+{
+    return Response.Active && Response.ClientID == ClientSockFD;
+}
+
+uint32_t KwmGetSubscribedTopics()
+{
+    return __atomic_load_n(&SubscribedTopics, __ATOMIC_RELAXED);
+}
+
+uint32_t KwmGetConnectedClients()
+{
+    return __atomic_load_n(&ConnectedClients, __ATOMIC_RELAXED);
+}
+
+/* NOTE(koekeishiya): Initial is sent to the client before any notification, so that it can
+ * start from the current state. The client is not closed after this reply. */
+void KwmSubscribeClient(int ClientSockFD, uint32_t Topics, std::string Initial)
+{
+    kwm_reply Reply = {};
+    Reply.ClientID = ClientSockFD;
+    Reply.Subscribe = true;
+    Reply.Topics = Topics;
+    Reply.Body = Initial;
+    KwmPostReply(Reply);
+}
+
+/* NOTE(koekeishiya): Message must be a single line, the newline is added here. */
+void KwmPublish(uint32_t Topic, std::string Message)
+{
+    if(!(KwmGetSubscribedTopics() & Topic))
+        return;
+
+    kwm_reply Reply = {};
+    Reply.Topics = Topic;
+    Reply.Body = Message + "\n";
+    KwmPostReply(Reply);
+}
+
+void KwmSetDaemonConnectionLimit(int Limit)
+{
+    if(Limit > 0)
+        __atomic_store_n(&KwmMaxClients, Limit, __ATOMIC_RELAXED);
+}
+
+/* NOTE(koekeishiya): A socket file that still accepts connections belongs to another instance
+ * of kwm. Otherwise it was left behind by one that did not exit cleanly, and is replaced. */
+internal int
+KwmListenUnixSocket(std::string Path)
+{
+    struct sockaddr_un SrvAddr = {};
+    if(Path.empty() || Path.size() >= sizeof(SrvAddr.sun_path))
+        return -1;
+
+    SrvAddr.sun_family = AF_UNIX;
+    memcpy(SrvAddr.sun_path, Path.c_str(), Path.size() + 1);
+
+    std::size_t Split = Path.find_last_of('/');
+    if(Split != std::string::npos && Split != 0)
+        mkdir(Path.substr(0, Split).c_str(), 0700);
+
+    int SockFD;
+    if((SockFD = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+        return -1;
+
+    if(connect(SockFD, (struct sockaddr*)&SrvAddr, sizeof(SrvAddr)) == 0)
+    {
+        close(SockFD);
+        fprintf(stderr, "Error: Another instance of kwm is listening on %s\n", Path.c_str());
+        return -1;
+    }
+
+    close(SockFD);
+    unlink(Path.c_str());
+
+    if((SockFD = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+        return -1;
+
+    if(bind(SockFD, (struct sockaddr*)&SrvAddr, sizeof(SrvAddr)) == -1 ||
+       chmod(Path.c_str(), 0600) == -1 ||
+       listen(SockFD, KWM_DAEMON_BACKLOG) == -1 ||
+       !KwmSetNonBlocking(SockFD))
+    {
+        close(SockFD);
+        return -1;
+    }
+
+    return SockFD;
 }
 
-bool KwmStartDaemon()
+internal int
+KwmListenTCPSocket(int Port)
 {
     struct sockaddr_in SrvAddr;
     int _True = 1;
+    int SockFD;
 
-    if((KwmSockFD = socket(PF_INET, SOCK_STREAM, 0)) == -1)
-        return false;
+    if((SockFD = socket(PF_INET, SOCK_STREAM, 0)) == -1)
+        return -1;
 
-    if(setsockopt(KwmSockFD, SOL_SOCKET, SO_REUSEADDR, &_True, sizeof(int)) == -1)
+    if(setsockopt(SockFD, SOL_SOCKET, SO_REUSEADDR, &_True, sizeof(int)) == -1)
         printf("Could not set socket option: SO_REUSEADDR!\n");
 
     SrvAddr.sin_family = AF_INET;
-    SrvAddr.sin_port = htons(KwmDaemonPort);
+    SrvAddr.sin_port = htons(Port);
     SrvAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
     memset(&SrvAddr.sin_zero, '\0', 8);
 
-    if(bind(KwmSockFD, (struct sockaddr*)&SrvAddr, sizeof(struct sockaddr)) == -1)
+    if(bind(SockFD, (struct sockaddr*)&SrvAddr, sizeof(struct sockaddr)) == -1 ||
+       listen(SockFD, KWM_DAEMON_BACKLOG) == -1 ||
+       !KwmSetNonBlocking(SockFD))
+    {
+        close(SockFD);
+        return -1;
+    }
+
+    return SockFD;
+}
+
+void KwmTerminateDaemon()
+{
+    if(!KwmDaemonIsRunning)
+        return;
+
+    KwmDaemonIsRunning = false;
+    if(KwmUnixSockFD != -1)
+    {
+        close(KwmUnixSockFD);
+        unlink(KwmSocketPath.c_str());
+    }
+
+    if(KwmTCPSockFD != -1)
+        close(KwmTCPSockFD);
+
+    char Byte = 0;
+    write(WakePipe[1], &Byte, 1);
+}
+
+/* NOTE(koekeishiya): The daemon listens on the unix socket at SocketPath, and on the loopback
+ * tcp port as well if TCP is set. It only fails to start if it can listen on neither. */
+bool KwmStartDaemon(std::string SocketPath, bool TCP, kwm_daemon_handler Handler)
+{
+    KwmDaemonHandler = Handler;
+    if(!KwmCreatePoller(&Poller) || pipe(WakePipe) == -1 ||
+       !KwmSetNonBlocking(WakePipe[0]) || !KwmSetNonBlocking(WakePipe[1]) ||
+       !KwmPollerWatch(&Poller, WakePipe[0], KWM_POLLER_READ))
         return false;
 
-    if(listen(KwmSockFD, 10) == -1)
+    KwmSocketPath = SocketPath;
+    KwmUnixSockFD = KwmListenUnixSocket(SocketPath);
+    if(KwmUnixSockFD == -1)
+        fprintf(stderr, "Error: Could not listen on %s\n", SocketPath.c_str());
+
+    if(TCP && (KwmTCPSockFD = KwmListenTCPSocket(KwmDaemonPort)) == -1)
+        fprintf(stderr, "Error: Could not listen on port %d\n", KwmDaemonPort);
+
+    if(KwmUnixSockFD == -1 && KwmTCPSockFD == -1)
         return false;
 
+    if(KwmUnixSockFD != -1)
+        KwmPollerWatch(&Poller, KwmUnixSockFD, KWM_POLLER_READ);
+    if(KwmTCPSockFD != -1)
+        KwmPollerWatch(&Poller, KwmTCPSockFD, KWM_POLLER_READ);
+
     KwmDaemonIsRunning = true;
     pthread_create(&KwmDaemonThread, NULL, &KwmDaemonHandleConnectionBG, NULL);
     return true;
@@ -3,17 +3,106 @@
 
 #include <stdio.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <unistd.h>
 #include <pthread.h>
 #include <string.h>
 #include <string>
+#include <deque>
+#include <stdint.h>
 
-bool KwmStartDaemon();
+/* NOTE(koekeishiya): A connection carries one newline-terminated command, whose reply is
+ * written before the connection is closed, unless the first line is KWM_PIPELINE_HANDSHAKE.
+ * The client may then send any number of commands back to back, either terminated by a
+ * newline or as '#<length>\n' followed by length bytes. Every command is answered with
+ * exactly one '<length>\n' frame, possibly empty, in the order the commands were sent.
+ * The connection is closed once the client has shut down its side and every command has
+ * been answered. */
+#define KWM_PIPELINE_HANDSHAKE "pipeline"
+#define KWM_DAEMON_BACKLOG 128
+#define KWM_SOCKET_CHUNK 4096
+
+/* NOTE(koekeishiya): A client is closed once it has been quiet for KWM_CLIENT_IDLE_TIMEOUT
+ * milliseconds, unless a reply to it is still pending or unsent. Input that does not hold a
+ * complete command within KWM_CLIENT_MAX_INPUT bytes closes it as well. A pipelined client is
+ * not read from while KWM_CLIENT_MAX_PENDING of its commands are waiting to be answered. */
+#define KWM_CLIENT_IDLE_TIMEOUT 30000
+#define KWM_CLIENT_MAX_INPUT (1 << 20)
+#define KWM_CLIENT_MAX_PENDING 256
+#define KWM_DEFAULT_MAX_CLIENTS 64
+
+/* NOTE(koekeishiya): Microseconds the daemon thread sleeps after the poller failed with anything
+ * but an interrupted wait, so that a persistent error does not keep it spinning. */
+#define KWM_POLLER_ERROR_BACKOFF 100000
+
+/* NOTE(koekeishiya): A subscriber stays connected until it closes its side, and is exempt from
+ * the idle timeout. Notifications are dropped while more than KWM_SUBSCRIBER_MAX_OUTPUT bytes
+ * are waiting to be sent to it; the next one that gets through is preceded by 'dropped <n>'. */
+#define KWM_SUBSCRIBER_MAX_OUTPUT (64 * 1024)
+
+struct kwm_socket_reader
+{
+    std::string Buffer;
+    std::size_t Cursor;
+};
+
+/* NOTE(koekeishiya): Clients are owned by the daemon thread. The rest of kwm refers to a client
+ * by its ID, which is what is passed around as ClientSockFD, so that a reply to a client that
+ * has gone away can never reach a new connection that happens to reuse its descriptor. */
+struct kwm_client
+{
+    int ID;
+    int SockFD;
+    uint32_t Watching;
+    uint32_t Pending;
+    uint32_t Topics;
+    uint32_t Dropped;
+    uint64_t LastActive;
+
+    bool Started;
+    bool Pipelined;
+    bool InputDone;
+    bool Closing;
+
+    kwm_socket_reader Reader;
+    std::deque<std::string> Output;
+    std::size_t OutputCursor;
+    std::size_t OutputSize;
+};
+
+/* NOTE(koekeishiya): The daemon only moves bytes; what a command means is up to the handler it
+ * is started with. Command is called from the daemon thread for every command it reads, and
+ * must queue it rather than run it. Query may answer a command on the daemon thread instead,
+ * from state that is safe to read there; Commands is the number of commands queued so far.
+ * Query may be NULL, in which case every command is passed to Command. */
+#define DAEMON_COMMAND_CALLBACK(name) void name(std::string Command, int ClientID, bool Pipelined)
+typedef DAEMON_COMMAND_CALLBACK(DaemonCommandCallback);
+
+#define DAEMON_QUERY_CALLBACK(name) bool name(std::string Command, uint64_t Commands, std::string *Output)
+typedef DAEMON_QUERY_CALLBACK(DaemonQueryCallback);
+
+struct kwm_daemon_handler
+{
+    DaemonCommandCallback *Command;
+    DaemonQueryCallback *Query;
+};
+
+bool KwmStartDaemon(std::string SocketPath, bool TCP, kwm_daemon_handler Handler);
 void KwmTerminateDaemon();
+void KwmSetDaemonConnectionLimit(int Limit);
 
-std::string KwmReadFromSocket(int ClientSockFD);
 void KwmWriteToSocket(std::string Msg, int ClientSockFD);
+void KwmCloseSocket(int ClientSockFD);
+
+void KwmBeginResponse(int ClientSockFD);
+void KwmEndResponse();
+bool KwmIsResponseActive(int ClientSockFD);
+
+uint32_t KwmGetConnectedClients();
+uint32_t KwmGetSubscribedTopics();
+void KwmSubscribeClient(int ClientSockFD, uint32_t Topics, std::string Initial);
+void KwmPublish(uint32_t Topic, std::string Message);
 
 #endif
@@ -208,14 +208,14 @@ void FocusDisplay(ax_display *Display)
                     FocusWindowByID(Node->WindowID);
                     int X  = Node->Container.X + (Node->Container.Width / 2);
                     int Y  = Node->Container.Y + (Node->Container.Height / 2);
-                    CGWarpMouseCursorPosition(CGPointMake(X, Y));
+                    AXLibSetCursorPos(CGPointMake(X, Y));
                 }
             }
             else if(SpaceInfo->Settings.Mode == SpaceModeMonocle)
             {
                 int X  = Display->Frame.origin.x + (Display->Frame.size.width / 2);
                 int Y  = Display->Frame.origin.y + (Display->Frame.size.height / 2);
-                CGWarpMouseCursorPosition(CGPointMake(X, Y));
+                AXLibSetCursorPos(CGPointMake(X, Y));
                 FocusWindowBelowCursor();
             }
         }
@@ -223,7 +223,7 @@ void FocusDisplay(ax_display *Display)
         {
             int X  = Display->Frame.origin.x + (Display->Frame.size.width / 2);
             int Y  = Display->Frame.origin.y + (Display->Frame.size.height / 2);
-            CGWarpMouseCursorPosition(CGPointMake(X, Y));
+            AXLibSetCursorPos(CGPointMake(X, Y));
         }
     }
 }
@@ -22,6 +22,7 @@ extern EVENT_CALLBACK(Callback_KWMEvent_QueryPreviousSpaceName);
 extern EVENT_CALLBACK(Callback_KWMEvent_QueryCurrentSpaceMode);
 extern EVENT_CALLBACK(Callback_KWMEvent_QueryCurrentSpaceTag);
 extern EVENT_CALLBACK(Callback_KWMEvent_QueryCurrentSpaceId);
+extern EVENT_CALLBACK(Callback_KWMEvent_QueryCurrentSpaceAllocator);
 extern EVENT_CALLBACK(Callback_KWMEvent_QueryPreviousSpaceId);
 
 extern EVENT_CALLBACK(Callback_KWMEvent_QueryFocusedBorder);
@@ -43,6 +44,16 @@ extern EVENT_CALLBACK(Callback_KWMEvent_QueryParentNodeState);
 extern EVENT_CALLBACK(Callback_KWMEvent_QueryWindowIdInDirectionOfFocusedWindow);
 extern EVENT_CALLBACK(Callback_KWMEvent_QueryScratchpad);
 
+extern EVENT_CALLBACK(Callback_KWMEvent_QueryEventsCoalesced);
+extern EVENT_CALLBACK(Callback_KWMEvent_QueryEventsLanes);
+extern EVENT_CALLBACK(Callback_KWMEvent_QueryEventsLatency);
+extern EVENT_CALLBACK(Callback_KWMEvent_QueryEventsLaunch);
+extern EVENT_CALLBACK(Callback_KWMEvent_QueryEventsBurst);
+
+extern EVENT_CALLBACK(Callback_KWMEvent_Command);
+extern EVENT_CALLBACK(Callback_KWMEvent_PipelinedCommand);
+extern EVENT_CALLBACK(Callback_KWMEvent_FlushWindowBurst);
+
 enum kwm_event_type
 {
     KWMEvent_QueryTilingMode,
@@ -62,6 +73,7 @@ enum kwm_event_type
     KWMEvent_QueryCurrentSpaceName,
     KWMEvent_QueryCurrentSpaceMode,
     KWMEvent_QueryCurrentSpaceTag,
+    KWMEvent_QueryCurrentSpaceAllocator,
     KWMEvent_QueryPreviousSpaceId,
     KWMEvent_QueryPreviousSpaceName,
 
@@ -83,23 +95,58 @@ enum kwm_event_type
     KWMEvent_QueryParentNodeState,
     KWMEvent_QueryWindowIdInDirectionOfFocusedWindow,
     KWMEvent_QueryScratchpad,
+
+    KWMEvent_QueryEventsCoalesced,
+    KWMEvent_QueryEventsLanes,
+    KWMEvent_QueryEventsLatency,
+    KWMEvent_QueryEventsLaunch,
+    KWMEvent_QueryEventsBurst,
+
+    KWMEvent_Command,
+    KWMEvent_PipelinedCommand,
+    KWMEvent_FlushWindowBurst,
 };
 
-inline void *
-KwmCreateContext(int Id)
+inline ax_event_payload
+KwmCreatePayload(int SockFD)
+{
+    ax_event_payload Payload = {};
+    Payload.Type = AXPayload_SockFD;
+    Payload.SockFD = SockFD;
+    return Payload;
+}
+
+/* NOTE(koekeishiya): The first argument is always the socket to reply to. */
+inline ax_event_payload
+KwmCreatePayload(int SockFD, int First, int Second = 0)
 {
-    int *IdContext = (int *) malloc(sizeof(Id));
-    *IdContext = Id;
-    return IdContext;
+    ax_event_payload Payload = {};
+    Payload.Type = AXPayload_Args;
+    Payload.Args[0] = SockFD;
+    Payload.Args[1] = First;
+    Payload.Args[2] = Second;
+    return Payload;
 }
 
 /* NOTE(koekeishiya): Construct an ax_event with the appropriate callback through macro expansion. */
-#define KwmConstructEvent(EventType, EventContext) \
+#define KwmConstructEvent(EventType, EventPayload) \
     do { ax_event Event = {}; \
-         Event.Context = EventContext; \
+         Event.Name = #EventType; \
+         Event.Payload = EventPayload; \
          Event.Intrinsic = false; \
          Event.Handle = &Callback_##EventType; \
          AXLibAddEvent(Event); \
        } while(0)
 
+/* NOTE(koekeishiya): Run the callback of an event right away on the calling thread. Queries
+ * are parsed by the worker, so they reply before the command that asked for them returns. */
+#define KwmRunEvent(EventType, EventPayload) \
+    do { ax_event Event = {}; \
+         Event.Name = #EventType; \
+         Event.Payload = EventPayload; \
+         Event.Intrinsic = false; \
+         Event.Handle = &Callback_##EventType; \
+         (*Event.Handle)(&Event); \
+       } while(0)
+
 #endif
@@ -0,0 +1,327 @@
+#include "history.h"
+#include "node.h"
+#include "tree.h"
+#include "container.h"
+#include "window.h"
+#include "transaction.h"
+#include "../axlib/axlib.h"
+
+#include <algorithm>
+
+#define internal static
+
+extern std::map<std::string, space_info> WindowTree;
+
+internal inline tree_snapshot *
+RetainTreeSnapshot(tree_snapshot *Snapshot)
+{
+    if(Snapshot)
+        ++Snapshot->RefCount;
+
+    return Snapshot;
+}
+
+void ReleaseTreeSnapshot(tree_snapshot *Snapshot)
+{
+    if(Snapshot && --Snapshot->RefCount == 0)
+    {
+        ReleaseTreeSnapshot(Snapshot->LeftChild);
+        ReleaseTreeSnapshot(Snapshot->RightChild);
+        delete Snapshot;
+    }
+}
+
+/* NOTE(koekeishiya): The snapshot a node was last captured as is kept alive by the node, so
+ * that it can be compared against by the next capture no matter who else still uses it. */
+internal inline void
+SetTreeNodeSnapshot(tree_node *Node, tree_snapshot *Snapshot)
+{
+    RetainTreeSnapshot(Snapshot);
+    ReleaseTreeSnapshot(Node->Snapshot);
+    Node->Snapshot = Snapshot;
+}
+
+void ReleaseTreeNodeSnapshot(tree_node *Node)
+{
+    ReleaseTreeSnapshot(Node->Snapshot);
+    Node->Snapshot = NULL;
+}
+
+void ReleaseTreeNodeSnapshots(tree_node *Node)
+{
+    if(Node)
+    {
+        ReleaseTreeNodeSnapshot(Node);
+        ReleaseTreeNodeSnapshots(Node->LeftChild);
+        ReleaseTreeNodeSnapshots(Node->RightChild);
+    }
+}
+
+internal bool
+IsTreeSnapshotOfNode(tree_snapshot *Snapshot, tree_node *Node,
+                     tree_snapshot *LeftChild, tree_snapshot *RightChild)
+{
+    if(Snapshot->WindowID != Node->WindowID ||
+       Snapshot->Type != Node->Type ||
+       Snapshot->SplitMode != Node->SplitMode ||
+       Snapshot->SplitRatio != Node->SplitRatio ||
+       Snapshot->LeftChild != LeftChild ||
+       Snapshot->RightChild != RightChild)
+        return false;
+
+    std::size_t Index = 0;
+    link_node *Link = Node->List;
+    while(Link)
+    {
+        if(Index == Snapshot->Links.size() || Snapshot->Links[Index] != Link->WindowID)
+            return false;
+
+        ++Index;
+        Link = Link->Next;
+    }
+
+    return Index == Snapshot->Links.size();
+}
+
+/* NOTE(koekeishiya): Returns a snapshot of the subtree with a reference owned by the caller.
+ * A node whose fields and child snapshots are unchanged since it was last captured returns
+ * the snapshot it was captured as, so only the paths from the root down to a change are
+ * copied and a mutation costs O(depth) memory. */
+internal tree_snapshot *
+CaptureTreeSnapshot(tree_node *Node)
+{
+    if(!Node)
+        return NULL;
+
+    tree_snapshot *LeftChild = CaptureTreeSnapshot(Node->LeftChild);
+    tree_snapshot *RightChild = CaptureTreeSnapshot(Node->RightChild);
+
+    if(Node->Snapshot && IsTreeSnapshotOfNode(Node->Snapshot, Node, LeftChild, RightChild))
+    {
+        ReleaseTreeSnapshot(LeftChild);
+        ReleaseTreeSnapshot(RightChild);
+        return RetainTreeSnapshot(Node->Snapshot);
+    }
+
+    tree_snapshot *Snapshot = new tree_snapshot();
+    Snapshot->RefCount = 1;
+    Snapshot->WindowID = Node->WindowID;
+    Snapshot->Type = Node->Type;
+    Snapshot->SplitMode = Node->SplitMode;
+    Snapshot->SplitRatio = Node->SplitRatio;
+    Snapshot->LeftChild = LeftChild;
+    Snapshot->RightChild = RightChild;
+
+    link_node *Link = Node->List;
+    while(Link)
+    {
+        Snapshot->Links.push_back(Link->WindowID);
+        Link = Link->Next;
+    }
+
+    SetTreeNodeSnapshot(Node, Snapshot);
+    return Snapshot;
+}
+
+internal void
+RestoreTreeSnapshot(ax_display *Display, space_info *SpaceInfo, tree_node *Node, tree_snapshot *Snapshot)
+{
+    Node->WindowID = Snapshot->WindowID;
+    Node->Type = Snapshot->Type;
+    Node->SplitMode = Snapshot->SplitMode;
+    Node->SplitRatio = Snapshot->SplitRatio;
+    SetTreeNodeSnapshot(Node, Snapshot);
+
+    link_node *Prev = NULL;
+    for(std::size_t Index = 0; Index < Snapshot->Links.size(); ++Index)
+    {
+        link_node *Link = CreateLinkNode(SpaceInfo);
+        Link->WindowID = Snapshot->Links[Index];
+        Link->Prev = Prev;
+
+        if(Prev)
+            Prev->Next = Link;
+        else
+            Node->List = Link;
+
+        Prev = Link;
+    }
+
+    if(Snapshot->LeftChild && Snapshot->RightChild)
+    {
+        bool Vertical = Snapshot->SplitMode == SPLIT_VERTICAL;
+        Node->LeftChild = CreateLeafNode(Display, Node, 0, Vertical ? CONTAINER_LEFT : CONTAINER_UPPER);
+        Node->RightChild = CreateLeafNode(Display, Node, 0, Vertical ? CONTAINER_RIGHT : CONTAINER_LOWER);
+
+        RestoreTreeSnapshot(Display, SpaceInfo, Node->LeftChild, Snapshot->LeftChild);
+        RestoreTreeSnapshot(Display, SpaceInfo, Node->RightChild, Snapshot->RightChild);
+    }
+    else
+    {
+        ResizeLinkNodeContainers(Node);
+        IndexTreeNode(SpaceInfo, Node);
+    }
+}
+
+internal void
+CollectTreeSnapshotWindows(tree_snapshot *Snapshot, std::vector<uint32_t> &Windows)
+{
+    if(Snapshot)
+    {
+        if(!Snapshot->LeftChild && Snapshot->WindowID != 0)
+            Windows.push_back(Snapshot->WindowID);
+
+        for(std::size_t Index = 0; Index < Snapshot->Links.size(); ++Index)
+            Windows.push_back(Snapshot->Links[Index]);
+
+        CollectTreeSnapshotWindows(Snapshot->LeftChild, Windows);
+        CollectTreeSnapshotWindows(Snapshot->RightChild, Windows);
+    }
+}
+
+/* NOTE(koekeishiya): Rebuilds the tree of the space from a snapshot. Windows that have been
+ * closed since are removed again and windows that have been opened since are added back, so
+ * the result always holds exactly the windows that are tiled right now. Only frames that
+ * actually differ from what is on screen are written. */
+internal void
+ActivateTreeSnapshot(ax_display *Display, space_info *SpaceInfo, tree_snapshot *Snapshot)
+{
+    std::vector<uint32_t> Restored;
+    CollectTreeSnapshotWindows(Snapshot, Restored);
+
+    std::vector<uint32_t> Tiled;
+    for(std::unordered_map<uint32_t, node_index_entry>::iterator It = SpaceInfo->WindowIndex.begin();
+        It != SpaceInfo->WindowIndex.end();
+        ++It)
+        Tiled.push_back(It->first);
+
+    BeginLayoutTransaction();
+    DestroyNodeTree(SpaceInfo);
+
+    tree_node *RootNode = CreateRootNode(SpaceInfo);
+    SetRootNodeContainer(Display, RootNode);
+    RestoreTreeSnapshot(Display, SpaceInfo, RootNode, Snapshot);
+    SpaceInfo->RootNode = RootNode;
+
+    for(std::size_t Index = 0; Index < Restored.size(); ++Index)
+    {
+        if(std::find(Tiled.begin(), Tiled.end(), Restored[Index]) == Tiled.end())
+            RemoveWindowFromNodeTree(Display, Restored[Index]);
+    }
+
+    for(std::size_t Index = 0; Index < Tiled.size(); ++Index)
+    {
+        if(std::find(Restored.begin(), Restored.end(), Tiled[Index]) == Restored.end())
+            AddWindowToNodeTree(Display, Tiled[Index]);
+    }
+
+    if(SpaceInfo->RootNode)
+        ApplyTreeNodeContainer(SpaceInfo->RootNode);
+
+    CommitLayoutTransaction();
+}
+
+/* NOTE(koekeishiya): Records the current tree of the space. When NewVersion is false the
+ * current version is replaced instead, which is used to pick up changes that happened
+ * outside of a tree command (windows opened or closed, splits resized) before the next
+ * command or before moving through the history. */
+void RecordTreeHistory(space_info *SpaceInfo, bool NewVersion)
+{
+    if(SpaceInfo->Settings.Mode != SpaceModeBSP || !SpaceInfo->RootNode)
+        return;
+
+    tree_history *History = &SpaceInfo->History;
+    tree_snapshot *Snapshot = CaptureTreeSnapshot(SpaceInfo->RootNode);
+
+    if(History->Versions.empty())
+    {
+        History->Versions.push_back(Snapshot);
+        History->Current = 0;
+        return;
+    }
+
+    if(History->Versions[History->Current] == Snapshot)
+    {
+        ReleaseTreeSnapshot(Snapshot);
+        return;
+    }
+
+    if(!NewVersion)
+    {
+        ReleaseTreeSnapshot(History->Versions[History->Current]);
+        History->Versions[History->Current] = Snapshot;
+        return;
+    }
+
+    while(History->Versions.size() > History->Current + 1)
+    {
+        ReleaseTreeSnapshot(History->Versions.back());
+        History->Versions.pop_back();
+    }
+
+    History->Versions.push_back(Snapshot);
+    if(History->Versions.size() > TREE_HISTORY_LIMIT)
+    {
+        ReleaseTreeSnapshot(History->Versions.front());
+        History->Versions.erase(History->Versions.begin());
+    }
+
+    History->Current = History->Versions.size() - 1;
+}
+
+void RecordTreeHistory(ax_display *Display, bool NewVersion)
+{
+    if(Display)
+        RecordTreeHistory(&WindowTree[Display->Space->Identifier], NewVersion);
+}
+
+void ClearTreeHistory(space_info *SpaceInfo)
+{
+    tree_history *History = &SpaceInfo->History;
+    for(std::size_t Index = 0; Index < History->Versions.size(); ++Index)
+        ReleaseTreeSnapshot(History->Versions[Index]);
+
+    History->Versions.clear();
+    History->Current = 0;
+}
+
+void UndoTreeHistory(ax_display *Display)
+{
+    if(!Display)
+        return;
+
+    space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
+    RecordTreeHistory(SpaceInfo, false);
+
+    tree_history *History = &SpaceInfo->History;
+    if(SpaceInfo->Settings.Mode == SpaceModeBSP && History->Current > 0)
+    {
+        --History->Current;
+        ActivateTreeSnapshot(Display, SpaceInfo, History->Versions[History->Current]);
+        RecordTreeHistory(SpaceInfo, false);
+    }
+}
+
+void RedoTreeHistory(ax_display *Display)
+{
+    if(!Display)
+        return;
+
+    space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
+    RecordTreeHistory(SpaceInfo, false);
+
+    tree_history *History = &SpaceInfo->History;
+    if(SpaceInfo->Settings.Mode == SpaceModeBSP && History->Current + 1 < History->Versions.size())
+    {
+        ++History->Current;
+        ActivateTreeSnapshot(Display, SpaceInfo, History->Versions[History->Current]);
+        RecordTreeHistory(SpaceInfo, false);
+    }
+}
+
+/* NOTE(koekeishiya): Returns a snapshot of the current tree, which shares every unchanged
+ * subtree with the versions in the history. The caller owns the reference. */
+tree_snapshot *CaptureTreeSnapshot(space_info *SpaceInfo)
+{
+    return CaptureTreeSnapshot(SpaceInfo->RootNode);
+}
@@ -0,0 +1,18 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "types.h"
+#include "../axlib/display.h"
+
+void RecordTreeHistory(space_info *SpaceInfo, bool NewVersion);
+void RecordTreeHistory(ax_display *Display, bool NewVersion);
+void ClearTreeHistory(space_info *SpaceInfo);
+void UndoTreeHistory(ax_display *Display);
+void RedoTreeHistory(ax_display *Display);
+
+tree_snapshot *CaptureTreeSnapshot(space_info *SpaceInfo);
+void ReleaseTreeSnapshot(tree_snapshot *Snapshot);
+void ReleaseTreeNodeSnapshot(tree_node *Node);
+void ReleaseTreeNodeSnapshots(tree_node *Node);
+
+#endif
@@ -4,10 +4,19 @@
 #include "rules.h"
 #include "config.h"
 #include "tokenizer.h"
+#include "event.h"
+#include "transaction.h"
+#include "daemon.h"
+#include "subscription.h"
 #include "../axlib/axlib.h"
 
+#define internal static
+
+internal uint64_t HandledCommands;
+
 void KwmInterpretCommand(std::string Message, int ClientSockFD)
 {
+    FlushWindowBurst();
     std::vector<std::string> Tokens = SplitString(Message, ' ');
     tokenizer Tokenizer = {};
     Tokenizer.At = (char *) Message.c_str();
@@ -27,10 +36,54 @@ void KwmInterpretCommand(std::string Message, int ClientSockFD)
         KwmAddRule(CreateStringFromTokens(Tokens, 1));
     else if(Tokens[0] == "whitelist")
         CarbonWhitelistProcess(CreateStringFromTokens(Tokens, 1));
+    else if(Tokens[0] == "subscribe")
+        KwmSubscribe(Tokens, ClientSockFD);
+
+    if(Tokens[0] != "query" && Tokens[0] != "subscribe")
+        KwmCloseSocket(ClientSockFD);
+}
 
-    if(Tokens[0] != "query")
-    {
-        shutdown(ClientSockFD, SHUT_RDWR);
-        close(ClientSockFD);
-    }
+/* NOTE(koekeishiya): Commands received by the daemon are run by the event loop on the
+ * interactive lane, so they are serialized with the handlers of window-server events
+ * and do not wait behind a backlog of them. The payload holds the socket to reply to,
+ * followed by the command as a null-terminated string. Pipelined commands share their
+ * connection with the commands that follow, and are answered with a single frame. */
+void KwmQueueCommand(std::string Message, int ClientSockFD, bool Pipelined)
+{
+    ax_event_payload Payload;
+    char *Data = (char *) AXLibAllocateEventPayload(&Payload, sizeof(int) + Message.size() + 1);
+    memcpy(Data, &ClientSockFD, sizeof(int));
+    memcpy(Data + sizeof(int), Message.c_str(), Message.size() + 1);
+    if(Pipelined)
+        KwmConstructEvent(KWMEvent_PipelinedCommand, Payload);
+    else
+        KwmConstructEvent(KWMEvent_Command, Payload);
+}
+
+EVENT_CALLBACK(Callback_KWMEvent_Command)
+{
+    char *Data = (char *) Event->Payload.Block.Data;
+    int ClientSockFD;
+    memcpy(&ClientSockFD, Data, sizeof(int));
+    KwmInterpretCommand(std::string(Data + sizeof(int)), ClientSockFD);
+    ++HandledCommands;
+}
+
+EVENT_CALLBACK(Callback_KWMEvent_PipelinedCommand)
+{
+    char *Data = (char *) Event->Payload.Block.Data;
+    int ClientSockFD;
+    memcpy(&ClientSockFD, Data, sizeof(int));
+
+    KwmBeginResponse(ClientSockFD);
+    KwmInterpretCommand(std::string(Data + sizeof(int)), ClientSockFD);
+    KwmEndResponse();
+    ++HandledCommands;
+}
+
+/* NOTE(koekeishiya): Number of commands received by the daemon that have been handled. Only
+ * called from the worker thread. */
+uint64_t KwmGetHandledCommands()
+{
+    return HandledCommands;
 }
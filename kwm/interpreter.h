@@ -2,7 +2,10 @@
 #define INTERPRETER_H
 
 #include <string>
+#include <stdint.h>
 
 void KwmInterpretCommand(std::string Message, int ClientSockFD);
+void KwmQueueCommand(std::string Message, int ClientSockFD, bool Pipelined = false);
+uint64_t KwmGetHandledCommands();
 
 #endif
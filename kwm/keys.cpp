@@ -1,6 +1,7 @@
 #include "keys.h"
 #include "helpers.h"
 #include "interpreter.h"
+#include "../axlib/axlib.h"
 
 #define internal static
 #define local_persist static
@@ -189,6 +190,9 @@ bool MouseDragKeyMatchesCGEvent(CGEventRef Event)
 
 void KwmExecuteSystemCommand(std::string Command)
 {
+    if(AXLibIsReplayingEvents())
+        return;
+
     int ChildPID = fork();
     if(ChildPID == 0)
     {
@@ -6,6 +6,10 @@
 #include "scratchpad.h"
 #include "border.h"
 #include "config.h"
+#include "interpreter.h"
+#include "transaction.h"
+#include "subscription.h"
+#include "snapshot.h"
 #include "../axlib/axlib.h"
 #include <getopt.h>
 
@@ -23,6 +27,8 @@ kwm_settings KWMSettings = {};
 kwm_border FocusedBorder = {};
 kwm_border MarkedBorder = {};
 scratchpad Scratchpad = {};
+layout_transaction LayoutTransaction = {};
+window_burst WindowBurst = {};
 modifier_keys MouseDragKey = {};
 
 internal CGEventRef
@@ -43,7 +49,7 @@ CGEventCallback(CGEventTapProxy Proxy, CGEventType Type, CGEventRef Event, void
                 CGEventFlags Flags = CGEventGetFlags(Event);
                 if(!(Flags & Event_Mask_Alt))
                 {
-                    AXLibConstructEvent(AXEvent_MouseMoved, NULL, false);
+                    AXLibConstructEvent(AXEvent_MouseMoved, AXLibEmptyPayload(), false);
                 }
             }
         } break;
@@ -53,7 +59,7 @@ CGEventCallback(CGEventTapProxy Proxy, CGEventType Type, CGEventRef Event, void
             {
                 if(MouseDragKeyMatchesCGEvent(Event))
                 {
-                    AXLibConstructEvent(AXEvent_LeftMouseDown, NULL, false);
+                    AXLibConstructEvent(AXEvent_LeftMouseDown, AXLibEmptyPayload(), false);
                     return NULL;
                 }
             }
@@ -61,12 +67,12 @@ CGEventCallback(CGEventTapProxy Proxy, CGEventType Type, CGEventRef Event, void
         case kCGEventLeftMouseUp:
         {
             if(HasFlags(&KWMSettings, Settings_MouseDrag))
-                AXLibConstructEvent(AXEvent_LeftMouseUp, NULL, false);
+                AXLibConstructEvent(AXEvent_LeftMouseUp, AXLibEmptyPayload(), false);
         } break;
         case kCGEventLeftMouseDragged:
         {
             if(HasFlags(&KWMSettings, Settings_MouseDrag))
-                AXLibConstructEvent(AXEvent_LeftMouseDragged, NULL, false);
+                AXLibConstructEvent(AXEvent_LeftMouseDragged, AXLibEmptyPayload(), false);
         } break;
         case kCGEventRightMouseDown:
         {
@@ -74,7 +80,7 @@ CGEventCallback(CGEventTapProxy Proxy, CGEventType Type, CGEventRef Event, void
             {
                 if(MouseDragKeyMatchesCGEvent(Event))
                 {
-                    AXLibConstructEvent(AXEvent_RightMouseDown, NULL, false);
+                    AXLibConstructEvent(AXEvent_RightMouseDown, AXLibEmptyPayload(), false);
                     return NULL;
                 }
             }
@@ -82,12 +88,12 @@ CGEventCallback(CGEventTapProxy Proxy, CGEventType Type, CGEventRef Event, void
         case kCGEventRightMouseUp:
         {
             if(HasFlags(&KWMSettings, Settings_MouseDrag))
-                AXLibConstructEvent(AXEvent_RightMouseUp, NULL, false);
+                AXLibConstructEvent(AXEvent_RightMouseUp, AXLibEmptyPayload(), false);
         } break;
         case kCGEventRightMouseDragged:
         {
             if(HasFlags(&KWMSettings, Settings_MouseDrag))
-                AXLibConstructEvent(AXEvent_RightMouseDragged, NULL, false);
+                AXLibConstructEvent(AXEvent_RightMouseDragged, AXLibEmptyPayload(), false);
         } break;
 
         default: {} break;
@@ -159,6 +165,7 @@ KwmInit()
         Fatal("Error: Could not access OSX Accessibility!");
 
     signal(SIGCHLD, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
 #ifndef DEBUG_BUILD
     signal(SIGSEGV, SignalHandler);
     signal(SIGABRT, SignalHandler);
@@ -190,6 +197,14 @@ KwmInit()
     MarkedBorder.Radius = -1;
     MarkedBorder.Type = BORDER_MARKED;
 
+    AXLibLoadApplicationReadiness(KWMPath.Home + "/readiness");
+    GetKwmFilePath();
+}
+
+/* NOTE(koekeishiya): Called before the daemon is started, so that it knows where to put its socket. */
+internal void
+GetKwmHomePath()
+{
     char *HomeP = std::getenv("HOME");
     if(HomeP)
     {
@@ -200,13 +215,13 @@ KwmInit()
 
         if(KWMPath.Config.empty())
             KWMPath.Config = KWMPath.Home + "/kwmrc";
+        if(KWMPath.Socket.empty())
+            KWMPath.Socket = KWMPath.Home + "/kwm.sock";
     }
     else
     {
         Fatal("Error: Failed to get environment variable 'HOME'");
     }
-
-    GetKwmFilePath();
 }
 
 void KwmQuit()
@@ -214,6 +229,9 @@ void KwmQuit()
     ShowAllScratchpadWindows();
     CloseBorder(&FocusedBorder);
     CloseBorder(&MarkedBorder);
+    AXLibStopEventRecording();
+    AXLibSaveApplicationReadiness();
+    KwmTerminateDaemon();
 
     exit(0);
 }
@@ -223,11 +241,15 @@ internal inline bool
 ParseArguments(int argc, char **argv)
 {
     int Option;
-    const char *ShortOptions = "vc:";
+    const char *ShortOptions = "vc:r:e:s:t";
     struct option LongOptions[] =
     {
         {"version", no_argument, NULL, 'v'},
         {"config", required_argument, NULL, 'c'},
+        {"record", required_argument, NULL, 'r'},
+        {"events", required_argument, NULL, 'e'},
+        {"socket", required_argument, NULL, 's'},
+        {"tcp", no_argument, NULL, 't'},
         {NULL, 0, NULL, 0}
     };
 
@@ -245,12 +267,56 @@ ParseArguments(int argc, char **argv)
                 DEBUG("Notice: Using config file " << optarg);
                 KWMPath.Config = optarg;
             } break;
+            case 'r':
+            {
+                KWMPath.Record = optarg;
+            } break;
+            case 'e':
+            {
+                KWMPath.EventLog = optarg;
+            } break;
+            case 's':
+            {
+                KWMPath.Socket = optarg;
+            } break;
+            case 't':
+            {
+                AddFlags(&KWMSettings, Settings_DaemonTCP);
+            } break;
         }
     }
 
     return false;
 }
 
+/* NOTE(koekeishiya): Prints the handler timings and AX calls of a log written by 'kwm --record'.
+ * The handlers are not run, see AXLibReplayEventLog for that. Times are in microseconds. */
+internal void
+KwmPrintEventLog(std::string Path)
+{
+    ax_event_log_summary Summary = {};
+    if(!AXLibReadEventLog(Path.c_str(), &Summary))
+        fprintf(stderr, "Error: Could not read event log %s\n", Path.c_str());
+
+    for(std::size_t Index = 0; Index < Summary.Timings.size(); ++Index)
+    {
+        ax_event_log_timing *Timing = &Summary.Timings[Index];
+        printf("%s: %llu events, run %llu/%llu/%llu us, wait %llu/%llu/%llu us, %llu reads, %llu writes\n",
+               Timing->Name.c_str(), (unsigned long long) Timing->Runtime.Count,
+               (unsigned long long) AXLibGetHistogramPercentile(&Timing->Runtime, 50.0),
+               (unsigned long long) AXLibGetHistogramPercentile(&Timing->Runtime, 99.0),
+               (unsigned long long) Timing->Runtime.Max,
+               (unsigned long long) AXLibGetHistogramPercentile(&Timing->Wait, 50.0),
+               (unsigned long long) AXLibGetHistogramPercentile(&Timing->Wait, 99.0),
+               (unsigned long long) Timing->Wait.Max,
+               (unsigned long long) Timing->Reads, (unsigned long long) Timing->Writes);
+    }
+
+    printf("total: %llu events, %llu us, %llu reads, %llu writes\n",
+           (unsigned long long) Summary.Events, (unsigned long long) (Summary.Runtime / 1000),
+           (unsigned long long) Summary.Reads, (unsigned long long) Summary.Writes);
+}
+
 internal inline void
 ConfigureRunLoop()
 {
@@ -272,25 +338,26 @@ ConfigureRunLoop()
                        kCFRunLoopCommonModes);
 }
 
-int main(int argc, char **argv)
-{
-    if(ParseArguments(argc, argv))
-        return 0;
+internal uint64_t PublishedStateEvents;
 
-    NSApplicationLoad();
-    if(!AXLibDisplayHasSeparateSpaces())
-        Fatal("Error: 'Displays have separate spaces' must be enabled!");
-
-    if(!AXLibInit())
-        Fatal("Error: Could not initialize AXLib!");
-
-    AXLibStartEventLoop();
-    if(!KwmStartDaemon())
-        Fatal("Error: Could not start daemon!");
+/* NOTE(koekeishiya): Run by the event loop every time it has handled a batch of events. A batch
+ * that only moved the cursor changes nothing that is published, and is skipped. Focus that
+ * follows the mouse is published once the focus event it causes has been handled. */
+internal EVENT_BATCH_CALLBACK(KwmHandleEventBatch)
+{
+    uint64_t StateEvents = AXLibGetStateEventCount();
+    if(StateEvents == PublishedStateEvents)
+        return;
 
-	OverlayLibInitialize();
-	DEBUG("OverlayLib initialized!");
+    PublishedStateEvents = StateEvents;
+    PublishStateSnapshot();
+    KwmPublishChanges();
+}
 
+/* NOTE(koekeishiya): Runs as a source of its own, so that a recorded session can be replayed from
+ * the start. A replay runs the config of the replaying process. */
+internal EVENT_CALLBACK(KwmStartup)
+{
     ax_display *MainDisplay = AXLibMainDisplay();
     ax_display *Display = MainDisplay;
     do
@@ -304,7 +371,6 @@ int main(int argc, char **argv)
     FocusedDisplay = MainDisplay;
     FocusedApplication = AXLibGetFocusedApplication();
 
-    KwmInit();
     KwmParseConfig(KWMPath.Config);
 
     CreateWindowNodeTree(MainDisplay);
@@ -315,6 +381,46 @@ int main(int argc, char **argv)
      * refinement, because we will (sometimes ?) get NULL when started by launchd at login */
     if(FocusedApplication && FocusedApplication->Focus)
         UpdateBorder(&FocusedBorder, FocusedApplication->Focus);
+}
+
+int main(int argc, char **argv)
+{
+    if(ParseArguments(argc, argv))
+        return 0;
+
+    if(!KWMPath.EventLog.empty())
+    {
+        KwmPrintEventLog(KWMPath.EventLog);
+        return 0;
+    }
+
+    GetKwmHomePath();
+
+    NSApplicationLoad();
+    if(!AXLibDisplayHasSeparateSpaces())
+        Fatal("Error: 'Displays have separate spaces' must be enabled!");
+
+    if(!KWMPath.Record.empty() && !AXLibStartEventRecording(KWMPath.Record.c_str()))
+        Fatal("Error: Could not open event log!");
+
+    if(!AXLibInit())
+        Fatal("Error: Could not initialize AXLib!");
+
+    AXLibSetEventBatchCallback(&KwmHandleEventBatch);
+    AXLibStartEventLoop();
+    kwm_daemon_handler DaemonHandler = { &KwmQueueCommand, &AnswerQueryFromSnapshot };
+    if(!KwmStartDaemon(KWMPath.Socket, HasFlags(&KWMSettings, Settings_DaemonTCP), DaemonHandler))
+        Fatal("Error: Could not start daemon!");
+
+	OverlayLibInitialize();
+	DEBUG("OverlayLib initialized!");
+
+    KwmInit();
+
+    ax_event Startup = {};
+    Startup.Name = "KwmStartup";
+    Startup.Handle = &KwmStartup;
+    AXLibRunEventSource(&Startup);
 
     ConfigureRunLoop();
     CFRunLoopRun();
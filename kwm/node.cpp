@@ -3,6 +3,8 @@
 #include "tree.h"
 #include "space.h"
 #include "window.h"
+#include "transaction.h"
+#include "history.h"
 #include "../axlib/axlib.h"
 
 #define internal static
@@ -11,26 +13,126 @@ extern std::map<std::string, space_info> WindowTree;
 extern ax_application *FocusedApplication;
 extern kwm_settings KWMSettings;
 
-tree_node *CreateRootNode()
+/* NOTE(koekeishiya): Every space owns an arena that hands out its tree- and link-nodes
+ * from chunks of NODE_ARENA_CHUNK_SIZE elements. Nodes released one at a time go on a
+ * free-list and are reused before the arena grows. Tearing down the whole tree only
+ * rewinds the arena; the chunks are kept and reused by the next tree of that space. */
+internal void *
+AllocateFromNodePool(node_pool *Pool, std::size_t ElementSize)
 {
-    tree_node *RootNode = (tree_node*) malloc(sizeof(tree_node));
-    memset(RootNode, 0, sizeof(tree_node));
+    void *Element = NULL;
+    if(Pool->FreeList)
+    {
+        Element = Pool->FreeList;
+        Pool->FreeList = *(void **)Element;
+    }
+    else
+    {
+        if(Pool->Offset == NODE_ARENA_CHUNK_SIZE)
+        {
+            ++Pool->Chunk;
+            Pool->Offset = 0;
+        }
+
+        if(Pool->Chunk == Pool->Chunks.size())
+            Pool->Chunks.push_back((char *) malloc(ElementSize * NODE_ARENA_CHUNK_SIZE));
+
+        Element = Pool->Chunks[Pool->Chunk] + (ElementSize * Pool->Offset++);
+    }
+
+    if(++Pool->Live > Pool->Peak)
+        Pool->Peak = Pool->Live;
+
+    memset(Element, 0, ElementSize);
+    return Element;
+}
+
+internal void
+ReleaseToNodePool(node_pool *Pool, void *Element)
+{
+    *(void **)Element = Pool->FreeList;
+    Pool->FreeList = Element;
+    --Pool->Live;
+}
+
+internal inline void
+ResetNodePool(node_pool *Pool)
+{
+    Pool->Chunk = 0;
+    Pool->Offset = 0;
+    Pool->FreeList = NULL;
+    Pool->Live = 0;
+}
+
+internal tree_node *
+AllocateTreeNode(space_info *SpaceInfo)
+{
+    ++SpaceInfo->Arena.Allocations;
+    return (tree_node *) AllocateFromNodePool(&SpaceInfo->Arena.Trees, sizeof(tree_node));
+}
+
+void FreeTreeNode(space_info *SpaceInfo, tree_node *Node)
+{
+    if(Node)
+    {
+        ReleaseTreeNodeSnapshot(Node);
+        ++SpaceInfo->Arena.Releases;
+        ReleaseToNodePool(&SpaceInfo->Arena.Trees, Node);
+    }
+}
+
+void FreeLinkNode(space_info *SpaceInfo, link_node *Link)
+{
+    if(Link)
+    {
+        ++SpaceInfo->Arena.Releases;
+        ReleaseToNodePool(&SpaceInfo->Arena.Links, Link);
+    }
+}
+
+void ResetNodeArena(space_info *SpaceInfo)
+{
+    ResetNodePool(&SpaceInfo->Arena.Trees);
+    ResetNodePool(&SpaceInfo->Arena.Links);
+    ++SpaceInfo->Arena.Resets;
+}
+
+std::string GetNodeArenaStatistics(space_info *SpaceInfo)
+{
+    node_arena *Arena = &SpaceInfo->Arena;
+    std::size_t Reserved = (Arena->Trees.Chunks.size() * sizeof(tree_node) * NODE_ARENA_CHUNK_SIZE) +
+                           (Arena->Links.Chunks.size() * sizeof(link_node) * NODE_ARENA_CHUNK_SIZE);
+
+    std::string Output;
+    Output += "tree nodes: " + std::to_string(Arena->Trees.Live) + " live, " + std::to_string(Arena->Trees.Peak) + " peak\n";
+    Output += "link nodes: " + std::to_string(Arena->Links.Live) + " live, " + std::to_string(Arena->Links.Peak) + " peak\n";
+    Output += "chunks: " + std::to_string(Arena->Trees.Chunks.size()) + " tree, " +
+              std::to_string(Arena->Links.Chunks.size()) + " link, " + std::to_string(Reserved) + " bytes reserved\n";
+    Output += "allocations: " + std::to_string(Arena->Allocations) + ", releases: " + std::to_string(Arena->Releases) +
+              ", resets: " + std::to_string(Arena->Resets);
+    return Output;
+}
+
+tree_node *CreateRootNode(space_info *SpaceInfo)
+{
+    tree_node *RootNode = AllocateTreeNode(SpaceInfo);
 
     RootNode->WindowID = 0;
     RootNode->Type = NodeTypeTree;
     RootNode->Parent = NULL;
     RootNode->LeftChild = NULL;
     RootNode->RightChild = NULL;
+    RootNode->Depth = 0;
     RootNode->SplitRatio = KWMSettings.SplitRatio;
     RootNode->SplitMode = SPLIT_OPTIMAL;
 
     return RootNode;
 }
 
-link_node *CreateLinkNode()
+link_node *CreateLinkNode(space_info *SpaceInfo)
 {
-    link_node *Link = (link_node*) malloc(sizeof(link_node));
-    memset(Link, 0, sizeof(link_node));
+    ++SpaceInfo->Arena.Allocations;
+    link_node *Link = (link_node *) AllocateFromNodePool(&SpaceInfo->Arena.Links, sizeof(link_node));
 
     Link->WindowID = 0;
     Link->Prev = NULL;
@@ -41,10 +143,11 @@ link_node *CreateLinkNode()
 
 tree_node *CreateLeafNode(ax_display *Display, tree_node *Parent, uint32_t WindowID, container_type Type)
 {
-    tree_node *Leaf = (tree_node*) malloc(sizeof(tree_node));
-    memset(Leaf, 0, sizeof(tree_node));
+    space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
+    tree_node *Leaf = AllocateTreeNode(SpaceInfo);
 
     Leaf->Parent = Parent;
+    Leaf->Depth = Parent ? Parent->Depth + 1 : 0;
     Leaf->WindowID = WindowID;
     Leaf->Type = NodeTypeTree;
 
@@ -58,6 +161,9 @@ tree_node *CreateLeafNode(ax_display *Display, tree_node *Parent, uint32_t Windo
 
 void CreateLeafNodePair(ax_display *Display, tree_node *Parent, uint32_t FirstWindowID, uint32_t SecondWindowID, split_type SplitMode)
 {
+    space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
+    UnindexTreeNode(SpaceInfo, Parent);
+
     Parent->WindowID = 0;
     Parent->SplitMode = SplitMode;
     Parent->SplitRatio = KWMSettings.SplitRatio;
@@ -95,6 +201,8 @@ void CreateLeafNodePair(ax_display *Display, tree_node *Parent, uint32_t FirstWi
         Node->Type = ParentType;
         Node->List = ParentList;
         ResizeLinkNodeContainers(Node);
+        IndexTreeNode(SpaceInfo, Parent->LeftChild);
+        IndexTreeNode(SpaceInfo, Parent->RightChild);
     }
     else if(SplitMode == SPLIT_HORIZONTAL)
     {
@@ -110,6 +218,8 @@ void CreateLeafNodePair(ax_display *Display, tree_node *Parent, uint32_t FirstWi
         Node->Type = ParentType;
         Node->List = ParentList;
         ResizeLinkNodeContainers(Node);
+        IndexTreeNode(SpaceInfo, Parent->LeftChild);
+        IndexTreeNode(SpaceInfo, Parent->RightChild);
     }
     else
     {
@@ -131,7 +241,7 @@ void CreatePseudoNode()
     if(!Window)
         return;
 
-    tree_node *Node = GetTreeNodeFromWindowID(SpaceInfo->RootNode, Window->ID);
+    tree_node *Node = GetTreeNodeFromWindowID(SpaceInfo, Window->ID);
     if(Node)
     {
         split_type SplitMode = KWMSettings.SplitMode == SPLIT_OPTIMAL ? GetOptimalSplitMode(Node) : KWMSettings.SplitMode;
@@ -151,7 +261,7 @@ void RemovePseudoNode()
     if(!Window)
         return;
 
-    tree_node *Node = GetTreeNodeFromWindowID(SpaceInfo->RootNode, Window->ID);
+    tree_node *Node = GetTreeNodeFromWindowID(SpaceInfo, Window->ID);
     if(Node && Node->Parent)
     {
         tree_node *Parent = Node->Parent;
@@ -159,11 +269,13 @@ void RemovePseudoNode()
         if(!PseudoNode || !IsLeafNode(PseudoNode) || PseudoNode->WindowID != 0)
             return;
 
+        UnindexTreeNode(SpaceInfo, Node);
         Parent->WindowID = Node->WindowID;
         Parent->LeftChild = NULL;
         Parent->RightChild = NULL;
-        free(Node);
-        free(PseudoNode);
+        IndexTreeNode(SpaceInfo, Parent);
+        FreeTreeNode(SpaceInfo, Node);
+        FreeTreeNode(SpaceInfo, PseudoNode);
         ApplyTreeNodeContainer(Parent);
     }
 }
@@ -211,7 +323,7 @@ void ToggleFocusedNodeSplitMode()
     if(!Window)
         return;
 
-    tree_node *Node = GetTreeNodeFromWindowID(SpaceInfo->RootNode, Window->ID);
+    tree_node *Node = GetTreeNodeFromWindowID(SpaceInfo, Window->ID);
     if(!Node)
         return;
 
@@ -233,7 +345,7 @@ void ToggleTypeOfFocusedNode()
     ax_display *Display = AXLibWindowDisplay(Window);
     space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
 
-    tree_node *TreeNode = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo->RootNode, Window->ID);
+    tree_node *TreeNode = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo, Window->ID);
     if(TreeNode && TreeNode != SpaceInfo->RootNode)
         TreeNode->Type = TreeNode->Type == NodeTypeTree ? NodeTypeLink : NodeTypeTree;
 }
@@ -247,12 +359,12 @@ void ChangeTypeOfFocusedNode(node_type Type)
     ax_display *Display = AXLibWindowDisplay(Window);
     space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
 
-    tree_node *TreeNode = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo->RootNode, Window->ID);
+    tree_node *TreeNode = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo, Window->ID);
     if(TreeNode && TreeNode != SpaceInfo->RootNode)
         TreeNode->Type = Type;
 }
 
-void SwapNodeWindowIDs(tree_node *A, tree_node *B)
+void SwapNodeWindowIDs(space_info *SpaceInfo, tree_node *A, tree_node *B)
 {
     if(A && B)
     {
@@ -269,6 +381,9 @@ void SwapNodeWindowIDs(tree_node *A, tree_node *B)
         A->List = B->List;
         B->List = TempLinkList;
 
+        IndexTreeNode(SpaceInfo, A);
+        IndexTreeNode(SpaceInfo, B);
+
         ResizeLinkNodeContainers(A);
         ResizeLinkNodeContainers(B);
         ApplyTreeNodeContainer(A);
@@ -276,14 +391,20 @@ void SwapNodeWindowIDs(tree_node *A, tree_node *B)
     }
 }
 
-void SwapNodeWindowIDs(link_node *A, link_node *B)
+void SwapNodeWindowIDs(space_info *SpaceInfo, link_node *A, link_node *B)
 {
     if(A && B)
     {
         DEBUG("SwapNodeWindowIDs() " << A->WindowID << " with " << B->WindowID);
+        tree_node *OwnerA = GetTreeNodeFromLink(SpaceInfo, A);
+        tree_node *OwnerB = GetTreeNodeFromLink(SpaceInfo, B);
+
         int TempWindowID = A->WindowID;
         A->WindowID = B->WindowID;
         B->WindowID = TempWindowID;
+
+        IndexLinkNode(SpaceInfo, OwnerA, A);
+        IndexLinkNode(SpaceInfo, OwnerB, B);
         ResizeWindowToContainerSize(A);
         ResizeWindowToContainerSize(B);
     }
@@ -296,6 +417,13 @@ split_type GetOptimalSplitMode(tree_node *Node)
 
 void ResizeWindowToContainerSize(tree_node *Node)
 {
+    ForgetWindowBurstFrame(Node->WindowID);
+    if(IsLayoutTransactionActive())
+    {
+        RecordLayoutFrame(Node->WindowID, &Node->Container);
+        return;
+    }
+
     ax_window *Window = GetWindowByID((unsigned int)Node->WindowID);
     if(Window)
     {
@@ -306,6 +434,13 @@ void ResizeWindowToContainerSize(tree_node *Node)
 
 void ResizeWindowToContainerSize(link_node *Link)
 {
+    ForgetWindowBurstFrame(Link->WindowID);
+    if(IsLayoutTransactionActive())
+    {
+        RecordLayoutFrame(Link->WindowID, &Link->Container);
+        return;
+    }
+
     ax_window *Window = GetWindowByID((unsigned int)Link->WindowID);
     if(Window)
     {
@@ -325,13 +460,13 @@ void ResizeWindowToContainerSize(ax_window *Window)
         ax_display *Display = AXLibWindowDisplay(Window);
         space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
 
-        tree_node *Node = GetTreeNodeFromWindowID(SpaceInfo->RootNode, Window->ID);
+        tree_node *Node = GetTreeNodeFromWindowID(SpaceInfo, Window->ID);
         if(Node)
             ResizeWindowToContainerSize(Node);
 
         if(!Node)
         {
-            link_node *Link = GetLinkNodeFromWindowID(SpaceInfo->RootNode, Window->ID);
+            link_node *Link = GetLinkNodeFromWindowID(SpaceInfo, Window->ID);
             if(Link)
                 ResizeWindowToContainerSize(Link);
         }
@@ -363,28 +498,42 @@ void ModifyContainerSplitRatio(double Offset)
     if(!Root || IsLeafNode(Root) || Root->WindowID != 0)
         return;
 
-    tree_node *Node = GetTreeNodeFromWindowIDOrLinkNode(Root, Window->ID);
+    tree_node *Node = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo, Window->ID);
     if(Node && Node->Parent)
     {
         if(Node->Parent->SplitRatio + Offset > 0.0 &&
            Node->Parent->SplitRatio + Offset < 1.0)
         {
             Node->Parent->SplitRatio += Offset;
-            ResizeNodeContainer(Display, Node->Parent);
-            ApplyTreeNodeContainer(Node->Parent);
+            MarkNodeSplitDirty(Node->Parent);
+            UpdateDirtyNodeContainers(Display, Node->Parent);
+            ApplyDirtyNodeContainers(Node->Parent);
         }
     }
 }
 
-internal inline bool
-IsLeftChildInSubTree(tree_node *Root, tree_node *Target)
+/* NOTE(koekeishiya): Every node knows its distance from the root, so both queries below
+ * only walk up the parent pointers, O(depth), and never allocate. They run on every
+ * drag-resize and keyboard resize. */
+void SetNodeDepth(tree_node *Node, uint32_t Depth)
 {
-    bool Result = ((Root->LeftChild == Target) ||
-                   (Root->RightChild == Target)) ||
-                   (Root->LeftChild && IsLeftChildInSubTree(Root->LeftChild, Target)) ||
-                   (Root->RightChild && IsLeftChildInSubTree(Root->RightChild, Target));
+    if(Node)
+    {
+        Node->Depth = Depth;
+        SetNodeDepth(Node->LeftChild, Depth + 1);
+        SetNodeDepth(Node->RightChild, Depth + 1);
+    }
+}
+
+bool IsNodeInSubTree(tree_node *Root, tree_node *Node)
+{
+    if(!Root || !Node)
+        return false;
+
+    while(Node && Node->Depth > Root->Depth)
+        Node = Node->Parent;
 
-    return Result;
+    return Node == Root;
 }
 
 tree_node *FindLowestCommonAncestor(tree_node *A, tree_node *B)
@@ -392,24 +541,19 @@ tree_node *FindLowestCommonAncestor(tree_node *A, tree_node *B)
     if(!A || !B)
         return NULL;
 
-    std::map<tree_node *, bool> Ancestors;
-    while(A != NULL)
-    {
-        Ancestors[A] = true;
+    while(A->Depth > B->Depth)
         A = A->Parent;
-    }
 
-    while(B != NULL)
-    {
-        if(Ancestors.find(B) != Ancestors.end())
-        {
-           return B;
-        }
+    while(B->Depth > A->Depth)
+        B = B->Parent;
 
+    while(A != B)
+    {
+        A = A->Parent;
         B = B->Parent;
     }
 
-    return NULL;
+    return A;
 }
 
 void ModifyContainerSplitRatio(double Offset, int Degrees)
@@ -428,18 +572,18 @@ void ModifyContainerSplitRatio(double Offset, int Degrees)
     if(!Root || IsLeafNode(Root) || Root->WindowID != 0)
         return;
 
-    tree_node *Node = GetTreeNodeFromWindowIDOrLinkNode(Root, Window->ID);
+    tree_node *Node = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo, Window->ID);
     if(Node)
     {
         ax_window *ClosestWindow = NULL;
         if(FindClosestWindow(Degrees, &ClosestWindow, false))
         {
-            tree_node *Target = GetTreeNodeFromWindowIDOrLinkNode(Root, ClosestWindow->ID);
+            tree_node *Target = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo, ClosestWindow->ID);
             tree_node *Ancestor = FindLowestCommonAncestor(Node, Target);
 
             if(Ancestor)
             {
-                if(!(Node == Ancestor->LeftChild || IsLeftChildInSubTree(Ancestor->LeftChild, Node)))
+                if(!IsNodeInSubTree(Ancestor->LeftChild, Node))
                     Offset = -Offset;
 
                 double NewSplitRatio = Ancestor->SplitRatio + Offset;
@@ -455,8 +599,9 @@ void SetContainerSplitRatio(double SplitRatio, tree_node *Node, tree_node *Ances
        SplitRatio < 1.0)
     {
         Ancestor->SplitRatio = SplitRatio;
-        ResizeNodeContainer(Display, Ancestor);
+        MarkNodeSplitDirty(Ancestor);
+        UpdateDirtyNodeContainers(Display, Ancestor);
         if(ResizeWindows)
-            ApplyTreeNodeContainer(Ancestor);
+            ApplyDirtyNodeContainers(Ancestor);
     }
 }
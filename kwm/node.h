@@ -5,9 +5,13 @@
 #include "../axlib/display.h"
 #include "../axlib/window.h"
 
-tree_node *CreateRootNode();
-link_node *CreateLinkNode();
+tree_node *CreateRootNode(space_info *SpaceInfo);
+link_node *CreateLinkNode(space_info *SpaceInfo);
 tree_node *CreateLeafNode(ax_display *Display, tree_node *Parent, uint32_t WindowID, container_type Type);
+void FreeTreeNode(space_info *SpaceInfo, tree_node *Node);
+void FreeLinkNode(space_info *SpaceInfo, link_node *Link);
+void ResetNodeArena(space_info *SpaceInfo);
+std::string GetNodeArenaStatistics(space_info *SpaceInfo);
 void CreateLeafNodePair(ax_display *Display, tree_node *Parent, uint32_t FirstWindowID, uint32_t SecondWindowID, split_type SplitMode);
 void CreatePseudoNode();
 void RemovePseudoNode();
@@ -16,13 +20,15 @@ bool IsPseudoNode(tree_node *Node);
 bool IsLeftChild(tree_node *Node);
 bool IsRightChild(tree_node *Node);
 void ToggleFocusedNodeSplitMode();
-void SwapNodeWindowIDs(tree_node *A, tree_node *B);
-void SwapNodeWindowIDs(link_node *A, link_node *B);
+void SwapNodeWindowIDs(space_info *SpaceInfo, tree_node *A, tree_node *B);
+void SwapNodeWindowIDs(space_info *SpaceInfo, link_node *A, link_node *B);
 split_type GetOptimalSplitMode(tree_node *Node);
 void ResizeWindowToContainerSize(tree_node *Node);
 void ResizeWindowToContainerSize(link_node *Node);
 void ResizeWindowToContainerSize(ax_window *Window);
 void ResizeWindowToContainerSize();
+void SetNodeDepth(tree_node *Node, uint32_t Depth);
+bool IsNodeInSubTree(tree_node *Root, tree_node *Node);
 tree_node *FindLowestCommonAncestor(tree_node *A, tree_node *B);
 void ModifyContainerSplitRatio(double Offset);
 void ModifyContainerSplitRatio(double Offset, int Degrees);
@@ -0,0 +1,113 @@
+#include "poller.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#else
+#include <sys/epoll.h>
+#endif
+
+bool KwmCreatePoller(kwm_poller *Poller)
+{
+#ifdef __APPLE__
+    Poller->FD = kqueue();
+#else
+    Poller->FD = epoll_create1(EPOLL_CLOEXEC);
+#endif
+    return Poller->FD != -1;
+}
+
+void KwmDestroyPoller(kwm_poller *Poller)
+{
+    if(Poller->FD != -1)
+    {
+        close(Poller->FD);
+        Poller->FD = -1;
+    }
+}
+
+/* NOTE(koekeishiya): Replaces the set of events that FD is watched for. Both filters are
+ * always added to the kqueue and only enabled or disabled, so that a change never fails
+ * because a filter was or was not registered before. */
+bool KwmPollerWatch(kwm_poller *Poller, int FD, uint32_t Events)
+{
+#ifdef __APPLE__
+    struct kevent Changes[2];
+    EV_SET(&Changes[0], FD, EVFILT_READ, EV_ADD | ((Events & KWM_POLLER_READ) ? EV_ENABLE : EV_DISABLE), 0, 0, NULL);
+    EV_SET(&Changes[1], FD, EVFILT_WRITE, EV_ADD | ((Events & KWM_POLLER_WRITE) ? EV_ENABLE : EV_DISABLE), 0, 0, NULL);
+    return kevent(Poller->FD, Changes, 2, NULL, 0, NULL) != -1;
+#else
+    struct epoll_event Event = {};
+    Event.data.fd = FD;
+    if(Events & KWM_POLLER_READ)
+        Event.events |= EPOLLIN | EPOLLRDHUP;
+    if(Events & KWM_POLLER_WRITE)
+        Event.events |= EPOLLOUT;
+
+    if(epoll_ctl(Poller->FD, EPOLL_CTL_MOD, FD, &Event) == 0)
+        return true;
+
+    return errno == ENOENT && epoll_ctl(Poller->FD, EPOLL_CTL_ADD, FD, &Event) == 0;
+#endif
+}
+
+/* NOTE(koekeishiya): Must be called before FD is closed, a closed descriptor is dropped by
+ * kqueue on its own but epoll may keep reporting it if the file is still open elsewhere. */
+void KwmPollerForget(kwm_poller *Poller, int FD)
+{
+#ifdef __APPLE__
+    struct kevent Changes[2];
+    EV_SET(&Changes[0], FD, EVFILT_READ, EV_DELETE, 0, 0, NULL);
+    EV_SET(&Changes[1], FD, EVFILT_WRITE, EV_DELETE, 0, 0, NULL);
+    kevent(Poller->FD, Changes, 2, NULL, 0, NULL);
+#else
+    epoll_ctl(Poller->FD, EPOLL_CTL_DEL, FD, NULL);
+#endif
+}
+
+/* NOTE(koekeishiya): Timeout is in milliseconds, -1 waits until something is ready. Returns
+ * the number of events written to Events, 0 on timeout or if the wait was interrupted. */
+int KwmPollerWait(kwm_poller *Poller, kwm_poller_event *Events, int Count, int Timeout)
+{
+#ifdef __APPLE__
+    struct kevent Ready[64];
+    if(Count > 64)
+        Count = 64;
+
+    struct timespec Time = { Timeout / 1000, (Timeout % 1000) * 1000000 };
+    int Result = kevent(Poller->FD, NULL, 0, Ready, Count, Timeout < 0 ? NULL : &Time);
+    if(Result == -1)
+        return errno == EINTR ? 0 : -1;
+
+    for(int Index = 0; Index < Result; ++Index)
+    {
+        Events[Index].FD = (int) Ready[Index].ident;
+        Events[Index].Events = (Ready[Index].filter == EVFILT_WRITE && !(Ready[Index].flags & EV_ERROR))
+                             ? KWM_POLLER_WRITE : KWM_POLLER_READ;
+    }
+#else
+    struct epoll_event Ready[64];
+    if(Count > 64)
+        Count = 64;
+
+    int Result = epoll_wait(Poller->FD, Ready, Count, Timeout);
+    if(Result == -1)
+        return errno == EINTR ? 0 : -1;
+
+    for(int Index = 0; Index < Result; ++Index)
+    {
+        Events[Index].FD = Ready[Index].data.fd;
+        Events[Index].Events = 0;
+        if(Ready[Index].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+            Events[Index].Events |= KWM_POLLER_READ;
+        if(Ready[Index].events & EPOLLOUT)
+            Events[Index].Events |= KWM_POLLER_WRITE;
+    }
+#endif
+
+    return Result;
+}
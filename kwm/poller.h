@@ -0,0 +1,30 @@
+#ifndef POLLER_H
+#define POLLER_H
+
+#include <stdint.h>
+
+/* NOTE(koekeishiya): Readiness notification for the daemon. Uses kqueue on macOS and epoll
+ * elsewhere, so that the daemon can be built and run on its own on Linux. A descriptor that
+ * has hung up or failed is reported as readable, so that the following read sees it. */
+#define KWM_POLLER_READ (1 << 0)
+#define KWM_POLLER_WRITE (1 << 1)
+
+struct kwm_poller
+{
+    int FD;
+};
+
+struct kwm_poller_event
+{
+    int FD;
+    uint32_t Events;
+};
+
+bool KwmCreatePoller(kwm_poller *Poller);
+void KwmDestroyPoller(kwm_poller *Poller);
+
+bool KwmPollerWatch(kwm_poller *Poller, int FD, uint32_t Events);
+void KwmPollerForget(kwm_poller *Poller, int FD);
+int KwmPollerWait(kwm_poller *Poller, kwm_poller_event *Events, int Count, int Timeout);
+
+#endif
@@ -4,6 +4,7 @@
 #include "daemon.h"
 #include "tree.h"
 #include "node.h"
+#include "snapshot.h"
 
 #include "../axlib/axlib.h"
 
@@ -11,11 +12,13 @@
 
 extern std::map<std::string, space_info> WindowTree;
 extern ax_window *MarkedWindow;
+extern ax_application *FocusedApplication;
 
 extern kwm_settings KWMSettings;
 extern kwm_border FocusedBorder;
 extern kwm_border MarkedBorder;
 extern scratchpad Scratchpad;
+extern window_burst WindowBurst;
 
 internal std::string
 GetSplitModeOfWindow(ax_window *Window)
@@ -27,7 +30,7 @@ GetSplitModeOfWindow(ax_window *Window)
     ax_display *Display = AXLibWindowDisplay(Window);
     space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
 
-    tree_node *Node = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo->RootNode, Window->ID);
+    tree_node *Node = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo, Window->ID);
     if(Node)
     {
         if(Node->SplitMode == SPLIT_VERTICAL)
@@ -39,28 +42,29 @@ GetSplitModeOfWindow(ax_window *Window)
     return Output;
 }
 
-EVENT_CALLBACK(Callback_KWMEvent_QueryTilingMode)
+internal std::string
+GetTilingMode()
 {
-    int *SockFD = (int *) Event->Context;
-    std::string Output;
-
     if(KWMSettings.Space == SpaceModeBSP)
-        Output = "bsp";
+        return "bsp";
     else if(KWMSettings.Space == SpaceModeMonocle)
-        Output = "monocle";
+        return "monocle";
     else
-        Output = "float";
+        return "float";
+}
+
+EVENT_CALLBACK(Callback_KWMEvent_QueryTilingMode)
+{
+    int SockFD = Event->Payload.SockFD;
 
-    printf("QueryTilingMode: %d\n", *SockFD);
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+    printf("QueryTilingMode: %d\n", SockFD);
+    KwmWriteToSocket(GetTilingMode(), SockFD);
 }
 
-EVENT_CALLBACK(Callback_KWMEvent_QuerySplitMode)
+internal std::string
+GetSplitMode()
 {
-    int *SockFD = (int *) Event->Context;
     std::string Output;
-
     if(KWMSettings.SplitMode == SPLIT_OPTIMAL)
         Output = "Optimal";
     else if(KWMSettings.SplitMode == SPLIT_VERTICAL)
@@ -68,92 +72,122 @@ EVENT_CALLBACK(Callback_KWMEvent_QuerySplitMode)
     else if(KWMSettings.SplitMode == SPLIT_HORIZONTAL)
         Output = "Horizontal";
 
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+    return Output;
 }
 
-EVENT_CALLBACK(Callback_KWMEvent_QuerySplitRatio)
+EVENT_CALLBACK(Callback_KWMEvent_QuerySplitMode)
 {
-    int *SockFD = (int *) Event->Context;
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetSplitMode(), SockFD);
+}
 
+internal std::string
+GetSplitRatio()
+{
     std::string Output = std::to_string(KWMSettings.SplitRatio);
     Output.erase(Output.find_last_not_of('0') + 1, std::string::npos);
+    return Output;
+}
 
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+EVENT_CALLBACK(Callback_KWMEvent_QuerySplitRatio)
+{
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetSplitRatio(), SockFD);
 }
 
-EVENT_CALLBACK(Callback_KWMEvent_QuerySpawnPosition)
+internal std::string
+GetSpawnPosition()
 {
-    int *SockFD = (int *) Event->Context;
+    return HasFlags(&KWMSettings, Settings_SpawnAsLeftChild) ? "left" : "right";
+}
 
-    std::string Output = HasFlags(&KWMSettings, Settings_SpawnAsLeftChild) ? "left" : "right";
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+EVENT_CALLBACK(Callback_KWMEvent_QuerySpawnPosition)
+{
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetSpawnPosition(), SockFD);
 }
 
-EVENT_CALLBACK(Callback_KWMEvent_QueryFocusFollowsMouse)
+internal std::string
+GetFocusFollowsMouse()
 {
-    int *SockFD = (int *) Event->Context;
     std::string Output;
-
     if(KWMSettings.Focus == FocusModeAutoraise)
         Output = "autoraise";
     else if(KWMSettings.Focus == FocusModeDisabled)
         Output = "off";
 
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+    return Output;
+}
+
+EVENT_CALLBACK(Callback_KWMEvent_QueryFocusFollowsMouse)
+{
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetFocusFollowsMouse(), SockFD);
+}
+
+internal std::string
+GetMouseFollowsFocus()
+{
+    return HasFlags(&KWMSettings, Settings_MouseFollowsFocus) ? "on" : "off";
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QueryMouseFollowsFocus)
 {
-    int *SockFD = (int *) Event->Context;
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetMouseFollowsFocus(), SockFD);
+}
 
-    std::string Output = HasFlags(&KWMSettings, Settings_MouseFollowsFocus) ? "on" : "off";
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+internal std::string
+GetCycleFocus()
+{
+    return KWMSettings.Cycle == CycleModeScreen ? "screen" : "off";
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QueryCycleFocus)
 {
-    int *SockFD = (int *) Event->Context;
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetCycleFocus(), SockFD);
+}
 
-    std::string Output = KWMSettings.Cycle == CycleModeScreen ? "screen" : "off";
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+internal std::string
+GetFloatNonResizable()
+{
+    return HasFlags(&KWMSettings, Settings_FloatNonResizable) ? "on" : "off";
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QueryFloatNonResizable)
 {
-    int *SockFD = (int *) Event->Context;
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetFloatNonResizable(), SockFD);
+}
 
-    std::string Output = HasFlags(&KWMSettings, Settings_FloatNonResizable) ? "on" : "off";
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+internal std::string
+GetLockToContainer()
+{
+    return HasFlags(&KWMSettings, Settings_LockToContainer) ? "on" : "off";
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QueryLockToContainer)
 {
-    int *SockFD = (int *) Event->Context;
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetLockToContainer(), SockFD);
+}
 
-    std::string Output = HasFlags(&KWMSettings, Settings_LockToContainer) ? "on" : "off";
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+internal std::string
+GetStandbyOnFloat()
+{
+    return HasFlags(&KWMSettings, Settings_StandbyOnFloat) ? "on" : "off";
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QueryStandbyOnFloat)
 {
-    int *SockFD = (int *) Event->Context;
-
-    std::string Output = HasFlags(&KWMSettings, Settings_StandbyOnFloat) ? "on" : "off";
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetStandbyOnFloat(), SockFD);
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QuerySpaces)
 {
-    int *SockFD = (int *) Event->Context;
+    int SockFD = Event->Payload.SockFD;
 
     std::string Output;
     ax_display *Display = AXLibMainDisplay();
@@ -185,56 +219,55 @@ EVENT_CALLBACK(Callback_KWMEvent_QuerySpaces)
             Output.erase(Output.begin() + Output.size()-1);
     }
 
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+    KwmWriteToSocket(Output, SockFD);
 }
 
-EVENT_CALLBACK(Callback_KWMEvent_QueryCurrentSpaceName)
+internal std::string
+GetCurrentSpaceName(ax_display *Display)
 {
-    int *SockFD = (int *) Event->Context;
-    std::string Output;
+    return Display ? GetNameOfSpace(Display, Display->Space) : "";
+}
 
-    ax_display *Display = AXLibMainDisplay();
-    Output = GetNameOfSpace(Display, Display->Space);
+EVENT_CALLBACK(Callback_KWMEvent_QueryCurrentSpaceName)
+{
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetCurrentSpaceName(AXLibMainDisplay()), SockFD);
+}
 
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+internal std::string
+GetPreviousSpaceName(ax_display *Display)
+{
+    return Display ? GetNameOfSpace(Display, Display->PrevSpace) : "";
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QueryPreviousSpaceName)
 {
-    int *SockFD = (int *) Event->Context;
-
-    std::string Output;
-    ax_display *Display = AXLibMainDisplay();
-    if(Display)
-        Output = GetNameOfSpace(Display, Display->PrevSpace);
-
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetPreviousSpaceName(AXLibMainDisplay()), SockFD);
 }
 
-EVENT_CALLBACK(Callback_KWMEvent_QueryCurrentSpaceMode)
+internal std::string
+GetCurrentSpaceMode(ax_application *Application)
 {
-    int *SockFD = (int *) Event->Context;
-
     std::string Output;
     ax_window *Window = NULL;
-    ax_application *Application = AXLibGetFocusedApplication();
     if(Application)
         Window = Application->Focus;
 
     GetTagForCurrentSpace(Output, Window);
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+    return Output;
 }
 
-EVENT_CALLBACK(Callback_KWMEvent_QueryCurrentSpaceTag)
+EVENT_CALLBACK(Callback_KWMEvent_QueryCurrentSpaceMode)
 {
-    int *SockFD = (int *) Event->Context;
-    std::string Output;
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetCurrentSpaceMode(AXLibGetFocusedApplication()), SockFD);
+}
 
-    ax_application *Application = AXLibGetFocusedApplication();
+internal std::string
+GetCurrentSpaceTag(ax_application *Application)
+{
+    std::string Output;
     if(Application)
     {
         ax_window *Window = Application->Focus;
@@ -248,136 +281,179 @@ EVENT_CALLBACK(Callback_KWMEvent_QueryCurrentSpaceTag)
         GetTagForCurrentSpace(Output, NULL);
     }
 
+    return Output;
+}
 
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+EVENT_CALLBACK(Callback_KWMEvent_QueryCurrentSpaceTag)
+{
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetCurrentSpaceTag(AXLibGetFocusedApplication()), SockFD);
+}
+
+internal std::string
+GetCurrentSpaceId(ax_display *Display)
+{
+    return Display ? std::to_string(AXLibDesktopIDFromCGSSpaceID(Display, Display->Space->ID)) : "-1";
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QueryCurrentSpaceId)
 {
-    int *SockFD = (int *) Event->Context;
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetCurrentSpaceId(AXLibMainDisplay()), SockFD);
+}
+
+EVENT_CALLBACK(Callback_KWMEvent_QueryCurrentSpaceAllocator)
+{
+    int SockFD = Event->Payload.SockFD;
 
-    std::string Output = "-1";
+    std::string Output;
     ax_display *Display = AXLibMainDisplay();
     if(Display)
-        Output = std::to_string(AXLibDesktopIDFromCGSSpaceID(Display, Display->Space->ID));
+    {
+        space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
+        Output = GetNodeArenaStatistics(SpaceInfo);
+    }
 
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+    KwmWriteToSocket(Output, SockFD);
+}
+
+internal std::string
+GetPreviousSpaceId(ax_display *Display)
+{
+    return Display ? std::to_string(AXLibDesktopIDFromCGSSpaceID(Display, Display->PrevSpace->ID)) : "-1";
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QueryPreviousSpaceId)
 {
-    int *SockFD = (int *) Event->Context;
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetPreviousSpaceId(AXLibMainDisplay()), SockFD);
+}
 
-    std::string Output = "-1";
-    ax_display *Display = AXLibMainDisplay();
-    if(Display)
-        Output = std::to_string(AXLibDesktopIDFromCGSSpaceID(Display, Display->PrevSpace->ID));
+/* NOTE(koekeishiya): Turning a space into a desktop id asks the window server for every space
+ * it manages, so the ids that go into the query snapshot are only looked up again when the
+ * active or previous space of the main display has changed. */
+internal CGSSpaceID CachedActiveSpace;
+internal CGSSpaceID CachedPreviousSpace;
+internal std::string CachedActiveSpaceId;
+internal std::string CachedPreviousSpaceId;
 
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+internal void
+UpdateCachedSpaceIds(ax_display *Display)
+{
+    if(Display->Space->ID != CachedActiveSpace)
+    {
+        CachedActiveSpace = Display->Space->ID;
+        CachedActiveSpaceId = GetCurrentSpaceId(Display);
+    }
+
+    if(Display->PrevSpace->ID != CachedPreviousSpace)
+    {
+        CachedPreviousSpace = Display->PrevSpace->ID;
+        CachedPreviousSpaceId = GetPreviousSpaceId(Display);
+    }
+}
+
+internal std::string
+GetFocusedBorder()
+{
+    return FocusedBorder.Enabled ? "true" : "false";
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QueryFocusedBorder)
 {
-    int *SockFD = (int *) Event->Context;
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetFocusedBorder(), SockFD);
+}
 
-    std::string Output = FocusedBorder.Enabled ? "true" : "false";
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+internal std::string
+GetMarkedBorder()
+{
+    return MarkedBorder.Enabled ? "true" : "false";
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QueryMarkedBorder)
 {
-    int *SockFD = (int *) Event->Context;
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetMarkedBorder(), SockFD);
+}
 
-    std::string Output = MarkedBorder.Enabled ? "true" : "false";
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+internal std::string
+GetWindowId(ax_window *Window)
+{
+    return Window ? std::to_string(Window->ID) : "-1";
 }
 
-EVENT_CALLBACK(Callback_KWMEvent_QueryFocusedWindowId)
+internal std::string
+GetWindowName(ax_window *Window)
 {
-    int *SockFD = (int *) Event->Context;
+    return Window && Window->Name ? Window->Name : "";
+}
 
+internal std::string
+GetWindowFloat(ax_window *Window, std::string Default)
+{
+    return Window ? (AXLibHasFlags(Window, AXWindow_Floating) ? "true" : "false") : Default;
+}
+
+EVENT_CALLBACK(Callback_KWMEvent_QueryFocusedWindowId)
+{
+    int SockFD = Event->Payload.SockFD;
 
     ax_application *Application = AXLibGetFocusedApplication();
-    std::string Output = Application && Application->Focus ? std::to_string(Application->Focus->ID) : "-1";
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+    KwmWriteToSocket(GetWindowId(Application ? Application->Focus : NULL), SockFD);
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QueryFocusedWindowName)
 {
-    int *SockFD = (int *) Event->Context;
-
+    int SockFD = Event->Payload.SockFD;
 
     ax_application *Application = AXLibGetFocusedApplication();
-    std::string Output = Application && Application->Focus ? Application->Focus->Name : "";
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+    KwmWriteToSocket(GetWindowName(Application ? Application->Focus : NULL), SockFD);
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QueryFocusedWindowSplit)
 {
-    int *SockFD = (int *) Event->Context;
+    int SockFD = Event->Payload.SockFD;
 
     ax_application *Application = AXLibGetFocusedApplication();
-    std::string Output = Application ? GetSplitModeOfWindow(Application->Focus) : "";
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+    KwmWriteToSocket(GetSplitModeOfWindow(Application ? Application->Focus : NULL), SockFD);
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QueryFocusedWindowFloat)
 {
-    int *SockFD = (int *) Event->Context;
+    int SockFD = Event->Payload.SockFD;
 
     ax_application *Application = AXLibGetFocusedApplication();
-    std::string Output = Application && Application->Focus ? (AXLibHasFlags(Application->Focus, AXWindow_Floating) ? "true" : "false") : "false";
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+    KwmWriteToSocket(GetWindowFloat(Application ? Application->Focus : NULL, "false"), SockFD);
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QueryMarkedWindowId)
 {
-    int *SockFD = (int *) Event->Context;
-
-    std::string Output = MarkedWindow ? std::to_string(MarkedWindow->ID) : "-1";
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetWindowId(MarkedWindow), SockFD);
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QueryMarkedWindowName)
 {
-    int *SockFD = (int *) Event->Context;
-
-    std::string Output = MarkedWindow && MarkedWindow->Name ? MarkedWindow->Name : "";
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetWindowName(MarkedWindow), SockFD);
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QueryMarkedWindowSplit)
 {
-    int *SockFD = (int *) Event->Context;
-
-    std::string Output = GetSplitModeOfWindow(MarkedWindow);
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetSplitModeOfWindow(MarkedWindow), SockFD);
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QueryMarkedWindowFloat)
 {
-    int *SockFD = (int *) Event->Context;
-
-    std::string Output = MarkedWindow ? (AXLibHasFlags(MarkedWindow, AXWindow_Floating) ? "true" : "false") : "";
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetWindowFloat(MarkedWindow, ""), SockFD);
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QueryWindowList)
 {
-    int *SockFD = (int *) Event->Context;
+    int SockFD = Event->Payload.SockFD;
 
     std::string Output;
     std::vector<ax_window *> Windows = AXLibGetAllVisibleWindows();
@@ -391,13 +467,12 @@ EVENT_CALLBACK(Callback_KWMEvent_QueryWindowList)
             Output += "\n";
     }
 
-    KwmWriteToSocket(Output, *SockFD);
-    free(SockFD);
+    KwmWriteToSocket(Output, SockFD);
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QueryNodePosition)
 {
-    int *Args = (int *) Event->Context;
+    int *Args = Event->Payload.Args;
     int SockFD = *(Args + 0);
     int WindowID = *(Args + 1);
 
@@ -406,18 +481,17 @@ EVENT_CALLBACK(Callback_KWMEvent_QueryNodePosition)
     if(Display)
     {
         space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
-        tree_node *Node = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo->RootNode, WindowID);
+        tree_node *Node = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo, WindowID);
         if(Node)
             Output = IsLeftChild(Node) ? "left" : "right";
     }
 
     KwmWriteToSocket(Output, SockFD);
-    free(Args);
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QueryParentNodeState)
 {
-    int *Args = (int *) Event->Context;
+    int *Args = Event->Payload.Args;
     int SockFD = *(Args + 0);
     int FirstID = *(Args + 1);
     int SecondID = *(Args + 2);
@@ -427,19 +501,18 @@ EVENT_CALLBACK(Callback_KWMEvent_QueryParentNodeState)
     if(Display)
     {
         space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
-        tree_node *FirstNode = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo->RootNode, FirstID);
-        tree_node *SecondNode = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo->RootNode, SecondID);
+        tree_node *FirstNode = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo, FirstID);
+        tree_node *SecondNode = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo, SecondID);
         if(FirstNode && SecondNode)
             Output = SecondNode->Parent == FirstNode->Parent ? "true" : "false";
     }
 
     KwmWriteToSocket(Output, SockFD);
-    free(Args);
 }
 
 EVENT_CALLBACK(Callback_KWMEvent_QueryWindowIdInDirectionOfFocusedWindow)
 {
-    int *Args = (int *) Event->Context;
+    int *Args = Event->Payload.Args;
     int SockFD = *(Args + 0);
     int Degrees = *(Args + 1);
 
@@ -450,12 +523,11 @@ EVENT_CALLBACK(Callback_KWMEvent_QueryWindowIdInDirectionOfFocusedWindow)
         Output = std::to_string(ClosestWindow->ID);
 
     KwmWriteToSocket(Output, SockFD);
-    free(Args);
 }
 
-EVENT_CALLBACK(Callback_KWMEvent_QueryScratchpad)
+internal std::string
+GetScratchpadList()
 {
-    int *SockFD = (int *) Event->Context;
     std::string Result;
 
     int Index = 0;
@@ -465,12 +537,192 @@ EVENT_CALLBACK(Callback_KWMEvent_QueryScratchpad)
         Result += std::to_string(It->first) + ": " +
                   std::to_string(It->second->ID) + ", " +
                   It->second->Application->Name + ", " +
-                  It->second->Name;
+                  (It->second->Name ? It->second->Name : "");
 
         if(Index++ < Scratchpad.Windows.size() - 1)
             Result += "\n";
     }
 
-    KwmWriteToSocket(Result, *SockFD);
-    free(SockFD);
+    return Result;
+}
+
+EVENT_CALLBACK(Callback_KWMEvent_QueryScratchpad)
+{
+    int SockFD = Event->Payload.SockFD;
+    KwmWriteToSocket(GetScratchpadList(), SockFD);
+}
+
+/* NOTE(koekeishiya): Number of events merged into an already queued event, per event type,
+ * followed by the events dropped or spilled because the event queue was full. */
+EVENT_CALLBACK(Callback_KWMEvent_QueryEventsCoalesced)
+{
+    int SockFD = Event->Payload.SockFD;
+
+    ax_event_loop_statistics Statistics;
+    AXLibGetEventLoopStatistics(&Statistics);
+
+    std::string Output;
+    for(int Type = AXEvent_None + 1; Type < AXEvent_Count; ++Type)
+    {
+        if(Statistics.Coalesced[Type] != 0)
+            Output += std::string(AXLibGetEventTypeName((ax_event_type) Type)) + ": " +
+                      std::to_string(Statistics.Coalesced[Type]) + "\n";
+    }
+
+    Output += "dropped: " + std::to_string(Statistics.Dropped) +
+              ", spilled: " + std::to_string(Statistics.Spilled);
+
+    KwmWriteToSocket(Output, SockFD);
+}
+
+/* NOTE(koekeishiya): Events waiting in, and events processed from, each lane of the event loop. */
+EVENT_CALLBACK(Callback_KWMEvent_QueryEventsLanes)
+{
+    int SockFD = Event->Payload.SockFD;
+
+    ax_event_loop_statistics Statistics;
+    AXLibGetEventLoopStatistics(&Statistics);
+
+    std::string Output;
+    for(int Lane = 0; Lane < AXEventLane_Count; ++Lane)
+    {
+        if(Lane > 0)
+            Output += "\n";
+
+        Output += std::string(AXLibGetEventLaneName((ax_event_lane_type) Lane)) + ": " +
+                  std::to_string(Statistics.Depth[Lane]) + " queued, " +
+                  std::to_string(Statistics.Processed[Lane]) + " processed";
+    }
+
+    KwmWriteToSocket(Output, SockFD);
+}
+
+internal std::string
+GetHistogramSummary(ax_event_histogram *Histogram)
+{
+    return std::to_string(AXLibGetHistogramPercentile(Histogram, 50.0)) + "/" +
+           std::to_string(AXLibGetHistogramPercentile(Histogram, 99.0)) + "/" +
+           std::to_string(Histogram->Max);
+}
+
+/* NOTE(koekeishiya): Time spent waiting in the queue and time spent in the handler, as
+ * p50/p99/max in microseconds, per event. Followed by the deepest each lane has been and
+ * the number of handlers that ran longer than the slow-handler threshold. */
+EVENT_CALLBACK(Callback_KWMEvent_QueryEventsLatency)
+{
+    int SockFD = Event->Payload.SockFD;
+
+    ax_event_loop_statistics Statistics;
+    AXLibGetEventLoopStatistics(&Statistics);
+
+    std::string Output;
+    ax_event_timing *Timings = AXLibGetEventTimings();
+    for(int Index = 0; Index < AX_EVENT_TIMING_SLOTS; ++Index)
+    {
+        ax_event_timing *Timing = &Timings[Index];
+        if(Timing->Name && Timing->Runtime.Count != 0)
+        {
+            Output += std::string(Timing->Name) + ": " + std::to_string(Timing->Runtime.Count) +
+                      " events, wait " + GetHistogramSummary(&Timing->Wait) +
+                      " us, run " + GetHistogramSummary(&Timing->Runtime) + " us\n";
+        }
+    }
+
+    for(int Lane = 0; Lane < AXEventLane_Count; ++Lane)
+    {
+        Output += std::string(AXLibGetEventLaneName((ax_event_lane_type) Lane)) + " max depth: " +
+                  std::to_string(Statistics.MaxDepth[Lane]) + "\n";
+    }
+
+    Output += "slow handlers: " + std::to_string(Statistics.SlowHandlers);
+    KwmWriteToSocket(Output, SockFD);
+}
+
+/* NOTE(koekeishiya): Per application, the learned delay until it responds after launch, the
+ * number of launches seen, and the time from launch until its first window was tiled, in milliseconds. */
+EVENT_CALLBACK(Callback_KWMEvent_QueryEventsLaunch)
+{
+    int SockFD = Event->Payload.SockFD;
+
+    std::string Output;
+    std::map<std::string, ax_application_launch> Launches = AXLibGetApplicationLaunchStatistics();
+    std::map<std::string, ax_application_launch>::iterator It;
+    for(It = Launches.begin(); It != Launches.end(); ++It)
+    {
+        ax_application_launch *Launch = &It->second;
+        if(!Output.empty())
+            Output += "\n";
+
+        Output += It->first + ": ready " + std::to_string(Launch->ReadyDelay) + " ms, " +
+                  std::to_string(Launch->Launches) + " launches";
+        if(Launch->Tiles != 0)
+        {
+            Output += ", tiled " + std::to_string(Launch->LastTile) + " ms (avg " +
+                      std::to_string(Launch->TotalTile / Launch->Tiles) + ", max " +
+                      std::to_string(Launch->MaxTile) + ", " +
+                      std::to_string(Launch->Tiles) + " tiled)";
+        }
+    }
+
+    KwmWriteToSocket(Output, SockFD);
+}
+
+/* NOTE(koekeishiya): Windows inserted and AX writes issued by the last burst of created
+ * windows, followed by the totals over all bursts. */
+EVENT_CALLBACK(Callback_KWMEvent_QueryEventsBurst)
+{
+    int SockFD = Event->Payload.SockFD;
+
+    std::string Output = "last: " + std::to_string(WindowBurst.LastWindows) + " windows, " +
+                         std::to_string(WindowBurst.LastWrites) + " writes\n" +
+                         "total: " + std::to_string(WindowBurst.Bursts) + " bursts, " +
+                         std::to_string(WindowBurst.TotalWindows) + " windows, " +
+                         std::to_string(WindowBurst.TotalWrites) + " writes";
+
+    KwmWriteToSocket(Output, SockFD);
+}
+
+/* NOTE(koekeishiya): Answers every query that only reads state kwm keeps track of itself, with
+ * the focus kwm last saw instead of asking the system for it. Queries that talk to the window
+ * server, and the event loop statistics, are not part of the snapshot. */
+void GetQuerySnapshot(state_snapshot *Snapshot)
+{
+    std::map<std::string, std::string> &Answers = Snapshot->Answers;
+    ax_application *Application = FocusedApplication;
+    ax_window *Window = Application ? Application->Focus : NULL;
+
+    Answers["query tiling mode"] = GetTilingMode();
+    Answers["query tiling spawn"] = GetSpawnPosition();
+    Answers["query tiling split-mode"] = GetSplitMode();
+    Answers["query tiling split-ratio"] = GetSplitRatio();
+    Answers["query cycle-focus"] = GetCycleFocus();
+    Answers["query float-non-resizable"] = GetFloatNonResizable();
+    Answers["query lock-to-container"] = GetLockToContainer();
+    Answers["query standby-on-float"] = GetStandbyOnFloat();
+    Answers["query focus-follows-mouse"] = GetFocusFollowsMouse();
+    Answers["query mouse-follows-focus"] = GetMouseFollowsFocus();
+    Answers["query border focused"] = GetFocusedBorder();
+    Answers["query border marked"] = GetMarkedBorder();
+    Answers["query scratchpad list"] = GetScratchpadList();
+
+    Answers["query window focused id"] = GetWindowId(Window);
+    Answers["query window focused name"] = GetWindowName(Window);
+    Answers["query window focused split"] = GetSplitModeOfWindow(Window);
+    Answers["query window focused float"] = GetWindowFloat(Window, "false");
+    Answers["query window marked id"] = GetWindowId(MarkedWindow);
+    Answers["query window marked name"] = GetWindowName(MarkedWindow);
+    Answers["query window marked split"] = GetSplitModeOfWindow(MarkedWindow);
+    Answers["query window marked float"] = GetWindowFloat(MarkedWindow, "");
+
+    ax_display *Display = AXLibMainDisplay();
+    if(Display && Display->Space && Display->PrevSpace)
+    {
+        UpdateCachedSpaceIds(Display);
+        Answers["query space active tag"] = GetCurrentSpaceTag(Application);
+        Answers["query space active name"] = GetCurrentSpaceName(Display);
+        Answers["query space active id"] = CachedActiveSpaceId;
+        Answers["query space active mode"] = GetCurrentSpaceMode(Application);
+        Answers["query space previous name"] = GetPreviousSpaceName(Display);
+        Answers["query space previous id"] = CachedPreviousSpaceId;
+    }
 }
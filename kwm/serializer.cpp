@@ -12,7 +12,7 @@
 extern kwm_path KWMPath;
 
 internal void SerializeParentNode(tree_node *Parent, std::string Role, std::vector<std::string> &Serialized);
-internal tree_node * DeserializeNodeTree(std::vector<std::string> &Serialized, ax_display *Display);
+internal tree_node * DeserializeNodeTree(std::vector<std::string> &Serialized, ax_display *Display, space_info *SpaceInfo);
 internal unsigned int DeserializeParentNode(tree_node *Parent, ax_display *Display, std::vector<std::string> &Serialized, unsigned int Index);
 internal unsigned int DeserializeChildNode(tree_node *Parent, ax_display *Display, std::vector<std::string> &Serialized, unsigned int Index);
 
@@ -122,13 +122,13 @@ DeserializeChildNode(tree_node *Parent, ax_display *Display, std::vector<std::st
 }
 
 internal tree_node *
-DeserializeNodeTree(std::vector<std::string> &Serialized, ax_display *Display)
+DeserializeNodeTree(std::vector<std::string> &Serialized, ax_display *Display, space_info *SpaceInfo)
 {
     if(Serialized.empty() || Serialized[0] != "kwmc tree root create parent")
         return NULL;
 
     DEBUG("Deserialize: Create Master");
-    tree_node *RootNode = CreateRootNode();
+    tree_node *RootNode = CreateRootNode(SpaceInfo);
     SetRootNodeContainer(Display, RootNode);
     DeserializeParentNode(RootNode, Display, Serialized, 1);
     return RootNode;
@@ -173,7 +173,7 @@ bool LoadBSPTreeFromFile(ax_display *Display, space_info *SpaceInfo, std::string
     while(std::getline(InFD, Line))
         SerializedTree.push_back(Line);
 
-    DestroyNodeTree(SpaceInfo->RootNode);
-    SpaceInfo->RootNode = DeserializeNodeTree(SerializedTree, Display);
+    DestroyNodeTree(SpaceInfo);
+    SpaceInfo->RootNode = DeserializeNodeTree(SerializedTree, Display, SpaceInfo);
     return true;
 }
@@ -0,0 +1,209 @@
+#include "snapshot.h"
+#include "history.h"
+#include "interpreter.h"
+#include "daemon.h"
+#include "helpers.h"
+#include "../axlib/axlib.h"
+
+#define internal static
+
+extern std::map<std::string, space_info> WindowTree;
+
+/* NOTE(koekeishiya): The event loop publishes a new snapshot by swapping it in, and the daemon
+ * thread is the only reader. Before it reads a snapshot the reader announces it in
+ * ReadingSnapshot, and checks that it is still the current one. A snapshot that has been
+ * swapped out is retired, and freed by the event loop once the reader no longer announces it,
+ * so neither side ever waits for the other. Reference counts of the tree are only touched by
+ * the event loop. */
+internal state_snapshot *CurrentSnapshot;
+internal state_snapshot *ReadingSnapshot;
+internal std::vector<state_snapshot *> RetiredSnapshots;
+
+internal void
+DestroyStateSnapshot(state_snapshot *Snapshot)
+{
+    ReleaseTreeSnapshot(Snapshot->Tree);
+    delete Snapshot;
+}
+
+internal void
+ReclaimStateSnapshots()
+{
+    state_snapshot *Reading = __atomic_load_n(&ReadingSnapshot, __ATOMIC_SEQ_CST);
+
+    std::size_t Kept = 0;
+    for(std::size_t Index = 0; Index < RetiredSnapshots.size(); ++Index)
+    {
+        if(RetiredSnapshots[Index] == Reading)
+            RetiredSnapshots[Kept++] = RetiredSnapshots[Index];
+        else
+            DestroyStateSnapshot(RetiredSnapshots[Index]);
+    }
+
+    RetiredSnapshots.resize(Kept);
+}
+
+internal void
+SwapStateSnapshot(state_snapshot *Snapshot)
+{
+    state_snapshot *Retired = __atomic_exchange_n(&CurrentSnapshot, Snapshot, __ATOMIC_SEQ_CST);
+    if(Retired)
+        RetiredSnapshots.push_back(Retired);
+
+    ReclaimStateSnapshots();
+}
+
+/* NOTE(koekeishiya): Called by the event loop after a batch of events that may have changed
+ * the state. The snapshot is only read to answer clients, so while none is connected the
+ * current one is dropped instead of replaced. A query from a client that connects later is
+ * then handled by the event loop, which publishes a new snapshot once it is done. The number
+ * of clients is recorded, so that a replayed batch asks the same questions. */
+void PublishStateSnapshot()
+{
+    if(AXLibGetHandlerValue(KwmGetConnectedClients()) == 0)
+    {
+        SwapStateSnapshot(NULL);
+        return;
+    }
+
+    state_snapshot *Snapshot = new state_snapshot();
+    Snapshot->Commands = KwmGetHandledCommands();
+    GetQuerySnapshot(Snapshot);
+
+    ax_display *Display = AXLibMainDisplay();
+    if(Display && Display->Space)
+    {
+        std::map<std::string, space_info>::iterator It = WindowTree.find(Display->Space->Identifier);
+        if(It != WindowTree.end())
+            Snapshot->Tree = CaptureTreeSnapshot(&It->second);
+    }
+
+    SwapStateSnapshot(Snapshot);
+}
+
+internal state_snapshot *
+AcquireStateSnapshot()
+{
+    state_snapshot *Snapshot;
+    do
+    {
+        Snapshot = __atomic_load_n(&CurrentSnapshot, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&ReadingSnapshot, Snapshot, __ATOMIC_SEQ_CST);
+    } while(Snapshot != __atomic_load_n(&CurrentSnapshot, __ATOMIC_SEQ_CST));
+
+    return Snapshot;
+}
+
+internal void
+ReleaseStateSnapshot()
+{
+    __atomic_store_n(&ReadingSnapshot, (state_snapshot *) NULL, __ATOMIC_SEQ_CST);
+}
+
+/* NOTE(koekeishiya): Finds the node that holds the window, either as its own or as one of
+ * its links, the same way GetTreeNodeFromWindowIDOrLinkNode does for the live tree. */
+internal tree_snapshot *
+FindTreeSnapshotNode(tree_snapshot *Node, tree_snapshot *Parent, uint32_t WindowID, tree_snapshot **NodeParent)
+{
+    if(!Node)
+        return NULL;
+
+    bool Match = Node->WindowID == WindowID;
+    for(std::size_t Index = 0; !Match && Index < Node->Links.size(); ++Index)
+        Match = Node->Links[Index] == WindowID;
+
+    if(Match)
+    {
+        *NodeParent = Parent;
+        return Node;
+    }
+
+    tree_snapshot *Result = FindTreeSnapshotNode(Node->LeftChild, Node, WindowID, NodeParent);
+    if(!Result)
+        Result = FindTreeSnapshotNode(Node->RightChild, Node, WindowID, NodeParent);
+
+    return Result;
+}
+
+internal bool
+IsWindowIDToken(std::string &Token)
+{
+    return !Token.empty() && Token.find_first_not_of("0123456789") == std::string::npos;
+}
+
+/* NOTE(koekeishiya): 'query window child <id>' */
+internal std::string
+GetNodePositionFromSnapshot(state_snapshot *Snapshot, uint32_t WindowID)
+{
+    std::string Output;
+    tree_snapshot *Parent = NULL;
+    tree_snapshot *Node = WindowID ? FindTreeSnapshotNode(Snapshot->Tree, NULL, WindowID, &Parent) : NULL;
+    if(Node)
+    {
+        bool Leaf = !Node->LeftChild && !Node->RightChild;
+        Output = Leaf && Parent && Parent->LeftChild == Node ? "left" : "right";
+    }
+
+    return Output;
+}
+
+/* NOTE(koekeishiya): 'query window parent <id> <id>' */
+internal std::string
+GetParentNodeStateFromSnapshot(state_snapshot *Snapshot, uint32_t FirstID, uint32_t SecondID)
+{
+    tree_snapshot *FirstParent = NULL;
+    tree_snapshot *SecondParent = NULL;
+    tree_snapshot *FirstNode = FirstID ? FindTreeSnapshotNode(Snapshot->Tree, NULL, FirstID, &FirstParent) : NULL;
+    tree_snapshot *SecondNode = SecondID ? FindTreeSnapshotNode(Snapshot->Tree, NULL, SecondID, &SecondParent) : NULL;
+
+    return FirstNode && SecondNode && FirstParent == SecondParent ? "true" : "false";
+}
+
+/* NOTE(koekeishiya): Called by the daemon thread. Commands is the number of commands it has
+ * queued so far; a snapshot that was taken before all of them were handled is not used, so a
+ * query never reads state older than the commands that were sent before it. */
+bool AnswerQueryFromSnapshot(std::string Command, uint64_t Commands, std::string *Output)
+{
+    std::vector<std::string> Tokens;
+    std::vector<std::string> Elements = SplitString(Command, ' ');
+    for(std::size_t Index = 0; Index < Elements.size(); ++Index)
+    {
+        if(!Elements[Index].empty())
+            Tokens.push_back(Elements[Index]);
+    }
+
+    if(Tokens.empty() || Tokens[0] != "query")
+        return false;
+
+    bool Result = false;
+    state_snapshot *Snapshot = AcquireStateSnapshot();
+    if(Snapshot && Snapshot->Commands == Commands)
+    {
+        if(Tokens.size() == 4 && Tokens[1] == "window" && Tokens[2] == "child" &&
+           IsWindowIDToken(Tokens[3]))
+        {
+            *Output = GetNodePositionFromSnapshot(Snapshot, ConvertStringToUint(Tokens[3]));
+            Result = true;
+        }
+        else if(Tokens.size() == 5 && Tokens[1] == "window" && Tokens[2] == "parent" &&
+                IsWindowIDToken(Tokens[3]) && IsWindowIDToken(Tokens[4]))
+        {
+            *Output = GetParentNodeStateFromSnapshot(Snapshot,
+                                                     ConvertStringToUint(Tokens[3]),
+                                                     ConvertStringToUint(Tokens[4]));
+            Result = true;
+        }
+        else
+        {
+            std::map<std::string, std::string>::iterator It = Snapshot->Answers.find(CreateStringFromTokens(Tokens, 0));
+            if(It != Snapshot->Answers.end())
+            {
+                *Output = It->second;
+                Result = true;
+            }
+        }
+    }
+
+    ReleaseStateSnapshot();
+    return Result;
+}
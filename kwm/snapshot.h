@@ -0,0 +1,10 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "types.h"
+
+void GetQuerySnapshot(state_snapshot *Snapshot);
+void PublishStateSnapshot();
+bool AnswerQueryFromSnapshot(std::string Command, uint64_t Commands, std::string *Output);
+
+#endif
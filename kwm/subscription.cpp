@@ -0,0 +1,300 @@
+#include "subscription.h"
+#include "daemon.h"
+#include "space.h"
+#include "helpers.h"
+
+#define internal static
+
+extern std::map<std::string, space_info> WindowTree;
+extern ax_application *FocusedApplication;
+extern kwm_settings KWMSettings;
+extern scratchpad Scratchpad;
+
+internal published_state PublishedState = {};
+
+internal std::string
+GetSingleLine(std::string Line)
+{
+    for(std::size_t Index = 0; Index < Line.size(); ++Index)
+    {
+        if(Line[Index] == '\n' || Line[Index] == '\r')
+            Line[Index] = ' ';
+    }
+
+    return Line;
+}
+
+internal std::string
+GetFocusNotification()
+{
+    ax_application *Application = FocusedApplication;
+    if(!Application || !Application->Focus)
+        return "focus 0";
+
+    ax_window *Window = Application->Focus;
+    std::string Output = "focus " + std::to_string(Window->ID) + " " + Application->Name;
+    if(Window->Name)
+        Output += " - " + std::string(Window->Name);
+
+    return GetSingleLine(Output);
+}
+
+internal std::string
+GetSpaceNotification()
+{
+    ax_display *Display = AXLibMainDisplay();
+    if(!Display || !Display->Space)
+        return "space -1";
+
+    std::string Output = "space " + std::to_string(AXLibDesktopIDFromCGSSpaceID(Display, Display->Space->ID));
+    std::string Name = GetNameOfSpace(Display, Display->Space);
+    if(!Name.empty())
+        Output += " " + Name;
+
+    return GetSingleLine(Output);
+}
+
+internal space_info *
+GetActiveSpaceInfo()
+{
+    ax_display *Display = AXLibMainDisplay();
+    if(!Display || !Display->Space)
+        return NULL;
+
+    std::map<std::string, space_info>::iterator It = WindowTree.find(Display->Space->Identifier);
+    return It != WindowTree.end() ? &It->second : NULL;
+}
+
+internal std::string
+GetModeNotification()
+{
+    space_info *SpaceInfo = GetActiveSpaceInfo();
+    space_tiling_option Mode = SpaceInfo && SpaceInfo->Initialized ? SpaceInfo->Settings.Mode : KWMSettings.Space;
+
+    if(Mode == SpaceModeBSP)
+        return "mode bsp";
+    else if(Mode == SpaceModeMonocle)
+        return "mode monocle";
+    else
+        return "mode float";
+}
+
+internal std::string
+GetScratchpadNotification()
+{
+    std::string Output = "scratchpad";
+    std::map<int, ax_window *>::iterator It;
+    for(It = Scratchpad.Windows.begin(); It != Scratchpad.Windows.end(); ++It)
+        Output += " " + std::to_string(It->second->ID);
+
+    return Output;
+}
+
+/* NOTE(koekeishiya): FNV-1a over the parts of a node that a client can observe. */
+internal inline void
+HashValue(uint64_t *Hash, const void *Data, std::size_t Size)
+{
+    const uint8_t *Bytes = (const uint8_t *) Data;
+    for(std::size_t Index = 0; Index < Size; ++Index)
+    {
+        *Hash ^= Bytes[Index];
+        *Hash *= 1099511628211ULL;
+    }
+}
+
+internal void
+HashTreeNode(uint64_t *Hash, tree_node *Node)
+{
+    uint8_t Marker = Node ? 1 : 0;
+    HashValue(Hash, &Marker, sizeof(Marker));
+    if(!Node)
+        return;
+
+    HashValue(Hash, &Node->WindowID, sizeof(Node->WindowID));
+    HashValue(Hash, &Node->SplitMode, sizeof(Node->SplitMode));
+    HashValue(Hash, &Node->SplitRatio, sizeof(Node->SplitRatio));
+    HashValue(Hash, &Node->Container.X, sizeof(Node->Container.X));
+    HashValue(Hash, &Node->Container.Y, sizeof(Node->Container.Y));
+    HashValue(Hash, &Node->Container.Width, sizeof(Node->Container.Width));
+    HashValue(Hash, &Node->Container.Height, sizeof(Node->Container.Height));
+
+    for(link_node *Link = Node->List; Link; Link = Link->Next)
+        HashValue(Hash, &Link->WindowID, sizeof(Link->WindowID));
+
+    HashTreeNode(Hash, Node->LeftChild);
+    HashTreeNode(Hash, Node->RightChild);
+}
+
+internal uint64_t
+GetTreeHash()
+{
+    uint64_t Hash = 14695981039346656037ULL;
+    space_info *SpaceInfo = GetActiveSpaceInfo();
+    if(SpaceInfo)
+        HashTreeNode(&Hash, SpaceInfo->RootNode);
+
+    return Hash;
+}
+
+internal std::string
+GetTreeNotification()
+{
+    ax_display *Display = AXLibMainDisplay();
+    if(!Display || !Display->Space)
+        return "tree -1";
+
+    return "tree " + std::to_string(AXLibDesktopIDFromCGSSpaceID(Display, Display->Space->ID));
+}
+
+internal void
+UpdatePublishedLine(uint32_t Topics, uint32_t Topic, std::string *Published, std::string Line)
+{
+    if(*Published != Line)
+    {
+        *Published = Line;
+        if(Topics & Topic)
+            KwmPublish(Topic, Line);
+    }
+}
+
+/* NOTE(koekeishiya): Compares the current state against what was last published, and sends
+ * the topics that changed to the clients that subscribed to them. A state that nobody has
+ * subscribed to is not looked at; it is refreshed when the first subscriber for it arrives. */
+internal void
+UpdatePublishedState(uint32_t Topics)
+{
+    if(Topics & Topic_Focus)
+        UpdatePublishedLine(Topics, Topic_Focus, &PublishedState.Focus, GetFocusNotification());
+    if(Topics & Topic_Space)
+        UpdatePublishedLine(Topics, Topic_Space, &PublishedState.Space, GetSpaceNotification());
+    if(Topics & Topic_Mode)
+        UpdatePublishedLine(Topics, Topic_Mode, &PublishedState.Mode, GetModeNotification());
+    if(Topics & Topic_Scratchpad)
+        UpdatePublishedLine(Topics, Topic_Scratchpad, &PublishedState.Scratchpad, GetScratchpadNotification());
+
+    if(Topics & Topic_Tree)
+    {
+        uint64_t Hash = GetTreeHash();
+        std::string Tree = GetTreeNotification();
+        if(Hash != PublishedState.TreeHash || Tree != PublishedState.Tree)
+        {
+            PublishedState.TreeHash = Hash;
+            PublishedState.Tree = Tree;
+            KwmPublish(Topic_Tree, Tree);
+        }
+    }
+}
+
+internal uint32_t
+GetTopicFromName(std::string Name)
+{
+    if(Name == "focus")
+        return Topic_Focus;
+    else if(Name == "space")
+        return Topic_Space;
+    else if(Name == "mode")
+        return Topic_Mode;
+    else if(Name == "window")
+        return Topic_Window;
+    else if(Name == "tree")
+        return Topic_Tree;
+    else if(Name == "scratchpad")
+        return Topic_Scratchpad;
+    else if(Name == "all")
+        return Topic_Focus | Topic_Space | Topic_Mode | Topic_Window | Topic_Tree | Topic_Scratchpad;
+
+    return 0;
+}
+
+/* NOTE(koekeishiya): 'subscribe <topic> [<topic> ...]', topics may also be comma separated.
+ * The client is first sent the current state of every state topic it subscribed to, then
+ * one line per change. A subscription takes over the connection, so it can not be pipelined. */
+void KwmSubscribe(std::vector<std::string> &Tokens, int ClientSockFD)
+{
+    if(KwmIsResponseActive(ClientSockFD))
+    {
+        KwmWriteToSocket("subscribe can not be pipelined", ClientSockFD);
+        return;
+    }
+
+    uint32_t Topics = 0;
+    for(std::size_t TokenIndex = 1; TokenIndex < Tokens.size(); ++TokenIndex)
+    {
+        std::vector<std::string> Names = SplitString(Tokens[TokenIndex], ',');
+        for(std::size_t NameIndex = 0; NameIndex < Names.size(); ++NameIndex)
+        {
+            if(Names[NameIndex].empty())
+                continue;
+
+            uint32_t Topic = GetTopicFromName(Names[NameIndex]);
+            if(!Topic)
+            {
+                KwmWriteToSocket("unknown topic '" + Names[NameIndex] + "'", ClientSockFD);
+                return;
+            }
+
+            Topics |= Topic;
+        }
+    }
+
+    if(!Topics)
+    {
+        KwmWriteToSocket("no topic given", ClientSockFD);
+        return;
+    }
+
+    /* NOTE(koekeishiya): Bring existing subscribers up to date first, so that the state
+     * sent to the new client is the same as the one they last saw. */
+    UpdatePublishedState(KwmGetSubscribedTopics());
+
+    std::string Initial;
+    if(Topics & Topic_Focus)
+    {
+        PublishedState.Focus = GetFocusNotification();
+        Initial += PublishedState.Focus + "\n";
+    }
+    if(Topics & Topic_Space)
+    {
+        PublishedState.Space = GetSpaceNotification();
+        Initial += PublishedState.Space + "\n";
+    }
+    if(Topics & Topic_Mode)
+    {
+        PublishedState.Mode = GetModeNotification();
+        Initial += PublishedState.Mode + "\n";
+    }
+    if(Topics & Topic_Tree)
+    {
+        PublishedState.TreeHash = GetTreeHash();
+        PublishedState.Tree = GetTreeNotification();
+        Initial += PublishedState.Tree + "\n";
+    }
+    if(Topics & Topic_Scratchpad)
+    {
+        PublishedState.Scratchpad = GetScratchpadNotification();
+        Initial += PublishedState.Scratchpad + "\n";
+    }
+
+    KwmSubscribeClient(ClientSockFD, Topics, Initial);
+}
+
+/* NOTE(koekeishiya): Called by the event loop after it has handled a batch of events, so a
+ * burst of changes to the same state is published as one line. */
+void KwmPublishChanges()
+{
+    uint32_t Topics = KwmGetSubscribedTopics();
+    if(Topics)
+        UpdatePublishedState(Topics);
+}
+
+void PublishWindowChange(const char *Change, ax_window *Window)
+{
+    if(!(KwmGetSubscribedTopics() & Topic_Window))
+        return;
+
+    std::string Output = std::string("window ") + Change + " " + std::to_string(Window->ID);
+    if(Window->Application)
+        Output += " " + Window->Application->Name;
+
+    KwmPublish(Topic_Window, GetSingleLine(Output));
+}
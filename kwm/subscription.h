@@ -0,0 +1,11 @@
+#ifndef SUBSCRIPTION_H
+#define SUBSCRIPTION_H
+
+#include "types.h"
+#include "../axlib/axlib.h"
+
+void KwmSubscribe(std::vector<std::string> &Tokens, int ClientSockFD);
+void KwmPublishChanges();
+void PublishWindowChange(const char *Change, ax_window *Window);
+
+#endif
@@ -0,0 +1,240 @@
+#include "transaction.h"
+#include "window.h"
+#include "event.h"
+#include "../axlib/axlib.h"
+
+#define internal static
+#define WINDOW_BURST_DELAY 15
+#define WINDOW_BURST_MAX_DURATION 100
+
+extern layout_transaction LayoutTransaction;
+extern window_burst WindowBurst;
+
+/* NOTE(koekeishiya): While a layout transaction is open, windows are not resized directly.
+ * The target frame of every window is recorded instead, and a window that is recorded more
+ * than once only keeps its last frame. On commit, frames that equal the frame we last applied
+ * to that window are skipped, unless the window has been moved or resized by someone else
+ * since. Windows that shrink are applied before windows that grow, so that a growing window
+ * is never clamped by a neighbour that has not yet made room for it. Transactions nest; only
+ * the outermost commit touches the windows. */
+
+void BeginLayoutTransaction()
+{
+    ++LayoutTransaction.Depth;
+}
+
+bool IsLayoutTransactionActive()
+{
+    return LayoutTransaction.Depth > 0;
+}
+
+void RecordLayoutFrame(uint32_t WindowID, node_container *Container)
+{
+    layout_frame Frame = { WindowID, (int) Container->X, (int) Container->Y,
+                           (int) Container->Width, (int) Container->Height };
+
+    std::unordered_map<uint32_t, std::size_t>::iterator It = LayoutTransaction.Pending.find(WindowID);
+    if(It != LayoutTransaction.Pending.end())
+    {
+        LayoutTransaction.Frames[It->second] = Frame;
+        ++LayoutTransaction.Coalesced;
+    }
+    else
+    {
+        LayoutTransaction.Pending[WindowID] = LayoutTransaction.Frames.size();
+        LayoutTransaction.Frames.push_back(Frame);
+    }
+}
+
+void ForgetAppliedLayoutFrame(uint32_t WindowID)
+{
+    LayoutTransaction.Applied.erase(WindowID);
+}
+
+internal inline bool
+IsLayoutFrameEqual(layout_frame *A, layout_frame *B)
+{
+    return A->X == B->X && A->Y == B->Y &&
+           A->Width == B->Width && A->Height == B->Height;
+}
+
+internal inline bool
+IsLayoutFrameShrinking(ax_window *Window, layout_frame *Frame)
+{
+    return (Frame->Width * Frame->Height) < (Window->Size.width * Window->Size.height);
+}
+
+internal void
+ApplyLayoutFrames(std::vector<layout_frame> &Frames, std::vector<ax_window *> &Windows, layout_commit *Commit)
+{
+    for(std::size_t Index = 0; Index < Frames.size(); ++Index)
+    {
+        layout_frame *Frame = &Frames[Index];
+        bool Applied;
+        int Writes = ApplyWindowFrame(Windows[Index], Frame->X, Frame->Y, Frame->Width, Frame->Height, &Applied);
+
+        Commit->Writes += Writes;
+        Commit->Skipped += Writes < 2 ? 2 - Writes : 0;
+        if(Applied)
+            LayoutTransaction.Applied[Frame->WindowID] = *Frame;
+        else
+            LayoutTransaction.Applied.erase(Frame->WindowID);
+    }
+}
+
+layout_commit CommitLayoutTransaction()
+{
+    layout_commit Commit = {};
+    if(LayoutTransaction.Depth == 0 || --LayoutTransaction.Depth > 0)
+        return Commit;
+
+    std::vector<layout_frame> Shrinking, Growing;
+    std::vector<ax_window *> ShrinkingWindows, GrowingWindows;
+
+    Commit.Frames = LayoutTransaction.Frames.size();
+    Commit.Skipped = LayoutTransaction.Coalesced * 2;
+    LayoutTransaction.Coalesced = 0;
+
+    for(std::size_t Index = 0; Index < LayoutTransaction.Frames.size(); ++Index)
+    {
+        layout_frame *Frame = &LayoutTransaction.Frames[Index];
+        ax_window *Window = GetWindowByID(Frame->WindowID);
+        if(!Window)
+            continue;
+
+        std::unordered_map<uint32_t, layout_frame>::iterator It = LayoutTransaction.Applied.find(Frame->WindowID);
+        if(It != LayoutTransaction.Applied.end() && IsLayoutFrameEqual(&It->second, Frame))
+        {
+            Commit.Skipped += 2;
+            continue;
+        }
+
+        if(IsLayoutFrameShrinking(Window, Frame))
+        {
+            Shrinking.push_back(*Frame);
+            ShrinkingWindows.push_back(Window);
+        }
+        else
+        {
+            Growing.push_back(*Frame);
+            GrowingWindows.push_back(Window);
+        }
+    }
+
+    LayoutTransaction.Frames.clear();
+    LayoutTransaction.Pending.clear();
+
+    ApplyLayoutFrames(Shrinking, ShrinkingWindows, &Commit);
+    ApplyLayoutFrames(Growing, GrowingWindows, &Commit);
+
+    ++LayoutTransaction.Commits;
+    LayoutTransaction.Writes += Commit.Writes;
+    LayoutTransaction.Skipped += Commit.Skipped;
+
+    DEBUG("CommitLayoutTransaction() " << Commit.Frames << " frames, " <<
+          Commit.Writes << " AX writes issued, " << Commit.Skipped << " skipped");
+    return Commit;
+}
+
+/* NOTE(koekeishiya): Moves the frames of the burst in or out of the layout transaction, so
+ * that they are only recorded into while a window is being inserted, and handlers that run
+ * between two insertions neither defer their own frames nor commit those of the burst. */
+internal void
+SwapWindowBurstFrames()
+{
+    LayoutTransaction.Frames.swap(WindowBurst.Frames);
+    LayoutTransaction.Pending.swap(WindowBurst.Pending);
+    std::swap(LayoutTransaction.Coalesced, WindowBurst.Coalesced);
+}
+
+/* NOTE(koekeishiya): Ends the burst, applying the frames of every window that was inserted
+ * or moved during it in a single pass. */
+void FlushWindowBurst()
+{
+    if(WindowBurst.Windows == 0)
+        return;
+
+    AXLibCancelEvent(WindowBurst.Timer);
+    WindowBurst.Timer = 0;
+
+    SwapWindowBurstFrames();
+    BeginLayoutTransaction();
+    layout_commit Commit = CommitLayoutTransaction();
+    ++WindowBurst.Bursts;
+    WindowBurst.LastWindows = WindowBurst.Windows;
+    WindowBurst.LastWrites = Commit.Writes;
+    WindowBurst.TotalWindows += WindowBurst.Windows;
+    WindowBurst.TotalWrites += Commit.Writes;
+    WindowBurst.Windows = 0;
+
+    DEBUG("FlushWindowBurst() " << WindowBurst.LastWindows << " windows, " <<
+          Commit.Writes << " AX writes issued");
+}
+
+EVENT_CALLBACK(Callback_KWMEvent_FlushWindowBurst)
+{
+    FlushWindowBurst();
+}
+
+/* NOTE(koekeishiya): Called for every created window, before the window rules are applied,
+ * and paired with EndWindowInsertion. A window that is created within WINDOW_BURST_DELAY ms
+ * of the previous one starts a burst, so a single window is still tiled right away. The tree
+ * is updated for every window as it arrives, exactly as it would be outside of a burst, and
+ * only the frames recorded between the two calls are deferred. The burst ends once no window
+ * has been created for WINDOW_BURST_DELAY ms, or after it has been open for
+ * WINDOW_BURST_MAX_DURATION ms. */
+void BeginWindowInsertion()
+{
+    uint64_t Now = AXLibGetHandlerTimestamp();
+    uint64_t Delay = (uint64_t) WINDOW_BURST_DELAY * 1000000;
+    uint64_t MaxDuration = (uint64_t) WINDOW_BURST_MAX_DURATION * 1000000;
+
+    if(WindowBurst.Windows != 0 && Now - WindowBurst.Start >= MaxDuration)
+        FlushWindowBurst();
+
+    if(WindowBurst.Windows != 0)
+    {
+        ++WindowBurst.Windows;
+        if(!AXLibRescheduleEvent(WindowBurst.Timer, WINDOW_BURST_DELAY))
+            AXLibConstructTimerEvent(KWMEvent_FlushWindowBurst, AXLibEmptyPayload(), false, WINDOW_BURST_DELAY, 0, WindowBurst.Timer);
+    }
+    else if(WindowBurst.LastCreated != 0 && Now - WindowBurst.LastCreated < Delay)
+    {
+        WindowBurst.Start = Now;
+        WindowBurst.Windows = 1;
+        AXLibConstructTimerEvent(KWMEvent_FlushWindowBurst, AXLibEmptyPayload(), false, WINDOW_BURST_DELAY, 0, WindowBurst.Timer);
+    }
+
+    WindowBurst.LastCreated = Now;
+    if(WindowBurst.Windows != 0)
+    {
+        SwapWindowBurstFrames();
+        BeginLayoutTransaction();
+        WindowBurst.Inserting = true;
+    }
+}
+
+void EndWindowInsertion()
+{
+    if(!WindowBurst.Inserting)
+        return;
+
+    WindowBurst.Inserting = false;
+    --LayoutTransaction.Depth;
+    SwapWindowBurstFrames();
+}
+
+/* NOTE(koekeishiya): Called when a window is resized outside of an insertion while a burst
+ * is open. The deferred frame of that window is older, so it must not be applied later. */
+void ForgetWindowBurstFrame(uint32_t WindowID)
+{
+    if(WindowBurst.Inserting || WindowBurst.Windows == 0)
+        return;
+
+    std::unordered_map<uint32_t, std::size_t>::iterator It = WindowBurst.Pending.find(WindowID);
+    if(It != WindowBurst.Pending.end())
+    {
+        WindowBurst.Frames[It->second].WindowID = 0;
+        WindowBurst.Pending.erase(It);
+    }
+}
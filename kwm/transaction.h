@@ -0,0 +1,17 @@
+#ifndef TRANSACTION_H
+#define TRANSACTION_H
+
+#include "types.h"
+
+void BeginLayoutTransaction();
+layout_commit CommitLayoutTransaction();
+bool IsLayoutTransactionActive();
+void RecordLayoutFrame(uint32_t WindowID, node_container *Container);
+void ForgetAppliedLayoutFrame(uint32_t WindowID);
+
+void BeginWindowInsertion();
+void EndWindowInsertion();
+void ForgetWindowBurstFrame(uint32_t WindowID);
+void FlushWindowBurst();
+
+#endif
@@ -7,6 +7,8 @@
 #include "window.h"
 #include "border.h"
 #include "cursor.h"
+#include "transaction.h"
+#include "history.h"
 #include "../axlib/axlib.h"
 
 #define internal static
@@ -44,15 +46,28 @@ CreateBSPTree(tree_node *RootNode, ax_display *Display, std::vector<uint32_t> *W
 
     if(!Windows.empty())
     {
-        tree_node *Root = RootNode;
-        Root->WindowID = Windows[0];
+        space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
+        RootNode->WindowID = Windows[0];
+        IndexTreeNode(SpaceInfo, RootNode);
+
+        /* NOTE(koekeishiya): The leafs of a tree built this way are, in breadth-first order,
+         * exactly the contents of a FIFO queue: the first min-depth leaf is always at the
+         * front, and the two leafs created by splitting it belong at the back. This gives the
+         * same tree as calling FindFirstMinDepthLeafNode for every window, in O(n). */
+        std::vector<tree_node *> Leafs;
+        Leafs.reserve(Windows.size() * 2);
+        Leafs.push_back(RootNode);
+
+        std::size_t Front = 0;
         for(std::size_t Index = 1; Index < Windows.size(); ++Index)
         {
-            Root = FindFirstMinDepthLeafNode(RootNode);
-            Assert(Root != NULL);
+            tree_node *Root = Leafs[Front++];
+            Assert(IsLeafNode(Root));
 
             DEBUG("CreateBSPTree() Create pair of leafs");
             CreateLeafNodePair(Display, Root, Root->WindowID, Windows[Index], GetOptimalSplitMode(Root));
+            Leafs.push_back(Root->LeftChild);
+            Leafs.push_back(Root->RightChild);
         }
 
         Result = true;
@@ -69,18 +84,21 @@ CreateMonocleTree(tree_node *RootNode, ax_display *Display, std::vector<uint32_t
 
     if(!Windows.empty())
     {
+        space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
         tree_node *Root = RootNode;
-        Root->List = CreateLinkNode();
+        Root->List = CreateLinkNode(SpaceInfo);
 
         SetLinkNodeContainer(Display, Root->List);
         Root->List->WindowID = Windows[0];
+        IndexLinkNode(SpaceInfo, Root, Root->List);
 
         link_node *Link = Root->List;
         for(std::size_t Index = 1; Index < Windows.size(); ++Index)
         {
-            link_node *Next = CreateLinkNode();
+            link_node *Next = CreateLinkNode(SpaceInfo);
             SetLinkNodeContainer(Display, Next);
             Next->WindowID = Windows[Index];
+            IndexLinkNode(SpaceInfo, Root, Next);
 
             Link->Next = Next;
             Next->Prev = Link;
@@ -95,11 +113,11 @@ CreateMonocleTree(tree_node *RootNode, ax_display *Display, std::vector<uint32_t
 
 tree_node *CreateTreeFromWindowIDList(ax_display *Display, std::vector<uint32_t> *Windows)
 {
-    tree_node *RootNode = CreateRootNode();
+    space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
+    tree_node *RootNode = CreateRootNode(SpaceInfo);
     SetRootNodeContainer(Display, RootNode);
     bool Result = false;
 
-    space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
     if(SpaceInfo->Settings.Mode == SpaceModeBSP)
         Result = CreateBSPTree(RootNode, Display, Windows);
     else if(SpaceInfo->Settings.Mode == SpaceModeMonocle)
@@ -107,7 +125,7 @@ tree_node *CreateTreeFromWindowIDList(ax_display *Display, std::vector<uint32_t>
 
     if(!Result)
     {
-        free(RootNode);
+        FreeTreeNode(SpaceInfo, RootNode);
         RootNode = NULL;
     }
 
@@ -122,76 +140,58 @@ tree_node *GetNearestLeafNodeNeighbour(tree_node *Node)
     return NULL;
 }
 
-/* NOTE(koekeishiya): This function can probably be optimized by checking
- * containers in a Root->Child approach, rather than iterating through
- * every leaf node. */
+internal inline bool
+IsPointInsideNodeContainer(tree_node *Node, CGPoint *Point)
+{
+    return Point->x >= Node->Container.X &&
+           Point->x <= Node->Container.X + Node->Container.Width &&
+           Point->y >= Node->Container.Y &&
+           Point->y <= Node->Container.Y + Node->Container.Height;
+}
+
+/* NOTE(koekeishiya): Descend from the given node into the child whose container holds the
+ * point, left child first. A leaf is always inside the containers of its ancestors, so this
+ * finds the same leaf as scanning the leaves from left to right. The right child is only
+ * tried when the point is in the left container but not in any of its leaves, which can
+ * only happen on a shared edge or inside a gap. */
 tree_node *GetTreeNodeForPoint(tree_node *Node, CGPoint *Point)
 {
-    if(Node)
-    {
-        tree_node *CurrentNode = NULL;
-        GetFirstLeafNode(Node, (void**)&CurrentNode);
-        while(CurrentNode)
-        {
-            if(Point->x >= CurrentNode->Container.X &&
-               Point->x <= CurrentNode->Container.X + CurrentNode->Container.Width &&
-               Point->y >= CurrentNode->Container.Y &&
-               Point->y <= CurrentNode->Container.Y + CurrentNode->Container.Height)
-                return CurrentNode;
+    if(!Node || !IsPointInsideNodeContainer(Node, Point))
+        return NULL;
 
-            CurrentNode = GetNearestTreeNodeToTheRight(CurrentNode);
-        }
-    }
+    if(IsLeafNode(Node))
+        return Node;
 
-    return NULL;
+    tree_node *Result = GetTreeNodeForPoint(Node->LeftChild, Point);
+    if(!Result)
+        Result = GetTreeNodeForPoint(Node->RightChild, Point);
+
+    return Result;
 }
 
-tree_node *GetTreeNodeFromWindowID(tree_node *Node, uint32_t WindowID)
+tree_node *GetTreeNodeFromWindowID(space_info *SpaceInfo, uint32_t WindowID)
 {
-    if(Node)
-    {
-        tree_node *CurrentNode = NULL;
-        GetFirstLeafNode(Node, (void**)&CurrentNode);
-        while(CurrentNode)
-        {
-            if(CurrentNode->WindowID == WindowID)
-                return CurrentNode;
-
-            CurrentNode = GetNearestTreeNodeToTheRight(CurrentNode);
-        }
-    }
+    std::unordered_map<uint32_t, node_index_entry>::iterator It = SpaceInfo->WindowIndex.find(WindowID);
+    if(It != SpaceInfo->WindowIndex.end() && !It->second.Link)
+        return It->second.Node;
 
     return NULL;
 }
 
-tree_node *GetTreeNodeFromWindowIDOrLinkNode(tree_node *Node, uint32_t WindowID)
+tree_node *GetTreeNodeFromWindowIDOrLinkNode(space_info *SpaceInfo, uint32_t WindowID)
 {
-    tree_node *Result = NULL;
-    Result = GetTreeNodeFromWindowID(Node, WindowID);
-    if(!Result)
-    {
-        link_node *Link = GetLinkNodeFromWindowID(Node, WindowID);
-        Result = GetTreeNodeFromLink(Node, Link);
-    }
+    std::unordered_map<uint32_t, node_index_entry>::iterator It = SpaceInfo->WindowIndex.find(WindowID);
+    if(It != SpaceInfo->WindowIndex.end())
+        return It->second.Node;
 
-    return Result;
+    return NULL;
 }
 
-link_node *GetLinkNodeFromWindowID(tree_node *Root, uint32_t WindowID)
+link_node *GetLinkNodeFromWindowID(space_info *SpaceInfo, uint32_t WindowID)
 {
-    if(Root)
-    {
-        tree_node *Node = NULL;
-        GetFirstLeafNode(Root, (void**)&Node);
-        while(Node)
-        {
-            link_node *Link = GetLinkNodeFromTree(Node, WindowID);
-            if(Link)
-                return Link;
-
-            Node = GetNearestTreeNodeToTheRight(Node);
-        }
-    }
+    std::unordered_map<uint32_t, node_index_entry>::iterator It = SpaceInfo->WindowIndex.find(WindowID);
+    if(It != SpaceInfo->WindowIndex.end())
+        return It->second.Link;
 
     return NULL;
 }
@@ -213,22 +213,74 @@ link_node *GetLinkNodeFromTree(tree_node *Root, uint32_t WindowID)
     return NULL;
 }
 
-tree_node *GetTreeNodeFromLink(tree_node *Root, link_node *Link)
+tree_node *GetTreeNodeFromLink(space_info *SpaceInfo, link_node *Link)
+{
+    if(Link)
+    {
+        std::unordered_map<uint32_t, node_index_entry>::iterator It = SpaceInfo->WindowIndex.find(Link->WindowID);
+        if(It != SpaceInfo->WindowIndex.end() && It->second.Link == Link)
+            return It->second.Node;
+    }
+
+    return NULL;
+}
+
+/* NOTE(koekeishiya): The WindowIndex of a space maps the id of every tiled window to the
+ * leaf that holds it, or to the link and the tree-node that owns the link. Every function
+ * that changes the WindowID or the List of a leaf must keep the index up to date. */
+void IndexLinkNode(space_info *SpaceInfo, tree_node *Owner, link_node *Link)
+{
+    if(Owner && Link && Link->WindowID != 0)
+    {
+        node_index_entry Entry = { Owner, Link };
+        SpaceInfo->WindowIndex[Link->WindowID] = Entry;
+    }
+}
+
+void UnindexLinkNode(space_info *SpaceInfo, link_node *Link)
+{
+    if(Link)
+    {
+        std::unordered_map<uint32_t, node_index_entry>::iterator It = SpaceInfo->WindowIndex.find(Link->WindowID);
+        if(It != SpaceInfo->WindowIndex.end() && It->second.Link == Link)
+            SpaceInfo->WindowIndex.erase(It);
+    }
+}
+
+void IndexTreeNode(space_info *SpaceInfo, tree_node *Node)
 {
-    if(Root && Link)
+    if(Node && IsLeafNode(Node))
     {
-        tree_node *Node = NULL;
-        GetFirstLeafNode(Root, (void**)&Node);
-        while(Node)
+        if(Node->WindowID != 0)
         {
-            if(GetLinkNodeFromTree(Node, Link->WindowID) == Link)
-                return Node;
+            node_index_entry Entry = { Node, NULL };
+            SpaceInfo->WindowIndex[Node->WindowID] = Entry;
+        }
 
-            Node = GetNearestTreeNodeToTheRight(Node);
+        link_node *Link = Node->List;
+        while(Link)
+        {
+            IndexLinkNode(SpaceInfo, Node, Link);
+            Link = Link->Next;
         }
     }
+}
 
-    return NULL;
+void UnindexTreeNode(space_info *SpaceInfo, tree_node *Node)
+{
+    if(Node)
+    {
+        std::unordered_map<uint32_t, node_index_entry>::iterator It = SpaceInfo->WindowIndex.find(Node->WindowID);
+        if(It != SpaceInfo->WindowIndex.end() && It->second.Node == Node && !It->second.Link)
+            SpaceInfo->WindowIndex.erase(It);
+
+        link_node *Link = Node->List;
+        while(Link)
+        {
+            UnindexLinkNode(SpaceInfo, Link);
+            Link = Link->Next;
+        }
+    }
 }
 
 tree_node *GetNearestTreeNodeToTheLeft(tree_node *Node)
@@ -389,7 +441,8 @@ void ApplyLinkNodeContainer(link_node *Link)
     }
 }
 
-void ApplyTreeNodeContainer(tree_node *Node)
+internal void
+RecordTreeNodeContainer(tree_node *Node)
 {
     if(Node)
     {
@@ -399,45 +452,68 @@ void ApplyTreeNodeContainer(tree_node *Node)
         if(Node->List)
             ApplyLinkNodeContainer(Node->List);
 
+        Node->Dirty &= ~(NodeDirty_Geometry | NodeDirty_GeometryBelow);
         if(Node->LeftChild)
-            ApplyTreeNodeContainer(Node->LeftChild);
+            RecordTreeNodeContainer(Node->LeftChild);
 
         if(Node->RightChild)
-            ApplyTreeNodeContainer(Node->RightChild);
+            RecordTreeNodeContainer(Node->RightChild);
     }
 }
 
-internal void
-DestroyLinkList(link_node *Link)
+void ApplyTreeNodeContainer(tree_node *Node)
 {
-    if(Link)
-    {
-        if(Link->Next)
-            DestroyLinkList(Link->Next);
-
-        free(Link);
-        Link = NULL;
-    }
+    BeginLayoutTransaction();
+    RecordTreeNodeContainer(Node);
+    ClearDirtyNodeAncestors(Node, NodeDirty_Geometry, NodeDirty_GeometryBelow);
+    CommitLayoutTransaction();
 }
 
-void DestroyNodeTree(tree_node *Node)
+/* NOTE(koekeishiya): Only resizes windows of nodes whose container changed since they were
+ * last applied, and only descends into subtrees that contain such a node. */
+internal void
+RecordDirtyNodeContainers(tree_node *Node)
 {
     if(Node)
     {
-        if(Node->List)
-            DestroyLinkList(Node->List);
+        if(Node->Dirty & NodeDirty_Geometry)
+        {
+            if(Node->WindowID != 0)
+                ResizeWindowToContainerSize(Node);
 
-        if(Node->LeftChild)
-            DestroyNodeTree(Node->LeftChild);
+            if(Node->List)
+                ApplyLinkNodeContainer(Node->List);
+        }
 
-        if(Node->RightChild)
-            DestroyNodeTree(Node->RightChild);
+        bool GeometryBelow = Node->Dirty & NodeDirty_GeometryBelow;
+        Node->Dirty &= ~(NodeDirty_Geometry | NodeDirty_GeometryBelow);
 
-        free(Node);
-        Node = NULL;
+        if(GeometryBelow)
+        {
+            RecordDirtyNodeContainers(Node->LeftChild);
+            RecordDirtyNodeContainers(Node->RightChild);
+        }
     }
 }
 
+void ApplyDirtyNodeContainers(tree_node *Node)
+{
+    BeginLayoutTransaction();
+    RecordDirtyNodeContainers(Node);
+    ClearDirtyNodeAncestors(Node, NodeDirty_Geometry, NodeDirty_GeometryBelow);
+    CommitLayoutTransaction();
+}
+
+/* NOTE(koekeishiya): All nodes of a space live in its arena, so rewinding the arena releases
+ * every node at once. The tree is only walked to drop the snapshots the nodes hold on to. */
+void DestroyNodeTree(space_info *SpaceInfo)
+{
+    ReleaseTreeNodeSnapshots(SpaceInfo->RootNode);
+    ResetNodeArena(SpaceInfo);
+    SpaceInfo->RootNode = NULL;
+    SpaceInfo->WindowIndex.clear();
+}
+
 internal void
 RotateTree(tree_node *Node, int Deg)
 {
@@ -513,6 +589,7 @@ void EqualizeBSPTree(std::string Op)
 void FillDeserializedTree(tree_node *RootNode, ax_display *Display, std::vector<uint32_t> *WindowsPtr)
 {
     std::vector<uint32_t> &Windows = *WindowsPtr;
+    space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
     tree_node *Current = NULL;
     GetFirstLeafNode(RootNode, (void**)&Current);
 
@@ -520,7 +597,10 @@ void FillDeserializedTree(tree_node *RootNode, ax_display *Display, std::vector<
     while(Current)
     {
         if(Counter < Windows.size())
+        {
             Current->WindowID = Windows[Counter++];
+            IndexTreeNode(SpaceInfo, Current);
+        }
 
         Current = GetNearestTreeNodeToTheRight(Current);
         ++Leafs;
@@ -541,7 +621,12 @@ void FillDeserializedTree(tree_node *RootNode, ax_display *Display, std::vector<
 
             DEBUG("FillDeserializedTree() Create pair of leafs");
             CreateLeafNodePair(Display, Root, Root->WindowID, Windows[Counter], GetOptimalSplitMode(Root));
-            Root = RootNode;
+
+            /* NOTE(koekeishiya): Splitting a leaf only changes the choice made at its parent,
+             * every node above it is still reached the same way. Continue from there instead
+             * of descending from the root again. */
+            if(Root->Parent)
+                Root = Root->Parent;
         }
     }
 }
@@ -11,11 +11,15 @@ void EqualizeBSPTree(std::string Op);
 tree_node * FindFirstMinDepthLeafNode(tree_node *Root);
 tree_node *GetNearestLeafNodeNeighbour(tree_node *Node);
 tree_node *GetTreeNodeForPoint(tree_node *Node, CGPoint *Point);
-tree_node *GetTreeNodeFromWindowID(tree_node *Node, uint32_t WindowID);
-tree_node *GetTreeNodeFromWindowIDOrLinkNode(tree_node *Node, uint32_t WindowID);
-link_node *GetLinkNodeFromWindowID(tree_node *Root, uint32_t WindowID);
+tree_node *GetTreeNodeFromWindowID(space_info *SpaceInfo, uint32_t WindowID);
+tree_node *GetTreeNodeFromWindowIDOrLinkNode(space_info *SpaceInfo, uint32_t WindowID);
+link_node *GetLinkNodeFromWindowID(space_info *SpaceInfo, uint32_t WindowID);
 link_node *GetLinkNodeFromTree(tree_node *Root, uint32_t WindowID);
-tree_node *GetTreeNodeFromLink(tree_node *Root, link_node *Link);
+tree_node *GetTreeNodeFromLink(space_info *SpaceInfo, link_node *Link);
+void IndexTreeNode(space_info *SpaceInfo, tree_node *Node);
+void UnindexTreeNode(space_info *SpaceInfo, tree_node *Node);
+void IndexLinkNode(space_info *SpaceInfo, tree_node *Owner, link_node *Link);
+void UnindexLinkNode(space_info *SpaceInfo, link_node *Link);
 tree_node *GetNearestTreeNodeToTheLeft(tree_node *Node);
 tree_node *GetNearestTreeNodeToTheRight(tree_node *Node);
 void GetFirstLeafNode(tree_node *Node, void **Result);
@@ -25,6 +29,7 @@ void FocusLastLeafNode(ax_display *Display);
 tree_node *GetFirstPseudoLeafNode(tree_node *Node);
 void ApplyLinkNodeContainer(link_node *Link);
 void ApplyTreeNodeContainer(tree_node *Node);
-void DestroyNodeTree(tree_node *Node);
+void ApplyDirtyNodeContainers(tree_node *Node);
+void DestroyNodeTree(space_info *SpaceInfo);
 
 #endif
@@ -8,6 +8,7 @@
 #include <queue>
 #include <stack>
 #include <map>
+#include <unordered_map>
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -23,6 +24,8 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include "../axlib/timer.h"
+
 struct space_identifier;
 struct color;
 struct modifier_keys;
@@ -34,7 +37,19 @@ struct window_rule;
 struct space_info;
 struct node_container;
 struct tree_node;
+struct link_node;
+struct node_index_entry;
+struct tree_snapshot;
+struct tree_history;
+struct state_snapshot;
+struct node_pool;
+struct node_arena;
+struct layout_frame;
+struct layout_commit;
+struct layout_transaction;
+struct window_burst;
 struct scratchpad;
+struct published_state;
 
 struct kwm_mach;
 struct kwm_border;
@@ -95,6 +110,14 @@ enum container_type
     CONTAINER_LOWER = 4
 };
 
+enum node_dirty_flag
+{
+    NodeDirty_Split = (1 << 0),
+    NodeDirty_Geometry = (1 << 1),
+    NodeDirty_SplitBelow = (1 << 2),
+    NodeDirty_GeometryBelow = (1 << 3),
+};
+
 enum node_type
 {
     NodeTypeTree,
@@ -168,6 +191,122 @@ struct tree_node
 
     split_type SplitMode;
     double SplitRatio;
+
+    uint32_t Depth;
+    uint32_t Dirty;
+
+    tree_snapshot *Snapshot;
+};
+
+/* NOTE(koekeishiya): Immutable, reference counted copy of a bsp-tree node. Consecutive
+ * versions share every subtree that did not change between them. The Snapshot member of
+ * a tree_node caches the snapshot it was last captured as, and owns a reference to it. */
+#define TREE_HISTORY_LIMIT 32
+struct tree_snapshot
+{
+    int RefCount;
+
+    uint32_t WindowID;
+    node_type Type;
+    split_type SplitMode;
+    double SplitRatio;
+    std::vector<uint32_t> Links;
+
+    tree_snapshot *LeftChild;
+    tree_snapshot *RightChild;
+};
+
+struct tree_history
+{
+    std::vector<tree_snapshot *> Versions;
+    std::size_t Current;
+};
+
+/* NOTE(koekeishiya): Immutable copy of the state that queries read, published by the event
+ * loop after every batch of events and read by the daemon thread. Answers holds the reply to
+ * every query that can be answered from it, keyed by the query. Tree is the bsp-tree of the
+ * active space. Commands is the number of daemon commands handled when it was taken. */
+struct state_snapshot
+{
+    uint64_t Commands;
+    tree_snapshot *Tree;
+    std::map<std::string, std::string> Answers;
+};
+
+struct node_index_entry
+{
+    tree_node *Node;
+    link_node *Link;
+};
+
+#define NODE_ARENA_CHUNK_SIZE 64
+struct node_pool
+{
+    std::vector<char *> Chunks;
+    std::size_t Chunk, Offset;
+    void *FreeList;
+
+    uint32_t Live;
+    uint32_t Peak;
+};
+
+struct node_arena
+{
+    node_pool Trees;
+    node_pool Links;
+
+    uint64_t Allocations;
+    uint64_t Releases;
+    uint32_t Resets;
+};
+
+struct layout_frame
+{
+    uint32_t WindowID;
+    int X, Y;
+    int Width, Height;
+};
+
+struct layout_commit
+{
+    uint32_t Frames;
+    uint32_t Writes;
+    uint32_t Skipped;
+};
+
+struct layout_transaction
+{
+    int Depth;
+    std::vector<layout_frame> Frames;
+    std::unordered_map<uint32_t, std::size_t> Pending;
+    std::unordered_map<uint32_t, layout_frame> Applied;
+    uint32_t Coalesced;
+
+    uint64_t Commits;
+    uint64_t Writes;
+    uint64_t Skipped;
+};
+
+/* NOTE(koekeishiya): Windows created in quick succession are inserted into the tree as they
+ * arrive. The frames recorded while a window is inserted are kept aside in Frames, and are
+ * applied in one layout transaction when the burst ends. */
+struct window_burst
+{
+    ax_timer_id Timer;
+    uint64_t Start;
+    uint64_t LastCreated;
+    uint32_t Windows;
+    bool Inserting;
+
+    std::vector<layout_frame> Frames;
+    std::unordered_map<uint32_t, std::size_t> Pending;
+    uint32_t Coalesced;
+
+    uint64_t Bursts;
+    uint32_t LastWindows;
+    uint32_t LastWrites;
+    uint64_t TotalWindows;
+    uint64_t TotalWrites;
 };
 
 struct window_properties
@@ -196,6 +335,28 @@ struct scratchpad
     int LastFocus;
 };
 
+enum subscription_topic
+{
+    Topic_Focus = (1 << 0),
+    Topic_Space = (1 << 1),
+    Topic_Mode = (1 << 2),
+    Topic_Window = (1 << 3),
+    Topic_Tree = (1 << 4),
+    Topic_Scratchpad = (1 << 5),
+};
+
+/* NOTE(koekeishiya): The notification that was last published for every topic that describes
+ * state, so that a change is only published once. The tree is kept as a hash of its shape. */
+struct published_state
+{
+    std::string Focus;
+    std::string Space;
+    std::string Mode;
+    std::string Scratchpad;
+    std::string Tree;
+    uint64_t TreeHash;
+};
+
 struct space_settings
 {
     container_offset Offset;
@@ -212,6 +373,9 @@ struct space_info
     bool Initialized;
 
     tree_node *RootNode;
+    node_arena Arena;
+    tree_history History;
+    std::unordered_map<uint32_t, node_index_entry> WindowIndex;
 };
 
 struct kwm_mach
@@ -241,6 +405,10 @@ struct kwm_path
     std::string Home;
     std::string Include;
     std::string Layouts;
+
+    std::string Record;
+    std::string EventLog;
+    std::string Socket;
 };
 
 struct kwm_settings
@@ -270,6 +438,7 @@ enum kwm_toggleable
     Settings_LockToContainer = (1 << 5),
     Settings_MouseDrag = (1 << 6),
     Settings_FloatNextWindow = (1 << 7),
+    Settings_DaemonTCP = (1 << 8),
 };
 
 inline void
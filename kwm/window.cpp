@@ -10,6 +10,9 @@
 #include "serializer.h"
 #include "cursor.h"
 #include "scratchpad.h"
+#include "transaction.h"
+#include "subscription.h"
+#include "history.h"
 #include "../axlib/axlib.h"
 
 #include <cmath>
@@ -104,6 +107,7 @@ TileWindow(ax_display *Display, ax_window *Window)
            (!AXLibStickyWindow(Window)))
         {
             AddWindowToNodeTree(Display, Window->ID);
+            AXLibRecordApplicationTiled(Window->Application);
         }
     }
 }
@@ -115,7 +119,7 @@ ClearBorderIfFullscreenSpace(ax_display *Display)
         ClearBorder(&FocusedBorder);
 }
 
-/* TODO(koekeishiya): Event context is a pointer to the new display. */
+/* TODO(koekeishiya): Event payload is a pointer to the new display. */
 EVENT_CALLBACK(Callback_AXEvent_DisplayAdded)
 {
     DEBUG("AXEvent_DisplayAdded");
@@ -141,23 +145,23 @@ ResizeDisplay(ax_display *Display)
     }
 }
 
-/* NOTE(koekeishiya): Event context is a pointer to the resized display. */
+/* NOTE(koekeishiya): Event payload is a pointer to the resized display. */
 EVENT_CALLBACK(Callback_AXEvent_DisplayResized)
 {
-    ax_display *Display = (ax_display *) Event->Context;
+    ax_display *Display = Event->Payload.Display;
     DEBUG("AXEvent_DisplayResized");
     ResizeDisplay(Display);
 }
 
-/* NOTE(koekeishiya): Event context is a pointer to the moved display. */
+/* NOTE(koekeishiya): Event payload is a pointer to the moved display. */
 EVENT_CALLBACK(Callback_AXEvent_DisplayMoved)
 {
-    ax_display *Display = (ax_display *) Event->Context;
+    ax_display *Display = Event->Payload.Display;
     DEBUG("AXEvent_DisplayMoved");
     ResizeDisplay(Display);
 }
 
-/* NOTE(koekeishiya): Event context is NULL. */
+/* NOTE(koekeishiya): Event has no payload. */
 EVENT_CALLBACK(Callback_AXEvent_DisplayChanged)
 {
     ax_display *CurrentDisplay = AXLibMainDisplay();
@@ -180,10 +184,10 @@ EVENT_CALLBACK(Callback_AXEvent_DisplayChanged)
     }
 }
 
-/* NOTE(koekeishiya): Event context is a pointer to the display whos space was changed. */
+/* NOTE(koekeishiya): Event payload is a pointer to the display whos space was changed. */
 EVENT_CALLBACK(Callback_AXEvent_SpaceChanged)
 {
-    ax_display *Display = (ax_display *) Event->Context;
+    ax_display *Display = Event->Payload.Display;
     DEBUG("AXEvent_SpaceChanged");
 
     /* TODO(koekeishiya): Do we want to reset this flag if a space transition occurs ?
@@ -247,12 +251,10 @@ EVENT_CALLBACK(Callback_AXEvent_SpaceChanged)
     ClearBorderIfFullscreenSpace(Display);
 }
 
-/* NOTE(koekeishiya): Event context is a pointer to the PID of the launched application. */
+/* NOTE(koekeishiya): Event payload is the PID of the launched application. */
 EVENT_CALLBACK(Callback_AXEvent_ApplicationLaunched)
 {
-    pid_t *ApplicationPID = (pid_t *) Event->Context;
-    ax_application *Application = AXLibGetApplicationByPID(*ApplicationPID);
-    free(ApplicationPID);
+    ax_application *Application = AXLibGetApplicationByPID(Event->Payload.PID);
 
     if(Application)
     {
@@ -273,12 +275,10 @@ EVENT_CALLBACK(Callback_AXEvent_ApplicationLaunched)
     }
 }
 
-/* NOTE(koekeishiya): Event context is a pointer to the PID of the application. */
+/* NOTE(koekeishiya): Event payload is the PID of the application. */
 EVENT_CALLBACK(Callback_AXEvent_ApplicationHidden)
 {
-    pid_t *ApplicationPID = (pid_t *) Event->Context;
-    ax_application *Application = AXLibGetApplicationByPID(*ApplicationPID);
-    free(ApplicationPID);
+    ax_application *Application = AXLibGetApplicationByPID(Event->Payload.PID);
 
     if(Application)
     {
@@ -295,12 +295,10 @@ EVENT_CALLBACK(Callback_AXEvent_ApplicationHidden)
     }
 }
 
-/* NOTE(koekeishiya): Event context is a pointer to the PID of the application. */
+/* NOTE(koekeishiya): Event payload is the PID of the application. */
 EVENT_CALLBACK(Callback_AXEvent_ApplicationVisible)
 {
-    pid_t *ApplicationPID = (pid_t *) Event->Context;
-    ax_application *Application = AXLibGetApplicationByPID(*ApplicationPID);
-    free(ApplicationPID);
+    ax_application *Application = AXLibGetApplicationByPID(Event->Payload.PID);
 
     if(Application)
     {
@@ -317,12 +315,10 @@ EVENT_CALLBACK(Callback_AXEvent_ApplicationVisible)
     }
 }
 
-/* NOTE(koekeishiya): Event context is NULL */
+/* NOTE(koekeishiya): Event has no payload */
 EVENT_CALLBACK(Callback_AXEvent_ApplicationTerminated)
 {
-    pid_t *ApplicationPID = (pid_t *) Event->Context;
-    ax_application *Application = AXLibGetApplicationByPID(*ApplicationPID);
-    free(ApplicationPID);
+    ax_application *Application = AXLibGetApplicationByPID(Event->Payload.PID);
 
     if(Application)
     {
@@ -345,12 +341,10 @@ EVENT_CALLBACK(Callback_AXEvent_ApplicationTerminated)
     }
 }
 
-/* NOTE(koekeishiya): Event context is a pointer to the PID of the activated application. */
+/* NOTE(koekeishiya): Event payload is the PID of the activated application. */
 EVENT_CALLBACK(Callback_AXEvent_ApplicationActivated)
 {
-    pid_t *ApplicationPID = (pid_t *) Event->Context;
-    ax_application *Application = AXLibGetApplicationByPID(*ApplicationPID);
-    free(ApplicationPID);
+    ax_application *Application = AXLibGetApplicationByPID(Event->Payload.PID);
 
     if(Application)
     {
@@ -370,12 +364,10 @@ EVENT_CALLBACK(Callback_AXEvent_ApplicationActivated)
     }
 }
 
-/* NOTE(koekeishiya): Event context is a pointer to the CGWindowID of the new window. */
+/* NOTE(koekeishiya): Event payload is the CGWindowID of the new window. */
 EVENT_CALLBACK(Callback_AXEvent_WindowCreated)
 {
-    uint32_t *WindowID = (uint32_t *) Event->Context;
-    ax_window *Window = GetWindowByID(*WindowID);
-    free(WindowID);
+    ax_window *Window = GetWindowByID(Event->Payload.WindowID);
 
     if(Window)
     {
@@ -384,28 +376,29 @@ EVENT_CALLBACK(Callback_AXEvent_WindowCreated)
         else
             DEBUG("AXEvent_WindowCreated: " << Window->Application->Name << " - [Unknown]");
 
-        if(ApplyWindowRules(Window))
-            return;
-
-        ax_display *Display = AXLibCursorDisplay();
-        if(Display)
+        PublishWindowChange("created", Window);
+        BeginWindowInsertion();
+        if(!ApplyWindowRules(Window))
         {
-            FloatNonResizable(Window);
-            if(!FloatNextWindow(Display, Window))
+            ax_display *Display = AXLibCursorDisplay();
+            if(Display)
             {
-                TileWindow(Display, Window);
+                FloatNonResizable(Window);
+                if(!FloatNextWindow(Display, Window))
+                {
+                    TileWindow(Display, Window);
+                }
             }
         }
+        EndWindowInsertion();
     }
 }
 
-/* NOTE(koekeishiya): Event context is a pointer to the CGWindowID of the closed window.
+/* NOTE(koekeishiya): Event payload is the CGWindowID of the closed window.
                       Must call AXLibRemoveApplicationWindow() and AXLibDestroyWindow() */
 EVENT_CALLBACK(Callback_AXEvent_WindowDestroyed)
 {
-    uint32_t *WindowID = (uint32_t *) Event->Context;
-    ax_window *Window = GetWindowByID(*WindowID);
-    free(WindowID);
+    ax_window *Window = GetWindowByID(Event->Payload.WindowID);
 
     if(Window)
     {
@@ -414,7 +407,9 @@ EVENT_CALLBACK(Callback_AXEvent_WindowDestroyed)
         else
             DEBUG("AXEvent_WindowDestroyed: " << Window->Application->Name << " - [Unknown]");
 
+        PublishWindowChange("destroyed", Window);
         ax_display *Display = AXLibWindowDisplay(Window);
+        ForgetAppliedLayoutFrame(Window->ID);
         RemoveWindowFromScratchpad(Window);
         RemoveWindowFromNodeTree(Display, Window->ID);
         RebalanceNodeTree(Display);
@@ -436,12 +431,10 @@ EVENT_CALLBACK(Callback_AXEvent_WindowDestroyed)
     }
 }
 
-/* NOTE(koekeishiya): Event context is a pointer to the CGWindowID of the minimized window. */
+/* NOTE(koekeishiya): Event payload is the CGWindowID of the minimized window. */
 EVENT_CALLBACK(Callback_AXEvent_WindowMinimized)
 {
-    uint32_t *WindowID = (uint32_t *) Event->Context;
-    ax_window *Window = GetWindowByID(*WindowID);
-    free(WindowID);
+    ax_window *Window = GetWindowByID(Event->Payload.WindowID);
 
     if(Window)
     {
@@ -459,12 +452,10 @@ EVENT_CALLBACK(Callback_AXEvent_WindowMinimized)
     }
 }
 
-/* NOTE(koekeishiya): Event context is a pointer to the CGWindowID of the deminimized window. */
+/* NOTE(koekeishiya): Event payload is the CGWindowID of the deminimized window. */
 EVENT_CALLBACK(Callback_AXEvent_WindowDeminimized)
 {
-    uint32_t *WindowID = (uint32_t *) Event->Context;
-    ax_window *Window = GetWindowByID(*WindowID);
-    free(WindowID);
+    ax_window *Window = GetWindowByID(Event->Payload.WindowID);
 
     if(Window)
     {
@@ -482,12 +473,10 @@ EVENT_CALLBACK(Callback_AXEvent_WindowDeminimized)
     }
 }
 
-/* NOTE(koekeishiya): Event context is a pointer to the CGWindowID of the focused window. */
+/* NOTE(koekeishiya): Event payload is the CGWindowID of the focused window. */
 EVENT_CALLBACK(Callback_AXEvent_WindowFocused)
 {
-    uint32_t *WindowID = (uint32_t *) Event->Context;
-    ax_window *Window = GetWindowByID(*WindowID);
-    free(WindowID);
+    ax_window *Window = GetWindowByID(Event->Payload.WindowID);
 
     if(Window)
     {
@@ -510,12 +499,10 @@ EVENT_CALLBACK(Callback_AXEvent_WindowFocused)
     }
 }
 
-/* NOTE(koekeishiya): Event context is a pointer to the CGWindowID of the moved window. */
+/* NOTE(koekeishiya): Event payload is the CGWindowID of the moved window. */
 EVENT_CALLBACK(Callback_AXEvent_WindowMoved)
 {
-    uint32_t *WindowID = (uint32_t *) Event->Context;
-    ax_window *Window = GetWindowByID(*WindowID);
-    free(WindowID);
+    ax_window *Window = GetWindowByID(Event->Payload.WindowID);
 
     if(Window)
     {
@@ -526,6 +513,7 @@ EVENT_CALLBACK(Callback_AXEvent_WindowMoved)
 
         if(!Event->Intrinsic)
         {
+            ForgetAppliedLayoutFrame(Window->ID);
             RemoveWindowFromOtherDisplays(Window);
             if(HasFlags(&KWMSettings, Settings_LockToContainer))
                 LockWindowToContainerSize(Window);
@@ -541,12 +529,10 @@ EVENT_CALLBACK(Callback_AXEvent_WindowMoved)
     }
 }
 
-/* NOTE(koekeishiya): Event context is a pointer to the CGWindowID of the resized window. */
+/* NOTE(koekeishiya): Event payload is the CGWindowID of the resized window. */
 EVENT_CALLBACK(Callback_AXEvent_WindowResized)
 {
-    uint32_t *WindowID = (uint32_t *) Event->Context;
-    ax_window *Window = GetWindowByID(*WindowID);
-    free(WindowID);
+    ax_window *Window = GetWindowByID(Event->Payload.WindowID);
 
     if(Window)
     {
@@ -555,8 +541,12 @@ EVENT_CALLBACK(Callback_AXEvent_WindowResized)
         else
             DEBUG("AXEvent_WindowResized: " << Window->Application->Name << " - [Unknown]");
 
-        if(!Event->Intrinsic && HasFlags(&KWMSettings, Settings_LockToContainer))
-            LockWindowToContainerSize(Window);
+        if(!Event->Intrinsic)
+        {
+            ForgetAppliedLayoutFrame(Window->ID);
+            if(HasFlags(&KWMSettings, Settings_LockToContainer))
+                LockWindowToContainerSize(Window);
+        }
 
         ax_display *Display = AXLibWindowDisplay(Window);
         if((FocusedApplication == Window->Application) &&
@@ -568,12 +558,10 @@ EVENT_CALLBACK(Callback_AXEvent_WindowResized)
     }
 }
 
-/* NOTE(koekeishiya): Event context is a pointer to the CGWindowID of the window. */
+/* NOTE(koekeishiya): Event payload is the CGWindowID of the window. */
 EVENT_CALLBACK(Callback_AXEvent_WindowTitleChanged)
 {
-    uint32_t *WindowID = (uint32_t *) Event->Context;
-    ax_window *Window = GetWindowByID(*WindowID);
-    free(WindowID);
+    ax_window *Window = GetWindowByID(Event->Payload.WindowID);
 
     if(Window)
     {
@@ -688,8 +676,8 @@ GetAllWindowIDSOnDisplay(ax_display *Display)
                 space_info *SpaceOfWindow = &WindowTree[DisplayOfWindow->Space->Identifier];
                 if(!SpaceOfWindow->Initialized ||
                    SpaceOfWindow->Settings.Mode == SpaceModeFloating ||
-                   GetTreeNodeFromWindowID(SpaceOfWindow->RootNode, Window->ID) ||
-                   GetLinkNodeFromWindowID(SpaceOfWindow->RootNode, Window->ID))
+                   GetTreeNodeFromWindowID(SpaceOfWindow, Window->ID) ||
+                   GetLinkNodeFromWindowID(SpaceOfWindow, Window->ID))
                     continue;
             }
 
@@ -705,8 +693,7 @@ GetAllWindowIDSOnDisplay(ax_display *Display)
 internal inline bool
 IsWindowInTree(space_info *SpaceInfo, uint32_t WindowID)
 {
-    std::vector<uint32_t> WindowIDs = GetAllWindowIDsInTree(SpaceInfo);
-    return std::find(WindowIDs.begin(), WindowIDs.end(), WindowID) != WindowIDs.end();
+    return SpaceInfo->WindowIndex.find(WindowID) != SpaceInfo->WindowIndex.end();
 }
 
 internal void
@@ -718,6 +705,7 @@ AddWindowToBSPTree(ax_display *Display, space_info *SpaceInfo, uint32_t WindowID
         tree_node *Insert = GetFirstPseudoLeafNode(SpaceInfo->RootNode);
         if(Insert && (Insert->WindowID = WindowID))
         {
+            IndexTreeNode(SpaceInfo, Insert);
             ApplyTreeNodeContainer(Insert);
             return;
         }
@@ -726,10 +714,10 @@ AddWindowToBSPTree(ax_display *Display, space_info *SpaceInfo, uint32_t WindowID
         ax_application *Application = FocusedApplication ? FocusedApplication : AXLibGetFocusedApplication();
         ax_window *Window = Application ? Application->Focus : NULL;
         if(MarkedWindow && MarkedWindow->ID != WindowID)
-            CurrentNode = GetTreeNodeFromWindowIDOrLinkNode(RootNode, MarkedWindow->ID);
+            CurrentNode = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo, MarkedWindow->ID);
 
         if(!CurrentNode && Window && Window->ID != WindowID)
-            CurrentNode = GetTreeNodeFromWindowIDOrLinkNode(RootNode, Window->ID);
+            CurrentNode = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo, Window->ID);
 
         if(!CurrentNode)
             CurrentNode = FindFirstMinDepthLeafNode(RootNode);
@@ -753,19 +741,21 @@ AddWindowToBSPTree(ax_display *Display, space_info *SpaceInfo, uint32_t WindowID
                     while(Link->Next)
                         Link = Link->Next;
 
-                    link_node *NewLink = CreateLinkNode();
+                    link_node *NewLink = CreateLinkNode(SpaceInfo);
                     NewLink->Container = CurrentNode->Container;
 
                     NewLink->WindowID = WindowID;
                     Link->Next = NewLink;
                     NewLink->Prev = Link;
+                    IndexLinkNode(SpaceInfo, CurrentNode, NewLink);
                     ResizeWindowToContainerSize(NewLink);
                 }
                 else
                 {
-                    CurrentNode->List = CreateLinkNode();
+                    CurrentNode->List = CreateLinkNode(SpaceInfo);
                     CurrentNode->List->Container = CurrentNode->Container;
                     CurrentNode->List->WindowID = WindowID;
+                    IndexLinkNode(SpaceInfo, CurrentNode, CurrentNode->List);
                     ResizeWindowToContainerSize(CurrentNode->List);
                 }
             }
@@ -787,9 +777,10 @@ RemoveWindowFromBSPTree(ax_display *Display, uint32_t WindowID)
     if(!SpaceInfo->RootNode)
         return;
 
-    tree_node *WindowNode = GetTreeNodeFromWindowID(SpaceInfo->RootNode, WindowID);
+    tree_node *WindowNode = GetTreeNodeFromWindowID(SpaceInfo, WindowID);
     if(WindowNode)
     {
+        UnindexTreeNode(SpaceInfo, WindowNode);
         if((SpaceInfo->RootNode != WindowNode) &&
            (SpaceInfo->RootNode->WindowID == WindowID))
             SpaceInfo->RootNode->WindowID = 0;
@@ -802,6 +793,7 @@ RemoveWindowFromBSPTree(ax_display *Display, uint32_t WindowID)
                SpaceInfo->RootNode->WindowID = 0;
 
             tree_node *AccessChild = IsRightChild(WindowNode) ? Parent->LeftChild : Parent->RightChild;
+            UnindexTreeNode(SpaceInfo, AccessChild);
             Parent->LeftChild = NULL;
             Parent->RightChild = NULL;
 
@@ -816,25 +808,27 @@ RemoveWindowFromBSPTree(ax_display *Display, uint32_t WindowID)
 
                 Parent->RightChild = AccessChild->RightChild;
                 Parent->RightChild->Parent = Parent;
+                SetNodeDepth(Parent->LeftChild, Parent->Depth + 1);
+                SetNodeDepth(Parent->RightChild, Parent->Depth + 1);
 
                 CreateNodeContainers(Display, Parent, true);
             }
 
+            IndexTreeNode(SpaceInfo, Parent);
             ResizeLinkNodeContainers(Parent);
             ApplyTreeNodeContainer(Parent);
-            free(AccessChild);
-            free(WindowNode);
+            FreeTreeNode(SpaceInfo, AccessChild);
+            FreeTreeNode(SpaceInfo, WindowNode);
         }
         else if(!Parent)
         {
-            free(SpaceInfo->RootNode);
-            SpaceInfo->RootNode = NULL;
+            DestroyNodeTree(SpaceInfo);
         }
     }
     else
     {
-        link_node *Link = GetLinkNodeFromWindowID(SpaceInfo->RootNode, WindowID);
-        tree_node *Root = GetTreeNodeFromLink(SpaceInfo->RootNode, Link);
+        link_node *Link = GetLinkNodeFromWindowID(SpaceInfo, WindowID);
+        tree_node *Root = GetTreeNodeFromLink(SpaceInfo, Link);
         if(Link)
         {
             if(SpaceInfo->RootNode->WindowID == WindowID)
@@ -858,7 +852,8 @@ RemoveWindowFromBSPTree(ax_display *Display, uint32_t WindowID)
             if(Link == Root->List)
                 Root->List = NULL;
 
-            free(Link);
+            UnindexLinkNode(SpaceInfo, Link);
+            FreeLinkNode(SpaceInfo, Link);
         }
     }
 }
@@ -872,12 +867,13 @@ AddWindowToMonocleTree(ax_display *Display, space_info *SpaceInfo, uint32_t Wind
         while(Link->Next)
             Link = Link->Next;
 
-        link_node *NewLink = CreateLinkNode();
+        link_node *NewLink = CreateLinkNode(SpaceInfo);
         SetLinkNodeContainer(Display, NewLink);
 
         NewLink->WindowID = WindowID;
         Link->Next = NewLink;
         NewLink->Prev = Link;
+        IndexLinkNode(SpaceInfo, SpaceInfo->RootNode, NewLink);
 
         ResizeWindowToContainerSize(NewLink);
     }
@@ -889,9 +885,10 @@ RemoveWindowFromMonocleTree(ax_display *Display, uint32_t WindowID)
     space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
     if(SpaceInfo->RootNode && SpaceInfo->RootNode->List)
     {
-        link_node *Link = GetLinkNodeFromTree(SpaceInfo->RootNode, WindowID);
+        link_node *Link = GetLinkNodeFromWindowID(SpaceInfo, WindowID);
         if(Link)
         {
+            UnindexLinkNode(SpaceInfo, Link);
             link_node *Prev = Link->Prev;
             link_node *Next = Link->Next;
 
@@ -907,11 +904,12 @@ RemoveWindowFromMonocleTree(ax_display *Display, uint32_t WindowID)
 
                 if(!SpaceInfo->RootNode->List)
                 {
-                    free(SpaceInfo->RootNode);
-                    SpaceInfo->RootNode = NULL;
+                    DestroyNodeTree(SpaceInfo);
+                    return;
                 }
             }
-            free(Link);
+
+            FreeLinkNode(SpaceInfo, Link);
         }
     }
 }
@@ -977,6 +975,7 @@ void LoadWindowNodeTree(ax_display *Display, std::string Layout)
             std::vector<uint32_t> Windows = GetAllWindowIDSOnDisplay(Display);
             if(LoadBSPTreeFromFile(Display, SpaceInfo, Layout))
             {
+                ClearTreeHistory(SpaceInfo);
                 FillDeserializedTree(SpaceInfo->RootNode, Display, &Windows);
                 ApplyTreeNodeContainer(SpaceInfo->RootNode);
             }
@@ -995,8 +994,8 @@ void ResetWindowNodeTree(ax_display *Display, space_tiling_option Mode)
         if(SpaceInfo->Settings.Mode == Mode)
             return;
 
-        DestroyNodeTree(SpaceInfo->RootNode);
-        SpaceInfo->RootNode = NULL;
+        DestroyNodeTree(SpaceInfo);
+        ClearTreeHistory(SpaceInfo);
         SpaceInfo->Initialized = true;
         SpaceInfo->Settings.Mode = Mode;
         CreateWindowNodeTree(Display);
@@ -1130,12 +1129,13 @@ void AddWindowToInactiveNodeTree(ax_display *Display, uint32_t WindowID)
         while(Link->Next)
             Link = Link->Next;
 
-        link_node *NewLink = CreateLinkNode();
+        link_node *NewLink = CreateLinkNode(SpaceInfo);
         SetLinkNodeContainer(Display, NewLink);
 
         NewLink->WindowID = WindowID;
         Link->Next = NewLink;
         NewLink->Prev = Link;
+        IndexLinkNode(SpaceInfo, SpaceInfo->RootNode, NewLink);
         ResizeWindowToContainerSize(NewLink);
     }
 }
@@ -1187,7 +1187,7 @@ void ToggleFocusedWindowParentContainer()
     if(Space->Settings.Mode != SpaceModeBSP)
         return;
 
-    tree_node *Node = GetTreeNodeFromWindowID(Space->RootNode, Window->ID);
+    tree_node *Node = GetTreeNodeFromWindowID(Space, Window->ID);
     if(Node && Node->Parent)
     {
         if(IsLeafNode(Node) && Node->Parent->WindowID == 0)
@@ -1220,7 +1220,7 @@ void ToggleFocusedWindowFullscreen()
     tree_node *Node = NULL;
     if(Space->RootNode->WindowID == 0)
     {
-        Node = GetTreeNodeFromWindowID(Space->RootNode, Window->ID);
+        Node = GetTreeNodeFromWindowID(Space, Window->ID);
         if(Node)
         {
             DEBUG("ToggleFocusedWindowFullscreen() Set fullscreen");
@@ -1232,7 +1232,7 @@ void ToggleFocusedWindowFullscreen()
     {
         DEBUG("ToggleFocusedWindowFullscreen() Restore old size");
         Space->RootNode->WindowID = 0;
-        Node = GetTreeNodeFromWindowID(Space->RootNode, Window->ID);
+        Node = GetTreeNodeFromWindowID(Space, Window->ID);
         if(Node)
         {
             ResizeWindowToContainerSize(Node);
@@ -1253,7 +1253,7 @@ bool IsWindowParentContainer(ax_window *Window)
     ax_display *Display = AXLibWindowDisplay(Window);
     space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
 
-    tree_node *Node = GetTreeNodeFromWindowID(SpaceInfo->RootNode, Window->ID);
+    tree_node *Node = GetTreeNodeFromWindowID(SpaceInfo, Window->ID);
     return Node && Node->Parent && Node->Parent->WindowID == Window->ID;
 }
 
@@ -1264,7 +1264,7 @@ void LockWindowToContainerSize(ax_window *Window)
         ax_display *Display = AXLibWindowDisplay(Window);
         space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
 
-        tree_node *Node = GetTreeNodeFromWindowID(SpaceInfo->RootNode, Window->ID);
+        tree_node *Node = GetTreeNodeFromWindowID(SpaceInfo, Window->ID);
         if(Node)
         {
             if(IsWindowFullscreen(Window))
@@ -1326,13 +1326,13 @@ void SwapFocusedWindowWithMarked()
     ax_display *Display = AXLibWindowDisplay(FocusedWindow);
     space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
 
-    tree_node *TreeNode = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo->RootNode, FocusedWindow->ID);
+    tree_node *TreeNode = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo, FocusedWindow->ID);
     if(TreeNode)
     {
-        tree_node *NewFocusNode = GetTreeNodeFromWindowID(SpaceInfo->RootNode, MarkedWindow->ID);
+        tree_node *NewFocusNode = GetTreeNodeFromWindowID(SpaceInfo, MarkedWindow->ID);
         if(NewFocusNode)
         {
-            SwapNodeWindowIDs(TreeNode, NewFocusNode);
+            SwapNodeWindowIDs(SpaceInfo, TreeNode, NewFocusNode);
             MoveCursorToCenterOfFocusedWindow();
         }
     }
@@ -1366,14 +1366,14 @@ void SwapFocusedWindowWithNearest(int Shift)
 
             if(ShiftNode)
             {
-                SwapNodeWindowIDs(Link, ShiftNode);
+                SwapNodeWindowIDs(SpaceInfo, Link, ShiftNode);
                 MoveCursorToCenterOfWindow(Window);
             }
         }
     }
     else if(SpaceInfo->Settings.Mode == SpaceModeBSP)
     {
-        tree_node *Node = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo->RootNode, Window->ID);
+        tree_node *Node = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo, Window->ID);
         if(Node)
         {
             tree_node *ClosestNode = NULL;;
@@ -1397,7 +1397,7 @@ void SwapFocusedWindowWithNearest(int Shift)
 
             if(ClosestNode)
             {
-                SwapNodeWindowIDs(Node, ClosestNode);
+                SwapNodeWindowIDs(SpaceInfo, Node, ClosestNode);
                 MoveCursorToCenterOfTreeNode(ClosestNode);
             }
         }
@@ -1414,17 +1414,17 @@ void SwapFocusedWindowDirected(int Degrees)
     space_info *Space = &WindowTree[Display->Space->Identifier];
     if(Space->Settings.Mode == SpaceModeBSP)
     {
-        tree_node *Node = GetTreeNodeFromWindowIDOrLinkNode(Space->RootNode, Window->ID);
+        tree_node *Node = GetTreeNodeFromWindowIDOrLinkNode(Space, Window->ID);
         if(Node)
         {
             tree_node *ClosestNode = NULL;
             ax_window *ClosestWindow = NULL;
             if(FindClosestWindow(Degrees, &ClosestWindow, KWMSettings.Cycle == CycleModeScreen))
-                ClosestNode = GetTreeNodeFromWindowID(Space->RootNode, ClosestWindow->ID);
+                ClosestNode = GetTreeNodeFromWindowID(Space, ClosestWindow->ID);
 
             if(ClosestNode)
             {
-                SwapNodeWindowIDs(Node, ClosestNode);
+                SwapNodeWindowIDs(Space, Node, ClosestNode);
                 MoveCursorToCenterOfTreeNode(ClosestNode);
             }
         }
@@ -1438,13 +1438,9 @@ void SwapFocusedWindowDirected(int Degrees)
     }
 }
 
-bool WindowIsInDirection(ax_window *WindowA, ax_window *WindowB, int Degrees)
+internal bool
+IsNodeInDirection(tree_node *NodeA, tree_node *NodeB, int Degrees)
 {
-    ax_display *Display = AXLibWindowDisplay(WindowA);
-    space_info *Space = &WindowTree[Display->Space->Identifier];
-    tree_node *NodeA = GetTreeNodeFromWindowIDOrLinkNode(Space->RootNode, WindowA->ID);
-    tree_node *NodeB = GetTreeNodeFromWindowIDOrLinkNode(Space->RootNode, WindowB->ID);
-
     if(!NodeA || !NodeB || NodeA == NodeB)
         return false;
 
@@ -1459,11 +1455,19 @@ bool WindowIsInDirection(ax_window *WindowA, ax_window *WindowB, int Degrees)
     return false;
 }
 
-void GetCenterOfWindow(ax_window *Window, int *X, int *Y)
+bool WindowIsInDirection(ax_window *WindowA, ax_window *WindowB, int Degrees)
 {
-    ax_display *Display = AXLibWindowDisplay(Window);
+    ax_display *Display = AXLibWindowDisplay(WindowA);
     space_info *Space = &WindowTree[Display->Space->Identifier];
-    tree_node *Node = GetTreeNodeFromWindowIDOrLinkNode(Space->RootNode, Window->ID);
+    tree_node *NodeA = GetTreeNodeFromWindowIDOrLinkNode(Space, WindowA->ID);
+    tree_node *NodeB = GetTreeNodeFromWindowIDOrLinkNode(Space, WindowB->ID);
+
+    return IsNodeInDirection(NodeA, NodeB, Degrees);
+}
+
+internal inline void
+GetCenterOfNode(tree_node *Node, int *X, int *Y)
+{
     if(Node)
     {
         *X = Node->Container.X + Node->Container.Width / 2;
@@ -1476,14 +1480,22 @@ void GetCenterOfWindow(ax_window *Window, int *X, int *Y)
     }
 }
 
-double GetWindowDistance(ax_window *A, ax_window *B, int Degrees, bool Wrap)
+void GetCenterOfWindow(ax_window *Window, int *X, int *Y)
+{
+    ax_display *Display = AXLibWindowDisplay(Window);
+    space_info *Space = &WindowTree[Display->Space->Identifier];
+    tree_node *Node = GetTreeNodeFromWindowIDOrLinkNode(Space, Window->ID);
+    GetCenterOfNode(Node, X, Y);
+}
+
+internal double
+GetNodeDistance(ax_display *Display, tree_node *A, tree_node *B, int Degrees, bool Wrap)
 {
-    ax_display *Display = AXLibWindowDisplay(A);
     double Rank = INT_MAX;
 
     int X1, Y1, X2, Y2;
-    GetCenterOfWindow(A, &X1, &Y1);
-    GetCenterOfWindow(B, &X2, &Y2);
+    GetCenterOfNode(A, &X1, &Y1);
+    GetCenterOfNode(B, &X2, &Y2);
 
     if(Wrap)
     {
@@ -1522,36 +1534,151 @@ double GetWindowDistance(ax_window *A, ax_window *B, int Degrees, bool Wrap)
     return Rank;
 }
 
+/* NOTE(koekeishiya): The order in which AXLibGetAllVisibleWindows returns windows, by process
+ * and then window id. A tie in rank resolves to the window that comes first. */
+internal inline bool
+IsWindowOrderedBefore(ax_window *A, ax_window *B)
+{
+    if(A->Application->PID != B->Application->PID)
+        return A->Application->PID < B->Application->PID;
+
+    return A->ID < B->ID;
+}
+
 bool FindClosestWindow(int Degrees, ax_window **ClosestWindow, bool Wrap)
 {
     ax_window *FocusedWindow = FocusedApplication->Focus;
     return FindClosestWindow(FocusedWindow, Degrees, ClosestWindow, Wrap);
 }
 
-bool FindClosestWindow(ax_window *Match, int Degrees, ax_window **ClosestWindow, bool Wrap)
+struct closest_window_search
 {
-    std::vector<ax_window*> Windows = AXLibGetAllVisibleWindows();
+    ax_display *Display;
+    tree_node *Node;
+    int Degrees;
+    bool Wrap;
 
-    int MatchX, MatchY;
-    GetCenterOfWindow(Match, &MatchX, &MatchY);
+    ax_window *Closest;
+    double MinRank;
+};
 
-    double MinDist = INT_MAX;
-    for(int Index = 0; Index < Windows.size(); ++Index)
+/* NOTE(koekeishiya): A vertical split separates east from west, a horizontal split north from
+ * south. Walking east or south leaves the left child of such a split, walking north or west
+ * leaves the right child. */
+internal inline bool
+IsSplitAcrossDirection(tree_node *Node, int Degrees)
+{
+    if(Degrees == 90 || Degrees == 270)
+        return Node->SplitMode == SPLIT_VERTICAL;
+    else
+        return Node->SplitMode == SPLIT_HORIZONTAL;
+}
+
+internal inline tree_node *
+GetChildFacingDirection(tree_node *Node, int Degrees)
+{
+    return (Degrees == 90 || Degrees == 180) ? Node->LeftChild : Node->RightChild;
+}
+
+internal inline bool
+IsNodeAlongsideDirection(tree_node *NodeA, tree_node *NodeB, int Degrees)
+{
+    node_container *A = &NodeA->Container;
+    node_container *B = &NodeB->Container;
+
+    if(Degrees == 0 || Degrees == 180)
+        return fmax(A->X, B->X) < fmin(B->X + B->Width, A->X + A->Width);
+    else
+        return fmax(A->Y, B->Y) < fmin(B->Y + B->Height, A->Y + A->Height);
+}
+
+internal void
+RankClosestWindow(closest_window_search *Search, uint32_t WindowID, double Rank)
+{
+    if(WindowID == 0 || Rank > Search->MinRank || (Rank == Search->MinRank && !Search->Closest))
+        return;
+
+    ax_window *Window = GetWindowByID(WindowID);
+    if(Window && (Rank < Search->MinRank || IsWindowOrderedBefore(Window, Search->Closest)))
     {
-        ax_window *Window = Windows[Index];
-        if(Match->ID != Window->ID &&
-           WindowIsInDirection(Match, Window, Degrees))
+        Search->MinRank = Rank;
+        Search->Closest = Window;
+    }
+}
+
+/* NOTE(koekeishiya): Visits the leaves of the subtree that touch its edge facing Search->Node,
+ * and skips every subtree that does not line up with it. These are the leaves that share an
+ * edge with Search->Node, so only they are ranked. */
+internal void
+RankLeavesFacingNode(closest_window_search *Search, tree_node *Node)
+{
+    if(!Node || !IsNodeAlongsideDirection(Search->Node, Node, Search->Degrees))
+        return;
+
+    if(IsLeafNode(Node))
+    {
+        if(!IsNodeInDirection(Search->Node, Node, Search->Degrees))
+            return;
+
+        double Rank = GetNodeDistance(Search->Display, Search->Node, Node, Search->Degrees, Search->Wrap);
+        RankClosestWindow(Search, Node->WindowID, Rank);
+
+        link_node *Link = Node->List;
+        while(Link)
         {
-            double Dist = GetWindowDistance(Match, Window, Degrees, Wrap);
-            if(Dist < MinDist)
-            {
-                MinDist = Dist;
-                *ClosestWindow = Window;
-            }
+            RankClosestWindow(Search, Link->WindowID, Rank);
+            Link = Link->Next;
         }
     }
+    else if(IsSplitAcrossDirection(Node, Search->Degrees))
+    {
+        RankLeavesFacingNode(Search, GetChildFacingDirection(Node, Search->Degrees));
+    }
+    else
+    {
+        RankLeavesFacingNode(Search, Node->LeftChild);
+        RankLeavesFacingNode(Search, Node->RightChild);
+    }
+}
+
+/* NOTE(koekeishiya): The bsp-tree is the adjacency structure of the space, and it is always up
+ * to date. The neighbours of a leaf in a direction are the leaves that face it on the other side
+ * of the closest split that lies across that direction. When Wrap is set and there is no such
+ * split, the leaves at the opposite edge of the space are ranked instead. A query costs the depth
+ * of the leaf plus the number of neighbours, and only windows that may be the result are looked up. */
+bool FindClosestWindow(ax_window *Match, int Degrees, ax_window **ClosestWindow, bool Wrap)
+{
+    ax_display *Display = AXLibWindowDisplay(Match);
+    if(!Display || Degrees % 90 != 0 || Degrees < 0 || Degrees >= 360)
+        return false;
+
+    space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
+    tree_node *Node = GetTreeNodeFromWindowIDOrLinkNode(SpaceInfo, Match->ID);
+    if(!Node)
+        return false;
+
+    closest_window_search Search = { Display, Node, Degrees, Wrap, NULL, INT_MAX };
+
+    tree_node *Neighbours = NULL;
+    tree_node *Child = Node;
+    while(Child->Parent && !Neighbours)
+    {
+        tree_node *Parent = Child->Parent;
+        if(IsSplitAcrossDirection(Parent, Degrees) && GetChildFacingDirection(Parent, Degrees) == Child)
+            Neighbours = Child == Parent->LeftChild ? Parent->RightChild : Parent->LeftChild;
+
+        Child = Parent;
+    }
+
+    if(Neighbours)
+        RankLeavesFacingNode(&Search, Neighbours);
+    else if(Wrap)
+        RankLeavesFacingNode(&Search, SpaceInfo->RootNode);
 
-    return MinDist != INT_MAX;
+    if(Search.Closest)
+        *ClosestWindow = Search.Closest;
+
+    return Search.Closest != NULL;
 }
 
 void ShiftWindowFocusDirected(int Degrees)
@@ -1632,7 +1759,7 @@ void ShiftWindowFocus(int Shift)
     }
     else if(SpaceInfo->Settings.Mode == SpaceModeBSP)
     {
-        tree_node *TreeNode = GetTreeNodeFromWindowID(SpaceInfo->RootNode, Window->ID);
+        tree_node *TreeNode = GetTreeNodeFromWindowID(SpaceInfo, Window->ID);
         if(TreeNode)
         {
             tree_node *FocusNode = NULL;
@@ -1680,7 +1807,7 @@ void ShiftSubTreeWindowFocus(int Shift)
     space_info *SpaceInfo = &WindowTree[Display->Space->Identifier];
     if(SpaceInfo->Settings.Mode == SpaceModeBSP)
     {
-        link_node *Link = GetLinkNodeFromWindowID(SpaceInfo->RootNode, Window->ID);
+        link_node *Link = GetLinkNodeFromWindowID(SpaceInfo, Window->ID);
         if(Link)
         {
             if(Shift == 1)
@@ -1693,7 +1820,7 @@ void ShiftSubTreeWindowFocus(int Shift)
                 }
                 else if(KWMSettings.Cycle == CycleModeScreen)
                 {
-                    tree_node *Root = GetTreeNodeFromLink(SpaceInfo->RootNode, Link);
+                    tree_node *Root = GetTreeNodeFromLink(SpaceInfo, Link);
                     SetWindowFocusByNode(Root);
                     MoveCursorToCenterOfFocusedWindow();
                 }
@@ -1707,7 +1834,7 @@ void ShiftSubTreeWindowFocus(int Shift)
                 }
                 else
                 {
-                    tree_node *Root = GetTreeNodeFromLink(SpaceInfo->RootNode, Link);
+                    tree_node *Root = GetTreeNodeFromLink(SpaceInfo, Link);
                     SetWindowFocusByNode(Root);
                 }
                 MoveCursorToCenterOfFocusedWindow();
@@ -1715,7 +1842,7 @@ void ShiftSubTreeWindowFocus(int Shift)
         }
         else
         {
-            tree_node *Root = GetTreeNodeFromWindowID(SpaceInfo->RootNode, Window->ID);
+            tree_node *Root = GetTreeNodeFromWindowID(SpaceInfo, Window->ID);
             if(Root)
             {
                 if(Shift == 1)
@@ -1820,7 +1947,7 @@ void SetWindowFocusByNode(link_node *Link)
     }
 }
 
-void CenterWindowInsideNodeContainer(ax_window *Window, int *Xptr, int *Yptr, int *Wptr, int *Hptr)
+bool CenterWindowInsideNodeContainer(ax_window *Window, int *Xptr, int *Yptr, int *Wptr, int *Hptr)
 {
     CGPoint WindowOrigin = AXLibGetWindowPosition(Window->Ref);
     CGSize WindowOGSize = AXLibGetWindowSize(Window->Ref);
@@ -1846,36 +1973,94 @@ void CenterWindowInsideNodeContainer(ax_window *Window, int *Xptr, int *Yptr, in
         AXLibAddFlags(Window, AXWindow_SizeIntrinsic);
         if(!AXLibSetWindowSize(Window->Ref, Width, Height))
             AXLibClearFlags(Window, AXWindow_SizeIntrinsic);
+
+        return true;
     }
+
+    return false;
 }
 
-void SetWindowDimensions(ax_window *Window, int X, int Y, int Width, int Height)
+internal inline bool
+SetWindowPositionIfChanged(ax_window *Window, int X, int Y, bool *Failed)
 {
-    if(!AXLibIsWindowFullscreen(Window->Ref))
+    if((Window->Position.x != X) ||
+       (Window->Position.y != Y))
     {
-        bool Changed = false;
+        AXLibAddFlags(Window, AXWindow_MoveIntrinsic);
+        if(!AXLibSetWindowPosition(Window->Ref, X, Y))
+        {
+            AXLibClearFlags(Window, AXWindow_MoveIntrinsic);
+            *Failed = true;
+        }
 
-        if((Window->Position.x != X) ||
-           (Window->Position.y != Y))
+        return true;
+    }
+
+    return false;
+}
+
+internal inline bool
+SetWindowSizeIfChanged(ax_window *Window, int Width, int Height, bool *Failed)
+{
+    if((Window->Size.width != Width) ||
+       (Window->Size.height != Height))
+    {
+        AXLibAddFlags(Window, AXWindow_SizeIntrinsic);
+        if(!AXLibSetWindowSize(Window->Ref, Width, Height))
         {
-            Changed = true;
-            AXLibAddFlags(Window, AXWindow_MoveIntrinsic);
-            if(!AXLibSetWindowPosition(Window->Ref, X, Y))
-                AXLibClearFlags(Window, AXWindow_MoveIntrinsic);
+            AXLibClearFlags(Window, AXWindow_SizeIntrinsic);
+            *Failed = true;
         }
 
-        if((Window->Size.width != Width) ||
-           (Window->Size.height != Height))
+        return true;
+    }
+
+    return false;
+}
+
+/* NOTE(koekeishiya): Returns the number of AX writes issued. A window that shrinks is
+ * resized before it is moved, and a window that grows is moved before it is resized,
+ * so that the intermediate frame is never clamped by the edge of the display. Applied is
+ * set to whether the window now has the frame, which is not the case for a fullscreen
+ * window, when one of the writes failed, or when the window did not accept the size and
+ * was centered inside the frame instead. */
+int ApplyWindowFrame(ax_window *Window, int X, int Y, int Width, int Height, bool *Applied)
+{
+    int Writes = 0;
+    bool Failed = false;
+    bool Centered = false;
+    bool Fullscreen = AXLibIsWindowFullscreen(Window->Ref);
+    if(!Fullscreen)
+    {
+        bool SizeFirst = (Width * Height) < (Window->Size.width * Window->Size.height);
+        if(SizeFirst)
+        {
+            Writes += SetWindowSizeIfChanged(Window, Width, Height, &Failed);
+            Writes += SetWindowPositionIfChanged(Window, X, Y, &Failed);
+        }
+        else
         {
-            Changed = true;
-            AXLibAddFlags(Window, AXWindow_SizeIntrinsic);
-            if(!AXLibSetWindowSize(Window->Ref, Width, Height))
-                AXLibClearFlags(Window, AXWindow_SizeIntrinsic);
+            Writes += SetWindowPositionIfChanged(Window, X, Y, &Failed);
+            Writes += SetWindowSizeIfChanged(Window, Width, Height, &Failed);
         }
 
-        if(Changed)
-            CenterWindowInsideNodeContainer(Window, &X, &Y, &Width, &Height);
+        if(Writes && CenterWindowInsideNodeContainer(Window, &X, &Y, &Width, &Height))
+        {
+            Writes += 2;
+            Centered = true;
+        }
     }
+
+    if(Applied)
+        *Applied = !Fullscreen && !Failed && !Centered;
+
+    return Writes;
+}
+
+void SetWindowDimensions(ax_window *Window, int X, int Y, int Width, int Height)
+{
+    ForgetAppliedLayoutFrame(Window->ID);
+    ApplyWindowFrame(Window, X, Y, Width, Height);
 }
 
 void CenterWindow(ax_display *Display, ax_window *Window)
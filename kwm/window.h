@@ -38,7 +38,8 @@ void MarkWindowContainer(ax_window *Window);
 void MarkFocusedWindowContainer();
 void SetWindowFocusByNode(tree_node *Node);
 void SetWindowFocusByNode(link_node *Link);
-void CenterWindowInsideNodeContainer(ax_window *Window, int *Xptr, int *Yptr, int *Wptr, int *Hptr);
+bool CenterWindowInsideNodeContainer(ax_window *Window, int *Xptr, int *Yptr, int *Wptr, int *Hptr);
+int ApplyWindowFrame(ax_window *Window, int X, int Y, int Width, int Height, bool *Applied = NULL);
 void SetWindowDimensions(ax_window *Window, int X, int Y, int Width, int Height);
 bool IsWindowFullscreen(ax_window *Window);
 bool IsWindowParentContainer(ax_window *Window);
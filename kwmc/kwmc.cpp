@@ -5,10 +5,21 @@
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
-#include <netdb.h>
+#include <sys/un.h>
 #include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <stdlib.h>
 
 #define KwmDaemonPort 3020
+#define KwmPipelineHandshake "pipeline"
+#define KwmSocketChunk 4096
+
+struct socket_reader
+{
+    std::string Buffer;
+    std::size_t Cursor;
+};
 
 int KwmcSockFD;
 
@@ -18,21 +29,89 @@ void Fatal(const std::string &err)
     exit(1);
 }
 
+bool FillReader(int FD, socket_reader *Reader)
+{
+    if(Reader->Cursor == Reader->Buffer.size())
+    {
+        Reader->Buffer.clear();
+        Reader->Cursor = 0;
+    }
+    else if(Reader->Cursor >= KwmSocketChunk)
+    {
+        Reader->Buffer.erase(0, Reader->Cursor);
+        Reader->Cursor = 0;
+    }
+
+    char Chunk[KwmSocketChunk];
+    ssize_t Bytes;
+    do
+    {
+        Bytes = read(FD, Chunk, sizeof(Chunk));
+    } while(Bytes == -1 && errno == EINTR);
+
+    if(Bytes <= 0)
+        return false;
+
+    Reader->Buffer.append(Chunk, Bytes);
+    return true;
+}
+
+bool ParseLine(socket_reader *Reader, std::string *Line)
+{
+    std::size_t End = Reader->Buffer.find('\n', Reader->Cursor);
+    if(End == std::string::npos)
+        return false;
+
+    Line->assign(Reader->Buffer, Reader->Cursor, End - Reader->Cursor);
+    Reader->Cursor = End + 1;
+    return true;
+}
+
+/* NOTE(koekeishiya): A reply to a pipelined command is '<length>\n' followed by length bytes.
+ * Returns false until the whole frame has been read. */
+bool ParseFrame(socket_reader *Reader, std::string *Frame)
+{
+    std::size_t End = Reader->Buffer.find('\n', Reader->Cursor);
+    if(End == std::string::npos)
+        return false;
+
+    std::size_t Length = strtoul(Reader->Buffer.c_str() + Reader->Cursor, NULL, 10);
+    if(Reader->Buffer.size() - (End + 1) < Length)
+        return false;
+
+    Frame->assign(Reader->Buffer, End + 1, Length);
+    Reader->Cursor = End + 1 + Length;
+    return true;
+}
+
 std::string ReadFromSocket(int SockFD)
 {
-    std::string Message;
-    char Cur;
+    socket_reader Reader = {};
+    while(FillReader(SockFD, &Reader));
+    return Reader.Buffer;
+}
+
+void SendToSocket(const std::string &Msg)
+{
+    std::size_t Sent = 0;
+    while(Sent < Msg.size())
+    {
+        ssize_t Bytes = send(KwmcSockFD, Msg.c_str() + Sent, Msg.size() - Sent, 0);
+        if(Bytes == -1)
+        {
+            if(errno == EINTR)
+                continue;
 
-    while(recv(SockFD, &Cur, 1, 0))
-        Message += Cur;
+            Fatal("Connection lost!");
+        }
 
-    return Message;
+        Sent += Bytes;
+    }
 }
 
 void WriteToSocket(std::string Msg)
 {
-    Msg += "\n";
-    send(KwmcSockFD, Msg.c_str(), Msg.size(), 0);
+    SendToSocket(Msg + "\n");
 
     std::string Response = ReadFromSocket(KwmcSockFD);
     if(!Response.empty())
@@ -56,36 +135,152 @@ void KwmcForwardMessageThroughSocket(int argc, char **argv)
     WriteToSocket(Msg);
 }
 
+/* NOTE(koekeishiya): Notifications are written to stdout as they arrive, one per line, until
+ * kwm closes the connection. The write side is left open; closing it ends the subscription. */
+void KwmcSubscribe(int argc, char **argv)
+{
+    std::string Msg = "subscribe";
+    for(int i = 2; i < argc; ++i)
+        Msg += std::string(" ") + argv[i];
+
+    SendToSocket(Msg + "\n");
+
+    socket_reader Reader = {};
+    while(FillReader(KwmcSockFD, &Reader))
+    {
+        std::cout << Reader.Buffer << std::flush;
+        Reader.Buffer.clear();
+    }
+
+    close(KwmcSockFD);
+}
+
+/* NOTE(koekeishiya): The socket path is taken from KWM_SOCKET, and defaults to the one kwm
+ * creates. If nobody listens there, the loopback tcp port of 'kwm --tcp' is tried. */
+bool KwmcConnectToUnixSocket()
+{
+    std::string Path;
+    const char *Env = getenv("KWM_SOCKET");
+    const char *Home = getenv("HOME");
+    if(Env)
+        Path = Env;
+    else if(Home)
+        Path = std::string(Home) + "/.kwm/kwm.sock";
+
+    struct sockaddr_un srv_addr = {};
+    if(Path.empty() || Path.size() >= sizeof(srv_addr.sun_path))
+        return false;
+
+    srv_addr.sun_family = AF_UNIX;
+    std::memcpy(srv_addr.sun_path, Path.c_str(), Path.size() + 1);
+
+    if((KwmcSockFD = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+        Fatal("Could not create socket!");
+
+    if(connect(KwmcSockFD, (struct sockaddr*) &srv_addr, sizeof(srv_addr)) == -1)
+    {
+        close(KwmcSockFD);
+        return false;
+    }
+
+    return true;
+}
+
 void KwmcConnectToDaemon()
 {
-    struct sockaddr_in srv_addr;
-    struct hostent *server;
+    if(KwmcConnectToUnixSocket())
+        return;
 
+    struct sockaddr_in srv_addr;
     if((KwmcSockFD = socket(PF_INET, SOCK_STREAM, 0)) == -1)
         Fatal("Could not create socket!");
 
-    server = gethostbyname("localhost");
     srv_addr.sin_family = AF_INET;
     srv_addr.sin_port = htons(KwmDaemonPort);
-    std::memcpy(&srv_addr.sin_addr.s_addr, server->h_addr, server->h_length);
+    srv_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
     std::memset(&srv_addr.sin_zero, '\0', 8);
 
     if(connect(KwmcSockFD, (struct sockaddr*) &srv_addr, sizeof(struct sockaddr)) == -1)
         Fatal("Connection failed!");
 }
 
+/* NOTE(koekeishiya): Every command read from stdin is sent over the same connection as soon as
+ * it is read, without waiting for the reply to the previous one. Replies come back in order,
+ * so 'kwmc interpret < script' costs one connection and a handful of syscalls. */
 void KwmcInterpreter()
 {
-    while(true)
+    KwmcConnectToDaemon();
+    SendToSocket(std::string(KwmPipelineHandshake) + "\n");
+
+    socket_reader Input = {};
+    socket_reader Reader = {};
+    bool Writing = true;
+    int Outstanding = 0;
+
+    while(Writing || Outstanding > 0)
     {
-        std::string Msg;
-        std::getline(std::cin, Msg);
-        if(Msg  == "/quit" || Msg == "/q")
+        struct pollfd Descriptors[2] =
+        {
+            { KwmcSockFD, POLLIN, 0 },
+            { STDIN_FILENO, POLLIN, 0 }
+        };
+
+        if(poll(Descriptors, Writing ? 2 : 1, -1) == -1)
+        {
+            if(errno == EINTR)
+                continue;
+
             break;
+        }
+
+        if(Descriptors[0].revents)
+        {
+            if(!FillReader(KwmcSockFD, &Reader))
+                break;
+
+            std::string Frame;
+            while(ParseFrame(&Reader, &Frame))
+            {
+                if(!Frame.empty())
+                    std::cout << Frame << std::endl;
+
+                --Outstanding;
+            }
+        }
+
+        if(Writing && Descriptors[1].revents)
+        {
+            if(!FillReader(STDIN_FILENO, &Input))
+            {
+                Input.Buffer += "\n";
+                Writing = false;
+            }
+
+            std::string Batch, Msg;
+            while(ParseLine(&Input, &Msg))
+            {
+                if(Msg == "/quit" || Msg == "/q")
+                {
+                    Writing = false;
+                    break;
+                }
 
-        KwmcConnectToDaemon();
-        WriteToSocket(Msg);
+                if(Msg.empty() || Msg[0] == '#')
+                    continue;
+
+                Batch += Msg + "\n";
+                ++Outstanding;
+            }
+
+            if(!Batch.empty())
+                SendToSocket(Batch);
+
+            if(!Writing)
+                shutdown(KwmcSockFD, SHUT_WR);
+        }
     }
+
+    close(KwmcSockFD);
 }
 
 int main(int argc, char **argv)
@@ -95,6 +290,11 @@ int main(int argc, char **argv)
         std::string Command = argv[1];
         if(Command == "interpret")
             KwmcInterpreter();
+        else if(Command == "subscribe")
+        {
+            KwmcConnectToDaemon();
+            KwmcSubscribe(argc, argv);
+        }
         else
         {
             KwmcConnectToDaemon();
@@ -0,0 +1,204 @@
+#include "../kwm/daemon.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <queue>
+
+#define internal static
+
+/* NOTE(koekeishiya): Runs the daemon against a stub handler, the way kwm runs it against the
+ * interpreter, and talks to it as kwmc would. Builds and runs on Linux as well as on macOS,
+ * 'make test' runs it. The stub understands:
+ *   'echo <text>'  replies with <text>
+ *   'query fast'   answered by Query on the daemon thread once every command is handled
+ *   'subscribe'    subscribes the client to topic 1, with 'initial' as the first line */
+struct stub_command
+{
+    std::string Message;
+    int ClientID;
+    bool Pipelined;
+};
+
+internal pthread_mutex_t CommandLock = PTHREAD_MUTEX_INITIALIZER;
+internal pthread_cond_t CommandReady = PTHREAD_COND_INITIALIZER;
+internal std::queue<stub_command> Commands;
+internal uint64_t HandledCommands;
+internal int Failures;
+
+internal DAEMON_COMMAND_CALLBACK(StubQueueCommand)
+{
+    stub_command Entry = { Command, ClientID, Pipelined };
+    pthread_mutex_lock(&CommandLock);
+    Commands.push(Entry);
+    pthread_cond_signal(&CommandReady);
+    pthread_mutex_unlock(&CommandLock);
+}
+
+internal DAEMON_QUERY_CALLBACK(StubAnswerQuery)
+{
+    if(Command != "query fast" || __atomic_load_n(&HandledCommands, __ATOMIC_SEQ_CST) != Commands)
+        return false;
+
+    *Output = "fast";
+    return true;
+}
+
+internal void
+StubInterpretCommand(std::string Message, int ClientID)
+{
+    if(Message.compare(0, 5, "echo ") == 0)
+        KwmWriteToSocket(Message.substr(5), ClientID);
+    else if(Message == "query fast")
+        KwmWriteToSocket("slow", ClientID);
+
+    KwmCloseSocket(ClientID);
+}
+
+internal void *
+StubWorker(void *)
+{
+    while(true)
+    {
+        pthread_mutex_lock(&CommandLock);
+        while(Commands.empty())
+            pthread_cond_wait(&CommandReady, &CommandLock);
+
+        stub_command Entry = Commands.front();
+        Commands.pop();
+        pthread_mutex_unlock(&CommandLock);
+
+        if(Entry.Message == "subscribe")
+        {
+            KwmSubscribeClient(Entry.ClientID, 1, "initial\n");
+        }
+        else
+        {
+            if(Entry.Pipelined)
+                KwmBeginResponse(Entry.ClientID);
+
+            StubInterpretCommand(Entry.Message, Entry.ClientID);
+
+            if(Entry.Pipelined)
+                KwmEndResponse();
+        }
+
+        __atomic_add_fetch(&HandledCommands, 1, __ATOMIC_SEQ_CST);
+    }
+
+    return NULL;
+}
+
+internal int
+ConnectToDaemon(std::string SocketPath)
+{
+    int SockFD = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(SockFD == -1)
+        return -1;
+
+    struct timeval Timeout = { 5, 0 };
+    setsockopt(SockFD, SOL_SOCKET, SO_RCVTIMEO, &Timeout, sizeof(Timeout));
+
+    struct sockaddr_un Address = {};
+    Address.sun_family = AF_UNIX;
+    strncpy(Address.sun_path, SocketPath.c_str(), sizeof(Address.sun_path) - 1);
+    if(connect(SockFD, (struct sockaddr *) &Address, sizeof(Address)) == -1)
+    {
+        close(SockFD);
+        return -1;
+    }
+
+    return SockFD;
+}
+
+/* NOTE(koekeishiya): Reads until the daemon closes the connection, or until Size bytes have
+ * arrived if Size is not 0. Gives up after the receive timeout. */
+internal std::string
+ReadFromDaemon(int SockFD, std::size_t Size)
+{
+    std::string Result;
+    char Buffer[KWM_SOCKET_CHUNK];
+    while(Size == 0 || Result.size() < Size)
+    {
+        ssize_t Bytes = read(SockFD, Buffer, Size ? Size - Result.size() : sizeof(Buffer));
+        if(Bytes == -1 && errno == EINTR)
+            continue;
+        if(Bytes <= 0)
+            break;
+
+        Result.append(Buffer, Bytes);
+    }
+
+    return Result;
+}
+
+internal std::string
+SendToDaemon(std::string SocketPath, std::string Message, bool Shutdown)
+{
+    int SockFD = ConnectToDaemon(SocketPath);
+    if(SockFD == -1)
+        return "<connect failed>";
+
+    write(SockFD, Message.c_str(), Message.size());
+    if(Shutdown)
+        shutdown(SockFD, SHUT_WR);
+
+    std::string Result = ReadFromDaemon(SockFD, 0);
+    close(SockFD);
+    return Result;
+}
+
+internal void
+Expect(const char *Test, std::string Result, std::string Expected)
+{
+    if(Result != Expected)
+    {
+        printf("FAIL %s: expected '%s', got '%s'\n", Test, Expected.c_str(), Result.c_str());
+        ++Failures;
+    }
+    else
+    {
+        printf("ok   %s\n", Test);
+    }
+}
+
+int main()
+{
+    signal(SIGPIPE, SIG_IGN);
+
+    std::string SocketPath = "/tmp/kwm-daemon-test." + std::to_string(getpid()) + ".sock";
+    kwm_daemon_handler Handler = { &StubQueueCommand, &StubAnswerQuery };
+    if(!KwmStartDaemon(SocketPath, false, Handler))
+    {
+        printf("FAIL could not start daemon on %s\n", SocketPath.c_str());
+        return 1;
+    }
+
+    pthread_t Worker;
+    pthread_create(&Worker, NULL, &StubWorker, NULL);
+
+    Expect("command", SendToDaemon(SocketPath, "echo hello\n", false), "hello");
+    Expect("query", SendToDaemon(SocketPath, "query fast\n", false), "fast");
+    Expect("pipeline", SendToDaemon(SocketPath, "pipeline\necho a\n#7\necho bb\necho c\n", true), "1\na2\nbb1\nc");
+
+    /* NOTE(koekeishiya): A client that never finishes its command must not hold up the others. */
+    int Stalled = ConnectToDaemon(SocketPath);
+    write(Stalled, "echo never", 10);
+    usleep(100000);
+    Expect("stalled client", SendToDaemon(SocketPath, "echo not stalled\n", false), "not stalled");
+    close(Stalled);
+
+    int Subscriber = ConnectToDaemon(SocketPath);
+    write(Subscriber, "subscribe\n", 10);
+    Expect("subscribe", ReadFromDaemon(Subscriber, 8), "initial\n");
+    KwmPublish(2, "other topic");
+    KwmPublish(1, "changed");
+    Expect("publish", ReadFromDaemon(Subscriber, 8), "changed\n");
+    close(Subscriber);
+
+    KwmTerminateDaemon();
+    printf("%s\n", Failures ? "FAILED" : "PASSED");
+    return Failures ? 1 : 0;
+}
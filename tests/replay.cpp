@@ -0,0 +1,468 @@
+#include "../kwm/kwm.h"
+#include "../kwm/daemon.h"
+#include "../kwm/display.h"
+#include "../kwm/window.h"
+#include "../kwm/border.h"
+#include "../kwm/interpreter.h"
+#include "../kwm/event.h"
+#include "../kwm/snapshot.h"
+#include "../kwm/subscription.h"
+#include "../axlib/axlib.h"
+#include "stub/windowsystem.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/un.h>
+#include <sys/time.h>
+
+#define internal static
+
+/* NOTE(koekeishiya): Runs kwm against the stub window system in tests/stub and records the session,
+ * then replays the log in a second process and checks that it ends up with the same trees. Only
+ * the log and the trees are shared between the two, so everything the handlers asked the window
+ * system must have been recorded. 'make test' runs it:
+ *   'replay-test record <log>'  records a session to <log> and its trees to <log>.state
+ *   'replay-test replay <log>'  replays <log> and compares its trees to <log>.state
+ * The config is not read, the settings are the defaults of kwm. */
+std::map<std::string, space_info> WindowTree;
+
+ax_display *FocusedDisplay = NULL;
+ax_application *FocusedApplication = NULL;
+ax_window *MarkedWindow = NULL;
+
+kwm_path KWMPath = {};
+kwm_settings KWMSettings = {};
+kwm_border FocusedBorder = {};
+kwm_border MarkedBorder = {};
+scratchpad Scratchpad = {};
+layout_transaction LayoutTransaction = {};
+window_burst WindowBurst = {};
+modifier_keys MouseDragKey = {};
+
+internal int Failures;
+
+void KwmQuit()
+{
+    KwmTerminateDaemon();
+    exit(0);
+}
+
+/* NOTE(koekeishiya): The settings of KwmInit in kwm/kwm.cpp. */
+internal void
+ReplayInitSettings()
+{
+    KWMSettings.SplitRatio = 0.5;
+    KWMSettings.SplitMode = SPLIT_OPTIMAL;
+    KWMSettings.DefaultOffset = CreateDefaultDisplayOffset();
+    KWMSettings.OptimalRatio = 1.618;
+
+    AddFlags(&KWMSettings,
+            Settings_MouseFollowsFocus |
+            Settings_StandbyOnFloat |
+            Settings_CenterOnFloat |
+            Settings_LockToContainer);
+
+    KWMSettings.Space = SpaceModeBSP;
+    KWMSettings.Focus = FocusModeAutoraise;
+    KWMSettings.Cycle = CycleModeScreen;
+
+    FocusedBorder.Radius = -1;
+    FocusedBorder.Type = BORDER_FOCUSED;
+    MarkedBorder.Radius = -1;
+    MarkedBorder.Type = BORDER_MARKED;
+}
+
+internal uint64_t PublishedStateEvents;
+
+/* NOTE(koekeishiya): KwmHandleEventBatch in kwm/kwm.cpp. */
+internal EVENT_BATCH_CALLBACK(ReplayHandleEventBatch)
+{
+    uint64_t StateEvents = AXLibGetStateEventCount();
+    if(StateEvents == PublishedStateEvents)
+        return;
+
+    PublishedStateEvents = StateEvents;
+    PublishStateSnapshot();
+    KwmPublishChanges();
+}
+
+/* NOTE(koekeishiya): KwmStartup in kwm/kwm.cpp, without the config. */
+internal EVENT_CALLBACK(ReplayStartup)
+{
+    ax_display *MainDisplay = AXLibMainDisplay();
+    ax_display *Display = MainDisplay;
+    do
+    {
+        ax_space *PrevSpace = Display->Space;
+        Display->Space = AXLibGetActiveSpace(Display);
+        Display->PrevSpace = PrevSpace;
+        Display = AXLibNextDisplay(Display);
+    } while(Display != MainDisplay);
+
+    FocusedDisplay = MainDisplay;
+    FocusedApplication = AXLibGetFocusedApplication();
+    CreateWindowNodeTree(MainDisplay);
+
+    if(FocusedApplication && FocusedApplication->Focus)
+        UpdateBorder(&FocusedBorder, FocusedApplication->Focus);
+}
+
+internal void
+DumpTreeNode(tree_node *Node, int Depth, std::string *Output)
+{
+    char Line[256];
+    snprintf(Line, sizeof(Line), "%*s%u split %d ratio %.3f container %.0f %.0f %.0f %.0f\n",
+             Depth * 2, "", Node->WindowID, Node->SplitMode, Node->SplitRatio,
+             Node->Container.X, Node->Container.Y, Node->Container.Width, Node->Container.Height);
+    *Output += Line;
+
+    for(link_node *Link = Node->List; Link; Link = Link->Next)
+    {
+        snprintf(Line, sizeof(Line), "%*slink %u\n", Depth * 2 + 2, "", Link->WindowID);
+        *Output += Line;
+    }
+
+    if(Node->LeftChild)
+        DumpTreeNode(Node->LeftChild, Depth + 1, Output);
+    if(Node->RightChild)
+        DumpTreeNode(Node->RightChild, Depth + 1, Output);
+}
+
+/* NOTE(koekeishiya): The trees of every space, the focused window and the marked window. Must not
+ * race the event loop. */
+internal std::string
+DumpState()
+{
+    std::string Output;
+    std::map<std::string, space_info>::iterator It;
+    for(It = WindowTree.begin(); It != WindowTree.end(); ++It)
+    {
+        Output += "space " + It->first + "\n";
+        if(It->second.RootNode)
+            DumpTreeNode(It->second.RootNode, 1, &Output);
+    }
+
+    ax_window *Focus = FocusedApplication ? FocusedApplication->Focus : NULL;
+    Output += "focus " + std::to_string(Focus ? Focus->ID : 0) + "\n";
+    Output += "mark " + std::to_string(MarkedWindow ? MarkedWindow->ID : 0) + "\n";
+    return Output;
+}
+
+internal void
+CollectTreeWindows(tree_node *Node, std::vector<uint32_t> *Windows)
+{
+    if(Node->WindowID)
+        Windows->push_back(Node->WindowID);
+    if(Node->LeftChild)
+        CollectTreeWindows(Node->LeftChild, Windows);
+    if(Node->RightChild)
+        CollectTreeWindows(Node->RightChild, Windows);
+}
+
+/* NOTE(koekeishiya): The windows that are tiled on any space, in ascending order. */
+internal std::string
+TiledWindows()
+{
+    std::vector<uint32_t> Windows;
+    AXLibPauseEventLoop();
+    std::map<std::string, space_info>::iterator It;
+    for(It = WindowTree.begin(); It != WindowTree.end(); ++It)
+    {
+        if(It->second.RootNode)
+            CollectTreeWindows(It->second.RootNode, &Windows);
+    }
+    AXLibResumeEventLoop();
+
+    std::sort(Windows.begin(), Windows.end());
+    std::string Result;
+    for(std::size_t Index = 0; Index < Windows.size(); ++Index)
+        Result += (Index ? " " : "") + std::to_string(Windows[Index]);
+
+    return Result;
+}
+
+/* NOTE(koekeishiya): Delivers notifications until the window system and the event loop have been
+ * quiet for a while, long enough for the window burst and the application probe timers to fire. */
+internal void
+Settle()
+{
+    int Quiet = 0;
+    while(Quiet < 20)
+    {
+        usleep(10000);
+        Quiet = StubRunLoop() ? 0 : Quiet + 1;
+    }
+}
+
+internal int
+ConnectToDaemon(std::string SocketPath)
+{
+    int SockFD = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(SockFD == -1)
+        return -1;
+
+    struct timeval Timeout = { 5, 0 };
+    setsockopt(SockFD, SOL_SOCKET, SO_RCVTIMEO, &Timeout, sizeof(Timeout));
+
+    struct sockaddr_un Address = {};
+    Address.sun_family = AF_UNIX;
+    strncpy(Address.sun_path, SocketPath.c_str(), sizeof(Address.sun_path) - 1);
+    if(connect(SockFD, (struct sockaddr *) &Address, sizeof(Address)) == -1)
+    {
+        close(SockFD);
+        return -1;
+    }
+
+    return SockFD;
+}
+
+/* NOTE(koekeishiya): Reads until the daemon closes the connection, and closes it as well. */
+internal std::string
+SendOnConnection(int SockFD, std::string Message)
+{
+    if(SockFD == -1)
+        return "<connect failed>";
+
+    write(SockFD, Message.c_str(), Message.size());
+
+    std::string Result;
+    char Buffer[KWM_SOCKET_CHUNK];
+    while(true)
+    {
+        ssize_t Bytes = read(SockFD, Buffer, sizeof(Buffer));
+        if(Bytes == -1 && errno == EINTR)
+            continue;
+        if(Bytes <= 0)
+            break;
+
+        Result.append(Buffer, Bytes);
+    }
+
+    close(SockFD);
+    return Result;
+}
+
+internal std::string
+SendToDaemon(std::string SocketPath, std::string Message)
+{
+    return SendOnConnection(ConnectToDaemon(SocketPath), Message);
+}
+
+internal void
+Expect(const char *Test, std::string Result, std::string Expected)
+{
+    if(Result != Expected)
+    {
+        printf("FAIL %s: expected '%s', got '%s'\n", Test, Expected.c_str(), Result.c_str());
+        ++Failures;
+    }
+    else
+    {
+        printf("ok   %s\n", Test);
+    }
+}
+
+internal bool
+StartDaemon(std::string SocketPath)
+{
+    kwm_daemon_handler Handler = { &KwmQueueCommand, &AnswerQueryFromSnapshot };
+    if(!KwmStartDaemon(SocketPath, false, Handler))
+    {
+        printf("FAIL could not start daemon on %s\n", SocketPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+internal bool
+WriteStateFile(std::string Path, std::string Contents)
+{
+    FILE *Handle = fopen(Path.c_str(), "w");
+    if(!Handle)
+        return false;
+
+    fwrite(Contents.c_str(), 1, Contents.size(), Handle);
+    fclose(Handle);
+    return true;
+}
+
+internal std::string
+ReadStateFile(std::string Path)
+{
+    std::string Result;
+    FILE *Handle = fopen(Path.c_str(), "r");
+    if(Handle)
+    {
+        char Buffer[4096];
+        std::size_t Bytes;
+        while((Bytes = fread(Buffer, 1, sizeof(Buffer), Handle)) > 0)
+            Result.append(Buffer, Bytes);
+
+        fclose(Handle);
+    }
+
+    return Result;
+}
+
+internal int
+RecordSession(std::string LogPath, std::string SocketPath)
+{
+    /* NOTE(koekeishiya): What is running before kwm starts. */
+    StubAddApplication(100, "Finder");
+    StubAddApplication(200, "Terminal");
+    uint32_t First = StubCreateWindow(200, "shell 1", { { 200, 200 }, { 600, 400 } });
+    StubFocusWindow(First);
+    StubRunLoop();
+
+    if(!AXLibStartEventRecording(LogPath.c_str()))
+    {
+        printf("FAIL could not open event log %s\n", LogPath.c_str());
+        return 1;
+    }
+
+    ReplayInitSettings();
+    if(!AXLibInit())
+    {
+        printf("FAIL could not initialize AXLib\n");
+        return 1;
+    }
+
+    AXLibSetEventBatchCallback(&ReplayHandleEventBatch);
+    AXLibStartEventLoop();
+    if(!StartDaemon(SocketPath))
+        return 1;
+
+    ax_event Startup = {};
+    Startup.Name = "KwmStartup";
+    Startup.Handle = &ReplayStartup;
+    AXLibRunEventSource(&Startup);
+    Settle();
+    Expect("startup", TiledWindows(), std::to_string(First));
+
+    uint32_t Second = StubCreateWindow(200, "shell 2", { { 300, 300 }, { 600, 400 } });
+    Settle();
+    Expect("window created", TiledWindows(), std::to_string(First) + " " + std::to_string(Second));
+
+    /* NOTE(koekeishiya): Created faster than WINDOW_BURST_DELAY, inserted as one burst. */
+    uint32_t Third = StubCreateWindow(200, "shell 3", { { 400, 400 }, { 600, 400 } });
+    uint32_t Fourth = StubCreateWindow(200, "shell 4", { { 500, 400 }, { 600, 400 } });
+    Settle();
+    Expect("window burst", TiledWindows(), std::to_string(First) + " " + std::to_string(Second) + " " +
+                                           std::to_string(Third) + " " + std::to_string(Fourth));
+
+    SendToDaemon(SocketPath, "tree rotate 90\n");
+    Settle();
+    SendToDaemon(SocketPath, "window -f west\n");
+    Settle();
+
+    StubFocusWindow(First);
+    Settle();
+    Expect("focus", SendToDaemon(SocketPath, "query window focused id\n"), std::to_string(First));
+
+    StubDestroyWindow(Third);
+    Settle();
+    Expect("window destroyed", TiledWindows(), std::to_string(First) + " " + std::to_string(Second) + " " +
+                                               std::to_string(Fourth));
+
+    StubLaunchApplication(300, "Safari");
+    Settle();
+    uint32_t Page = StubCreateWindow(300, "page", { { 100, 100 }, { 800, 600 } });
+    StubFocusWindow(Page);
+    Settle();
+    Expect("application launched", SendToDaemon(SocketPath, "query window focused id\n"), std::to_string(Page));
+
+    SendToDaemon(SocketPath, "window -s prev\n");
+    Settle();
+
+    StubSetActiveSpace(2);
+    Settle();
+    uint32_t Other = StubCreateWindow(200, "shell 5", { { 100, 100 }, { 600, 400 } });
+    Settle();
+    Expect("space changed", SendToDaemon(SocketPath, "query space active id\n"), "2");
+    Expect("window on other space", TiledWindows(), std::to_string(First) + " " + std::to_string(Second) + " " +
+                                                    std::to_string(Fourth) + " " + std::to_string(Page) + " " +
+                                                    std::to_string(Other));
+
+    StubSetActiveSpace(1);
+    Settle();
+
+    /* NOTE(koekeishiya): The tree is captured for a client, which then disconnects. The batch
+     * after the next change runs without clients and drops that snapshot, while the nodes that
+     * did not change still refer to it. 'tree rotate' captures those nodes again for the history. */
+    int Client = ConnectToDaemon(SocketPath);
+    uint32_t Last = StubCreateWindow(200, "shell 6", { { 300, 200 }, { 600, 400 } });
+    Settle();
+    Expect("query before disconnect", SendOnConnection(Client, "query space active id\n"), "1");
+    Settle();
+    StubDestroyWindow(Last);
+    Settle();
+    SendToDaemon(SocketPath, "tree rotate 180\n");
+    Settle();
+    Expect("rotate after dropped snapshot", TiledWindows(), std::to_string(First) + " " + std::to_string(Second) + " " +
+                                                            std::to_string(Fourth) + " " + std::to_string(Page) + " " +
+                                                            std::to_string(Other));
+
+    AXLibStopEventLoop();
+    std::string State = DumpState();
+    AXLibStopEventRecording();
+    KwmTerminateDaemon();
+
+    if(!WriteStateFile(LogPath + ".state", State))
+    {
+        printf("FAIL could not write %s.state\n", LogPath.c_str());
+        return 1;
+    }
+
+    printf("%s", State.c_str());
+    return 0;
+}
+
+internal int
+ReplaySession(std::string LogPath, std::string SocketPath)
+{
+    /* NOTE(koekeishiya): Replies to the clients of the recorded session go nowhere. */
+    if(!StartDaemon(SocketPath))
+        return 1;
+
+    ReplayInitSettings();
+    AXLibSetEventBatchCallback(&ReplayHandleEventBatch);
+    AXLibRegisterReplayHandler("KwmStartup", &ReplayStartup);
+    AXLibRegisterReplayHandler("KWMEvent_Command", &Callback_KWMEvent_Command);
+    AXLibRegisterReplayHandler("KWMEvent_PipelinedCommand", &Callback_KWMEvent_PipelinedCommand);
+    AXLibRegisterReplayHandler("KWMEvent_FlushWindowBurst", &Callback_KWMEvent_FlushWindowBurst);
+
+    ax_event_replay Replay = {};
+    bool Result = AXLibReplayEventLog(LogPath.c_str(), &Replay);
+    KwmTerminateDaemon();
+
+    Expect("log read", Result ? "yes" : "no", "yes");
+    Expect("events replayed", Replay.Events > 0 ? "yes" : "no", "yes");
+    Expect("events skipped", std::to_string(Replay.Skipped), "0");
+    Expect("responses mismatched", std::to_string(Replay.Mismatches), "0");
+    Expect("responses unused", std::to_string(Replay.Unused), "0");
+    Expect("state", DumpState(), ReadStateFile(LogPath + ".state"));
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc != 3 || (strcmp(argv[1], "record") != 0 && strcmp(argv[1], "replay") != 0))
+    {
+        printf("usage: %s record|replay <log>\n", argv[0]);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    std::string SocketPath = "/tmp/kwm-replay-test." + std::to_string(getpid()) + ".sock";
+
+    int Result = strcmp(argv[1], "record") == 0 ? RecordSession(argv[2], SocketPath)
+                                                : ReplaySession(argv[2], SocketPath);
+    if(Result)
+        return Result;
+
+    printf("%s\n", Failures ? "FAILED" : "PASSED");
+    return Failures ? 1 : 0;
+}
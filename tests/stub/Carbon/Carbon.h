@@ -0,0 +1,269 @@
+#ifndef STUB_CARBON_H
+#define STUB_CARBON_H
+
+/* NOTE(koekeishiya): The part of the macOS SDK that AXLib and Kwm use, so that they build on
+ * Linux against the stub window system in tests/stub/windowsystem.cpp. Types are declared the
+ * way the SDK declares them; only what the tree actually uses is here. */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <functional>
+
+typedef double CGFloat;
+struct CGPoint { CGFloat x; CGFloat y; };
+struct CGSize { CGFloat width; CGFloat height; };
+struct CGRect { CGPoint origin; CGSize size; };
+
+typedef unsigned char Boolean;
+typedef int32_t OSStatus;
+typedef int16_t OSErr;
+typedef uint32_t UInt32;
+typedef int32_t SInt32;
+typedef uint64_t UInt64;
+typedef uint32_t OptionBits;
+typedef unsigned long ItemCount;
+typedef unsigned long ByteCount;
+
+typedef long CFIndex;
+typedef unsigned long CFTypeID;
+typedef CFIndex CFComparisonResult;
+typedef unsigned long CFStringCompareFlags;
+typedef uint32_t CFStringEncoding;
+typedef CFIndex CFNumberType;
+typedef const void *CFTypeRef;
+typedef const struct __CFString *CFStringRef;
+typedef const struct __CFArray *CFArrayRef;
+typedef const struct __CFDictionary *CFDictionaryRef;
+typedef const struct __CFNumber *CFNumberRef;
+typedef const struct __CFBoolean *CFBooleanRef;
+typedef const struct __CFAllocator *CFAllocatorRef;
+typedef const struct __CFUUID *CFUUIDRef;
+typedef struct __CFRunLoop *CFRunLoopRef;
+typedef struct __CFRunLoopSource *CFRunLoopSourceRef;
+typedef struct __CFMachPort *CFMachPortRef;
+
+typedef uint32_t CGDirectDisplayID;
+typedef uint32_t CGWindowID;
+typedef uint32_t CGWindowListOption;
+typedef int32_t CGError;
+typedef uint64_t CGEventMask;
+typedef uint64_t CGEventFlags;
+typedef uint32_t CGEventType;
+typedef uint32_t CGDisplayChangeSummaryFlags;
+typedef struct __CGEvent *CGEventRef;
+typedef struct __CGEventSource *CGEventSourceRef;
+typedef struct __CGEventTapProxy *CGEventTapProxy;
+
+typedef int32_t AXError;
+typedef uint32_t AXValueType;
+typedef const struct __AXUIElement *AXUIElementRef;
+typedef const struct __AXValue *AXValueRef;
+typedef struct __AXObserver *AXObserverRef;
+typedef void (*AXObserverCallback)(AXObserverRef Observer, AXUIElementRef Element, CFStringRef Notification, void *Refcon);
+
+typedef uint32_t EventParamName;
+typedef uint32_t EventParamType;
+typedef struct OpaqueEventRef *EventRef;
+typedef struct OpaqueEventHandlerCallRef *EventHandlerCallRef;
+typedef struct OpaqueEventHandlerRef *EventHandlerRef;
+typedef struct OpaqueEventTargetRef *EventTargetRef;
+typedef OSStatus (*EventHandlerProcPtr)(EventHandlerCallRef HandlerCallRef, EventRef Event, void *UserData);
+typedef EventHandlerProcPtr EventHandlerUPP;
+struct EventTypeSpec { UInt32 eventClass; UInt32 eventKind; };
+struct ProcessSerialNumber { UInt32 highLongOfPSN; UInt32 lowLongOfPSN; };
+typedef unsigned char Str255[256];
+typedef const unsigned char *ConstStr255Param;
+struct ProcessInfoRec
+{
+    UInt32 processInfoLength;
+    unsigned char *processName;
+    ProcessSerialNumber processNumber;
+    UInt32 processType;
+    UInt32 processSignature;
+    UInt32 processMode;
+};
+
+enum
+{
+    kAXErrorSuccess = 0,
+    kAXErrorFailure = -25200,
+    kAXErrorIllegalArgument = -25201,
+    kAXErrorInvalidUIElement = -25202,
+    kAXErrorCannotComplete = -25204,
+    kAXErrorAttributeUnsupported = -25205,
+    kAXErrorNotificationUnsupported = -25207,
+    kAXErrorNoValue = -25212,
+};
+
+enum
+{
+    kAXValueTypeCGPoint = 1,
+    kAXValueTypeCGSize = 2,
+};
+
+enum
+{
+    kCGEventLeftMouseDown = 1,
+    kCGEventLeftMouseUp = 2,
+    kCGEventRightMouseDown = 3,
+    kCGEventRightMouseUp = 4,
+    kCGEventMouseMoved = 5,
+    kCGEventLeftMouseDragged = 6,
+    kCGEventRightMouseDragged = 7,
+    kCGEventKeyDown = 10,
+    kCGEventKeyUp = 11,
+    kCGEventFlagsChanged = 12,
+};
+
+enum
+{
+    kCGEventFlagMaskAlphaShift = 0x00010000,
+    kCGEventFlagMaskShift = 0x00020000,
+    kCGEventFlagMaskControl = 0x00040000,
+    kCGEventFlagMaskAlternate = 0x00080000,
+    kCGEventFlagMaskCommand = 0x00100000,
+    kCGEventFlagMaskSecondaryFn = 0x00800000,
+};
+
+enum
+{
+    kCGWindowListOptionOnScreenOnly = (1 << 0),
+    kCGWindowListExcludeDesktopElements = (1 << 4),
+};
+
+enum
+{
+    kCFStringEncodingMacRoman = 0,
+    kCFStringEncodingUTF8 = 0x08000100,
+};
+
+enum
+{
+    kCFNumberSInt32Type = 3,
+    kCFNumberSInt64Type = 4,
+    kCFNumberDoubleType = 13,
+};
+
+enum
+{
+    kEventClassApplication = 0x6170706C,
+    kEventAppLaunched = 5,
+    kEventAppTerminated = 6,
+    kEventParamProcessID = 0x70736E20,
+    typeProcessSerialNumber = 0x70736E20,
+};
+
+#define noErr 0
+#define kCGErrorSuccess 0
+#define kCFCompareEqualTo 0
+#define kCGNullWindowID 0
+#define kSetFrontProcessFrontWindowOnly (1 << 0)
+#define modeOnlyBackground 0x00000400
+
+/* NOTE(koekeishiya): Like the SDK, a CFSTR literal is created once and never released. */
+#define CFSTR(String) __CFStringMakeConstantString("" String "")
+#define kCFAllocatorDefault ((CFAllocatorRef) NULL)
+
+extern const CFBooleanRef kCFBooleanTrue;
+extern const CFBooleanRef kCFBooleanFalse;
+extern const CFStringRef kCFRunLoopDefaultMode;
+extern const CFStringRef kCFRunLoopCommonModes;
+
+extern const CFStringRef kAXWindowCreatedNotification;
+extern const CFStringRef kAXFocusedWindowChangedNotification;
+extern const CFStringRef kAXWindowMovedNotification;
+extern const CFStringRef kAXWindowResizedNotification;
+extern const CFStringRef kAXTitleChangedNotification;
+extern const CFStringRef kAXUIElementDestroyedNotification;
+extern const CFStringRef kAXWindowMiniaturizedNotification;
+extern const CFStringRef kAXWindowDeminiaturizedNotification;
+
+extern const CFStringRef kAXPositionAttribute;
+extern const CFStringRef kAXSizeAttribute;
+extern const CFStringRef kAXTitleAttribute;
+extern const CFStringRef kAXRoleAttribute;
+extern const CFStringRef kAXSubroleAttribute;
+extern const CFStringRef kAXWindowsAttribute;
+extern const CFStringRef kAXFocusedWindowAttribute;
+extern const CFStringRef kAXFocusedApplicationAttribute;
+extern const CFStringRef kAXMainAttribute;
+extern const CFStringRef kAXFocusedAttribute;
+extern const CFStringRef kAXMinimizedAttribute;
+extern const CFStringRef kAXRaiseAction;
+extern const CFStringRef kAXWindowRole;
+extern const CFStringRef kAXStandardWindowSubrole;
+
+CFStringRef __CFStringMakeConstantString(const char *String);
+CFTypeRef CFRetain(CFTypeRef Object);
+void CFRelease(CFTypeRef Object);
+Boolean CFEqual(CFTypeRef First, CFTypeRef Second);
+
+CFStringRef CFStringCreateWithCString(CFAllocatorRef Allocator, const char *String, CFStringEncoding Encoding);
+CFIndex CFStringGetLength(CFStringRef String);
+CFIndex CFStringGetMaximumSizeForEncoding(CFIndex Length, CFStringEncoding Encoding);
+Boolean CFStringGetCString(CFStringRef String, char *Buffer, CFIndex BufferSize, CFStringEncoding Encoding);
+CFComparisonResult CFStringCompare(CFStringRef First, CFStringRef Second, CFStringCompareFlags Options);
+
+Boolean CFBooleanGetValue(CFBooleanRef Boolean);
+CFIndex CFArrayGetCount(CFArrayRef Array);
+const void *CFArrayGetValueAtIndex(CFArrayRef Array, CFIndex Index);
+const void *CFDictionaryGetValue(CFDictionaryRef Dictionary, const void *Key);
+Boolean CFNumberGetValue(CFNumberRef Number, CFNumberType Type, void *Value);
+
+CFRunLoopRef CFRunLoopGetMain();
+void CFRunLoopAddSource(CFRunLoopRef RunLoop, CFRunLoopSourceRef Source, CFStringRef Mode);
+Boolean CFRunLoopContainsSource(CFRunLoopRef RunLoop, CFRunLoopSourceRef Source, CFStringRef Mode);
+void CFRunLoopSourceInvalidate(CFRunLoopSourceRef Source);
+
+CGPoint CGPointMake(CGFloat X, CGFloat Y);
+CGSize CGSizeMake(CGFloat Width, CGFloat Height);
+bool CGRectContainsPoint(CGRect Rect, CGPoint Point);
+CGRect CGRectIntersection(CGRect First, CGRect Second);
+bool CGRectMakeWithDictionaryRepresentation(CFDictionaryRef Dictionary, CGRect *Rect);
+
+CGEventRef CGEventCreate(CGEventSourceRef Source);
+CGPoint CGEventGetLocation(CGEventRef Event);
+CGEventFlags CGEventGetFlags(CGEventRef Event);
+CGError CGWarpMouseCursorPosition(CGPoint Point);
+CFArrayRef CGWindowListCopyWindowInfo(CGWindowListOption Option, CGWindowID RelativeToWindow);
+
+AXUIElementRef AXUIElementCreateSystemWide();
+AXUIElementRef AXUIElementCreateApplication(pid_t PID);
+AXError AXUIElementGetPid(AXUIElementRef Element, pid_t *PID);
+AXError AXUIElementSetMessagingTimeout(AXUIElementRef Element, float Timeout);
+AXError AXUIElementCopyAttributeValue(AXUIElementRef Element, CFStringRef Attribute, CFTypeRef *Value);
+AXError AXUIElementSetAttributeValue(AXUIElementRef Element, CFStringRef Attribute, CFTypeRef Value);
+AXError AXUIElementIsAttributeSettable(AXUIElementRef Element, CFStringRef Attribute, Boolean *Settable);
+AXError AXUIElementPerformAction(AXUIElementRef Element, CFStringRef Action);
+AXValueRef AXValueCreate(AXValueType Type, const void *Value);
+Boolean AXValueGetValue(AXValueRef Value, AXValueType Type, void *Result);
+
+AXError AXObserverCreate(pid_t PID, AXObserverCallback Callback, AXObserverRef *Observer);
+AXError AXObserverAddNotification(AXObserverRef Observer, AXUIElementRef Element, CFStringRef Notification, void *Refcon);
+AXError AXObserverRemoveNotification(AXObserverRef Observer, AXUIElementRef Element, CFStringRef Notification);
+CFRunLoopSourceRef AXObserverGetRunLoopSource(AXObserverRef Observer);
+
+OSErr GetProcessForPID(pid_t PID, ProcessSerialNumber *PSN);
+OSErr GetProcessInformation(const ProcessSerialNumber *PSN, ProcessInfoRec *Info);
+OSStatus GetProcessPID(const ProcessSerialNumber *PSN, pid_t *PID);
+OSErr SetFrontProcessWithOptions(const ProcessSerialNumber *PSN, OptionBits Options);
+
+EventHandlerUPP NewEventHandlerUPP(EventHandlerProcPtr Handler);
+EventTargetRef GetApplicationEventTarget();
+OSStatus InstallEventHandler(EventTargetRef Target, EventHandlerUPP Handler, ItemCount Count,
+                             const EventTypeSpec *Types, void *UserData, EventHandlerRef *Result);
+OSStatus GetEventParameter(EventRef Event, EventParamName Name, EventParamType DesiredType, EventParamType *ActualType,
+                           ByteCount BufferSize, ByteCount *ActualSize, void *Data);
+UInt32 GetEventKind(EventRef Event);
+
+#include <dispatch/dispatch.h>
+
+#endif
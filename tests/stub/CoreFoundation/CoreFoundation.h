@@ -0,0 +1,6 @@
+#ifndef STUB_COREFOUNDATION_H
+#define STUB_COREFOUNDATION_H
+
+#include <Carbon/Carbon.h>
+
+#endif
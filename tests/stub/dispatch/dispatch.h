@@ -0,0 +1,24 @@
+#ifndef STUB_DISPATCH_H
+#define STUB_DISPATCH_H
+
+/* NOTE(koekeishiya): There is only one queue. A block given to dispatch_after_f runs on the thread
+ * that calls StubRunLoop, once its time has come, the way the main queue runs with the run loop. */
+
+#include <stdint.h>
+
+typedef long dispatch_once_t;
+typedef uint64_t dispatch_time_t;
+typedef struct stub_dispatch_queue *dispatch_queue_t;
+typedef void (*dispatch_function_t)(void *Context);
+
+#define DISPATCH_TIME_NOW (0ull)
+#define NSEC_PER_USEC 1000ull
+#define NSEC_PER_MSEC 1000000ull
+#define NSEC_PER_SEC 1000000000ull
+
+void dispatch_once_f(dispatch_once_t *Predicate, void *Context, dispatch_function_t Function);
+dispatch_time_t dispatch_time(dispatch_time_t When, int64_t Delta);
+dispatch_queue_t dispatch_get_main_queue();
+void dispatch_after_f(dispatch_time_t When, dispatch_queue_t Queue, void *Context, dispatch_function_t Function);
+
+#endif
@@ -0,0 +1,214 @@
+#include "../../axlib/display.h"
+#include "../../axlib/window.h"
+#include "../../axlib/axlib.h"
+#include "windowsystem.h"
+
+#define internal static
+
+/* NOTE(koekeishiya): Stands in for axlib/display.mm. There is one display that is never
+ * reconfigured, and a space transition is never animated. What display.mm records is recorded
+ * here in the same way. */
+internal std::map<CGDirectDisplayID, ax_display> *Displays;
+
+internal ax_space
+StubConstructSpace(CGSSpaceID SpaceID)
+{
+    ax_space Space = {};
+    Space.Identifier = "stub-space-" + std::to_string(SpaceID);
+    Space.ID = SpaceID;
+    Space.Type = kCGSSpaceUser;
+    return Space;
+}
+
+void AXLibInitializeDisplays(std::map<CGDirectDisplayID, ax_display> *AXDisplays)
+{
+    Displays = AXDisplays;
+    if(AXLibReplayDisplays(Displays))
+        return;
+
+    ax_display Display = {};
+    Display.ID = STUB_DISPLAY_ID;
+    Display.ArrangementID = 0;
+    Display.Identifier = CFStringCreateWithCString(NULL, "stub-display", kCFStringEncodingUTF8);
+    Display.Frame.size = CGSizeMake(STUB_DISPLAY_WIDTH, STUB_DISPLAY_HEIGHT);
+    for(CGSSpaceID SpaceID = 1; SpaceID <= STUB_SPACE_COUNT; ++SpaceID)
+        Display.Spaces[SpaceID] = StubConstructSpace(SpaceID);
+
+    (*Displays)[Display.ID] = Display;
+    ax_display *Stored = &(*Displays)[Display.ID];
+    Stored->Space = &Stored->Spaces[StubGetActiveSpace()];
+    Stored->PrevSpace = Stored->Space;
+    AXLibRecordDisplays(Displays);
+}
+
+ax_display *AXLibMainDisplay()
+{
+    CGDirectDisplayID MainDisplay;
+    if(AXLibReplayResponse(AXQuery_MainDisplay, &MainDisplay, sizeof(MainDisplay)))
+        return &(*Displays)[MainDisplay];
+
+    MainDisplay = STUB_DISPLAY_ID;
+    AXLibRecordResponse(AXQuery_MainDisplay, &MainDisplay, sizeof(MainDisplay));
+    return &(*Displays)[MainDisplay];
+}
+
+ax_display *AXLibCursorDisplay()
+{
+    CGPoint Cursor = AXLibGetCursorPos();
+
+    std::map<CGDirectDisplayID, ax_display>::iterator It;
+    for(It = Displays->begin(); It != Displays->end(); ++It)
+    {
+        if(CGRectContainsPoint(It->second.Frame, Cursor))
+            return &It->second;
+    }
+
+    return NULL;
+}
+
+ax_display *AXLibWindowDisplay(ax_window *Window)
+{
+    CGRect Frame = { Window->Position, Window->Size };
+    std::map<CGDirectDisplayID, ax_display>::iterator It;
+    for(It = Displays->begin(); It != Displays->end(); ++It)
+    {
+        CGRect Intersection = CGRectIntersection(Frame, It->second.Frame);
+        if(Intersection.size.width * Intersection.size.height > 0)
+            return &It->second;
+    }
+
+    return AXLibMainDisplay();
+}
+
+ax_display *AXLibSpaceDisplay(CGSSpaceID SpaceID)
+{
+    std::map<CGDirectDisplayID, ax_display>::iterator It;
+    for(It = Displays->begin(); It != Displays->end(); ++It)
+    {
+        if(It->second.Spaces.find(SpaceID) != It->second.Spaces.end())
+            return &It->second;
+    }
+
+    return NULL;
+}
+
+ax_display *AXLibNextDisplay(ax_display *Display)
+{
+    return Display;
+}
+
+ax_display *AXLibPreviousDisplay(ax_display *Display)
+{
+    return Display;
+}
+
+ax_display *AXLibArrangementDisplay(unsigned int ArrangementID)
+{
+    std::map<CGDirectDisplayID, ax_display>::iterator It;
+    for(It = Displays->begin(); It != Displays->end(); ++It)
+    {
+        if(It->second.ArrangementID == ArrangementID)
+            return &It->second;
+    }
+
+    return NULL;
+}
+
+ax_space *AXLibGetActiveSpace(ax_display *Display)
+{
+    CGSSpaceID SpaceID;
+    if(!AXLibReplayResponse(AXQuery_ActiveSpace, &SpaceID, sizeof(SpaceID)))
+    {
+        SpaceID = StubGetActiveSpace();
+        AXLibRecordResponse(AXQuery_ActiveSpace, &SpaceID, sizeof(SpaceID));
+    }
+
+    return &Display->Spaces[SpaceID];
+}
+
+void AXLibSpaceTransition(ax_display *Display, CGSSpaceID SpaceID)
+{
+    if(!AXLibIsReplayingEvents())
+        StubSetActiveSpace(SpaceID);
+}
+
+bool AXLibRefreshSpaceTransition()
+{
+    return false;
+}
+
+bool AXLibIsSpaceTransitionInProgress()
+{
+    return false;
+}
+
+bool AXLibDisplayHasSeparateSpaces()
+{
+    return true;
+}
+
+unsigned int AXLibDisplaySpacesCount(ax_display *Display)
+{
+    unsigned int Result;
+    if(AXLibReplayResponse(AXQuery_SpacesCount, &Result, sizeof(Result)))
+        return Result;
+
+    Result = STUB_SPACE_COUNT;
+    AXLibRecordResponse(AXQuery_SpacesCount, &Result, sizeof(Result));
+    return Result;
+}
+
+/* NOTE(koekeishiya): The spaces are numbered from 1, like desktops are. */
+unsigned int AXLibDesktopIDFromCGSSpaceID(ax_display *Display, CGSSpaceID SpaceID)
+{
+    unsigned int Result;
+    if(AXLibReplayResponse(AXQuery_DesktopID, &Result, sizeof(Result)))
+        return Result;
+
+    Result = SpaceID >= 1 && SpaceID <= STUB_SPACE_COUNT ? SpaceID : 0;
+    AXLibRecordResponse(AXQuery_DesktopID, &Result, sizeof(Result));
+    return Result;
+}
+
+CGSSpaceID AXLibCGSSpaceIDFromDesktopID(ax_display *Display, unsigned int DesktopID)
+{
+    CGSSpaceID Result;
+    if(AXLibReplayResponse(AXQuery_SpaceID, &Result, sizeof(Result)))
+        return Result;
+
+    Result = DesktopID >= 1 && DesktopID <= STUB_SPACE_COUNT ? DesktopID : 0;
+    AXLibRecordResponse(AXQuery_SpaceID, &Result, sizeof(Result));
+    return Result;
+}
+
+bool AXLibStickyWindow(ax_window *Window)
+{
+    bool Result;
+    if(AXLibReplayResponse(AXQuery_StickyWindow, &Result, sizeof(Result)))
+        return Result;
+
+    Result = false;
+    AXLibRecordResponse(AXQuery_StickyWindow, &Result, sizeof(Result));
+    return Result;
+}
+
+bool AXLibSpaceHasWindow(ax_window *Window, CGSSpaceID SpaceID)
+{
+    bool Result;
+    if(AXLibReplayResponse(AXQuery_SpaceHasWindow, &Result, sizeof(Result)))
+        return Result;
+
+    Result = StubGetWindowSpace(Window->ID) == SpaceID;
+    AXLibRecordResponse(AXQuery_SpaceHasWindow, &Result, sizeof(Result));
+    return Result;
+}
+
+void AXLibSpaceAddWindow(CGSSpaceID SpaceID, uint32_t WindowID)
+{
+    if(!AXLibIsReplayingEvents())
+        StubSetWindowSpace(WindowID, SpaceID);
+}
+
+void AXLibSpaceRemoveWindow(CGSSpaceID SpaceID, uint32_t WindowID)
+{
+}
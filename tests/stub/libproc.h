@@ -0,0 +1,10 @@
+#ifndef STUB_LIBPROC_H
+#define STUB_LIBPROC_H
+
+#include <stdint.h>
+
+#define PROC_PIDPATHINFO_MAXSIZE 4096
+
+int proc_pidpath(int PID, void *Buffer, uint32_t BufferSize);
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef STUB_MACH_TIME_H
+#define STUB_MACH_TIME_H
+
+#include <stdint.h>
+
+struct mach_timebase_info_data_t
+{
+    uint32_t numer;
+    uint32_t denom;
+};
+
+typedef int kern_return_t;
+
+/* NOTE(koekeishiya): Counts nanoseconds of CLOCK_MONOTONIC, with a timebase of 1 / 1. */
+uint64_t mach_absolute_time();
+kern_return_t mach_timebase_info(mach_timebase_info_data_t *Info);
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef STUB_OBJC_MESSAGE_H
+#define STUB_OBJC_MESSAGE_H
+
+#include <objc/runtime.h>
+
+extern "C" void objc_msgSend();
+
+#endif
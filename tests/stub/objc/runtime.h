@@ -0,0 +1,14 @@
+#ifndef STUB_OBJC_RUNTIME_H
+#define STUB_OBJC_RUNTIME_H
+
+/* NOTE(koekeishiya): Enough of the runtime for the overlay bridge in kwm/border.cpp. There is no
+ * overlay on Linux, the stub class answers every message with 0. */
+
+typedef struct objc_class *Class;
+typedef struct objc_object *id;
+typedef struct objc_selector *SEL;
+
+Class objc_getClass(const char *Name);
+SEL sel_getUid(const char *Name);
+
+#endif
@@ -0,0 +1,59 @@
+#include "../../axlib/sharedworkspace.h"
+#include "../../axlib/axlib.h"
+#include "windowsystem.h"
+
+#define internal static
+
+/* NOTE(koekeishiya): Stands in for axlib/sharedworkspace.mm. The notifications are delivered by
+ * StubRunLoop, and start the same sources as those of the WorkspaceWatcher. No application is
+ * ever hidden. */
+internal bool Watching;
+
+void SharedWorkspaceInitialize()
+{
+    Watching = true;
+}
+
+shared_ws_map SharedWorkspaceRunningApplications()
+{
+    return StubGetApplications();
+}
+
+void SharedWorkspaceActivateApplication(pid_t PID)
+{
+    StubActivateApplication(PID);
+}
+
+bool SharedWorkspaceIsApplicationActive(pid_t PID)
+{
+    return StubGetActiveApplication() == PID;
+}
+
+bool SharedWorkspaceIsApplicationHidden(pid_t PID)
+{
+    return false;
+}
+
+void SharedWorkspaceDidChangeActiveSpace()
+{
+    if(!Watching)
+        return;
+
+    ax_event Event = {};
+    Event.Name = "SharedWorkspaceActiveSpaceChanged";
+    Event.Handle = &SharedWorkspaceActiveSpaceChanged;
+    AXLibRunEventSource(&Event);
+    AXLibUpdateSpaceTransition();
+}
+
+void SharedWorkspaceDidActivateApplication(pid_t PID)
+{
+    if(!Watching)
+        return;
+
+    ax_event Event = {};
+    Event.Name = "SharedWorkspaceApplicationActivated";
+    Event.Handle = &SharedWorkspaceApplicationActivated;
+    Event.Payload = AXLibPIDPayload(PID);
+    AXLibRunEventSource(&Event);
+}
@@ -0,0 +1,1387 @@
+#include "windowsystem.h"
+
+#include <mach/mach_time.h>
+#include <objc/runtime.h>
+#include <libproc.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <map>
+
+#define internal static
+
+/* NOTE(koekeishiya): Every CF object that the stub hands out starts with a stub_object, the opaque
+ * SDK types are cast to and from it. Immortal objects, the CFSTR literals, booleans and numbers, are
+ * never freed. AXLib releases numbers that it got from a dictionary, which macOS forgives because
+ * small numbers are tagged pointers; interning them forgives it here. */
+enum stub_object_type
+{
+    StubObject_String,
+    StubObject_Boolean,
+    StubObject_Number,
+    StubObject_Array,
+    StubObject_Dictionary,
+    StubObject_Value,
+    StubObject_Element,
+    StubObject_Observer,
+    StubObject_Event,
+};
+
+struct stub_object
+{
+    stub_object_type Type;
+    int RefCount;
+    bool Immortal;
+
+    stub_object(stub_object_type ObjectType) : Type(ObjectType), RefCount(1), Immortal(false) {}
+    virtual ~stub_object() {}
+};
+
+struct stub_string : stub_object
+{
+    std::string Value;
+    stub_string(std::string String) : stub_object(StubObject_String), Value(String) {}
+};
+
+struct stub_boolean : stub_object
+{
+    bool Value;
+    stub_boolean(bool Boolean) : stub_object(StubObject_Boolean), Value(Boolean) { Immortal = true; }
+};
+
+struct stub_number : stub_object
+{
+    double Value;
+    stub_number(double Number) : stub_object(StubObject_Number), Value(Number) { Immortal = true; }
+};
+
+struct stub_array : stub_object
+{
+    std::vector<CFTypeRef> Values;
+    stub_array() : stub_object(StubObject_Array) {}
+    ~stub_array();
+};
+
+struct stub_dictionary : stub_object
+{
+    std::vector<CFTypeRef> Keys;
+    std::vector<CFTypeRef> Values;
+    stub_dictionary() : stub_object(StubObject_Dictionary) {}
+    ~stub_dictionary();
+};
+
+struct stub_value : stub_object
+{
+    AXValueType ValueType;
+    CGPoint Point;
+    CGSize Size;
+    stub_value(AXValueType Type) : stub_object(StubObject_Value), ValueType(Type), Point(), Size() {}
+};
+
+enum stub_element_kind
+{
+    StubElement_SystemWide,
+    StubElement_Application,
+    StubElement_Window,
+};
+
+struct stub_element : stub_object
+{
+    stub_element_kind Kind;
+    pid_t PID;
+    uint32_t WindowID;
+    stub_element(stub_element_kind ElementKind, pid_t ElementPID, uint32_t ElementWindowID)
+        : stub_object(StubObject_Element), Kind(ElementKind), PID(ElementPID), WindowID(ElementWindowID) {}
+};
+
+struct stub_registration
+{
+    stub_element_kind Kind;
+    uint32_t WindowID;
+    std::string Notification;
+    void *Refcon;
+};
+
+struct stub_observer : stub_object
+{
+    pid_t PID;
+    AXObserverCallback Callback;
+    std::vector<stub_registration> Registrations;
+    bool Scheduled;
+    stub_observer(pid_t ObserverPID, AXObserverCallback ObserverCallback)
+        : stub_object(StubObject_Observer), PID(ObserverPID), Callback(ObserverCallback), Scheduled(false) {}
+    ~stub_observer();
+};
+
+struct stub_event : stub_object
+{
+    CGPoint Location;
+    stub_event(CGPoint Cursor) : stub_object(StubObject_Event), Location(Cursor) {}
+};
+
+struct stub_window
+{
+    uint32_t ID;
+    pid_t PID;
+    std::string Title;
+    CGRect Frame;
+    int Space;
+};
+
+struct stub_application
+{
+    pid_t PID;
+    std::string Name;
+    uint32_t Focus;
+};
+
+enum stub_notification_type
+{
+    StubNotification_Observer,
+    StubNotification_Carbon,
+    StubNotification_Activated,
+    StubNotification_SpaceChanged,
+};
+
+/* NOTE(koekeishiya): A notification of the observer kind goes to the registration on the window
+ * if Window is set, otherwise to the registration on the application, with the window as the
+ * element. Kind is the carbon event kind. */
+struct stub_notification
+{
+    stub_notification_type Type;
+    pid_t PID;
+    uint32_t WindowID;
+    bool Window;
+    std::string Name;
+    UInt32 Kind;
+};
+
+struct stub_dispatch
+{
+    dispatch_time_t When;
+    void *Context;
+    dispatch_function_t Function;
+};
+
+struct stub_carbon_event
+{
+    ProcessSerialNumber PSN;
+    UInt32 Kind;
+};
+
+struct stub_world
+{
+    std::map<pid_t, stub_application> Applications;
+    std::map<uint32_t, stub_window> Windows;
+    std::vector<uint32_t> Order;
+    std::vector<stub_observer *> Observers;
+    std::vector<stub_notification> Notifications;
+    std::vector<stub_dispatch> Dispatches;
+    pid_t Active;
+    int Space;
+    uint32_t NextWindowID;
+    CGPoint Cursor;
+    EventHandlerUPP CarbonHandler;
+    void *CarbonContext;
+};
+
+internal pthread_mutex_t WorldLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+internal stub_world World = { {}, {}, {}, {}, {}, {}, 0, 1, 1, {}, NULL, NULL };
+
+internal inline stub_object *
+StubObject(CFTypeRef Object)
+{
+    return (stub_object *) Object;
+}
+
+internal inline bool
+StubIsType(CFTypeRef Object, stub_object_type Type)
+{
+    return Object && StubObject(Object)->Type == Type;
+}
+
+stub_array::~stub_array()
+{
+    for(std::size_t Index = 0; Index < Values.size(); ++Index)
+        CFRelease(Values[Index]);
+}
+
+stub_dictionary::~stub_dictionary()
+{
+    for(std::size_t Index = 0; Index < Keys.size(); ++Index)
+    {
+        CFRelease(Keys[Index]);
+        CFRelease(Values[Index]);
+    }
+}
+
+stub_observer::~stub_observer()
+{
+    pthread_mutex_lock(&WorldLock);
+    World.Observers.erase(std::remove(World.Observers.begin(), World.Observers.end(), this), World.Observers.end());
+    pthread_mutex_unlock(&WorldLock);
+}
+
+internal CFStringRef
+StubString(std::string Value)
+{
+    return (CFStringRef) new stub_string(Value);
+}
+
+internal CFNumberRef
+StubNumber(double Value)
+{
+    static pthread_mutex_t NumberLock = PTHREAD_MUTEX_INITIALIZER;
+    static std::map<double, stub_number *> *Numbers = new std::map<double, stub_number *>();
+
+    pthread_mutex_lock(&NumberLock);
+    stub_number *&Number = (*Numbers)[Value];
+    if(!Number)
+        Number = new stub_number(Value);
+    pthread_mutex_unlock(&NumberLock);
+
+    return (CFNumberRef) Number;
+}
+
+internal AXUIElementRef
+StubElement(stub_element_kind Kind, pid_t PID, uint32_t WindowID)
+{
+    return (AXUIElementRef) new stub_element(Kind, PID, WindowID);
+}
+
+internal stub_element *
+StubGetElement(AXUIElementRef Element)
+{
+    return StubIsType(Element, StubObject_Element) ? (stub_element *) Element : NULL;
+}
+
+internal std::string
+StubGetString(CFStringRef String)
+{
+    return StubIsType(String, StubObject_String) ? ((stub_string *) String)->Value : std::string();
+}
+
+internal void
+StubDictionarySet(stub_dictionary *Dictionary, const char *Key, CFTypeRef Value)
+{
+    Dictionary->Keys.push_back(StubString(Key));
+    Dictionary->Values.push_back(Value);
+}
+
+/* NOTE(koekeishiya): The functions below expect WorldLock to be held. */
+internal stub_window *
+StubFindWindow(uint32_t WindowID)
+{
+    std::map<uint32_t, stub_window>::iterator It = World.Windows.find(WindowID);
+    return It != World.Windows.end() ? &It->second : NULL;
+}
+
+internal stub_application *
+StubFindApplication(pid_t PID)
+{
+    std::map<pid_t, stub_application>::iterator It = World.Applications.find(PID);
+    return It != World.Applications.end() ? &It->second : NULL;
+}
+
+internal void
+StubPostNotification(stub_notification_type Type, pid_t PID, uint32_t WindowID, bool Window,
+                     std::string Name, UInt32 Kind)
+{
+    stub_notification Notification = { Type, PID, WindowID, Window, Name, Kind };
+    World.Notifications.push_back(Notification);
+}
+
+internal void
+StubPostWindowNotification(stub_window *Window, CFStringRef Notification)
+{
+    StubPostNotification(StubNotification_Observer, Window->PID, Window->ID, false, StubGetString(Notification), 0);
+}
+
+internal void
+StubRaiseWindow(uint32_t WindowID)
+{
+    World.Order.erase(std::remove(World.Order.begin(), World.Order.end(), WindowID), World.Order.end());
+    World.Order.insert(World.Order.begin(), WindowID);
+}
+
+internal void
+StubSetApplicationFocus(stub_application *Application, uint32_t WindowID)
+{
+    stub_window *Window = StubFindWindow(WindowID);
+    if(!Window || Application->Focus == WindowID)
+        return;
+
+    Application->Focus = WindowID;
+    StubRaiseWindow(WindowID);
+    StubPostWindowNotification(Window, kAXFocusedWindowChangedNotification);
+}
+
+internal void
+StubSetActiveApplication(pid_t PID)
+{
+    if(World.Active == PID || !StubFindApplication(PID))
+        return;
+
+    World.Active = PID;
+    StubPostNotification(StubNotification_Activated, PID, 0, false, "", 0);
+}
+
+void StubAddApplication(pid_t PID, std::string Name)
+{
+    pthread_mutex_lock(&WorldLock);
+    stub_application Application = { PID, Name, 0 };
+    World.Applications[PID] = Application;
+    if(!World.Active)
+        World.Active = PID;
+    pthread_mutex_unlock(&WorldLock);
+}
+
+void StubLaunchApplication(pid_t PID, std::string Name)
+{
+    StubAddApplication(PID, Name);
+
+    pthread_mutex_lock(&WorldLock);
+    StubPostNotification(StubNotification_Carbon, PID, 0, false, "", kEventAppLaunched);
+    pthread_mutex_unlock(&WorldLock);
+}
+
+/* NOTE(koekeishiya): Like most applications, a window that is created by the active application
+ * also becomes its focused window, and macOS reports that before the window is created. */
+uint32_t StubCreateWindow(pid_t PID, std::string Title, CGRect Frame)
+{
+    pthread_mutex_lock(&WorldLock);
+    uint32_t WindowID = 0;
+    stub_application *Application = StubFindApplication(PID);
+    if(Application)
+    {
+        WindowID = World.NextWindowID++;
+        stub_window Window = { WindowID, PID, Title, Frame, World.Space };
+        World.Windows[WindowID] = Window;
+        World.Order.push_back(WindowID);
+
+        if(World.Active == PID)
+            StubSetApplicationFocus(Application, WindowID);
+
+        StubPostWindowNotification(StubFindWindow(WindowID), kAXWindowCreatedNotification);
+    }
+    pthread_mutex_unlock(&WorldLock);
+
+    return WindowID;
+}
+
+void StubDestroyWindow(uint32_t WindowID)
+{
+    pthread_mutex_lock(&WorldLock);
+    stub_window *Window = StubFindWindow(WindowID);
+    if(Window)
+    {
+        pid_t PID = Window->PID;
+        StubPostNotification(StubNotification_Observer, PID, WindowID, true,
+                             StubGetString(kAXUIElementDestroyedNotification), 0);
+
+        World.Windows.erase(WindowID);
+        World.Order.erase(std::remove(World.Order.begin(), World.Order.end(), WindowID), World.Order.end());
+
+        stub_application *Application = StubFindApplication(PID);
+        if(Application && Application->Focus == WindowID)
+        {
+            Application->Focus = 0;
+            for(std::size_t Index = 0; Index < World.Order.size(); ++Index)
+            {
+                stub_window *Next = StubFindWindow(World.Order[Index]);
+                if(Next->PID == PID && Next->Space == World.Space)
+                {
+                    StubSetApplicationFocus(Application, Next->ID);
+                    break;
+                }
+            }
+        }
+    }
+    pthread_mutex_unlock(&WorldLock);
+}
+
+/* NOTE(koekeishiya): What a click on the window does: its application is activated and the
+ * window becomes its focused window. */
+void StubFocusWindow(uint32_t WindowID)
+{
+    pthread_mutex_lock(&WorldLock);
+    stub_window *Window = StubFindWindow(WindowID);
+    if(Window)
+    {
+        StubSetActiveApplication(Window->PID);
+        StubSetApplicationFocus(StubFindApplication(Window->PID), WindowID);
+    }
+    pthread_mutex_unlock(&WorldLock);
+}
+
+bool StubGetWindowFrame(uint32_t WindowID, CGRect *Frame)
+{
+    pthread_mutex_lock(&WorldLock);
+    stub_window *Window = StubFindWindow(WindowID);
+    if(Window)
+        *Frame = Window->Frame;
+    pthread_mutex_unlock(&WorldLock);
+
+    return Window != NULL;
+}
+
+void StubSetCursor(CGPoint Cursor)
+{
+    pthread_mutex_lock(&WorldLock);
+    World.Cursor = Cursor;
+    pthread_mutex_unlock(&WorldLock);
+}
+
+void StubSetActiveSpace(int SpaceID)
+{
+    pthread_mutex_lock(&WorldLock);
+    if(SpaceID >= 1 && SpaceID <= STUB_SPACE_COUNT && SpaceID != World.Space)
+    {
+        World.Space = SpaceID;
+        StubPostNotification(StubNotification_SpaceChanged, 0, 0, false, "", 0);
+    }
+    pthread_mutex_unlock(&WorldLock);
+}
+
+int StubGetActiveSpace()
+{
+    pthread_mutex_lock(&WorldLock);
+    int Result = World.Space;
+    pthread_mutex_unlock(&WorldLock);
+    return Result;
+}
+
+int StubGetWindowSpace(uint32_t WindowID)
+{
+    pthread_mutex_lock(&WorldLock);
+    stub_window *Window = StubFindWindow(WindowID);
+    int Result = Window ? Window->Space : 0;
+    pthread_mutex_unlock(&WorldLock);
+    return Result;
+}
+
+void StubSetWindowSpace(uint32_t WindowID, int SpaceID)
+{
+    pthread_mutex_lock(&WorldLock);
+    stub_window *Window = StubFindWindow(WindowID);
+    if(Window)
+        Window->Space = SpaceID;
+    pthread_mutex_unlock(&WorldLock);
+}
+
+std::map<pid_t, std::string> StubGetApplications()
+{
+    std::map<pid_t, std::string> Result;
+    pthread_mutex_lock(&WorldLock);
+    std::map<pid_t, stub_application>::iterator It;
+    for(It = World.Applications.begin(); It != World.Applications.end(); ++It)
+        Result[It->first] = It->second.Name;
+    pthread_mutex_unlock(&WorldLock);
+    return Result;
+}
+
+pid_t StubGetActiveApplication()
+{
+    pthread_mutex_lock(&WorldLock);
+    pid_t Result = World.Active;
+    pthread_mutex_unlock(&WorldLock);
+    return Result;
+}
+
+void StubActivateApplication(pid_t PID)
+{
+    pthread_mutex_lock(&WorldLock);
+    StubSetActiveApplication(PID);
+    pthread_mutex_unlock(&WorldLock);
+}
+
+/* NOTE(koekeishiya): The callback is looked up when the notification is delivered, an observer that
+ * was removed or unscheduled since it was posted does not get it. */
+internal bool
+StubDeliverObserverNotification(stub_notification *Notification)
+{
+    pthread_mutex_lock(&WorldLock);
+    AXObserverCallback Callback = NULL;
+    AXObserverRef Observer = NULL;
+    void *Refcon = NULL;
+    stub_element_kind Kind = Notification->Window ? StubElement_Window : StubElement_Application;
+    for(std::size_t Index = 0; Index < World.Observers.size() && !Callback; ++Index)
+    {
+        stub_observer *Candidate = World.Observers[Index];
+        if(Candidate->PID != Notification->PID || !Candidate->Scheduled)
+            continue;
+
+        for(std::size_t Entry = 0; Entry < Candidate->Registrations.size(); ++Entry)
+        {
+            stub_registration *Registration = &Candidate->Registrations[Entry];
+            if(Registration->Kind == Kind &&
+               Registration->Notification == Notification->Name &&
+               (Kind == StubElement_Application || Registration->WindowID == Notification->WindowID))
+            {
+                Callback = Candidate->Callback;
+                Observer = (AXObserverRef) Candidate;
+                Refcon = Registration->Refcon;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&WorldLock);
+
+    if(!Callback)
+        return false;
+
+    AXUIElementRef Element = StubElement(StubElement_Window, Notification->PID, Notification->WindowID);
+    (*Callback)(Observer, Element, __CFStringMakeConstantString(Notification->Name.c_str()), Refcon);
+    CFRelease(Element);
+    return true;
+}
+
+internal bool
+StubDeliverCarbonEvent(stub_notification *Notification)
+{
+    pthread_mutex_lock(&WorldLock);
+    EventHandlerUPP Handler = World.CarbonHandler;
+    void *Context = World.CarbonContext;
+    pthread_mutex_unlock(&WorldLock);
+
+    if(!Handler)
+        return false;
+
+    stub_carbon_event Event = { { 0, (UInt32) Notification->PID }, Notification->Kind };
+    (*Handler)(NULL, (EventRef) &Event, Context);
+    return true;
+}
+
+/* NOTE(koekeishiya): Delivers the notifications that were posted, and those that their handlers
+ * post in turn, and runs the dispatched functions whose time has come. Returns the number of
+ * notifications and functions that were delivered. */
+int StubRunLoop()
+{
+    int Result = 0;
+    while(true)
+    {
+        pthread_mutex_lock(&WorldLock);
+        std::vector<stub_notification> Notifications;
+        Notifications.swap(World.Notifications);
+
+        std::vector<stub_dispatch> Dispatches;
+        dispatch_time_t Now = dispatch_time(DISPATCH_TIME_NOW, 0);
+        for(std::size_t Index = 0; Index < World.Dispatches.size();)
+        {
+            if(World.Dispatches[Index].When <= Now)
+            {
+                Dispatches.push_back(World.Dispatches[Index]);
+                World.Dispatches.erase(World.Dispatches.begin() + Index);
+            }
+            else
+            {
+                ++Index;
+            }
+        }
+        pthread_mutex_unlock(&WorldLock);
+
+        if(Notifications.empty() && Dispatches.empty())
+            break;
+
+        for(std::size_t Index = 0; Index < Notifications.size(); ++Index)
+        {
+            stub_notification *Notification = &Notifications[Index];
+            switch(Notification->Type)
+            {
+                case StubNotification_Observer:
+                {
+                    StubDeliverObserverNotification(Notification);
+                } break;
+                case StubNotification_Carbon:
+                {
+                    StubDeliverCarbonEvent(Notification);
+                } break;
+                case StubNotification_Activated:
+                {
+                    SharedWorkspaceDidActivateApplication(Notification->PID);
+                } break;
+                case StubNotification_SpaceChanged:
+                {
+                    SharedWorkspaceDidChangeActiveSpace();
+                } break;
+            }
+
+            ++Result;
+        }
+
+        for(std::size_t Index = 0; Index < Dispatches.size(); ++Index)
+        {
+            (*Dispatches[Index].Function)(Dispatches[Index].Context);
+            ++Result;
+        }
+    }
+
+    return Result;
+}
+
+/* NOTE(koekeishiya): CoreFoundation */
+const CFBooleanRef kCFBooleanTrue = (CFBooleanRef) new stub_boolean(true);
+const CFBooleanRef kCFBooleanFalse = (CFBooleanRef) new stub_boolean(false);
+const CFStringRef kCFRunLoopDefaultMode = CFSTR("kCFRunLoopDefaultMode");
+const CFStringRef kCFRunLoopCommonModes = CFSTR("kCFRunLoopCommonModes");
+
+const CFStringRef kAXWindowCreatedNotification = CFSTR("AXWindowCreated");
+const CFStringRef kAXFocusedWindowChangedNotification = CFSTR("AXFocusedWindowChanged");
+const CFStringRef kAXWindowMovedNotification = CFSTR("AXWindowMoved");
+const CFStringRef kAXWindowResizedNotification = CFSTR("AXWindowResized");
+const CFStringRef kAXTitleChangedNotification = CFSTR("AXTitleChanged");
+const CFStringRef kAXUIElementDestroyedNotification = CFSTR("AXUIElementDestroyed");
+const CFStringRef kAXWindowMiniaturizedNotification = CFSTR("AXWindowMiniaturized");
+const CFStringRef kAXWindowDeminiaturizedNotification = CFSTR("AXWindowDeminiaturized");
+
+const CFStringRef kAXPositionAttribute = CFSTR("AXPosition");
+const CFStringRef kAXSizeAttribute = CFSTR("AXSize");
+const CFStringRef kAXTitleAttribute = CFSTR("AXTitle");
+const CFStringRef kAXRoleAttribute = CFSTR("AXRole");
+const CFStringRef kAXSubroleAttribute = CFSTR("AXSubrole");
+const CFStringRef kAXWindowsAttribute = CFSTR("AXWindows");
+const CFStringRef kAXFocusedWindowAttribute = CFSTR("AXFocusedWindow");
+const CFStringRef kAXFocusedApplicationAttribute = CFSTR("AXFocusedApplication");
+const CFStringRef kAXMainAttribute = CFSTR("AXMain");
+const CFStringRef kAXFocusedAttribute = CFSTR("AXFocused");
+const CFStringRef kAXMinimizedAttribute = CFSTR("AXMinimized");
+const CFStringRef kAXRaiseAction = CFSTR("AXRaise");
+const CFStringRef kAXWindowRole = CFSTR("AXWindow");
+const CFStringRef kAXStandardWindowSubrole = CFSTR("AXStandardWindow");
+
+CFStringRef __CFStringMakeConstantString(const char *String)
+{
+    static pthread_mutex_t ConstantLock = PTHREAD_MUTEX_INITIALIZER;
+    static std::map<std::string, stub_string *> *Constants = new std::map<std::string, stub_string *>();
+
+    pthread_mutex_lock(&ConstantLock);
+    stub_string *&Constant = (*Constants)[String];
+    if(!Constant)
+    {
+        Constant = new stub_string(String);
+        Constant->Immortal = true;
+    }
+    pthread_mutex_unlock(&ConstantLock);
+
+    return (CFStringRef) Constant;
+}
+
+CFTypeRef CFRetain(CFTypeRef Object)
+{
+    if(Object && !StubObject(Object)->Immortal)
+        __atomic_add_fetch(&StubObject(Object)->RefCount, 1, __ATOMIC_SEQ_CST);
+
+    return Object;
+}
+
+void CFRelease(CFTypeRef Object)
+{
+    if(Object && !StubObject(Object)->Immortal &&
+       __atomic_sub_fetch(&StubObject(Object)->RefCount, 1, __ATOMIC_SEQ_CST) == 0)
+        delete StubObject(Object);
+}
+
+Boolean CFEqual(CFTypeRef First, CFTypeRef Second)
+{
+    if(First == Second)
+        return true;
+
+    if(!First || !Second || StubObject(First)->Type != StubObject(Second)->Type)
+        return false;
+
+    switch(StubObject(First)->Type)
+    {
+        case StubObject_String:
+        {
+            return StubGetString((CFStringRef) First) == StubGetString((CFStringRef) Second);
+        } break;
+        case StubObject_Number:
+        {
+            return ((stub_number *) First)->Value == ((stub_number *) Second)->Value;
+        } break;
+        case StubObject_Element:
+        {
+            stub_element *A = (stub_element *) First;
+            stub_element *B = (stub_element *) Second;
+            return A->Kind == B->Kind && A->PID == B->PID && A->WindowID == B->WindowID;
+        } break;
+        default: {} break;
+    }
+
+    return false;
+}
+
+CFStringRef CFStringCreateWithCString(CFAllocatorRef Allocator, const char *String, CFStringEncoding Encoding)
+{
+    return String ? StubString(String) : NULL;
+}
+
+CFIndex CFStringGetLength(CFStringRef String)
+{
+    return (CFIndex) StubGetString(String).size();
+}
+
+CFIndex CFStringGetMaximumSizeForEncoding(CFIndex Length, CFStringEncoding Encoding)
+{
+    return Length * 3;
+}
+
+Boolean CFStringGetCString(CFStringRef String, char *Buffer, CFIndex BufferSize, CFStringEncoding Encoding)
+{
+    std::string Value = StubGetString(String);
+    if(!Buffer || (CFIndex) Value.size() >= BufferSize)
+        return false;
+
+    memcpy(Buffer, Value.c_str(), Value.size() + 1);
+    return true;
+}
+
+CFComparisonResult CFStringCompare(CFStringRef First, CFStringRef Second, CFStringCompareFlags Options)
+{
+    int Result = StubGetString(First).compare(StubGetString(Second));
+    return Result < 0 ? -1 : (Result > 0 ? 1 : kCFCompareEqualTo);
+}
+
+Boolean CFBooleanGetValue(CFBooleanRef Boolean)
+{
+    return StubIsType(Boolean, StubObject_Boolean) && ((stub_boolean *) Boolean)->Value;
+}
+
+CFIndex CFArrayGetCount(CFArrayRef Array)
+{
+    return StubIsType(Array, StubObject_Array) ? (CFIndex) ((stub_array *) Array)->Values.size() : 0;
+}
+
+const void *CFArrayGetValueAtIndex(CFArrayRef Array, CFIndex Index)
+{
+    return ((stub_array *) Array)->Values[Index];
+}
+
+const void *CFDictionaryGetValue(CFDictionaryRef Dictionary, const void *Key)
+{
+    stub_dictionary *Entries = (stub_dictionary *) Dictionary;
+    for(std::size_t Index = 0; Index < Entries->Keys.size(); ++Index)
+    {
+        if(CFEqual(Entries->Keys[Index], Key))
+            return Entries->Values[Index];
+    }
+
+    return NULL;
+}
+
+Boolean CFNumberGetValue(CFNumberRef Number, CFNumberType Type, void *Value)
+{
+    if(!StubIsType(Number, StubObject_Number))
+        return false;
+
+    double Result = ((stub_number *) Number)->Value;
+    switch(Type)
+    {
+        case kCFNumberSInt32Type: { *(int32_t *) Value = (int32_t) Result; } break;
+        case kCFNumberSInt64Type: { *(int64_t *) Value = (int64_t) Result; } break;
+        case kCFNumberDoubleType: { *(double *) Value = Result; } break;
+        default: { return false; } break;
+    }
+
+    return true;
+}
+
+/* NOTE(koekeishiya): There is one run loop, that of the thread calling StubRunLoop. The only
+ * sources are observers, a scheduled observer has its notifications delivered. */
+CFRunLoopRef CFRunLoopGetMain()
+{
+    static int MainRunLoop;
+    return (CFRunLoopRef) &MainRunLoop;
+}
+
+void CFRunLoopAddSource(CFRunLoopRef RunLoop, CFRunLoopSourceRef Source, CFStringRef Mode)
+{
+    pthread_mutex_lock(&WorldLock);
+    ((stub_observer *) Source)->Scheduled = true;
+    pthread_mutex_unlock(&WorldLock);
+}
+
+Boolean CFRunLoopContainsSource(CFRunLoopRef RunLoop, CFRunLoopSourceRef Source, CFStringRef Mode)
+{
+    pthread_mutex_lock(&WorldLock);
+    bool Result = ((stub_observer *) Source)->Scheduled;
+    pthread_mutex_unlock(&WorldLock);
+    return Result;
+}
+
+void CFRunLoopSourceInvalidate(CFRunLoopSourceRef Source)
+{
+    pthread_mutex_lock(&WorldLock);
+    ((stub_observer *) Source)->Scheduled = false;
+    pthread_mutex_unlock(&WorldLock);
+}
+
+/* NOTE(koekeishiya): CoreGraphics */
+CGPoint CGPointMake(CGFloat X, CGFloat Y)
+{
+    CGPoint Result = { X, Y };
+    return Result;
+}
+
+CGSize CGSizeMake(CGFloat Width, CGFloat Height)
+{
+    CGSize Result = { Width, Height };
+    return Result;
+}
+
+bool CGRectContainsPoint(CGRect Rect, CGPoint Point)
+{
+    return Point.x >= Rect.origin.x && Point.x < Rect.origin.x + Rect.size.width &&
+           Point.y >= Rect.origin.y && Point.y < Rect.origin.y + Rect.size.height;
+}
+
+CGRect CGRectIntersection(CGRect First, CGRect Second)
+{
+    CGFloat Left = std::max(First.origin.x, Second.origin.x);
+    CGFloat Top = std::max(First.origin.y, Second.origin.y);
+    CGFloat Right = std::min(First.origin.x + First.size.width, Second.origin.x + Second.size.width);
+    CGFloat Bottom = std::min(First.origin.y + First.size.height, Second.origin.y + Second.size.height);
+
+    CGRect Result = {};
+    if(Right > Left && Bottom > Top)
+    {
+        Result.origin = CGPointMake(Left, Top);
+        Result.size = CGSizeMake(Right - Left, Bottom - Top);
+    }
+
+    return Result;
+}
+
+bool CGRectMakeWithDictionaryRepresentation(CFDictionaryRef Dictionary, CGRect *Rect)
+{
+    return CFNumberGetValue((CFNumberRef) CFDictionaryGetValue(Dictionary, CFSTR("X")), kCFNumberDoubleType, &Rect->origin.x) &&
+           CFNumberGetValue((CFNumberRef) CFDictionaryGetValue(Dictionary, CFSTR("Y")), kCFNumberDoubleType, &Rect->origin.y) &&
+           CFNumberGetValue((CFNumberRef) CFDictionaryGetValue(Dictionary, CFSTR("Width")), kCFNumberDoubleType, &Rect->size.width) &&
+           CFNumberGetValue((CFNumberRef) CFDictionaryGetValue(Dictionary, CFSTR("Height")), kCFNumberDoubleType, &Rect->size.height);
+}
+
+CGEventRef CGEventCreate(CGEventSourceRef Source)
+{
+    pthread_mutex_lock(&WorldLock);
+    CGEventRef Result = (CGEventRef) new stub_event(World.Cursor);
+    pthread_mutex_unlock(&WorldLock);
+    return Result;
+}
+
+CGPoint CGEventGetLocation(CGEventRef Event)
+{
+    return ((stub_event *) Event)->Location;
+}
+
+CGEventFlags CGEventGetFlags(CGEventRef Event)
+{
+    return 0;
+}
+
+CGError CGWarpMouseCursorPosition(CGPoint Point)
+{
+    StubSetCursor(Point);
+    return kCGErrorSuccess;
+}
+
+/* NOTE(koekeishiya): Front to back, only the windows on the active space. */
+CFArrayRef CGWindowListCopyWindowInfo(CGWindowListOption Option, CGWindowID RelativeToWindow)
+{
+    stub_array *Result = new stub_array();
+
+    pthread_mutex_lock(&WorldLock);
+    for(std::size_t Index = 0; Index < World.Order.size(); ++Index)
+    {
+        stub_window *Window = StubFindWindow(World.Order[Index]);
+        if(Window->Space != World.Space)
+            continue;
+
+        stub_dictionary *Bounds = new stub_dictionary();
+        StubDictionarySet(Bounds, "X", StubNumber(Window->Frame.origin.x));
+        StubDictionarySet(Bounds, "Y", StubNumber(Window->Frame.origin.y));
+        StubDictionarySet(Bounds, "Width", StubNumber(Window->Frame.size.width));
+        StubDictionarySet(Bounds, "Height", StubNumber(Window->Frame.size.height));
+
+        stub_dictionary *Entry = new stub_dictionary();
+        StubDictionarySet(Entry, "kCGWindowNumber", StubNumber(Window->ID));
+        StubDictionarySet(Entry, "kCGWindowLayer", StubNumber(0));
+        StubDictionarySet(Entry, "kCGWindowBounds", Bounds);
+        StubDictionarySet(Entry, "kCGWindowOwnerName", StubString(World.Applications[Window->PID].Name));
+        StubDictionarySet(Entry, "kCGWindowName", StubString(Window->Title));
+        Result->Values.push_back(Entry);
+    }
+    pthread_mutex_unlock(&WorldLock);
+
+    return (CFArrayRef) Result;
+}
+
+/* NOTE(koekeishiya): Private CoreGraphics */
+typedef int CGSConnectionID;
+extern "C" CGSConnectionID _CGSDefaultConnection(void)
+{
+    return 1;
+}
+
+extern "C" CGError CGSGetOnScreenWindowCount(const CGSConnectionID CID, CGSConnectionID TID, int *Count)
+{
+    pthread_mutex_lock(&WorldLock);
+    *Count = 0;
+    std::map<uint32_t, stub_window>::iterator It;
+    for(It = World.Windows.begin(); It != World.Windows.end(); ++It)
+    {
+        if(It->second.Space == World.Space)
+            ++*Count;
+    }
+    pthread_mutex_unlock(&WorldLock);
+    return kCGErrorSuccess;
+}
+
+extern "C" CGError CGSGetOnScreenWindowList(const CGSConnectionID CID, CGSConnectionID TID, int Count, int *List, int *OutCount)
+{
+    pthread_mutex_lock(&WorldLock);
+    *OutCount = 0;
+    for(std::size_t Index = 0; Index < World.Order.size() && *OutCount < Count; ++Index)
+    {
+        stub_window *Window = StubFindWindow(World.Order[Index]);
+        if(Window->Space == World.Space)
+            List[(*OutCount)++] = (int) Window->ID;
+    }
+    pthread_mutex_unlock(&WorldLock);
+    return kCGErrorSuccess;
+}
+
+/* NOTE(koekeishiya): Accessibility */
+AXUIElementRef AXUIElementCreateSystemWide()
+{
+    return StubElement(StubElement_SystemWide, 0, 0);
+}
+
+AXUIElementRef AXUIElementCreateApplication(pid_t PID)
+{
+    return StubElement(StubElement_Application, PID, 0);
+}
+
+AXError AXUIElementGetPid(AXUIElementRef Element, pid_t *PID)
+{
+    stub_element *Entry = StubGetElement(Element);
+    if(!Entry)
+        return kAXErrorIllegalArgument;
+
+    *PID = Entry->PID;
+    return kAXErrorSuccess;
+}
+
+extern "C" AXError _AXUIElementGetWindow(AXUIElementRef Element, uint32_t *WindowID)
+{
+    stub_element *Entry = StubGetElement(Element);
+    if(!Entry || Entry->Kind != StubElement_Window)
+        return kAXErrorIllegalArgument;
+
+    *WindowID = Entry->WindowID;
+    return kAXErrorSuccess;
+}
+
+AXError AXUIElementSetMessagingTimeout(AXUIElementRef Element, float Timeout)
+{
+    return kAXErrorSuccess;
+}
+
+internal AXError
+StubCopyApplicationAttribute(stub_application *Application, std::string Attribute, CFTypeRef *Value)
+{
+    if(Attribute == StubGetString(kAXWindowsAttribute))
+    {
+        stub_array *Windows = new stub_array();
+        std::map<uint32_t, stub_window>::iterator It;
+        for(It = World.Windows.begin(); It != World.Windows.end(); ++It)
+        {
+            if(It->second.PID == Application->PID)
+                Windows->Values.push_back(StubElement(StubElement_Window, Application->PID, It->first));
+        }
+
+        *Value = Windows;
+        return kAXErrorSuccess;
+    }
+
+    if(Attribute == StubGetString(kAXFocusedWindowAttribute))
+    {
+        if(!Application->Focus)
+            return kAXErrorNoValue;
+
+        *Value = StubElement(StubElement_Window, Application->PID, Application->Focus);
+        return kAXErrorSuccess;
+    }
+
+    return kAXErrorAttributeUnsupported;
+}
+
+internal AXError
+StubCopyWindowAttribute(stub_window *Window, std::string Attribute, CFTypeRef *Value)
+{
+    if(Attribute == StubGetString(kAXPositionAttribute))
+        *Value = AXValueCreate(kAXValueTypeCGPoint, &Window->Frame.origin);
+    else if(Attribute == StubGetString(kAXSizeAttribute))
+        *Value = AXValueCreate(kAXValueTypeCGSize, &Window->Frame.size);
+    else if(Attribute == StubGetString(kAXTitleAttribute))
+        *Value = StubString(Window->Title);
+    else if(Attribute == StubGetString(kAXRoleAttribute))
+        *Value = kAXWindowRole;
+    else if(Attribute == StubGetString(kAXSubroleAttribute))
+        *Value = kAXStandardWindowSubrole;
+    else if(Attribute == StubGetString(kAXMinimizedAttribute) || Attribute == "AXFullScreen")
+        *Value = kCFBooleanFalse;
+    else
+        return kAXErrorAttributeUnsupported;
+
+    return kAXErrorSuccess;
+}
+
+AXError AXUIElementCopyAttributeValue(AXUIElementRef Element, CFStringRef Attribute, CFTypeRef *Value)
+{
+    *Value = NULL;
+    stub_element *Entry = StubGetElement(Element);
+    if(!Entry)
+        return kAXErrorIllegalArgument;
+
+    pthread_mutex_lock(&WorldLock);
+    AXError Result = kAXErrorInvalidUIElement;
+    std::string Name = StubGetString(Attribute);
+    switch(Entry->Kind)
+    {
+        case StubElement_SystemWide:
+        {
+            Result = kAXErrorAttributeUnsupported;
+            if(Name == StubGetString(kAXFocusedApplicationAttribute))
+            {
+                Result = World.Active ? kAXErrorSuccess : kAXErrorNoValue;
+                if(World.Active)
+                    *Value = StubElement(StubElement_Application, World.Active, 0);
+            }
+        } break;
+        case StubElement_Application:
+        {
+            stub_application *Application = StubFindApplication(Entry->PID);
+            if(Application)
+                Result = StubCopyApplicationAttribute(Application, Name, Value);
+        } break;
+        case StubElement_Window:
+        {
+            stub_window *Window = StubFindWindow(Entry->WindowID);
+            if(Window)
+                Result = StubCopyWindowAttribute(Window, Name, Value);
+        } break;
+    }
+    pthread_mutex_unlock(&WorldLock);
+
+    return Result;
+}
+
+/* NOTE(koekeishiya): Only window attributes can be written. Main and focused make the window the
+ * focused window of its application, but like on macOS do not activate the application. */
+AXError AXUIElementSetAttributeValue(AXUIElementRef Element, CFStringRef Attribute, CFTypeRef Value)
+{
+    stub_element *Entry = StubGetElement(Element);
+    if(!Entry || Entry->Kind != StubElement_Window)
+        return kAXErrorIllegalArgument;
+
+    pthread_mutex_lock(&WorldLock);
+    AXError Result = kAXErrorSuccess;
+    std::string Name = StubGetString(Attribute);
+    stub_window *Window = StubFindWindow(Entry->WindowID);
+    if(!Window)
+    {
+        Result = kAXErrorInvalidUIElement;
+    }
+    else if(Name == StubGetString(kAXPositionAttribute))
+    {
+        CGPoint Position;
+        AXValueGetValue((AXValueRef) Value, kAXValueTypeCGPoint, &Position);
+        if(Position.x != Window->Frame.origin.x || Position.y != Window->Frame.origin.y)
+        {
+            Window->Frame.origin = Position;
+            StubPostWindowNotification(Window, kAXWindowMovedNotification);
+        }
+    }
+    else if(Name == StubGetString(kAXSizeAttribute))
+    {
+        CGSize Size;
+        AXValueGetValue((AXValueRef) Value, kAXValueTypeCGSize, &Size);
+        if(Size.width != Window->Frame.size.width || Size.height != Window->Frame.size.height)
+        {
+            Window->Frame.size = Size;
+            StubPostWindowNotification(Window, kAXWindowResizedNotification);
+        }
+    }
+    else if(Name == StubGetString(kAXMainAttribute) || Name == StubGetString(kAXFocusedAttribute))
+    {
+        if(CFBooleanGetValue((CFBooleanRef) Value))
+            StubSetApplicationFocus(StubFindApplication(Window->PID), Window->ID);
+    }
+    else
+    {
+        Result = kAXErrorAttributeUnsupported;
+    }
+    pthread_mutex_unlock(&WorldLock);
+
+    return Result;
+}
+
+AXError AXUIElementIsAttributeSettable(AXUIElementRef Element, CFStringRef Attribute, Boolean *Settable)
+{
+    stub_element *Entry = StubGetElement(Element);
+    if(!Entry || Entry->Kind != StubElement_Window)
+        return kAXErrorIllegalArgument;
+
+    *Settable = CFEqual(Attribute, kAXPositionAttribute) || CFEqual(Attribute, kAXSizeAttribute);
+    return kAXErrorSuccess;
+}
+
+AXError AXUIElementPerformAction(AXUIElementRef Element, CFStringRef Action)
+{
+    stub_element *Entry = StubGetElement(Element);
+    if(!Entry || Entry->Kind != StubElement_Window || !CFEqual(Action, kAXRaiseAction))
+        return kAXErrorIllegalArgument;
+
+    pthread_mutex_lock(&WorldLock);
+    bool Exists = StubFindWindow(Entry->WindowID) != NULL;
+    if(Exists)
+        StubRaiseWindow(Entry->WindowID);
+    pthread_mutex_unlock(&WorldLock);
+
+    return Exists ? kAXErrorSuccess : kAXErrorInvalidUIElement;
+}
+
+AXValueRef AXValueCreate(AXValueType Type, const void *Value)
+{
+    stub_value *Result = new stub_value(Type);
+    if(Type == kAXValueTypeCGPoint)
+        Result->Point = *(const CGPoint *) Value;
+    else if(Type == kAXValueTypeCGSize)
+        Result->Size = *(const CGSize *) Value;
+
+    return (AXValueRef) Result;
+}
+
+Boolean AXValueGetValue(AXValueRef Value, AXValueType Type, void *Result)
+{
+    stub_value *Entry = (stub_value *) Value;
+    if(!StubIsType(Value, StubObject_Value) || Entry->ValueType != Type)
+        return false;
+
+    if(Type == kAXValueTypeCGPoint)
+        *(CGPoint *) Result = Entry->Point;
+    else
+        *(CGSize *) Result = Entry->Size;
+
+    return true;
+}
+
+AXError AXObserverCreate(pid_t PID, AXObserverCallback Callback, AXObserverRef *Observer)
+{
+    pthread_mutex_lock(&WorldLock);
+    AXError Result = StubFindApplication(PID) ? kAXErrorSuccess : kAXErrorCannotComplete;
+    if(Result == kAXErrorSuccess)
+    {
+        stub_observer *Entry = new stub_observer(PID, Callback);
+        World.Observers.push_back(Entry);
+        *Observer = (AXObserverRef) Entry;
+    }
+    pthread_mutex_unlock(&WorldLock);
+
+    return Result;
+}
+
+AXError AXObserverAddNotification(AXObserverRef Observer, AXUIElementRef Element, CFStringRef Notification, void *Refcon)
+{
+    stub_element *Entry = StubGetElement(Element);
+    if(!Observer || !Entry || Entry->Kind == StubElement_SystemWide)
+        return kAXErrorIllegalArgument;
+
+    pthread_mutex_lock(&WorldLock);
+    AXError Result = kAXErrorSuccess;
+    if((Entry->Kind == StubElement_Application && !StubFindApplication(Entry->PID)) ||
+       (Entry->Kind == StubElement_Window && !StubFindWindow(Entry->WindowID)))
+    {
+        Result = kAXErrorInvalidUIElement;
+    }
+    else
+    {
+        AXObserverRemoveNotification(Observer, Element, Notification);
+        stub_registration Registration = { Entry->Kind, Entry->WindowID, StubGetString(Notification), Refcon };
+        ((stub_observer *) Observer)->Registrations.push_back(Registration);
+    }
+    pthread_mutex_unlock(&WorldLock);
+
+    return Result;
+}
+
+AXError AXObserverRemoveNotification(AXObserverRef Observer, AXUIElementRef Element, CFStringRef Notification)
+{
+    stub_element *Entry = StubGetElement(Element);
+    if(!Observer || !Entry)
+        return kAXErrorIllegalArgument;
+
+    pthread_mutex_lock(&WorldLock);
+    std::vector<stub_registration> *Registrations = &((stub_observer *) Observer)->Registrations;
+    for(std::size_t Index = 0; Index < Registrations->size(); ++Index)
+    {
+        stub_registration *Registration = &(*Registrations)[Index];
+        if(Registration->Kind == Entry->Kind && Registration->WindowID == Entry->WindowID &&
+           Registration->Notification == StubGetString(Notification))
+        {
+            Registrations->erase(Registrations->begin() + Index);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&WorldLock);
+
+    return kAXErrorSuccess;
+}
+
+CFRunLoopSourceRef AXObserverGetRunLoopSource(AXObserverRef Observer)
+{
+    return (CFRunLoopSourceRef) Observer;
+}
+
+/* NOTE(koekeishiya): Carbon. The serial number of a process is 0 and its pid. */
+OSErr GetProcessForPID(pid_t PID, ProcessSerialNumber *PSN)
+{
+    PSN->highLongOfPSN = 0;
+    PSN->lowLongOfPSN = (UInt32) PID;
+    return noErr;
+}
+
+OSErr GetProcessInformation(const ProcessSerialNumber *PSN, ProcessInfoRec *Info)
+{
+    pthread_mutex_lock(&WorldLock);
+    stub_application *Application = StubFindApplication((pid_t) PSN->lowLongOfPSN);
+    std::string Name = Application ? Application->Name : "";
+    pthread_mutex_unlock(&WorldLock);
+
+    if(Info->processName)
+    {
+        Info->processName[0] = (unsigned char) std::min<std::size_t>(Name.size(), 255);
+        memcpy(Info->processName + 1, Name.c_str(), Info->processName[0]);
+    }
+
+    Info->processNumber = *PSN;
+    Info->processMode = 0;
+    return Application ? noErr : -600;
+}
+
+OSStatus GetProcessPID(const ProcessSerialNumber *PSN, pid_t *PID)
+{
+    *PID = (pid_t) PSN->lowLongOfPSN;
+    return noErr;
+}
+
+OSErr SetFrontProcessWithOptions(const ProcessSerialNumber *PSN, OptionBits Options)
+{
+    StubActivateApplication((pid_t) PSN->lowLongOfPSN);
+    return noErr;
+}
+
+EventHandlerUPP NewEventHandlerUPP(EventHandlerProcPtr Handler)
+{
+    return Handler;
+}
+
+EventTargetRef GetApplicationEventTarget()
+{
+    static int ApplicationEventTarget;
+    return (EventTargetRef) &ApplicationEventTarget;
+}
+
+OSStatus InstallEventHandler(EventTargetRef Target, EventHandlerUPP Handler, ItemCount Count,
+                             const EventTypeSpec *Types, void *UserData, EventHandlerRef *Result)
+{
+    pthread_mutex_lock(&WorldLock);
+    World.CarbonHandler = Handler;
+    World.CarbonContext = UserData;
+    pthread_mutex_unlock(&WorldLock);
+    return noErr;
+}
+
+OSStatus GetEventParameter(EventRef Event, EventParamName Name, EventParamType DesiredType, EventParamType *ActualType,
+                           ByteCount BufferSize, ByteCount *ActualSize, void *Data)
+{
+    if(Name != kEventParamProcessID || BufferSize < sizeof(ProcessSerialNumber))
+        return -9870;
+
+    memcpy(Data, &((stub_carbon_event *) Event)->PSN, sizeof(ProcessSerialNumber));
+    return noErr;
+}
+
+UInt32 GetEventKind(EventRef Event)
+{
+    return ((stub_carbon_event *) Event)->Kind;
+}
+
+/* NOTE(koekeishiya): Dispatch, see dispatch/dispatch.h. */
+void dispatch_once_f(dispatch_once_t *Predicate, void *Context, dispatch_function_t Function)
+{
+    static pthread_mutex_t OnceLock = PTHREAD_MUTEX_INITIALIZER;
+    pthread_mutex_lock(&OnceLock);
+    if(!*Predicate)
+    {
+        (*Function)(Context);
+        *Predicate = ~0l;
+    }
+    pthread_mutex_unlock(&OnceLock);
+}
+
+dispatch_time_t dispatch_time(dispatch_time_t When, int64_t Delta)
+{
+    return (When == DISPATCH_TIME_NOW ? mach_absolute_time() : When) + Delta;
+}
+
+dispatch_queue_t dispatch_get_main_queue()
+{
+    static int MainQueue;
+    return (dispatch_queue_t) &MainQueue;
+}
+
+void dispatch_after_f(dispatch_time_t When, dispatch_queue_t Queue, void *Context, dispatch_function_t Function)
+{
+    pthread_mutex_lock(&WorldLock);
+    stub_dispatch Dispatch = { When, Context, Function };
+    World.Dispatches.push_back(Dispatch);
+    pthread_mutex_unlock(&WorldLock);
+}
+
+uint64_t mach_absolute_time()
+{
+    struct timespec Now;
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+    return (uint64_t) Now.tv_sec * NSEC_PER_SEC + (uint64_t) Now.tv_nsec;
+}
+
+kern_return_t mach_timebase_info(mach_timebase_info_data_t *Info)
+{
+    Info->numer = 1;
+    Info->denom = 1;
+    return 0;
+}
+
+/* NOTE(koekeishiya): Objective-C, see objc/runtime.h. */
+Class objc_getClass(const char *Name)
+{
+    return NULL;
+}
+
+SEL sel_getUid(const char *Name)
+{
+    return NULL;
+}
+
+/* NOTE(koekeishiya): objc/message.h declares it without a signature, callers cast it to the one
+ * of the message they send. This file does not see that declaration. */
+extern "C" uintptr_t objc_msgSend()
+{
+    return 0;
+}
+
+int proc_pidpath(int PID, void *Buffer, uint32_t BufferSize)
+{
+    return 0;
+}
@@ -0,0 +1,41 @@
+#ifndef STUB_WINDOWSYSTEM_H
+#define STUB_WINDOWSYSTEM_H
+
+#include <Carbon/Carbon.h>
+#include <string>
+#include <map>
+
+/* NOTE(koekeishiya): A window system for AXLib to run against on Linux. It knows about a set of
+ * applications, their windows and two spaces on a single display. Changes made through the
+ * functions below, and writes that AXLib makes through the AX API, are applied right away and
+ * queue the notifications that macOS would send for them. StubRunLoop delivers those on the
+ * calling thread, the way the main run loop of kwm delivers them on macOS. */
+
+#define STUB_DISPLAY_ID 1
+#define STUB_DISPLAY_WIDTH 1440
+#define STUB_DISPLAY_HEIGHT 900
+#define STUB_SPACE_COUNT 2
+
+void StubAddApplication(pid_t PID, std::string Name);
+void StubLaunchApplication(pid_t PID, std::string Name);
+uint32_t StubCreateWindow(pid_t PID, std::string Title, CGRect Frame);
+void StubDestroyWindow(uint32_t WindowID);
+void StubFocusWindow(uint32_t WindowID);
+bool StubGetWindowFrame(uint32_t WindowID, CGRect *Frame);
+void StubSetCursor(CGPoint Cursor);
+void StubSetActiveSpace(int SpaceID);
+int StubRunLoop();
+
+/* NOTE(koekeishiya): Used by the stub display and workspace, tests/stub/display.cpp and
+ * tests/stub/sharedworkspace.cpp. */
+int StubGetActiveSpace();
+int StubGetWindowSpace(uint32_t WindowID);
+void StubSetWindowSpace(uint32_t WindowID, int SpaceID);
+std::map<pid_t, std::string> StubGetApplications();
+pid_t StubGetActiveApplication();
+void StubActivateApplication(pid_t PID);
+
+void SharedWorkspaceDidActivateApplication(pid_t PID);
+void SharedWorkspaceDidChangeActiveSpace();
+
+#endif